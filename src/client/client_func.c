@@ -148,7 +148,17 @@ static int fdir_client_do_init_ex(FDIRClientContext *client_ctx,
         client_ctx->network_timeout = DEFAULT_NETWORK_TIMEOUT;
     }
 
+    client_ctx->list_stream_window = iniGetIntValueEx(
+            ini_ctx->section_name, "list_stream_window", ini_ctx->context,
+            FDIR_CLIENT_DEFAULT_LIST_STREAM_WINDOW, true);
+    if (client_ctx->list_stream_window < 0) {
+        client_ctx->list_stream_window = 0;
+    }
+
     sf_load_read_rule_config(&client_ctx->read_rule, ini_ctx);
+    client_ctx->read_your_writes.enabled = iniGetBoolValueEx(
+            ini_ctx->section_name, "read_your_writes",
+            ini_ctx->context, false, true);
 
     if ((result=fdir_load_server_group_ex(&client_ctx->
                     server_group, ini_ctx)) != 0)
@@ -176,15 +186,17 @@ void fdir_client_log_config_ex(FDIRClientContext *client_ctx,
             "base_path=%s, "
             "connect_timeout=%d, "
             "network_timeout=%d, "
-            "read_rule: %s, %s, "
+            "list_stream_window=%d, "
+            "read_rule: %s, read_your_writes=%d, %s, "
             "dir_server_count=%d%s%s",
             g_fdir_global_vars.version.major,
             g_fdir_global_vars.version.minor,
             g_fdir_client_vars.base_path,
             client_ctx->connect_timeout,
             client_ctx->network_timeout,
+            client_ctx->list_stream_window,
             sf_get_read_rule_caption(client_ctx->read_rule),
-            net_retry_output, client_ctx->server_group.count,
+            client_ctx->read_your_writes.enabled, net_retry_output, client_ctx->server_group.count,
             extra_config != NULL ? ", " : "",
             extra_config != NULL ? extra_config : "");
 }
@@ -220,6 +232,7 @@ static inline void fdir_client_common_init(FDIRClientContext *client_ctx,
 {
     client_ctx->conn_manager_type = conn_manager_type;
     client_ctx->cloned = false;
+    client_ctx->read_your_writes.data_version = 0;
     srand(time(NULL));
 }
 
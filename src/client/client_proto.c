@@ -131,6 +131,10 @@ int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
                 req->idempotency.key);
     } else {
         flags = 0;
+        memset(&req->idempotency, 0, sizeof(req->idempotency));
+    }
+    if (client_ctx->read_your_writes.enabled) {
+        flags |= FDIR_CLIENT_JOIN_FLAGS_UPDATE_DATA_VERSION;
     }
     int2buff(flags, req->flags);
 
@@ -157,21 +161,57 @@ static inline void proto_unpack_dentry(FDIRProtoStatDEntryResp *proto_stat,
     fdir_proto_unpack_dentry_stat(&proto_stat->stat, &dentry->stat);
 }
 
+//keep the max data version of the updates for read-your-writes
+static inline void update_data_version(FDIRClientContext *client_ctx,
+        const FDIRProtoUpdateRespTrailer *trailer)
+{
+    int64_t data_version;
+    int64_t old_version;
+
+    data_version = buff2long(trailer->data_version);
+    do {
+        old_version = __sync_add_and_fetch(&client_ctx->
+                read_your_writes.data_version, 0);
+        if (data_version <= old_version) {
+            break;
+        }
+    } while (!__sync_bool_compare_and_swap(&client_ctx->
+                read_your_writes.data_version, old_version, data_version));
+}
+
+/* the old servers and the connections joined without
+ * FDIR_CLIENT_JOIN_FLAGS_UPDATE_DATA_VERSION respond without the trailer
+ */
+static inline void check_update_data_version(FDIRClientContext *client_ctx,
+        const char *in_buff, const int body_len, const int base_len)
+{
+    if (body_len == base_len + (int)sizeof(FDIRProtoUpdateRespTrailer)) {
+        update_data_version(client_ctx, (const FDIRProtoUpdateRespTrailer *)
+                (in_buff + base_len));
+    }
+}
+
 static inline int do_update_dentry(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, char *out_buff, const int out_bytes,
         const int expect_cmd, FDIRDEntryInfo *dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
+    char in_buff[sizeof(FDIRProtoStatDEntryResp) +
+        sizeof(FDIRProtoUpdateRespTrailer)];
+    int expect_body_lens[2];
+    int body_len;
     int result;
 
+    expect_body_lens[0] = sizeof(FDIRProtoStatDEntryResp);
+    expect_body_lens[1] = sizeof(in_buff);
     response.error.length = 0;
-    if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
-                    &response, client_ctx->network_timeout,
-                    expect_cmd, (char *)&proto_stat,
-                    sizeof(proto_stat))) == 0)
+    if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
+                    &response, client_ctx->network_timeout, expect_cmd,
+                    in_buff, expect_body_lens, 2, &body_len)) == 0)
     {
-        proto_unpack_dentry(&proto_stat, dentry);
+        proto_unpack_dentry((FDIRProtoStatDEntryResp *)in_buff, dentry);
+        check_update_data_version(client_ctx, in_buff, body_len,
+                sizeof(FDIRProtoStatDEntryResp));
     } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -367,23 +407,31 @@ static int do_rename_dentry(FDIRClientContext *client_ctx,
         const int expect_cmd, FDIRDEntryInfo **dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
-    int expect_body_lens[2];
+    char in_buff[sizeof(FDIRProtoStatDEntryResp) +
+        sizeof(FDIRProtoUpdateRespTrailer)];
+    int expect_body_lens[4];
     int body_len;
+    int base_len;
     int result;
 
+    //the dentry is optional, so is the trailer
     expect_body_lens[0] = 0;
-    expect_body_lens[1] = sizeof(proto_stat);
+    expect_body_lens[1] = sizeof(FDIRProtoUpdateRespTrailer);
+    expect_body_lens[2] = sizeof(FDIRProtoStatDEntryResp);
+    expect_body_lens[3] = sizeof(in_buff);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout, expect_cmd,
-                    (char *)&proto_stat, expect_body_lens, 2, &body_len)) == 0)
+                    in_buff, expect_body_lens, 4, &body_len)) == 0)
     {
-        if (body_len == (int)sizeof(proto_stat)) {
-            proto_unpack_dentry(&proto_stat, *dentry);
+        if (body_len >= (int)sizeof(FDIRProtoStatDEntryResp)) {
+            proto_unpack_dentry((FDIRProtoStatDEntryResp *)in_buff, *dentry);
+            base_len = sizeof(FDIRProtoStatDEntryResp);
         } else {
             *dentry = NULL;
+            base_len = 0;
         }
+        check_update_data_version(client_ctx, in_buff, body_len, base_len);
     } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -617,6 +665,27 @@ int fdir_client_proto_stat_dentry_by_path(FDIRClientContext *client_ctx,
     return result;
 }
 
+int fdir_client_proto_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const FDIRDEntryFullName *fullname,
+        FDIRDEntryUsage *usage)
+{
+    FDIRProtoDEntryUsageResp proto_usage;
+    int result;
+
+    if ((result=query_by_dentry_fullname(client_ctx, conn, fullname,
+                    FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_REQ,
+                    FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_RESP,
+                    (char *)&proto_usage, sizeof(proto_usage),
+                    LOG_ERR)) == 0)
+    {
+        usage->file_count = buff2long(proto_usage.file_count);
+        usage->dir_count = buff2long(proto_usage.dir_count);
+        usage->bytes = buff2long(proto_usage.bytes);
+    }
+
+    return result;
+}
+
 static int do_readlink(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, char *out_buff, const int out_bytes,
         const int expect_cmd, string_t *link, const int size)
@@ -916,6 +985,9 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
         FDIR_BATCH_SET_MAX_DENTRY_COUNT *
         sizeof(FDIRProtoBatchSetDentrySizeReqBody)];
     SFResponseInfo response;
+    char in_buff[sizeof(FDIRProtoUpdateRespTrailer)];
+    int expect_body_lens[2];
+    int body_len;
     int out_bytes;
     int result;
 
@@ -946,11 +1018,16 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
     out_bytes = (char *)rbody - out_buff;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
+    expect_body_lens[0] = 0;
+    expect_body_lens[1] = sizeof(in_buff);
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff,
-                    out_bytes, &response, client_ctx->network_timeout,
-                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP)) != 0)
+    if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
+                    &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP,
+                    in_buff, expect_body_lens, 2, &body_len)) == 0)
     {
+        check_update_data_version(client_ctx, in_buff, body_len, 0);
+    } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
 
@@ -990,6 +1067,439 @@ int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP, dentry);
 }
 
+#define FDIR_CLIENT_BATCH_RESERVED_SIZE  (sizeof(FDIRProtoHeader) + \
+        sizeof(SFProtoIdempotencyAdditionalHeader) + \
+        sizeof(FDIRProtoCompoundReqHeader))
+
+int fdir_client_batch_init(FDIRClientBatch *batch)
+{
+    batch->count = 0;
+    batch->no_output = false;
+    batch->results = NULL;
+    batch->request.alloc = 0;
+    batch->request.length = FDIR_CLIENT_BATCH_RESERVED_SIZE;
+    batch->request.buff = NULL;
+    return 0;
+}
+
+void fdir_client_batch_reset(FDIRClientBatch *batch)
+{
+    batch->count = 0;
+    batch->no_output = false;
+    batch->request.length = FDIR_CLIENT_BATCH_RESERVED_SIZE;
+}
+
+void fdir_client_batch_free(FDIRClientBatch *batch)
+{
+    if (batch->results != NULL) {
+        free(batch->results);
+        batch->results = NULL;
+    }
+
+    if (batch->request.buff != NULL) {
+        free(batch->request.buff);
+        batch->request.buff = NULL;
+        batch->request.alloc = 0;
+    }
+    fdir_client_batch_reset(batch);
+}
+
+//return the body buffer of the new operation
+static char *client_batch_op_begin(FDIRClientBatch *batch,
+        const int max_body_len, int *result)
+{
+    char *buff;
+    int expect;
+    int alloc;
+
+    if (batch->count >= FDIR_COMPOUND_MAX_OP_COUNT) {
+        logError("file: "__FILE__", line: %d, "
+                "too many operations, exceeds %d", __LINE__,
+                FDIR_COMPOUND_MAX_OP_COUNT);
+        *result = EOVERFLOW;
+        return NULL;
+    }
+
+    expect = batch->request.length + sizeof(FDIRProtoCompoundOpHeader) +
+        max_body_len;
+    if (expect > batch->request.alloc) {
+        alloc = (batch->request.alloc > 0) ? batch->request.alloc : 4096;
+        while (alloc < expect) {
+            alloc *= 2;
+        }
+        if ((buff=(char *)fc_malloc(alloc)) == NULL) {
+            *result = ENOMEM;
+            return NULL;
+        }
+
+        if (batch->request.buff != NULL) {
+            memcpy(buff, batch->request.buff, batch->request.length);
+            free(batch->request.buff);
+        }
+        batch->request.buff = buff;
+        batch->request.alloc = alloc;
+    }
+
+    *result = 0;
+    return batch->request.buff + batch->request.length +
+        sizeof(FDIRProtoCompoundOpHeader);
+}
+
+static inline void client_batch_op_end(FDIRClientBatch *batch,
+        const int cmd, const int body_len)
+{
+    FDIRProtoCompoundOpHeader *oheader;
+
+    oheader = (FDIRProtoCompoundOpHeader *)(batch->request.buff +
+            batch->request.length);
+    int2buff(body_len, oheader->body_len);
+    oheader->cmd = cmd;
+    memset(oheader->padding, 0, sizeof(oheader->padding));
+    batch->request.length += sizeof(FDIRProtoCompoundOpHeader) + body_len;
+    batch->count++;
+}
+
+static int client_batch_add_dentry(FDIRClientBatch *batch,
+        const int cmd, const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp)
+{
+    FDIRProtoCreateDEntryFront *front;
+    char *body;
+    int front_size;
+    int result;
+
+    front_size = (omp != NULL) ? sizeof(FDIRProtoCreateDEntryFront) : 0;
+    if ((body=client_batch_op_begin(batch, front_size + sizeof(
+                        FDIRProtoDEntryInfo) + NAME_MAX + PATH_MAX,
+                    &result)) == NULL)
+    {
+        return result;
+    }
+
+    if ((result=client_check_set_proto_dentry(fullname,
+                    (FDIRProtoDEntryInfo *)(body + front_size))) != 0)
+    {
+        return result;
+    }
+
+    if (omp != NULL) {
+        front = (FDIRProtoCreateDEntryFront *)body;
+        CLIENT_PROTO_SET_OMP(omp, (*front));
+    }
+    client_batch_op_end(batch, cmd, front_size + sizeof(FDIRProtoDEntryInfo)
+            + fullname->ns.len + fullname->path.len);
+    return 0;
+}
+
+static int client_batch_add_pname(FDIRClientBatch *batch,
+        const int cmd, const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp)
+{
+    FDIRProtoCreateDEntryFront *front;
+    char *body;
+    int front_size;
+    int result;
+
+    front_size = (omp != NULL) ? sizeof(FDIRProtoCreateDEntryFront) : 0;
+    if ((body=client_batch_op_begin(batch, front_size + sizeof(
+                        FDIRProtoDEntryByPName) + 2 * NAME_MAX,
+                    &result)) == NULL)
+    {
+        return result;
+    }
+
+    if ((result=client_check_set_proto_pname(ns, pname,
+                    (FDIRProtoDEntryByPName *)(body + front_size))) != 0)
+    {
+        return result;
+    }
+
+    if (omp != NULL) {
+        front = (FDIRProtoCreateDEntryFront *)body;
+        CLIENT_PROTO_SET_OMP(omp, (*front));
+    }
+    client_batch_op_end(batch, cmd, front_size + sizeof(
+                FDIRProtoDEntryByPName) + ns->len + pname->name.len);
+    return 0;
+}
+
+int fdir_client_batch_add_create(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp)
+{
+    return client_batch_add_dentry(batch,
+            FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ, fullname, omp);
+}
+
+int fdir_client_batch_add_create_by_pname(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp)
+{
+    return client_batch_add_pname(batch,
+            FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ, ns, pname, omp);
+}
+
+int fdir_client_batch_add_remove(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname)
+{
+    return client_batch_add_dentry(batch,
+            FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ, fullname, NULL);
+}
+
+int fdir_client_batch_add_remove_by_pname(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRDEntryPName *pname)
+{
+    return client_batch_add_pname(batch,
+            FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ, ns, pname, NULL);
+}
+
+int fdir_client_batch_add_stat(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname)
+{
+    return client_batch_add_dentry(batch,
+            FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ, fullname, NULL);
+}
+
+int fdir_client_batch_add_stat_by_inode(FDIRClientBatch *batch,
+        const int64_t inode)
+{
+    char *body;
+    int result;
+
+    if ((body=client_batch_op_begin(batch, 8, &result)) == NULL) {
+        return result;
+    }
+
+    long2buff(inode, body);
+    client_batch_op_end(batch, FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ, 8);
+    return 0;
+}
+
+int fdir_client_batch_add_stat_by_pname(FDIRClientBatch *batch,
+        const FDIRDEntryPName *pname)
+{
+    FDIRProtoStatDEntryByPNameReq *req;
+    int result;
+
+    if (pname->name.len <= 0 || pname->name.len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid path length: %d, which <= 0 or > %d",
+                __LINE__, pname->name.len, NAME_MAX);
+        return EINVAL;
+    }
+
+    if ((req=(FDIRProtoStatDEntryByPNameReq *)client_batch_op_begin(batch,
+                    sizeof(FDIRProtoStatDEntryByPNameReq) + NAME_MAX,
+                    &result)) == NULL)
+    {
+        return result;
+    }
+
+    long2buff(pname->parent_inode, req->parent_inode);
+    req->name_len = pname->name.len;
+    memcpy(req->name_str, pname->name.str, pname->name.len);
+    client_batch_op_end(batch, FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ,
+            sizeof(FDIRProtoStatDEntryByPNameReq) + pname->name.len);
+    return 0;
+}
+
+int fdir_client_batch_add_set_dentry_size(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize)
+{
+    FDIRProtoSetDentrySizeReq *req;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+
+    if ((req=(FDIRProtoSetDentrySizeReq *)client_batch_op_begin(batch,
+                    sizeof(FDIRProtoSetDentrySizeReq) + NAME_MAX,
+                    &result)) == NULL)
+    {
+        return result;
+    }
+
+    FDIR_CLIENT_PROTO_PACK_DENTRY_SIZE(dsize, req);
+    req->ns_len = ns->len;
+    memcpy(req + 1, ns->str, ns->len);
+    client_batch_op_end(batch, FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ,
+            sizeof(FDIRProtoSetDentrySizeReq) + ns->len);
+    return 0;
+}
+
+int fdir_client_batch_add_modify_dentry_stat(FDIRClientBatch *batch,
+        const string_t *ns, const int64_t inode, const int64_t flags,
+        const FDIRDEntryStatus *stat)
+{
+    FDIRProtoModifyDentryStatReq *req;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+
+    if ((req=(FDIRProtoModifyDentryStatReq *)client_batch_op_begin(batch,
+                    sizeof(FDIRProtoModifyDentryStatReq) + NAME_MAX,
+                    &result)) == NULL)
+    {
+        return result;
+    }
+
+    long2buff(inode, req->inode);
+    long2buff(flags, req->mflags);
+    req->ns_len = ns->len;
+    memcpy(req->ns_str, ns->str, ns->len);
+    fdir_proto_pack_dentry_stat(stat, &req->stat);
+    client_batch_op_end(batch, FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ,
+            sizeof(FDIRProtoModifyDentryStatReq) + ns->len);
+    return 0;
+}
+
+int fdir_client_proto_compound(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        FDIRClientBatch *batch)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoCompoundReqHeader *rheader;
+    FDIRProtoCompoundRespHeader *resp_header;
+    FDIRProtoCompoundOpResult *op_result;
+    FDIRClientBatchResult *result_entry;
+    FDIRClientBatchResult *end;
+    SFResponseInfo response;
+    char *in_buff;
+    int expect_body_lens[4];
+    int body_len;
+    int out_bytes;
+    int result;
+
+    if (batch->count == 0) {
+        logError("file: "__FILE__", line: %d, "
+                "empty batch", __LINE__);
+        return EINVAL;
+    }
+
+    if (req_id > 0) {
+        header = (FDIRProtoHeader *)batch->request.buff;
+        long2buff(req_id, ((SFProtoIdempotencyAdditionalHeader *)
+                    (header + 1))->req_id);
+    } else {
+        header = (FDIRProtoHeader *)(batch->request.buff +
+                sizeof(SFProtoIdempotencyAdditionalHeader));
+    }
+    rheader = (FDIRProtoCompoundReqHeader *)(batch->request.buff +
+            sizeof(FDIRProtoHeader) +
+            sizeof(SFProtoIdempotencyAdditionalHeader));
+    int2buff(batch->count, rheader->count);
+    memset(rheader->padding, 0, sizeof(rheader->padding));
+    out_bytes = (batch->request.buff + batch->request.length) -
+        (char *)header;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_COMPOUND_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    if (batch->results == NULL) {
+        batch->results = (FDIRClientBatchResult *)fc_malloc(
+                sizeof(FDIRClientBatchResult) * FDIR_COMPOUND_MAX_OP_COUNT);
+        if (batch->results == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    //the retried request without output, optional trailer
+    expect_body_lens[0] = 0;
+    expect_body_lens[1] = sizeof(FDIRProtoUpdateRespTrailer);
+    expect_body_lens[2] = sizeof(FDIRProtoCompoundRespHeader) +
+        sizeof(FDIRProtoCompoundOpResult) * batch->count;
+    expect_body_lens[3] = expect_body_lens[2] +
+        sizeof(FDIRProtoUpdateRespTrailer);
+    if ((in_buff=(char *)fc_malloc(expect_body_lens[3])) == NULL) {
+        return ENOMEM;
+    }
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex(conn, (char *)header,
+                    out_bytes, &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_COMPOUND_RESP, in_buff,
+                    expect_body_lens, 4, &body_len)) != 0)
+    {
+        sf_log_network_error_for_update(&response, conn, result);
+        free(in_buff);
+        return result;
+    }
+
+    end = batch->results + batch->count;
+    if (body_len < expect_body_lens[2]) {
+        check_update_data_version(client_ctx, in_buff, body_len, 0);
+        batch->no_output = true;
+        memset(batch->results, 0, sizeof(FDIRClientBatchResult) *
+                batch->count);
+        free(in_buff);
+        return 0;
+    }
+
+    check_update_data_version(client_ctx, in_buff,
+            body_len, expect_body_lens[2]);
+    resp_header = (FDIRProtoCompoundRespHeader *)in_buff;
+    if (buff2int(resp_header->count) != batch->count) {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, response count: %d != request count: %d",
+                __LINE__, conn->ip_addr, conn->port,
+                buff2int(resp_header->count), batch->count);
+        free(in_buff);
+        return EINVAL;
+    }
+
+    batch->no_output = false;
+    op_result = (FDIRProtoCompoundOpResult *)(resp_header + 1);
+    for (result_entry=batch->results; result_entry<end;
+            result_entry++, op_result++)
+    {
+        result_entry->status = buff2short(op_result->status);
+        if (result_entry->status == 0) {
+            proto_unpack_dentry(&op_result->dentry, &result_entry->dentry);
+        } else {
+            memset(&result_entry->dentry, 0, sizeof(FDIRDEntryInfo));
+        }
+    }
+
+    free(in_buff);
+    return 0;
+}
+
+int fdir_client_proto_set_read_version(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const int64_t data_version)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoSetReadVersionReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoSetReadVersionReq)];
+    int result;
+
+    header = (FDIRProtoHeader *)out_buff;
+    req = (FDIRProtoSetReadVersionReq *)(header + 1);
+    long2buff(data_version, req->data_version);
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_SET_READ_VERSION_REQ,
+            sizeof(FDIRProtoSetReadVersionReq));
+
+    //without response
+    if ((result=tcpsenddata_nb(conn->sock, out_buff, sizeof(out_buff),
+                    client_ctx->network_timeout)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "send data to server %s:%u fail, "
+                "errno: %d, error info: %s", __LINE__,
+                conn->ip_addr, conn->port, result, STRERROR(result));
+    }
+
+    return result;
+}
+
 int fdir_client_init_session(FDIRClientContext *client_ctx,
     FDIRClientSession *session)
 {
@@ -1269,9 +1779,12 @@ static int check_realloc_dentry_array(SFResponseInfo *response,
     return 0;
 }
 
+/* the names of the last page refer to the recv buffer, except the streaming
+ * list which recv the empty frames of the in flight credits after the last
+ */
 static int parse_list_dentry_response_body(ConnectionInfo *conn,
         SFResponseInfo *response, FDIRClientDentryArray *array,
-        string_t *next_token)
+        const bool stream, int64_t *inode, bool *is_last)
 {
     FDIRProtoListDEntryRespBodyHeader *body_header;
     FDIRProtoListDEntryRespBodyPart *part;
@@ -1282,6 +1795,7 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
     int result;
     int entry_len;
     int count;
+    bool copy_names;
 
     if (response->header.body_len < sizeof(FDIRProtoListDEntryRespBodyHeader)) {
         response->error.length = snprintf(response->error.message,
@@ -1294,12 +1808,18 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
 
     body_header = (FDIRProtoListDEntryRespBodyHeader *)array->buffer.buff;
     count = buff2int(body_header->count);
-    next_token->str = body_header->token;
-    if (body_header->is_last) {
-        next_token->len = 0;
-    } else {
-        next_token->len = sizeof(body_header->token);
+    *inode = buff2long(body_header->inode);
+    *is_last = body_header->is_last;
+    if (!*is_last && count == 0) {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "server %s:%u response empty page without the end",
+                conn->ip_addr, conn->port);
+        return EINVAL;
+    }
 
+    copy_names = (!*is_last || stream) && count > 0;
+    if (copy_names) {
         if (!array->name_allocator.inited) {
             if ((result=fast_mpool_init(&array->name_allocator.mpool,
                             64 * 1024, 8)) != 0)
@@ -1333,7 +1853,7 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
 
         cd->dentry.inode = buff2long(part->inode);
         fdir_proto_unpack_dentry_stat(&part->stat, &cd->dentry.stat);
-        if (body_header->is_last) {
+        if (!copy_names) {
             FC_SET_STRING_EX(cd->name, part->name_str, part->name_len);
         } else if ((result=fast_mpool_alloc_string_ex(&array->name_allocator.mpool,
                         &cd->name, part->name_str, part->name_len)) != 0)
@@ -1361,7 +1881,8 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
 
 static int deal_list_dentry_response_body(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, SFResponseInfo *response,
-        FDIRClientDentryArray *array, string_t *next_token)
+        FDIRClientDentryArray *array, const bool stream,
+        int64_t *inode, bool *is_last)
 {
     int result;
     if ((result=check_realloc_client_buffer(response, &array->buffer)) != 0) {
@@ -1381,35 +1902,126 @@ static int deal_list_dentry_response_body(FDIRClientContext *client_ctx,
         return result;
     }
 
-    return parse_list_dentry_response_body(conn, response, array, next_token);
+    return parse_list_dentry_response_body(conn, response,
+            array, stream, inode, is_last);
 }
 
+//the last name listed as the cursor, so any server can list the next page
 static int do_list_dentry_next(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, string_t *next_token,
-        SFResponseInfo *response, FDIRClientDentryArray *array)
+        ConnectionInfo *conn, SFResponseInfo *response,
+        FDIRClientDentryArray *array, int64_t *inode, bool *is_last)
 {
     FDIRProtoHeader *header;
-    FDIRProtoListDEntryNextBody *entry_body;
-    char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoListDEntryNextBody)];
+    FDIRProtoListDEntryNextByNameBody *entry_body;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoListDEntryNextByNameBody) + NAME_MAX];
+    const string_t *cursor;
     int out_bytes;
     int result;
 
-    memset(out_buff, 0, sizeof(out_buff));
     header = (FDIRProtoHeader *)out_buff;
-    entry_body = (FDIRProtoListDEntryNextBody *)
+    entry_body = (FDIRProtoListDEntryNextByNameBody *)
         (out_buff + sizeof(FDIRProtoHeader));
+    cursor = &array->entries[array->count - 1].name;
     out_bytes = sizeof(FDIRProtoHeader) +
-        sizeof(FDIRProtoListDEntryNextBody);
-    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ,
+        sizeof(FDIRProtoListDEntryNextByNameBody) + cursor->len;
+    SF_PROTO_SET_HEADER(header,
+            FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_BY_NAME_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
-    memcpy(entry_body->token, next_token->str, next_token->len);
-    int2buff(array->count, entry_body->offset);
+    long2buff(*inode, entry_body->inode);
+    entry_body->name_len = cursor->len;
+    memcpy(entry_body->name_str, cursor->str, cursor->len);
     if ((result=sf_send_and_check_response_header(conn, out_buff,
                     out_bytes, response, client_ctx->
                     network_timeout, FDIR_SERVICE_PROTO_LIST_DENTRY_RESP)) == 0)
     {
         return deal_list_dentry_response_body(client_ctx,
-                conn, response, array, next_token);
+                conn, response, array, false, inode, is_last);
+    }
+
+    return result;
+}
+
+/* keep the credits of the window in flight, the server pushes one frame
+ * for one credit. all the in flight frames must be received even if error
+ * occurs, otherwise the connection is out of sync
+ */
+static int do_list_dentry_stream(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, SFResponseInfo *response,
+        FDIRClientDentryArray *array, const int stream_token,
+        int64_t *inode, bool *is_last)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoListDEntryStreamBody *stream_body;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoListDEntryStreamBody)];
+    int in_flight;
+    int result;
+    int r;
+
+    header = (FDIRProtoHeader *)out_buff;
+    stream_body = (FDIRProtoListDEntryStreamBody *)
+        (out_buff + sizeof(FDIRProtoHeader));
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_LIST_DENTRY_STREAM_REQ,
+            sizeof(FDIRProtoListDEntryStreamBody));
+    short2buff(stream_token, stream_body->stream_token);
+    memset(stream_body->padding, 0, sizeof(stream_body->padding));
+
+    result = 0;
+    in_flight = 0;
+    while (1) {
+        while (result == 0 && !*is_last && in_flight <
+                client_ctx->list_stream_window)
+        {
+            if ((r=tcpsenddata_nb(conn->sock, out_buff, sizeof(out_buff),
+                            client_ctx->network_timeout)) != 0)
+            {
+                response->error.length = snprintf(response->error.message,
+                        sizeof(response->error.message),
+                        "send data to server %s:%u fail, "
+                        "errno: %d, error info: %s",
+                        conn->ip_addr, conn->port, r, STRERROR(r));
+                return r;
+            }
+            in_flight++;
+        }
+
+        if (in_flight == 0) {
+            break;
+        }
+        in_flight--;
+
+        if ((r=sf_recv_response_header(conn, response,
+                        client_ctx->network_timeout)) != 0)
+        {
+            return r;
+        }
+        if ((r=sf_check_response(conn, response, client_ctx->
+                        network_timeout, FDIR_SERVICE_PROTO_LIST_DENTRY_RESP)) != 0)
+        {
+            if (result == 0) {
+                result = r;
+            }
+            continue;
+        }
+
+        if (result != 0) {  //drain the frame
+            if ((r=check_realloc_client_buffer(response,
+                            &array->buffer)) != 0)
+            {
+                return r;
+            }
+            if ((r=tcprecvdata_nb(conn->sock, array->buffer.buff,
+                            response->header.body_len, client_ctx->
+                            network_timeout)) != 0)
+            {
+                return r;
+            }
+            continue;
+        }
+
+        result = deal_list_dentry_response_body(client_ctx,
+                conn, response, array, true, inode, is_last);
     }
 
     return result;
@@ -1419,18 +2031,32 @@ static int deal_list_dentry_response(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, SFResponseInfo *response,
         FDIRClientDentryArray *array)
 {
-    string_t next_token;
+    int64_t inode;
+    int stream_token;
+    bool is_last;
     int result;
 
     if ((result=deal_list_dentry_response_body(client_ctx, conn,
-                    response, array, &next_token)) != 0)
+                    response, array, false, &inode, &is_last)) != 0)
     {
         return result;
     }
 
-    while (next_token.len > 0) {
+    if (client_ctx->list_stream_window > 0) {
+        if (is_last) {
+            return 0;
+        }
+
+        stream_token = (uint16_t)buff2short(
+                ((FDIRProtoListDEntryRespBodyHeader *)
+                 array->buffer.buff)->stream_token);
+        return do_list_dentry_stream(client_ctx, conn, response,
+                array, stream_token, &inode, &is_last);
+    }
+
+    while (!is_last) {
         if ((result=do_list_dentry_next(client_ctx, conn,
-                        &next_token, response, array)) != 0)
+                        response, array, &inode, &is_last)) != 0)
         {
             break;
         }
@@ -1558,11 +2184,33 @@ int fdir_client_service_stat(FDIRClientContext *client_ctx,
     stat->dentry.counters.dir = buff2long(stat_resp.dentry.counters.dir);
     stat->dentry.counters.file = buff2long(stat_resp.dentry.counters.file);
 
+    stat->inode_hashtable.capacity = buff2long(
+            stat_resp.inode_hashtable.capacity);
+    stat->inode_hashtable.count = buff2long(stat_resp.inode_hashtable.count);
+    stat->inode_hashtable.max_chain_length = buff2int(
+            stat_resp.inode_hashtable.max_chain_length);
+    stat->inode_hashtable.resizing = stat_resp.inode_hashtable.resizing;
+
+    stat->path_cache.capacity = buff2long(stat_resp.path_cache.capacity);
+    stat->path_cache.count = buff2long(stat_resp.path_cache.count);
+    stat->path_cache.hit_count = buff2long(stat_resp.path_cache.hit_count);
+    stat->path_cache.miss_count = buff2long(stat_resp.path_cache.miss_count);
+
+    stat->name_intern.count = buff2long(stat_resp.name_intern.count);
+    stat->name_intern.refer_count = buff2long(
+            stat_resp.name_intern.refer_count);
+    stat->name_intern.saved_bytes = buff2long(
+            stat_resp.name_intern.saved_bytes);
+
+    stat->reclaim.epoch = buff2long(stat_resp.reclaim.epoch);
+    stat->reclaim.waiting_count = buff2long(stat_resp.reclaim.waiting_count);
+
     return 0;
 }
 
-int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
-        FDIRClientClusterStatEntry *stats, const int size, int *count)
+int fdir_client_cluster_stat_ex(FDIRClientContext *client_ctx,
+        FDIRClientClusterStatEntry *stats, const int size, int *count,
+        int *ack_policy)
 {
     FDIRProtoHeader *header;
     FDIRProtoClusterStatRespBodyHeader *body_header;
@@ -1614,6 +2262,7 @@ int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
             sizeof(FDIRProtoClusterStatRespBodyHeader));
     if (result == 0) {
         *count = buff2int(body_header->count);
+        *ack_policy = body_header->replica_ack_policy;
 
         calc_size = sizeof(FDIRProtoClusterStatRespBodyHeader) +
             (*count) * sizeof(FDIRProtoClusterStatRespBodyPart);
@@ -1644,6 +2293,19 @@ int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
             memcpy(stat->ip_addr, body_part->ip_addr, IP_ADDRESS_SIZE);
             *(stat->ip_addr + IP_ADDRESS_SIZE - 1) = '\0';
             stat->port = buff2short(body_part->port);
+            stat->replica_ack.acked_count = buff2long(
+                    body_part->replica_ack.acked_count);
+            stat->replica_ack.satisfied_count = buff2long(
+                    body_part->replica_ack.satisfied_count);
+            stat->replica_ack.late_count = buff2long(
+                    body_part->replica_ack.late_count);
+            stat->replica_lag.data_versions = buff2long(
+                    body_part->replica_lag.data_versions);
+            stat->replica_lag.delay_ms = buff2int(
+                    body_part->replica_lag.delay_ms);
+            stat->load.in_flight = buff2int(body_part->load.in_flight);
+            stat->load.p99_latency_us = buff2int(
+                    body_part->load.p99_latency_us);
         }
     }
 
@@ -1825,7 +2487,7 @@ int fdir_client_get_slaves(FDIRClientContext *client_ctx,
 }
 
 int fdir_client_proto_namespace_stat(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const string_t *ns, FDIRInodeStat *stat)
+        ConnectionInfo *conn, const string_t *ns, FDIRNamespaceStat *stat)
 {
     FDIRProtoHeader *header;
     FDIRProtoNamespaceStatReq *req;
@@ -1858,12 +2520,62 @@ int fdir_client_proto_namespace_stat(FDIRClientContext *client_ctx,
                     FDIR_SERVICE_PROTO_NAMESPACE_STAT_RESP, (char *)&resp,
                     sizeof(FDIRProtoNamespaceStatResp))) == 0)
     {
-        stat->total = buff2long(resp.inode_counters.total);
-        stat->used = buff2long(resp.inode_counters.used);
-        stat->avail = buff2long(resp.inode_counters.avail);
+        stat->inode.total = buff2long(resp.inode_counters.total);
+        stat->inode.used = buff2long(resp.inode_counters.used);
+        stat->inode.avail = buff2long(resp.inode_counters.avail);
+        stat->used_bytes = buff2long(resp.used_bytes);
+        stat->quota.inodes = buff2long(resp.quota.inodes);
+        stat->quota.bytes = buff2long(resp.quota.bytes);
     } else {
         sf_log_network_error(&response, conn, result);
     }
 
     return result;
 }
+
+int fdir_client_proto_namespace_set_quota(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        const FDIRNamespaceQuota *quota)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoNamespaceSetQuotaReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FDIRProtoNamespaceSetQuotaReq) + NAME_MAX];
+    SFResponseInfo response;
+    char in_buff[sizeof(FDIRProtoUpdateRespTrailer)];
+    int expect_body_lens[2];
+    int body_len;
+    int out_bytes;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+
+    CLIENT_PROTO_SET_REQ(out_buff, header, req, req_id, out_bytes);
+    long2buff(quota->inodes, req->quota.inodes);
+    long2buff(quota->bytes, req->quota.bytes);
+    req->ns_len = ns->len;
+    memcpy(req->ns_str, ns->str, ns->len);
+    out_bytes += ns->len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+    expect_body_lens[0] = 0;
+    expect_body_lens[1] = sizeof(in_buff);
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
+                    &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_RESP,
+                    in_buff, expect_body_lens, 2, &body_len)) == 0)
+    {
+        check_update_data_version(client_ctx, in_buff, body_len, 0);
+    } else {
+        sf_log_network_error_for_update(&response, conn, result);
+    }
+
+    return result;
+}
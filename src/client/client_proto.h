@@ -50,6 +50,23 @@ typedef struct fdir_client_dentry_array {
     } name_allocator;
 } FDIRClientDentryArray;
 
+typedef struct fdir_client_batch_result {
+    int status;              //the errno of the operation
+    FDIRDEntryInfo dentry;   //valid when status is 0
+} FDIRClientBatchResult;
+
+//the operations of the compound request which executed in order
+typedef struct fdir_client_batch {
+    int count;
+    bool no_output;  //the retried request done without the op results
+    FDIRClientBatchResult *results;  //the op results after executed
+    struct {
+        int alloc;
+        int length;
+        char *buff;
+    } request;
+} FDIRClientBatch;
+
 typedef struct fdir_client_service_stat {
     int server_id;
     bool is_master;
@@ -69,6 +86,31 @@ typedef struct fdir_client_service_stat {
             int64_t file;
         } counters;
     } dentry;
+
+    struct {
+        int64_t capacity;
+        int64_t count;
+        int max_chain_length;
+        bool resizing;
+    } inode_hashtable;
+
+    struct {
+        int64_t capacity;
+        int64_t count;
+        int64_t hit_count;
+        int64_t miss_count;
+    } path_cache;
+
+    struct {
+        int64_t count;
+        int64_t refer_count;
+        int64_t saved_bytes;
+    } name_intern;
+
+    struct {
+        int64_t epoch;
+        int64_t waiting_count;
+    } reclaim;
 } FDIRClientServiceStat;
 
 typedef struct fdir_client_cluster_stat_entry {
@@ -77,6 +119,19 @@ typedef struct fdir_client_cluster_stat_entry {
     char status;
     char ip_addr[IP_ADDRESS_SIZE];
     uint16_t port;
+    struct {
+        int64_t acked_count;      //the acks while the request waiting
+        int64_t satisfied_count;  //the acks satisfied the ack policy
+        int64_t late_count;       //the acks after the ack policy satisfied
+    } replica_ack;  //counted by the master
+    struct {
+        int64_t data_versions;  //the data versions behind the master
+        int delay_ms;           //the sampled replica delay
+    } replica_lag;  //set by the master
+    struct {
+        int in_flight;       //the service requests in progress
+        int p99_latency_us;  //of the requests in the last second
+    } load;
 } FDIRClientClusterStatEntry;
 
 #ifdef __cplusplus
@@ -156,6 +211,10 @@ int fdir_client_proto_stat_dentry_by_path(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const FDIRDEntryFullName *fullname,
         const int enoent_log_level, FDIRDEntryInfo *dentry);
 
+int fdir_client_proto_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const FDIRDEntryFullName *fullname,
+        FDIRDEntryUsage *usage);
+
 int fdir_client_proto_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const int64_t inode, FDIRDEntryInfo *dentry);
 
@@ -189,6 +248,10 @@ int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStatus *stat, FDIRDEntryInfo *dentry);
 
+int fdir_client_proto_compound(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        FDIRClientBatch *batch);
+
 int fdir_client_flock_dentry_ex2(FDIRClientSession *session,
         const int64_t inode, const int operation, const int64_t offset,
         const int64_t length, const int64_t owner_id, const pid_t pid);
@@ -243,14 +306,64 @@ int fdir_client_dentry_array_init(FDIRClientDentryArray *array);
 
 void fdir_client_dentry_array_free(FDIRClientDentryArray *array);
 
+int fdir_client_batch_init(FDIRClientBatch *batch);
+
+//clear the operations for reuse
+void fdir_client_batch_reset(FDIRClientBatch *batch);
+
+void fdir_client_batch_free(FDIRClientBatch *batch);
+
+int fdir_client_batch_add_create(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp);
+
+int fdir_client_batch_add_create_by_pname(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp);
+
+int fdir_client_batch_add_remove(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname);
+
+int fdir_client_batch_add_remove_by_pname(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRDEntryPName *pname);
+
+int fdir_client_batch_add_stat(FDIRClientBatch *batch,
+        const FDIRDEntryFullName *fullname);
+
+int fdir_client_batch_add_stat_by_inode(FDIRClientBatch *batch,
+        const int64_t inode);
+
+int fdir_client_batch_add_stat_by_pname(FDIRClientBatch *batch,
+        const FDIRDEntryPName *pname);
+
+int fdir_client_batch_add_set_dentry_size(FDIRClientBatch *batch,
+        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize);
+
+int fdir_client_batch_add_modify_dentry_stat(FDIRClientBatch *batch,
+        const string_t *ns, const int64_t inode, const int64_t flags,
+        const FDIRDEntryStatus *stat);
+
 int fdir_client_service_stat(FDIRClientContext *client_ctx,
         const char *ip_addr, const int port, FDIRClientServiceStat *stat);
 
-int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
-        FDIRClientClusterStatEntry *stats, const int size, int *count);
+int fdir_client_cluster_stat_ex(FDIRClientContext *client_ctx,
+        FDIRClientClusterStatEntry *stats, const int size, int *count,
+        int *ack_policy);
+
+static inline int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
+        FDIRClientClusterStatEntry *stats, const int size, int *count)
+{
+    int ack_policy;
+    return fdir_client_cluster_stat_ex(client_ctx,
+            stats, size, count, &ack_policy);
+}
 
 int fdir_client_proto_namespace_stat(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const string_t *ns, FDIRInodeStat *stat);
+        ConnectionInfo *conn, const string_t *ns, FDIRNamespaceStat *stat);
+
+int fdir_client_proto_namespace_set_quota(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        const FDIRNamespaceQuota *quota);
 
 int fdir_client_get_master(FDIRClientContext *client_ctx,
         FDIRClientServerEntry *master);
@@ -261,6 +374,12 @@ int fdir_client_get_slaves(FDIRClientContext *client_ctx,
 int fdir_client_get_readable_server(FDIRClientContext *client_ctx,
         FDIRClientServerEntry *server);
 
+/* the server waits for the data version before the next read request
+ * on this connection, without response
+ */
+int fdir_client_proto_set_read_version(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const int64_t data_version);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,8 @@
 #include "sf/idempotency/client/client_types.h"
 #include "fdir_types.h"
 
+#define FDIR_CLIENT_DEFAULT_LIST_STREAM_WINDOW  4
+
 struct fdir_client_context;
 
 typedef ConnectionInfo *(*fdir_get_connection_func)(
@@ -107,6 +109,11 @@ typedef struct fdir_client_context {
     SFDataReadRule read_rule;  //the rule for read
     int connect_timeout;
     int network_timeout;
+    int list_stream_window;  //the in flight frames of streaming list
+    struct {
+        bool enabled;
+        volatile int64_t data_version;  //of the last update
+    } read_your_writes;
     SFNetRetryConfig net_retry_cfg;
 } FDIRClientContext;
 
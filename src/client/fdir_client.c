@@ -23,8 +23,37 @@
             result)
 
 #define GET_READABLE_CONNECTION(client_ctx, arg1, result)        \
-    client_ctx->conn_manager.get_readable_connection(client_ctx, \
-            result)
+    get_readable_connection(client_ctx, result)
+
+static ConnectionInfo *get_readable_connection(
+        FDIRClientContext *client_ctx, int *err_no)
+{
+    ConnectionInfo *conn;
+    int64_t data_version;
+
+    if ((conn=client_ctx->conn_manager.get_readable_connection(
+                    client_ctx, err_no)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (!client_ctx->read_your_writes.enabled) {
+        return conn;
+    }
+    data_version = __sync_add_and_fetch(&client_ctx->
+            read_your_writes.data_version, 0);
+    if (data_version == 0) {
+        return conn;
+    }
+
+    if ((*err_no=fdir_client_proto_set_read_version(client_ctx,
+                    conn, data_version)) != 0)
+    {
+        client_ctx->conn_manager.close_connection(client_ctx, conn);
+        return NULL;
+    }
+    return conn;
+}
 
 int fdir_client_create_dentry(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname,
@@ -167,6 +196,15 @@ int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
             stat, dentry);
 }
 
+int fdir_client_batch_execute(FDIRClientContext *client_ctx,
+        FDIRClientBatch *batch)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_compound, batch);
+}
+
 int fdir_client_getlk_dentry(FDIRClientContext *client_ctx,
         const int64_t inode, int *operation, int64_t *offset,
         int64_t *length, int64_t *owner_id, pid_t *pid)
@@ -203,6 +241,13 @@ int fdir_client_stat_dentry_by_path_ex(FDIRClientContext *client_ctx,
             enoent_log_level, dentry);
 }
 
+int fdir_client_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, FDIRDEntryUsage *usage)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_READABLE_CONNECTION,
+            NULL, fdir_client_proto_dentry_usage_by_path, fullname, usage);
+}
+
 int fdir_client_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         const int64_t inode, FDIRDEntryInfo *dentry)
 {
@@ -254,9 +299,18 @@ int fdir_client_list_dentry_by_inode(FDIRClientContext *client_ctx,
             NULL, fdir_client_proto_list_dentry_by_inode, inode, array);
 }
 
-int fdir_client_namespace_stat(FDIRClientContext *client_ctx,
-        const string_t *ns, FDIRInodeStat *stat)
+int fdir_client_namespace_stat_ex(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRNamespaceStat *stat)
 {
     SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
             NULL, fdir_client_proto_namespace_stat, ns, stat);
 }
+
+int fdir_client_namespace_set_quota(FDIRClientContext *client_ctx,
+        const string_t *ns, const FDIRNamespaceQuota *quota)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_namespace_set_quota, ns, quota);
+}
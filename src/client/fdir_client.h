@@ -121,6 +121,12 @@ int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStatus *stat, FDIRDEntryInfo *dentry);
 
+/* execute the operations of the batch in order by the master,
+ * the result of each operation is stored in batch->results
+ */
+int fdir_client_batch_execute(FDIRClientContext *client_ctx,
+        FDIRClientBatch *batch);
+
 int fdir_client_getlk_dentry(FDIRClientContext *client_ctx,
         const int64_t inode, int *operation, int64_t *offset,
         int64_t *length, int64_t *owner_id, pid_t *pid);
@@ -157,6 +163,10 @@ int fdir_client_stat_dentry_by_pname_ex(FDIRClientContext *client_ctx,
 int fdir_client_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         const int64_t inode, FDIRDEntryInfo *dentry);
 
+//the recursive file count, dir count and bytes of the path, O(1)
+int fdir_client_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, FDIRDEntryUsage *usage);
+
 int fdir_client_readlink_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, string_t *link, const int size);
 
@@ -172,8 +182,26 @@ int fdir_client_list_dentry_by_path(FDIRClientContext *client_ctx,
 int fdir_client_list_dentry_by_inode(FDIRClientContext *client_ctx,
         const int64_t inode, FDIRClientDentryArray *array);
 
-int fdir_client_namespace_stat(FDIRClientContext *client_ctx,
-        const string_t *ns, FDIRInodeStat *stat);
+int fdir_client_namespace_stat_ex(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRNamespaceStat *stat);
+
+static inline int fdir_client_namespace_stat(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRInodeStat *stat)
+{
+    FDIRNamespaceStat ns_stat;
+    int result;
+
+    if ((result=fdir_client_namespace_stat_ex(client_ctx,
+                    ns, &ns_stat)) == 0)
+    {
+        *stat = ns_stat.inode;
+    }
+    return result;
+}
+
+//the quota of inodes and bytes, 0 for unlimited
+int fdir_client_namespace_set_quota(FDIRClientContext *client_ctx,
+        const string_t *ns, const FDIRNamespaceQuota *quota);
 
 #ifdef __cplusplus
 }
@@ -25,11 +25,32 @@
 static inline int make_connection(FDIRClientContext *client_ctx,
         ConnectionInfo *conn)
 {
+    FDIRConnectionParameters conn_params;
+    int result;
+
     if (conn->sock >= 0) {
         return 0;
     }
 
-    return conn_pool_connect_server(conn, client_ctx->connect_timeout);
+    if ((result=conn_pool_connect_server(conn, client_ctx->
+                    connect_timeout)) != 0)
+    {
+        return result;
+    }
+
+    //join for the data version of the update responses
+    if (client_ctx->read_your_writes.enabled &&
+            !client_ctx->idempotency_enabled)
+    {
+        memset(&conn_params, 0, sizeof(conn_params));
+        if ((result=fdir_client_proto_join_server(client_ctx,
+                        conn, &conn_params)) != 0)
+        {
+            conn_pool_disconnect_server(conn);
+        }
+    }
+
+    return result;
 }
 
 static int check_realloc_group_servers(FDIRServerGroup *server_group)
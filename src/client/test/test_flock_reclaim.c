@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* a client waits for the flock held by another client while the dentries
+ * are removed, the removed dentries should still be freed by the server.
+ * run against an idle cluster because the waiting count of the master
+ * is expected to drop to zero.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "fastcommon/logger.h"
+#include "fastdir/client/fdir_client.h"
+
+static char *config_filename = "/etc/fdir/client.conf";
+static char *ns = "test";
+static char *base_path = "/test_flock_reclaim";
+static int remove_count = 10000;
+static int timeout = 10;
+
+static int64_t inode;
+static volatile int waiter_done = 0;
+static volatile int waiter_result = 0;
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename = /etc/fdir/client.conf] "
+            "[-n namespace = test] [-b base_path = /test_flock_reclaim] "
+            "[-r remove count = 10000] [-t timeout seconds = 10]\n",
+            argv[0]);
+}
+
+static int lock_dentry(FDIRClientContext *client_ctx,
+        FDIRClientSession *session, const short operation)
+{
+    int result;
+
+    if ((result=fdir_client_flock_dentry_ex(session,
+                    inode, operation, 0, 0)) != 0)
+    {
+        fprintf(stderr, "dentry flock fail, inode: %"PRId64", "
+                "operation: %d, errno: %d, error info: %s\n",
+                inode, operation, result, STRERROR(result));
+    }
+    return result;
+}
+
+static void *waiter_func(void *args)
+{
+    FDIRClientContext client_ctx;
+    FDIRClientSession session;
+    int result;
+
+    memset(&session, 0, sizeof(session));
+    do {
+        if ((result=fdir_client_pooled_init_ex(&client_ctx,
+                        config_filename, NULL, 0, 4 * 3600)) != 0)
+        {
+            break;
+        }
+
+        if ((result=fdir_client_init_session(&client_ctx,
+                        &session)) != 0)
+        {
+            break;
+        }
+
+        //blocked until the holder unlocks
+        if ((result=lock_dentry(&client_ctx, &session, LOCK_EX)) != 0) {
+            break;
+        }
+        result = lock_dentry(&client_ctx, &session, LOCK_UN);
+    } while (0);
+
+    fdir_client_close_session(&session, result != 0);
+    fdir_client_destroy_ex(&client_ctx);
+
+    waiter_result = result;
+    __sync_add_and_fetch(&waiter_done, 1);
+    return NULL;
+}
+
+static int create_dentry(const char *path, const mode_t mode)
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, (char *)path);
+    omp.mode = mode;
+    omp.uid = geteuid();
+    omp.gid = getegid();
+    if ((result=fdir_client_create_dentry(&g_fdir_client_vars.client_ctx,
+                    &fullname, &omp, &dentry)) != 0 && result != EEXIST)
+    {
+        fprintf(stderr, "create dentry %s fail, errno: %d, "
+                "error info: %s\n", path, result, STRERROR(result));
+        return result;
+    }
+    return 0;
+}
+
+static int remove_dentry(const char *path)
+{
+    FDIRDEntryFullName fullname;
+    int result;
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, (char *)path);
+    if ((result=fdir_client_remove_dentry(&g_fdir_client_vars.
+                    client_ctx, &fullname)) != 0)
+    {
+        fprintf(stderr, "remove dentry %s fail, errno: %d, "
+                "error info: %s\n", path, result, STRERROR(result));
+    }
+    return result;
+}
+
+static int create_and_remove()
+{
+    char path[PATH_MAX];
+    int result;
+    int i;
+
+    for (i=0; i<remove_count; i++) {
+        snprintf(path, sizeof(path), "%s/%06d", base_path, i);
+        if ((result=create_dentry(path, 0644 | S_IFREG)) != 0) {
+            return result;
+        }
+        if ((result=remove_dentry(path)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int wait_reclaimed(FDIRClientServerEntry *master)
+{
+    FDIRClientServiceStat stat;
+    int64_t start_time;
+    int result;
+
+    start_time = get_current_time_ms();
+    while (1) {
+        if ((result=fdir_client_service_stat(&g_fdir_client_vars.
+                        client_ctx, master->conn.ip_addr,
+                        master->conn.port, &stat)) != 0)
+        {
+            return result;
+        }
+
+        if (stat.reclaim.waiting_count == 0) {
+            printf("reclaimed in %"PRId64" ms, epoch: %"PRId64"\n",
+                    get_current_time_ms() - start_time,
+                    stat.reclaim.epoch);
+            return 0;
+        }
+
+        if (get_current_time_ms() - start_time >= timeout * 1000) {
+            fprintf(stderr, "reclaim timeout, waiting count: %"PRId64", "
+                    "epoch: %"PRId64"\n", stat.reclaim.waiting_count,
+                    stat.reclaim.epoch);
+            return ETIMEDOUT;
+        }
+        fc_sleep_ms(100);
+    }
+}
+
+static int test_case(FDIRClientContext *client_ctx,
+        FDIRClientSession *session, FDIRClientServerEntry *master)
+{
+    pthread_t tid;
+    int result;
+
+    if ((result=lock_dentry(client_ctx, session, LOCK_EX)) != 0) {
+        return result;
+    }
+
+    if ((result=fc_create_thread(&tid, waiter_func, NULL, 64 * 1024)) != 0) {
+        lock_dentry(client_ctx, session, LOCK_UN);
+        return result;
+    }
+    fc_sleep_ms(500);  //wait for the waiter queued
+
+    if ((result=create_and_remove()) == 0) {
+        result = wait_reclaimed(master);
+    }
+    if (result == 0 && __sync_add_and_fetch(&waiter_done, 0) != 0) {
+        fprintf(stderr, "the waiter returned before unlock, "
+                "errno: %d, error info: %s\n", waiter_result,
+                STRERROR(waiter_result));
+        result = EBUSY;
+    }
+
+    lock_dentry(client_ctx, session, LOCK_UN);
+    while (__sync_add_and_fetch(&waiter_done, 0) == 0) {
+        fc_sleep_ms(10);
+    }
+    if (result == 0) {
+        result = waiter_result;
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch;
+    char path[PATH_MAX];
+    FDIRDEntryFullName fullname;
+    FDIRClientServerEntry master;
+    FDIRClientContext client_ctx;
+    FDIRClientSession session;
+	int result;
+
+    while ((ch=getopt(argc, argv, "hc:n:b:r:t:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 'b':
+                base_path = optarg;
+                break;
+            case 'r':
+                remove_count = strtol(optarg, NULL, 10);
+                break;
+            case 't':
+                timeout = strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    log_init();
+    //g_log_context.log_level = LOG_DEBUG;
+
+    if ((result=fdir_client_simple_init(config_filename)) != 0) {
+        return result;
+    }
+
+    if ((result=fdir_client_get_master(&g_fdir_client_vars.
+                    client_ctx, &master)) != 0)
+    {
+        return result;
+    }
+
+    snprintf(path, sizeof(path), "%s/locked", base_path);
+    if ((result=create_dentry(base_path, 0755 | S_IFDIR)) != 0) {
+        return result;
+    }
+    if ((result=create_dentry(path, 0644 | S_IFREG)) != 0) {
+        return result;
+    }
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, path);
+    if ((result=fdir_client_lookup_inode_by_path(&g_fdir_client_vars.
+                    client_ctx, &fullname, &inode)) != 0)
+    {
+        return result;
+    }
+
+    memset(&session, 0, sizeof(session));
+    if ((result=fdir_client_pooled_init_ex(&client_ctx,
+                    config_filename, NULL, 0, 4 * 3600)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_init_session(&client_ctx, &session)) == 0) {
+        result = test_case(&client_ctx, &session, &master);
+        fdir_client_close_session(&session, result != 0);
+    }
+    fdir_client_destroy_ex(&client_ctx);
+
+    remove_dentry(path);
+    remove_dentry(base_path);
+    printf("test %s\n", result == 0 ? "PASS" : "FAIL");
+
+    fdir_client_destroy();
+    return result;
+}
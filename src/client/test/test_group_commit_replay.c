@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the files are created then their sizes are set at once, so the size
+ * updates race with the group commit of the creates. the slaves should
+ * replay all of them and reach the data version and file count of the
+ * master. run against an idle cluster with binlog_group_commit_count > 1
+ * and at least one slave.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastdir/client/fdir_client.h"
+
+#define MAX_SLAVE_COUNT  16
+
+static char *config_filename = "/etc/fdir/client.conf";
+static char *ns = "test";
+static char *base_path = "/test_group_commit";
+static int threads = 8;
+static int file_count = 1000;  //per thread
+static int timeout = 30;
+
+static volatile int thread_count = 0;
+static volatile int fail_count = 0;
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename = /etc/fdir/client.conf] "
+            "[-n namespace = test] [-b base_path = /test_group_commit] "
+            "[-t thread count = 8] [-r file count per thread = 1000] "
+            "[-w wait seconds = 30]\n", argv[0]);
+}
+
+static int create_and_set_size(FDIRClientContext *client_ctx,
+        const char *path, const int64_t file_size)
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRSetDEntrySizeInfo dsize;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, (char *)path);
+    omp.mode = 0644 | S_IFREG;
+    omp.uid = geteuid();
+    omp.gid = getegid();
+    if ((result=fdir_client_create_dentry(client_ctx,
+                    &fullname, &omp, &dentry)) != 0)
+    {
+        fprintf(stderr, "create dentry %s fail, errno: %d, "
+                "error info: %s\n", path, result, STRERROR(result));
+        return result;
+    }
+
+    //right after the create, maybe before its group flushed
+    dsize.inode = dentry.inode;
+    dsize.file_size = file_size;
+    dsize.inc_alloc = 0;
+    dsize.force = false;
+    dsize.flags = FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE;
+    if ((result=fdir_client_set_dentry_size(client_ctx,
+                    &fullname.ns, &dsize, &dentry)) != 0)
+    {
+        fprintf(stderr, "set dentry size %s fail, errno: %d, "
+                "error info: %s\n", path, result, STRERROR(result));
+    }
+    return result;
+}
+
+static void *thread_func(void *args)
+{
+    long thread_index;
+    FDIRClientContext client_ctx;
+    FDIRDEntryFullName fullname;
+    char path[PATH_MAX];
+    int result;
+    int i;
+
+    thread_index = (long)args;
+    if ((result=fdir_client_pooled_init_ex(&client_ctx,
+                    config_filename, NULL, 0, 4 * 3600)) == 0)
+    {
+        FC_SET_STRING(fullname.ns, ns);
+        for (i=0; i<file_count; i++) {
+            snprintf(path, sizeof(path), "%s/%02ld-%06d",
+                    base_path, thread_index, i);
+            if ((result=create_and_set_size(&client_ctx,
+                            path, i + 1)) != 0)
+            {
+                break;
+            }
+
+            //remove the half for the removes in the groups
+            if (i % 2 == 1) {
+                FC_SET_STRING(fullname.path, path);
+                if ((result=fdir_client_remove_dentry(&client_ctx,
+                                &fullname)) != 0)
+                {
+                    fprintf(stderr, "remove dentry %s fail, errno: %d, "
+                            "error info: %s\n", path, result,
+                            STRERROR(result));
+                    break;
+                }
+            }
+        }
+        fdir_client_destroy_ex(&client_ctx);
+    }
+
+    if (result != 0) {
+        __sync_add_and_fetch(&fail_count, 1);
+    }
+    __sync_sub_and_fetch(&thread_count, 1);
+    return NULL;
+}
+
+static int wait_slave(FDIRClientServerEntry *slave,
+        const FDIRClientServiceStat *master_stat)
+{
+    FDIRClientServiceStat stat;
+    int64_t start_time;
+    int result;
+
+    start_time = get_current_time_ms();
+    while (1) {
+        if ((result=fdir_client_service_stat(&g_fdir_client_vars.
+                        client_ctx, slave->conn.ip_addr,
+                        slave->conn.port, &stat)) != 0)
+        {
+            fprintf(stderr, "slave id: %d, service stat fail, "
+                    "errno: %d, error info: %s\n", slave->server_id,
+                    result, STRERROR(result));
+            return result;
+        }
+
+        if (stat.status != FDIR_SERVER_STATUS_ACTIVE) {
+            fprintf(stderr, "slave id: %d, status: %d (%s) is not "
+                    "active\n", slave->server_id, stat.status,
+                    fdir_get_server_status_caption(stat.status));
+            return EBUSY;
+        }
+
+        if (stat.dentry.current_data_version >=
+                master_stat->dentry.current_data_version)
+        {
+            break;
+        }
+
+        if (get_current_time_ms() - start_time >= timeout * 1000) {
+            fprintf(stderr, "slave id: %d, wait timeout, data version: "
+                    "%"PRId64", master's: %"PRId64"\n", slave->server_id,
+                    stat.dentry.current_data_version,
+                    master_stat->dentry.current_data_version);
+            return ETIMEDOUT;
+        }
+        fc_sleep_ms(100);
+    }
+
+    if (stat.dentry.counters.file != master_stat->dentry.counters.file) {
+        fprintf(stderr, "slave id: %d, file count: %"PRId64" != "
+                "master's: %"PRId64"\n", slave->server_id,
+                stat.dentry.counters.file,
+                master_stat->dentry.counters.file);
+        return EINVAL;
+    }
+
+    printf("slave id: %d, data version: %"PRId64", file count: "
+            "%"PRId64", replayed in %"PRId64" ms\n", slave->server_id,
+            stat.dentry.current_data_version, stat.dentry.counters.file,
+            get_current_time_ms() - start_time);
+    return 0;
+}
+
+static int check_slaves()
+{
+    FDIRClientServerEntry master;
+    FDIRClientServerEntry slaves[MAX_SLAVE_COUNT];
+    FDIRClientServiceStat master_stat;
+    int count;
+    int result;
+    int i;
+
+    if ((result=fdir_client_get_master(&g_fdir_client_vars.
+                    client_ctx, &master)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_get_slaves(&g_fdir_client_vars.client_ctx,
+                    slaves, MAX_SLAVE_COUNT, &count)) != 0)
+    {
+        return result;
+    }
+    if (count == 0) {
+        fprintf(stderr, "no slave to check\n");
+        return ENOENT;
+    }
+
+    if ((result=fdir_client_service_stat(&g_fdir_client_vars.client_ctx,
+                    master.conn.ip_addr, master.conn.port,
+                    &master_stat)) != 0)
+    {
+        return result;
+    }
+
+    for (i=0; i<count; i++) {
+        if ((result=wait_slave(slaves + i, &master_stat)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int create_base_path()
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, base_path);
+    omp.mode = 0755 | S_IFDIR;
+    omp.uid = geteuid();
+    omp.gid = getegid();
+    if ((result=fdir_client_create_dentry(&g_fdir_client_vars.client_ctx,
+                    &fullname, &omp, &dentry)) != 0)
+    {
+        fprintf(stderr, "create dentry %s fail, errno: %d, "
+                "error info: %s\n", base_path, result, STRERROR(result));
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch;
+    char time_buff[32];
+    pthread_t tid;
+    long i;
+    int64_t start_time;
+	int result;
+
+    while ((ch=getopt(argc, argv, "hc:n:b:t:r:w:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 'b':
+                base_path = optarg;
+                break;
+            case 't':
+                threads = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                file_count = strtol(optarg, NULL, 10);
+                break;
+            case 'w':
+                timeout = strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    log_init();
+    //g_log_context.log_level = LOG_DEBUG;
+
+    if ((result=fdir_client_simple_init(config_filename)) != 0) {
+        return result;
+    }
+
+    //the base path should not exist
+    if ((result=create_base_path()) != 0) {
+        return result;
+    }
+
+    start_time = get_current_time_ms();
+    for (i=0; i<threads; i++) {
+        if (fc_create_thread(&tid, thread_func, (void *)i, 64 * 1024) == 0) {
+            __sync_add_and_fetch(&thread_count, 1);
+        }
+    }
+
+    while (thread_count != 0) {
+        fc_sleep_ms(10);
+    }
+    printf("threads: %d, fail count: %d, time used: %s ms\n", threads,
+            fail_count, long_to_comma_str(get_current_time_ms() -
+                start_time, time_buff));
+
+    if (fail_count > 0) {
+        result = EIO;
+    } else {
+        result = check_slaves();
+    }
+    printf("test %s\n", result == 0 ? "PASS" : "FAIL");
+
+    fdir_client_destroy();
+    return result;
+}
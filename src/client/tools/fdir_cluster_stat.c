@@ -29,7 +29,8 @@ static void usage(char *argv[])
     fprintf(stderr, "Usage: %s [-c config_filename]\n", argv[0]);
 }
 
-static void output(FDIRClientClusterStatEntry *stats, const int count)
+static void output(FDIRClientClusterStatEntry *stats, const int count,
+        const int ack_policy)
 {
     FDIRClientClusterStatEntry *stat;
     FDIRClientClusterStatEntry *end;
@@ -38,15 +39,28 @@ static void output(FDIRClientClusterStatEntry *stats, const int count)
     for (stat=stats; stat<end; stat++) {
         printf( "server_id: %d, host: %s:%u, "
                 "status: %d (%s), "
-                "is_master: %d\n",
+                "is_master: %d",
                 stat->server_id,
                 stat->ip_addr, stat->port,
                 stat->status,
                 fdir_get_server_status_caption(stat->status),
                 stat->is_master
               );
+        if (!stat->is_master) {
+            printf(", replica ack {acked: %"PRId64", satisfied: %"PRId64
+                    ", late: %"PRId64"}", stat->replica_ack.acked_count,
+                    stat->replica_ack.satisfied_count,
+                    stat->replica_ack.late_count);
+            printf(", replica lag {data versions: %"PRId64", delay: %d ms}",
+                    stat->replica_lag.data_versions,
+                    stat->replica_lag.delay_ms);
+        }
+        printf(", load {in flight: %d, p99 latency: %d us}",
+                stat->load.in_flight, stat->load.p99_latency_us);
+        printf("\n");
     }
-    printf("\nserver count: %d\n\n", count);
+    printf("\nserver count: %d, replica ack policy: %s\n\n", count,
+            fdir_get_replica_ack_policy_caption(ack_policy));
 }
 
 int main(int argc, char *argv[])
@@ -55,6 +69,7 @@ int main(int argc, char *argv[])
 	int ch;
     const char *config_filename = "/etc/fdir/client.conf";
     int count;
+    int ack_policy;
     FDIRClientClusterStatEntry stats[CLUSTER_MAX_SERVER_COUNT];
 	int result;
 
@@ -86,14 +101,15 @@ int main(int argc, char *argv[])
         return result;
     }
 
-    if ((result=fdir_client_cluster_stat(&g_fdir_client_vars.client_ctx,
-                    stats, CLUSTER_MAX_SERVER_COUNT, &count)) != 0)
+    if ((result=fdir_client_cluster_stat_ex(&g_fdir_client_vars.client_ctx,
+                    stats, CLUSTER_MAX_SERVER_COUNT, &count,
+                    &ack_policy)) != 0)
     {
         fprintf(stderr, "fdir_client_cluster_stat fail, "
                 "errno: %d, error info: %s\n", result, STRERROR(result));
         return result;
     }
 
-    output(stats, count);
+    output(stats, count, ack_policy);
     return 0;
 }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastdir/client/fdir_client.h"
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename] <-n namespace> "
+            "[-i inode_quota] [-b bytes_quota]\n"
+            "\tset the quota when -i or -b specified, 0 for unlimited\n"
+            "\tsetting the quota is allowed on the cluster servers only\n"
+            "\tthe bytes quota can be followed by the unit: "
+            "K, M, G or T\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+	int ch;
+    const char *config_filename = "/etc/fdir/client.conf";
+    char *ns;
+    char *inodes;
+    char *bytes;
+    string_t nsname;
+    FDIRNamespaceQuota quota;
+    FDIRNamespaceStat stat;
+    FDIRNamespaceStat old_stat;
+	int result;
+
+    if (argc < 2) {
+        usage(argv);
+        return 1;
+    }
+
+    ns = inodes = bytes = NULL;
+    while ((ch=getopt(argc, argv, "hc:n:i:b:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'i':
+                inodes = optarg;
+                break;
+            case 'b':
+                bytes = optarg;
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    if (ns == NULL) {
+        usage(argv);
+        return 1;
+    }
+
+    log_init();
+    //g_log_context.log_level = LOG_DEBUG;
+
+    if ((result=fdir_client_simple_init(config_filename)) != 0) {
+        return result;
+    }
+
+    FC_SET_STRING(nsname, ns);
+    if (inodes != NULL || bytes != NULL) {
+        //keep the unspecified one
+        if ((result=fdir_client_namespace_stat_ex(&g_fdir_client_vars.
+                        client_ctx, &nsname, &old_stat)) != 0)
+        {
+            return result;
+        }
+        quota = old_stat.quota;
+
+        if (inodes != NULL) {
+            quota.inodes = strtoll(inodes, NULL, 10);
+        }
+        if (bytes != NULL && (result=parse_bytes(bytes, 1,
+                        &quota.bytes)) != 0)
+        {
+            fprintf(stderr, "invalid bytes quota: %s\n", bytes);
+            return result;
+        }
+        if (quota.inodes < 0 || quota.bytes < 0) {
+            fprintf(stderr, "the quota can't be negative\n");
+            return EINVAL;
+        }
+
+        if ((result=fdir_client_namespace_set_quota(&g_fdir_client_vars.
+                        client_ctx, &nsname, &quota)) != 0)
+        {
+            fprintf(stderr, "set quota fail, errno: %d, error info: %s\n",
+                    result, STRERROR(result));
+            return result;
+        }
+    }
+
+    if ((result=fdir_client_namespace_stat_ex(&g_fdir_client_vars.
+                    client_ctx, &nsname, &stat)) != 0)
+    {
+        return result;
+    }
+
+    printf("namespace: %s\n"
+            "inode {quota: %"PRId64", total: %"PRId64", used: %"PRId64", "
+            "avail: %"PRId64"}\n"
+            "space {quota: %"PRId64", used: %"PRId64"}\n", ns,
+            stat.quota.inodes, stat.inode.total, stat.inode.used,
+            stat.inode.avail, stat.quota.bytes, stat.used_bytes);
+    return 0;
+}
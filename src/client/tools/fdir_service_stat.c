@@ -41,7 +41,16 @@ static void output(FDIRClientServiceStat *stat)
             "current_inode_sn: %"PRId64", "
             "ns_count: %"PRId64", "
             "dir_count: %"PRId64", "
-            "file_count: %"PRId64"}\n\n",
+            "file_count: %"PRId64"}\n"
+            "\tinode_hashtable : {capacity: %"PRId64", "
+            "count: %"PRId64", load_factor: %.2f, "
+            "max_chain_length: %d, resizing: %d}\n"
+            "\tpath_cache : {capacity: %"PRId64", count: %"PRId64", "
+            "hit_count: %"PRId64", miss_count: %"PRId64", "
+            "hit_ratio: %.2f%%}\n"
+            "\tname_intern : {count: %"PRId64", refer_count: %"PRId64", "
+            "saved_bytes: %"PRId64"}\n"
+            "\treclaim : {epoch: %"PRId64", waiting_count: %"PRId64"}\n\n",
             stat->server_id, stat->status,
             fdir_get_server_status_caption(stat->status),
             stat->is_master,
@@ -51,7 +60,26 @@ static void output(FDIRClientServiceStat *stat)
             stat->dentry.current_inode_sn,
             stat->dentry.counters.ns,
             stat->dentry.counters.dir,
-            stat->dentry.counters.file
+            stat->dentry.counters.file,
+            stat->inode_hashtable.capacity,
+            stat->inode_hashtable.count,
+            stat->inode_hashtable.capacity > 0 ?
+            (double)stat->inode_hashtable.count /
+            stat->inode_hashtable.capacity : 0.00,
+            stat->inode_hashtable.max_chain_length,
+            stat->inode_hashtable.resizing,
+            stat->path_cache.capacity,
+            stat->path_cache.count,
+            stat->path_cache.hit_count,
+            stat->path_cache.miss_count,
+            (stat->path_cache.hit_count + stat->path_cache.miss_count) > 0 ?
+            100.00 * stat->path_cache.hit_count / (stat->path_cache.
+                hit_count + stat->path_cache.miss_count) : 0.00,
+            stat->name_intern.count,
+            stat->name_intern.refer_count,
+            stat->name_intern.saved_bytes,
+            stat->reclaim.epoch,
+            stat->reclaim.waiting_count
           );
 }
 
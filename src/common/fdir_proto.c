@@ -45,6 +45,20 @@ const char *fdir_get_server_status_caption(const int status)
     }
 }
 
+const char *fdir_get_replica_ack_policy_caption(const int policy)
+{
+    switch (policy) {
+        case FDIR_REPLICA_ACK_POLICY_ALL:
+            return FDIR_REPLICA_ACK_POLICY_ALL_STR;
+        case FDIR_REPLICA_ACK_POLICY_MAJORITY:
+            return FDIR_REPLICA_ACK_POLICY_MAJORITY_STR;
+        case FDIR_REPLICA_ACK_POLICY_ASYNC:
+            return FDIR_REPLICA_ACK_POLICY_ASYNC_STR;
+        default:
+            return "unkown";
+    }
+}
+
 const char *fdir_get_cmd_caption(const int cmd)
 {
     switch (cmd) {
@@ -158,6 +172,14 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "LIST_DENTRY_BY_INODE_REQ";
         case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ:
             return "LIST_DENTRY_NEXT_REQ";
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_STREAM_REQ:
+            return "LIST_DENTRY_STREAM_REQ";
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_BY_NAME_REQ:
+            return "LIST_DENTRY_NEXT_BY_NAME_REQ";
+        case FDIR_SERVICE_PROTO_COMPOUND_REQ:
+            return "COMPOUND_REQ";
+        case FDIR_SERVICE_PROTO_COMPOUND_RESP:
+            return "COMPOUND_RESP";
         case FDIR_SERVICE_PROTO_LIST_DENTRY_RESP:
             return "LIST_DENTRY_RESP";
         case FDIR_SERVICE_PROTO_SERVICE_STAT_REQ:
@@ -184,6 +206,16 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "GET_READABLE_SERVER_REQ";
         case FDIR_SERVICE_PROTO_GET_READABLE_SERVER_RESP:
             return "GET_READABLE_SERVER_RESP";
+        case FDIR_SERVICE_PROTO_SET_READ_VERSION_REQ:
+            return "SET_READ_VERSION_REQ";
+        case FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_REQ:
+            return "DENTRY_USAGE_BY_PATH_REQ";
+        case FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_RESP:
+            return "DENTRY_USAGE_BY_PATH_RESP";
+        case FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_REQ:
+            return "NAMESPACE_SET_QUOTA_REQ";
+        case FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_RESP:
+            return "NAMESPACE_SET_QUOTA_RESP";
         case FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ:
             return "GET_SERVER_STATUS_REQ";
         case FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_RESP:
@@ -208,6 +240,10 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "PUSH_BINLOG_RESP";
         case FDIR_REPLICA_PROTO_NOTIFY_SLAVE_QUIT:
             return "NOTIFY_SLAVE_QUIT";
+        case FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_REQ:
+            return "PUSH_SNAPSHOT_REQ";
+        case FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_RESP:
+            return "PUSH_SNAPSHOT_RESP";
         default:
             return sf_get_cmd_caption(cmd);
     }
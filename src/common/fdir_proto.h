@@ -49,6 +49,15 @@
 #define FDIR_SERVICE_PROTO_RENAME_BY_PNAME_REQ      33
 #define FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP     34
 
+//the credit for the next pushed frame of the streaming list
+#define FDIR_SERVICE_PROTO_LIST_DENTRY_STREAM_REQ   35
+//list the next page after the name cursor
+#define FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_BY_NAME_REQ  36
+
+//the operations of the compound request are executed in order
+#define FDIR_SERVICE_PROTO_COMPOUND_REQ             37
+#define FDIR_SERVICE_PROTO_COMPOUND_RESP            38
+
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ    39
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ   40
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ       41
@@ -102,6 +111,18 @@
 #define FDIR_SERVICE_PROTO_GET_READABLE_SERVER_REQ  83
 #define FDIR_SERVICE_PROTO_GET_READABLE_SERVER_RESP 84
 
+/* the min data version for the next read request on this connection,
+ * without response, the slave waits for the version before the read
+ */
+#define FDIR_SERVICE_PROTO_SET_READ_VERSION_REQ     85
+
+//the recursive usage of the directory (du), O(1) by the counters
+#define FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_REQ  86
+#define FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_RESP 87
+
+#define FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_REQ   88
+#define FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_RESP  89
+
 //cluster commands
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ    91
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_RESP   92
@@ -117,6 +138,8 @@
 #define FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ          103
 #define FDIR_REPLICA_PROTO_PUSH_BINLOG_RESP         104
 #define FDIR_REPLICA_PROTO_NOTIFY_SLAVE_QUIT        105  //when slave binlog not consistent
+#define FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_REQ        107  //for the empty slave
+#define FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_RESP       108
 
 typedef SFCommonProtoHeader  FDIRProtoHeader;
 
@@ -286,6 +309,45 @@ typedef struct fdir_proto_stat_dentry_resp {
     FDIRProtoDEntryStat stat;
 } FDIRProtoStatDEntryResp;
 
+typedef struct fdir_proto_dentry_usage_resp {
+    char file_count[8];
+    char dir_count[8];
+    char bytes[8];
+} FDIRProtoDEntryUsageResp;
+
+typedef struct fdir_proto_set_read_version_req {
+    char data_version[8];
+} FDIRProtoSetReadVersionReq;
+
+/* appended to the response body of the successful update request,
+ * only for the connection joined with FDIR_CLIENT_JOIN_FLAGS_UPDATE_DATA_VERSION
+ */
+typedef struct fdir_proto_update_resp_trailer {
+    char data_version[8];  //for the read-your-writes on the slaves
+} FDIRProtoUpdateRespTrailer;
+
+typedef struct fdir_proto_compound_req_header {
+    char count[4];  //operation count
+    char padding[4];
+} FDIRProtoCompoundReqHeader;
+
+typedef struct fdir_proto_compound_op_header {
+    char body_len[4];   //the body is same as the single request
+    unsigned char cmd;  //the request cmd of the single request
+    char padding[3];
+} FDIRProtoCompoundOpHeader;
+
+typedef struct fdir_proto_compound_resp_header {
+    char count[4];  //operation count
+    char padding[4];
+} FDIRProtoCompoundRespHeader;
+
+typedef struct fdir_proto_compound_op_result {
+    char status[2];  //the errno of the operation
+    char padding[6];
+    FDIRProtoStatDEntryResp dentry;  //valid when status is 0
+} FDIRProtoCompoundOpResult;
+
 typedef struct fdir_proto_flock_dentry_req {
     char inode[8];
     char offset[8];  /* lock region offset */
@@ -344,19 +406,32 @@ typedef struct fdir_proto_list_dentry_by_path_body {
     FDIRProtoDEntryInfo dentry;
 } FDIRProtoListDEntryByPathBody;
 
+//for the old clients, list the next page after the offset
 typedef struct fdir_proto_list_dentry_next_body {
-    char token[8];
-    char offset[4];    //for check, must be same with server's
+    char token[8];     //the inode of the list response
+    char offset[4];    //the count of the listed entries
     char padding[4];
 } FDIRProtoListDEntryNextBody;
 
+typedef struct fdir_proto_list_dentry_next_by_name_body {
+    char inode[8];          //the directory inode
+    unsigned char name_len; //the cursor, list the names greater than it
+    char name_str[0];
+} FDIRProtoListDEntryNextByNameBody;
+
 typedef struct fdir_proto_list_dentry_resp_body_header {
-    char token[8];
+    char inode[8];  //the listed dentry inode for the next list
     char count[4];
     char is_last;
-    char padding[3];
+    char padding;
+    char stream_token[2];  //for the stream credits of the first page
 } FDIRProtoListDEntryRespBodyHeader;
 
+typedef struct fdir_proto_list_dentry_stream_body {
+    char stream_token[2];  //the token of the first page
+    char padding[6];
+} FDIRProtoListDEntryStreamBody;
+
 typedef struct fdir_proto_list_dentry_resp_body_part {
     char inode[8];
     FDIRProtoDEntryStat stat;
@@ -383,10 +458,42 @@ typedef struct fdir_proto_service_stat_resp {
             char file[8];
         } counters;
     } dentry;
+
+    struct {
+        char capacity[8];
+        char count[8];
+        char max_chain_length[4];
+        char resizing;
+    } inode_hashtable;
+
+    struct {
+        char capacity[8];
+        char count[8];
+        char hit_count[8];
+        char miss_count[8];
+    } path_cache;
+
+    struct {
+        char count[8];
+        char refer_count[8];
+        char saved_bytes[8];
+    } name_intern;
+
+    struct {
+        char epoch[8];
+        char waiting_count[8];  //the retired objects not freed yet
+    } reclaim;
 } FDIRProtoServiceStatResp;
 
+typedef struct fdir_proto_server_load {
+    char in_flight[4];       //the service requests in progress
+    char p99_latency_us[4];  //of the service requests in the last second
+} FDIRProtoServerLoad;
+
 typedef struct fdir_proto_cluster_stat_resp_body_header {
     char count[4];
+    char replica_ack_policy;
+    char padding[3];
 } FDIRProtoClusterStatRespBodyHeader;
 
 typedef struct fdir_proto_cluster_stat_resp_body_part {
@@ -395,6 +502,17 @@ typedef struct fdir_proto_cluster_stat_resp_body_part {
     char status;
     char ip_addr[IP_ADDRESS_SIZE];
     char port[2];
+    struct {
+        char acked_count[8];
+        char satisfied_count[8];
+        char late_count[8];
+    } replica_ack;  //the slave acks counted by the master
+    struct {
+        char data_versions[8];
+        char delay_ms[4];
+        char padding[4];
+    } replica_lag;
+    FDIRProtoServerLoad load;
 } FDIRProtoClusterStatRespBodyPart;
 
 typedef struct fdir_proto_namespace_stat_req {
@@ -402,14 +520,27 @@ typedef struct fdir_proto_namespace_stat_req {
     char ns_str[0];       //namespace string
 } FDIRProtoNamespaceStatReq;
 
+typedef struct fdir_proto_namespace_quota {
+    char inodes[8];
+    char bytes[8];
+} FDIRProtoNamespaceQuota;
+
 typedef struct fdir_proto_namespace_stat_resp {
     struct {
         char total[8];
         char used[8];
         char avail[8];
     } inode_counters;
+    char used_bytes[8];
+    FDIRProtoNamespaceQuota quota;
 } FDIRProtoNamespaceStatResp;
 
+typedef struct fdir_proto_namespace_set_quota_req {
+    FDIRProtoNamespaceQuota quota;  //0 for unlimited
+    unsigned char ns_len; //namespace length
+    char ns_str[0];       //namespace string
+} FDIRProtoNamespaceSetQuotaReq;
+
 /* for FDIR_SERVICE_PROTO_GET_MASTER_RESP and
    FDIR_SERVICE_PROTO_GET_READABLE_SERVER_RESP
    */
@@ -475,14 +606,27 @@ typedef struct fdir_proto_notify_slave_quit {
     char first_unmatched_dv[8];   //the slave's first unmatched data version
 } FDIRProtoNotifySlaveQuit;
 
+//the load of the slave
+typedef struct fdir_proto_ping_master_req {
+    FDIRProtoServerLoad load;
+} FDIRProtoPingMasterReq;
+
 typedef struct fdir_proto_ping_master_resp_header {
     char inode_sn[8];  //current inode sn of master
     char server_count[4];
+    char status_changed;  //the status is set only when changed
+    char padding[3];
 } FDIRProtoPingMasterRespHeader;
 
 typedef struct fdir_proto_ping_master_resp_body_part {
     char server_id[4];
     char status;
+    char padding[3];
+    struct {
+        char data_versions[8];
+        char delay_ms[4];
+    } replica_lag;
+    FDIRProtoServerLoad load;
 } FDIRProtoPingMasterRespBodyPart;
 
 typedef struct fdir_proto_push_binlog_req_body_header {
@@ -493,8 +637,18 @@ typedef struct fdir_proto_push_binlog_req_body_header {
     } data_version;
 } FDIRProtoPushBinlogReqBodyHeader;
 
+//the chunk of the checkpoint file, the slave responds for each chunk
+typedef struct fdir_proto_push_snapshot_req_body_header {
+    char file_size[8];
+    char offset[8];
+    char length[4];
+    char diverged;    //the binlog of the slave diverged from the master
+    char padding[3];
+} FDIRProtoPushSnapshotReqBodyHeader;
+
 typedef struct fdir_proto_push_binlog_resp_body_header {
     char count[4];
+    char credits[4];  //the push requests granted to the master
 } FDIRProtoPushBinlogRespBodyHeader;
 
 typedef struct fdir_proto_push_binlog_resp_body_part {
@@ -549,6 +703,8 @@ static inline void fdir_proto_unpack_dentry_stat(const FDIRProtoDEntryStat *
 
 const char *fdir_get_server_status_caption(const int status);
 
+const char *fdir_get_replica_ack_policy_caption(const int policy);
+
 const char *fdir_get_cmd_caption(const int cmd);
 
 #ifdef __cplusplus
@@ -33,6 +33,7 @@
 
 #define FDIR_MAX_PATH_COUNT             128
 #define FDIR_BATCH_SET_MAX_DENTRY_COUNT 256
+#define FDIR_COMPOUND_MAX_OP_COUNT      256
 
 #define FDIR_SERVER_STATUS_INIT       0
 #define FDIR_SERVER_STATUS_BUILDING  10
@@ -40,7 +41,18 @@
 #define FDIR_SERVER_STATUS_SYNCING   22
 #define FDIR_SERVER_STATUS_ACTIVE    23
 
+//the slave acks the master waits for before the response
+#define FDIR_REPLICA_ACK_POLICY_ALL        0
+#define FDIR_REPLICA_ACK_POLICY_MAJORITY   1
+#define FDIR_REPLICA_ACK_POLICY_ASYNC      2
+
+#define FDIR_REPLICA_ACK_POLICY_ALL_STR       "all"
+#define FDIR_REPLICA_ACK_POLICY_MAJORITY_STR  "majority"
+#define FDIR_REPLICA_ACK_POLICY_ASYNC_STR     "async"
+
 #define FDIR_CLIENT_JOIN_FLAGS_IDEMPOTENCY_REQUEST  1
+//the successful update responses carry the data version trailer
+#define FDIR_CLIENT_JOIN_FLAGS_UPDATE_DATA_VERSION  2
 
 #define FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE   1  //file size
 #define FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC   2  //increase alloc space
@@ -104,6 +116,13 @@ typedef struct fdir_dentry_info {
     FDIRDEntryStatus stat;
 } FDIRDEntryInfo;
 
+//the recursive usage of the subtree
+typedef struct fdir_dentry_usage {
+    int64_t file_count;  //including the symlinks and the hard links
+    int64_t dir_count;
+    int64_t bytes;       //the size of the regular files
+} FDIRDEntryUsage;
+
 typedef union {
     int64_t flags;
     struct {
@@ -140,4 +159,16 @@ typedef struct fdir_set_dentry_size_info {
 
 typedef SFSpaceStat FDIRInodeStat;
 
+//the quota of the namespace, 0 for unlimited
+typedef struct fdir_namespace_quota {
+    int64_t inodes;
+    int64_t bytes;
+} FDIRNamespaceQuota;
+
+typedef struct fdir_namespace_stat {
+    FDIRInodeStat inode;  //the total is the inode quota when set
+    int64_t used_bytes;   //the size of the regular files
+    FDIRNamespaceQuota quota;
+} FDIRNamespaceStat;
+
 #endif
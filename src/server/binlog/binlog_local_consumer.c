@@ -35,6 +35,7 @@
 #include "binlog_write.h"
 #include "binlog_replication.h"
 #include "binlog_producer.h"
+#include "push_result_ring.h"
 #include "binlog_local_consumer.h"
 
 static FDIRSlaveReplicationArray slave_replication_array;
@@ -93,6 +94,9 @@ int binlog_local_consumer_init()
     if ((result=init_binlog_local_consumer_array()) != 0) {
         return result;
     }
+    if ((result=push_result_waiter_init()) != 0) {
+        return result;
+    }
     return binlog_write_init();
 }
 
@@ -171,18 +175,51 @@ static void push_to_slave_replica_queues(FDIRSlaveReplication *replication,
     }
 }
 
+static inline int get_ack_wait_count()
+{
+    if (REPLICA_ACK_POLICY == FDIR_REPLICA_ACK_POLICY_MAJORITY) {
+        //the master is one of the majority
+        return (slave_replication_array.count + 1) / 2;
+    } else {
+        return slave_replication_array.count;
+    }
+}
+
+static void alloc_ack_waiters(ServerBinlogRecordBuffer *rbuffer)
+{
+    struct fast_task_info *task;
+    int wait_count;
+    int count;
+    int i;
+
+    wait_count = get_ack_wait_count();
+    count = (rbuffer->group.count > 0 ? rbuffer->group.count : 1);
+    for (i=0; i<count; i++) {
+        task = (rbuffer->group.count > 0 ? rbuffer->group.tasks[i] :
+                (struct fast_task_info *)rbuffer->args);
+        rbuffer->waiters[i] = push_result_waiter_alloc(task,
+                wait_count, slave_replication_array.count);
+        if (rbuffer->waiters[i] == NULL) {
+            logError("file: "__FILE__", line: %d, "
+                    "alloc ack waiter fail, respond without waiting, "
+                    "data_version: %"PRId64, __LINE__,
+                    rbuffer->data_version.first + i);
+            sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+        }
+    }
+}
+
 int binlog_local_consumer_push_to_queues(ServerBinlogRecordBuffer *rbuffer)
 {
     FDIRSlaveReplication *replication;
     FDIRSlaveReplication *end;
-    struct fast_task_info *task;
 
     __sync_add_and_fetch(&rbuffer->reffer_count,
             slave_replication_array.count);
 
-    task = (struct fast_task_info *)rbuffer->args;
-    __sync_add_and_fetch(&((FDIRServerTaskArg *)task->arg)->context.
-            service.waiting_rpc_count, slave_replication_array.count);
+    if (rbuffer->wait_replica) {
+        alloc_ack_waiters(rbuffer);
+    }
 
     end = slave_replication_array.replications + slave_replication_array.count;
     for (replication=slave_replication_array.replications; replication<end;
@@ -190,5 +227,9 @@ int binlog_local_consumer_push_to_queues(ServerBinlogRecordBuffer *rbuffer)
         push_to_slave_replica_queues(replication, rbuffer);
     }
 
+    if (!rbuffer->wait_replica) {
+        //the reference for the producer
+        rbuffer->release_func(rbuffer);
+    }
     return 0;
 }
@@ -68,6 +68,8 @@
 #define BINLOG_RECORD_FIELD_NAME_HASH_CODE     "hc"
 #define BINLOG_RECORD_FIELD_NAME_INC_ALLOC     "ia"
 #define BINLOG_RECORD_FIELD_NAME_SRC_INODE     "si"
+#define BINLOG_RECORD_FIELD_NAME_QUOTA_INODES  "qi"
+#define BINLOG_RECORD_FIELD_NAME_QUOTA_BYTES   "qb"
 
 #define BINLOG_RECORD_FIELD_NAME_DEST_PARENT   BINLOG_RECORD_FIELD_NAME_PARENT
 #define BINLOG_RECORD_FIELD_NAME_DEST_SUBNAME  BINLOG_RECORD_FIELD_NAME_SUBNAME
@@ -95,10 +97,23 @@
 #define BINLOG_RECORD_FIELD_INDEX_HASH_CODE     ('h' * 256 + 'c')
 #define BINLOG_RECORD_FIELD_INDEX_INC_ALLOC     ('i' * 256 + 'a')
 #define BINLOG_RECORD_FIELD_INDEX_SRC_INODE     ('s' * 256 + 'i')
+#define BINLOG_RECORD_FIELD_INDEX_QUOTA_INODES  ('q' * 256 + 'i')
+#define BINLOG_RECORD_FIELD_INDEX_QUOTA_BYTES   ('q' * 256 + 'b')
 
 #define BINLOG_FIELD_TYPE_INTEGER   'i'
 #define BINLOG_FIELD_TYPE_STRING    's'
 
+#define BINLOG_BINARY_RECORD_HEADER_SIZE  3  //start magic + record length
+#define BINLOG_BINARY_RECORD_TAIL_SIZE    3  //record length + end magic
+
+#define BINLOG_IS_BINARY_RECORD(str) \
+    (*((const unsigned char *)(str)) == BINLOG_BINARY_RECORD_START_MAGIC)
+
+#define BINLOG_ZIGZAG_ENCODE(n) \
+    (((uint64_t)(n) << 1) ^ (uint64_t)((int64_t)(n) >> 63))
+#define BINLOG_ZIGZAG_DECODE(n) \
+    ((int64_t)((n) >> 1) ^ -(int64_t)((n) & 1))
+
 typedef struct {
     const char *name;
     int type;
@@ -111,12 +126,37 @@ typedef struct {
 typedef struct {
     const char *p;
     const char *rec_end;
+    bool binary;
     BinlogFieldValue fv;
     char *error_info;
     int error_size;
 } FieldParserContext;
 
 static FastCharConverter char_converter;
+static int64_t binary_fields_mask;
+
+static void binlog_init_binary_fields_mask()
+{
+    FDIRStatModifyFlags fields;
+
+    fields.flags = 0;
+    fields.path_info.ns = 1;
+    fields.path_info.subname = 1;
+    fields.hash_code = 1;
+    fields.link = 1;
+    fields.mode = 1;
+    fields.atime = 1;
+    fields.btime = 1;
+    fields.ctime = 1;
+    fields.mtime = 1;
+    fields.gid = 1;
+    fields.uid = 1;
+    fields.size = 1;
+    fields.inc_alloc = 1;
+    fields.space_end = 1;
+    fields.src_inode = 1;
+    binary_fields_mask = fields.flags;
+}
 
 int binlog_pack_init()
 {
@@ -132,6 +172,7 @@ int binlog_pack_init()
     FAST_CHAR_MAKE_PAIR(pairs[6], '<',  'l');
     FAST_CHAR_MAKE_PAIR(pairs[7], '>',  'g');
 
+    binlog_init_binary_fields_mask();
     return char_converter_init_ex(&char_converter, pairs,
             ESCAPE_CHAR_PAIR_COUNT, FAST_CHAR_OP_ADD_BACKSLASH);
 }
@@ -147,6 +188,8 @@ static inline const char *get_operation_label(const int operation)
             return BINLOG_OP_RENAME_DENTRY_STR;
         case BINLOG_OP_UPDATE_DENTRY_INT:
             return BINLOG_OP_UPDATE_DENTRY_STR;
+        case BINLOG_OP_SET_QUOTA_INT:
+            return BINLOG_OP_SET_QUOTA_STR;
         default:
             return BINLOG_OP_NONE_STR;
     }
@@ -170,6 +213,10 @@ static inline int get_operation_integer(const string_t *operation)
                 BINLOG_OP_RENAME_DENTRY_LEN))
     {
         return BINLOG_OP_RENAME_DENTRY_INT;
+    } else if (fc_string_equal2(operation, BINLOG_OP_SET_QUOTA_STR,
+                BINLOG_OP_SET_QUOTA_LEN))
+    {
+        return BINLOG_OP_SET_QUOTA_INT;
     } else {
         return BINLOG_OP_NONE_INT;
     }
@@ -211,7 +258,8 @@ static void binlog_pack_stringl(FastBuffer *buffer, const char *name,
     binlog_pack_stringl(buffer, name, value.str, value.len, true)
 
 
-int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
+static int binlog_pack_text_record(const FDIRBinlogRecord *record,
+        FastBuffer *buffer)
 {
     string_t op_caption;
     int old_len;
@@ -348,6 +396,10 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
 
         fast_buffer_append(buffer, " %s=%d",
                 BINLOG_RECORD_FIELD_NAME_FLAGS, record->rename.flags);
+    } else if (record->operation == BINLOG_OP_SET_QUOTA_INT) {
+        fast_buffer_append(buffer, " %s=%"PRId64" %s=%"PRId64,
+                BINLOG_RECORD_FIELD_NAME_QUOTA_INODES, record->quota.inodes,
+                BINLOG_RECORD_FIELD_NAME_QUOTA_BYTES, record->quota.bytes);
     }
 
     fast_buffer_append_buff(buffer, BINLOG_RECORD_END_TAG_STR,
@@ -367,6 +419,165 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
     return 0;
 }
 
+static inline void binlog_pack_varint(FastBuffer *buffer, uint64_t n)
+{
+    unsigned char *p;
+
+    p = (unsigned char *)buffer->data + buffer->length;
+    while (n >= 0x80) {
+        *p++ = (n & 0x7F) | 0x80;
+        n >>= 7;
+    }
+    *p++ = n;
+    buffer->length = (char *)p - buffer->data;
+}
+
+#define BINLOG_PACK_SVARINT(buffer, n) \
+    binlog_pack_varint(buffer, BINLOG_ZIGZAG_ENCODE(n))
+
+static inline void binlog_pack_binary_string(FastBuffer *buffer,
+        const string_t *s)
+{
+    binlog_pack_varint(buffer, s->len);
+    fast_buffer_append_buff(buffer, s->str, s->len);
+}
+
+static int binlog_pack_binary_record(const FDIRBinlogRecord *record,
+        FastBuffer *buffer)
+{
+    FDIRStatModifyFlags fields;
+    unsigned char *p;
+    int old_len;
+    int expect_len;
+    int record_len;
+    int result;
+
+    expect_len = 256;
+    if (record->options.path_info.flags != 0) {
+        expect_len += record->ns.len + record->me.pname.name.len;
+    }
+    if (record->options.link) {
+        expect_len += record->link.len;
+    }
+    if (record->operation == BINLOG_OP_RENAME_DENTRY_INT) {
+        expect_len += record->rename.src.pname.name.len;
+    }
+    if ((result=fast_buffer_check_capacity(buffer, expect_len)) != 0) {
+        return result;
+    }
+
+    fields.flags = record->options.flags & binary_fields_mask;
+    fields.hash_code = 1;
+    if (fields.path_info.flags != 0) {
+        if (record->me.pname.parent_inode == 0 &&
+                record->me.pname.name.len > 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "subname: %.*s, expect parent inode", __LINE__,
+                    record->me.pname.name.len, record->me.pname.name.str);
+            return EINVAL;
+        }
+        fields.path_info.ns = 1;
+        fields.path_info.subname = 1;
+    }
+
+    //reserve the header spaces
+    old_len = buffer->length;
+    buffer->length += BINLOG_BINARY_RECORD_HEADER_SIZE;
+
+    binlog_pack_varint(buffer, record->data_version);
+    binlog_pack_varint(buffer, record->inode);
+    *(buffer->data + buffer->length++) = record->operation;
+    binlog_pack_varint(buffer, (unsigned int)record->timestamp);
+    binlog_pack_varint(buffer, record->hash_code);
+    binlog_pack_varint(buffer, fields.flags);
+
+    if (fields.path_info.flags != 0) {
+        binlog_pack_binary_string(buffer, &record->ns);
+        binlog_pack_varint(buffer, record->me.pname.parent_inode);
+        binlog_pack_binary_string(buffer, &record->me.pname.name);
+    }
+    if (fields.link) {
+        binlog_pack_binary_string(buffer, &record->link);
+    }
+    if (fields.mode) {
+        binlog_pack_varint(buffer, (unsigned int)record->stat.mode);
+    }
+    if (fields.atime) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.atime);
+    }
+    if (fields.btime) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.btime);
+    }
+    if (fields.ctime) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.ctime);
+    }
+    if (fields.mtime) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.mtime);
+    }
+    if (fields.gid) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.gid);
+    }
+    if (fields.uid) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.uid);
+    }
+    if (fields.size) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.size);
+    }
+    if (fields.inc_alloc) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.alloc);
+    }
+    if (fields.space_end) {
+        BINLOG_PACK_SVARINT(buffer, record->stat.space_end);
+    }
+    if (fields.src_inode) {
+        binlog_pack_varint(buffer, record->hdlink.src_inode);
+    }
+
+    if (record->operation == BINLOG_OP_RENAME_DENTRY_INT) {
+        binlog_pack_varint(buffer, record->rename.src.pname.parent_inode);
+        binlog_pack_binary_string(buffer, &record->rename.src.pname.name);
+        binlog_pack_varint(buffer, (unsigned int)record->rename.flags);
+    } else if (record->operation == BINLOG_OP_SET_QUOTA_INT) {
+        binlog_pack_varint(buffer, record->quota.inodes);
+        binlog_pack_varint(buffer, record->quota.bytes);
+    }
+
+    record_len = (buffer->length + BINLOG_BINARY_RECORD_TAIL_SIZE) - old_len;
+    if (record_len > BINLOG_RECORD_MAX_SIZE) {
+        logError("file: "__FILE__", line: %d, "
+                "record length: %d is too large, exceeds %d",
+                __LINE__, record_len, BINLOG_RECORD_MAX_SIZE);
+        buffer->length = old_len;
+        return EOVERFLOW;
+    }
+
+    p = (unsigned char *)buffer->data + old_len;
+    *p = BINLOG_BINARY_RECORD_START_MAGIC;
+    short2buff(record_len, (char *)p + 1);
+
+    p = (unsigned char *)buffer->data + buffer->length;
+    short2buff(record_len, (char *)p);
+    *(p + 2) = BINLOG_BINARY_RECORD_END_MAGIC;
+    buffer->length += BINLOG_BINARY_RECORD_TAIL_SIZE;
+    return 0;
+}
+
+int binlog_pack_record_ex(const FDIRBinlogRecord *record,
+        FastBuffer *buffer, const int format)
+{
+    if (format == FDIR_BINLOG_FORMAT_BINARY) {
+        return binlog_pack_binary_record(record, buffer);
+    } else {
+        return binlog_pack_text_record(record, buffer);
+    }
+}
+
+int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
+{
+    return binlog_pack_record_ex(record, buffer, BINLOG_RECORD_FORMAT);
+}
+
 static int binlog_get_next_field_value(FieldParserContext *pcontext)
 {
     int remain;
@@ -616,6 +827,18 @@ static int binlog_set_field_value(FieldParserContext *pcontext,
                 record->options.src_inode = 1;
             }
             break;
+        case BINLOG_RECORD_FIELD_INDEX_QUOTA_INODES:
+            expect_type = BINLOG_FIELD_TYPE_INTEGER;
+            if (pcontext->fv.type == expect_type) {
+                record->quota.inodes = pcontext->fv.value.n;
+            }
+            break;
+        case BINLOG_RECORD_FIELD_INDEX_QUOTA_BYTES:
+            expect_type = BINLOG_FIELD_TYPE_INTEGER;
+            if (pcontext->fv.type == expect_type) {
+                record->quota.bytes = pcontext->fv.value.n;
+            }
+            break;
         default:
             sprintf(pcontext->error_info, "unkown field name: %.*s",
                     BINLOG_RECORD_FIELD_NAME_LENGTH, pcontext->fv.name);
@@ -636,7 +859,8 @@ static int binlog_set_field_value(FieldParserContext *pcontext,
 static int binlog_check_required_fields(FieldParserContext *pcontext,
         FDIRBinlogRecord *record)
 {
-    if (record->inode <= 0) {
+    //the set quota record is for the namespace without inode
+    if (record->inode <= 0 && record->operation != BINLOG_OP_SET_QUOTA_INT) {
         sprintf(pcontext->error_info, "expect inode field: %s",
                 BINLOG_RECORD_FIELD_NAME_INODE);
         return ENOENT;
@@ -765,7 +989,7 @@ static int binlog_parse_fields(FieldParserContext *pcontext,
 static inline int binlog_check_rec_length(const int len,
         FieldParserContext *pcontext)
 {
-    if (len < BINLOG_RECORD_MIN_SIZE) {
+    if (len < BINLOG_TEXT_RECORD_MIN_SIZE) {
         sprintf(pcontext->error_info, "string length: %d is too short", len);
         return EAGAIN;
     }
@@ -804,7 +1028,7 @@ static int binlog_check_record(const char *str, const int len,
         return EINVAL;
     }
 
-    if (record_len < BINLOG_RECORD_MIN_SIZE - BINLOG_RECORD_SIZE_STRLEN)
+    if (record_len < BINLOG_TEXT_RECORD_MIN_SIZE - BINLOG_RECORD_SIZE_STRLEN)
     {
         sprintf(pcontext->error_info, "record length: %d is too short",
                 record_len);
@@ -838,6 +1062,314 @@ static int binlog_check_record(const char *str, const int len,
     return 0;
 }
 
+static inline bool binlog_is_binary_record_start(const char *str,
+        const int len, FieldParserContext *pcontext)
+{
+    int record_len;
+    const char *rec_end;
+
+    if (len < BINLOG_BINARY_RECORD_MIN_SIZE) {
+        return false;
+    }
+
+    record_len = (unsigned short)buff2short(str + 1);
+    if (record_len < BINLOG_BINARY_RECORD_MIN_SIZE || record_len > len) {
+        return false;
+    }
+
+    rec_end = str + record_len;
+    if (*((const unsigned char *)rec_end - 1) !=
+            BINLOG_BINARY_RECORD_END_MAGIC ||
+            (unsigned short)buff2short(rec_end -
+                BINLOG_BINARY_RECORD_TAIL_SIZE) != record_len)
+    {
+        return false;
+    }
+
+    pcontext->binary = true;
+    pcontext->rec_end = rec_end;
+    pcontext->p = str + BINLOG_BINARY_RECORD_HEADER_SIZE;
+    return true;
+}
+
+static int binlog_check_binary_record(const char *str, const int len,
+        FieldParserContext *pcontext)
+{
+    int record_len;
+    const char *rec_end;
+
+    if (len < BINLOG_BINARY_RECORD_MIN_SIZE) {
+        sprintf(pcontext->error_info, "string length: %d is too short", len);
+        return EAGAIN;
+    }
+
+    record_len = (unsigned short)buff2short(str + 1);
+    if (record_len < BINLOG_BINARY_RECORD_MIN_SIZE) {
+        sprintf(pcontext->error_info, "record length: %d is too short",
+                record_len);
+        return EINVAL;
+    }
+    if (record_len > BINLOG_RECORD_MAX_SIZE) {
+        sprintf(pcontext->error_info, "record length: %d is too large",
+                record_len);
+        return EINVAL;
+    }
+    if (record_len > len) {
+        sprintf(pcontext->error_info, "record length: %d out of bound",
+                record_len);
+        return EOVERFLOW;
+    }
+
+    rec_end = str + record_len;
+    if (*((const unsigned char *)rec_end - 1) !=
+            BINLOG_BINARY_RECORD_END_MAGIC ||
+            (unsigned short)buff2short(rec_end -
+                BINLOG_BINARY_RECORD_TAIL_SIZE) != record_len)
+    {
+        sprintf(pcontext->error_info, "expect record end magic: 0x%02X "
+                "and record length: %d, but the tail is: 0x%02X and %d",
+                BINLOG_BINARY_RECORD_END_MAGIC, record_len,
+                *((const unsigned char *)rec_end - 1),
+                (unsigned short)buff2short(rec_end -
+                    BINLOG_BINARY_RECORD_TAIL_SIZE));
+        return EINVAL;
+    }
+
+    pcontext->binary = true;
+    pcontext->rec_end = rec_end;
+    pcontext->p = str + BINLOG_BINARY_RECORD_HEADER_SIZE;
+    return 0;
+}
+
+static int binlog_unpack_varint(FieldParserContext *pcontext,
+        const char *field_name, uint64_t *n)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    uint64_t value;
+    int shift;
+
+    p = (const unsigned char *)pcontext->p;
+    end = (const unsigned char *)pcontext->rec_end -
+        BINLOG_BINARY_RECORD_TAIL_SIZE;
+    value = 0;
+    shift = 0;
+    while (p < end && shift < 64) {
+        value |= (uint64_t)(*p & 0x7F) << shift;
+        if ((*p++ & 0x80) == 0) {
+            pcontext->p = (const char *)p;
+            *n = value;
+            return 0;
+        }
+        shift += 7;
+    }
+
+    snprintf(pcontext->error_info, pcontext->error_size,
+            "field: %s, invalid varint or out of bound", field_name);
+    return EINVAL;
+}
+
+static int binlog_unpack_binary_string(FieldParserContext *pcontext,
+        const char *field_name, string_t *s)
+{
+    uint64_t len;
+    int result;
+
+    if ((result=binlog_unpack_varint(pcontext, field_name, &len)) != 0) {
+        return result;
+    }
+
+    if (len > (pcontext->rec_end - BINLOG_BINARY_RECORD_TAIL_SIZE) -
+            pcontext->p)
+    {
+        snprintf(pcontext->error_info, pcontext->error_size,
+                "field: %s, value length: %"PRId64" out of bound",
+                field_name, (int64_t)len);
+        return EINVAL;
+    }
+
+    FC_SET_STRING_EX(*s, (char *)pcontext->p, len);
+    pcontext->p += len;
+    return 0;
+}
+
+#define BINLOG_UNPACK_VARINT(pcontext, field_name, var) \
+    do { \
+        uint64_t _n; \
+        if ((result=binlog_unpack_varint(pcontext, \
+                        field_name, &_n)) != 0) \
+        { \
+            return result; \
+        } \
+        var = _n; \
+    } while (0)
+
+#define BINLOG_UNPACK_SVARINT(pcontext, field_name, var) \
+    do { \
+        uint64_t _n; \
+        if ((result=binlog_unpack_varint(pcontext, \
+                        field_name, &_n)) != 0) \
+        { \
+            return result; \
+        } \
+        var = BINLOG_ZIGZAG_DECODE(_n); \
+    } while (0)
+
+static int binlog_parse_binary_fields(FieldParserContext *pcontext,
+        FDIRBinlogRecord *record)
+{
+    FDIRStatModifyFlags fields;
+    const char *fields_end;
+    int result;
+
+    fields_end = pcontext->rec_end - BINLOG_BINARY_RECORD_TAIL_SIZE;
+    BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_DATA_VERSION,
+            record->data_version);
+    BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_INODE,
+            record->inode);
+    if (pcontext->p >= fields_end) {
+        sprintf(pcontext->error_info, "expect operation field: %s",
+                BINLOG_RECORD_FIELD_NAME_OPERATION);
+        return EINVAL;
+    }
+    record->operation = *((const unsigned char *)pcontext->p++);
+    if (record->operation > BINLOG_OP_SET_QUOTA_INT) {
+        record->operation = BINLOG_OP_NONE_INT;
+    }
+    BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_TIMESTAMP,
+            record->timestamp);
+    BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_HASH_CODE,
+            record->hash_code);
+
+    BINLOG_UNPACK_VARINT(pcontext, "field bitmap", fields.flags);
+    if ((fields.flags & ~binary_fields_mask) != 0) {
+        sprintf(pcontext->error_info, "unkown fields in the bitmap: "
+                "0x%"PRIX64, (uint64_t)fields.flags);
+        return EINVAL;
+    }
+    record->options.flags = fields.flags;
+
+    if (fields.path_info.flags != 0) {
+        if ((result=binlog_unpack_binary_string(pcontext,
+                        BINLOG_RECORD_FIELD_NAME_NAMESPACE,
+                        &record->ns)) != 0)
+        {
+            return result;
+        }
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_PARENT,
+                record->me.pname.parent_inode);
+        if ((result=binlog_unpack_binary_string(pcontext,
+                        BINLOG_RECORD_FIELD_NAME_SUBNAME,
+                        &record->me.pname.name)) != 0)
+        {
+            return result;
+        }
+    }
+    if (fields.link) {
+        if ((result=binlog_unpack_binary_string(pcontext,
+                        BINLOG_RECORD_FIELD_NAME_LINK,
+                        &record->link)) != 0)
+        {
+            return result;
+        }
+    }
+    if (fields.mode) {
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_MODE,
+                record->stat.mode);
+    }
+    if (fields.atime) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_ATIME,
+                record->stat.atime);
+    }
+    if (fields.btime) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_BTIME,
+                record->stat.btime);
+    }
+    if (fields.ctime) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_CTIME,
+                record->stat.ctime);
+    }
+    if (fields.mtime) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_MTIME,
+                record->stat.mtime);
+    }
+    if (fields.gid) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_GID,
+                record->stat.gid);
+    }
+    if (fields.uid) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_UID,
+                record->stat.uid);
+    }
+    if (fields.size) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_FILE_SIZE,
+                record->stat.size);
+    }
+    if (fields.inc_alloc) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_INC_ALLOC,
+                record->stat.alloc);
+    }
+    if (fields.space_end) {
+        BINLOG_UNPACK_SVARINT(pcontext, BINLOG_RECORD_FIELD_NAME_SPACE_END,
+                record->stat.space_end);
+    }
+    if (fields.src_inode) {
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_SRC_INODE,
+                record->hdlink.src_inode);
+    }
+
+    if (record->operation == BINLOG_OP_RENAME_DENTRY_INT) {
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_SRC_PARENT,
+                record->rename.src.pname.parent_inode);
+        if ((result=binlog_unpack_binary_string(pcontext,
+                        BINLOG_RECORD_FIELD_NAME_SRC_SUBNAME,
+                        &record->rename.src.pname.name)) != 0)
+        {
+            return result;
+        }
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_FLAGS,
+                record->rename.flags);
+    } else if (record->operation == BINLOG_OP_SET_QUOTA_INT) {
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_QUOTA_INODES,
+                record->quota.inodes);
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_QUOTA_BYTES,
+                record->quota.bytes);
+    }
+
+    if (pcontext->p != fields_end) {
+        sprintf(pcontext->error_info, "%d unexpect bytes after the fields",
+                (int)(fields_end - pcontext->p));
+        return EINVAL;
+    }
+
+    return binlog_check_required_fields(pcontext, record);
+}
+
+static inline int binlog_check_any_record(const char *str, const int len,
+        FieldParserContext *pcontext)
+{
+    if (len > 0 && BINLOG_IS_BINARY_RECORD(str)) {
+        return binlog_check_binary_record(str, len, pcontext);
+    } else {
+        pcontext->binary = false;
+        return binlog_check_record(str, len, pcontext);
+    }
+}
+
+static inline int binlog_parse_any_first_field(
+        FieldParserContext *pcontext, FDIRBinlogRecord *record)
+{
+    int result;
+
+    if (pcontext->binary) {
+        BINLOG_UNPACK_VARINT(pcontext, BINLOG_RECORD_FIELD_NAME_DATA_VERSION,
+                record->data_version);
+        return 0;
+    } else {
+        return binlog_parse_first_field(pcontext, record);
+    }
+}
+
 #define BINLOG_PACK_SET_ERROR_INFO(pcontext, errinfo, errsize) \
     do { \
         *errinfo = '\0';   \
@@ -854,13 +1386,17 @@ int binlog_unpack_record(const char *str, const int len,
 
     memset(record, 0, (long)(&((FDIRBinlogRecord*)0)->notify));
     BINLOG_PACK_SET_ERROR_INFO(pcontext, error_info, error_size);
-    if ((result=binlog_check_record(str, len, &pcontext)) != 0) {
+    if ((result=binlog_check_any_record(str, len, &pcontext)) != 0) {
         *record_end = NULL;
         return result;
     }
 
     *record_end = pcontext.rec_end;
-    return binlog_parse_fields(&pcontext, record);
+    if (pcontext.binary) {
+        return binlog_parse_binary_fields(&pcontext, record);
+    } else {
+        return binlog_parse_fields(&pcontext, record);
+    }
 }
 
 int binlog_detect_record(const char *str, const int len,
@@ -872,11 +1408,11 @@ int binlog_detect_record(const char *str, const int len,
     int result;
 
     BINLOG_PACK_SET_ERROR_INFO(pcontext, error_info, error_size);
-    if ((result=binlog_check_record(str, len, &pcontext)) != 0) {
+    if ((result=binlog_check_any_record(str, len, &pcontext)) != 0) {
         return result;
     }
 
-    if ((result=binlog_parse_first_field(&pcontext, &record)) != 0) {
+    if ((result=binlog_parse_any_first_field(&pcontext, &record)) != 0) {
         return result;
     }
 
@@ -891,7 +1427,7 @@ static bool binlog_is_record_start(const char *str, const int len,
     int record_len;
     const char *rec_start;
 
-    if (len < BINLOG_RECORD_MIN_SIZE) {
+    if (len < BINLOG_TEXT_RECORD_MIN_SIZE) {
         return false;
     }
 
@@ -918,41 +1454,52 @@ static bool binlog_is_record_start(const char *str, const int len,
                 BINLOG_RECORD_END_TAG_STR,
                 BINLOG_RECORD_END_TAG_LEN) == 0)
     {
+        pcontext->binary = false;
         pcontext->p = rec_start + BINLOG_RECORD_START_TAG_LEN;
         return true;
     }
     return false;
 }
 
+/* check the record start of any format at the position p,
+ * p is the start magic of the binary record or the start tag
+ * char of the text record
+ */
+static inline bool binlog_is_any_record_start(const char *str,
+        const char *end, const char *p, const char **start,
+        FieldParserContext *pcontext)
+{
+    if (BINLOG_IS_BINARY_RECORD(p)) {
+        *start = p;
+        return binlog_is_binary_record_start(p, end - p, pcontext);
+    } else if (*p == BINLOG_RECORD_START_TAG_CHAR) {
+        *start = p - BINLOG_RECORD_SIZE_STRLEN;
+        return (*start >= str) && binlog_is_record_start(
+                *start, end - *start, pcontext);
+    } else {
+        return false;
+    }
+}
+
 int binlog_detect_record_forward(const char *str, const int len,
         int64_t *data_version, int *rstart_offset, int *rend_offset,
         char *error_info, const int error_size)
 {
     FDIRBinlogRecord record;
     FieldParserContext pcontext;
-    const char *rec_start;
+    const char *start;
     const char *p;
     const char *end;
     int result;
 
     BINLOG_PACK_SET_ERROR_INFO(pcontext, error_info, error_size);
     *rstart_offset = -1;
-    p = str;
     end = str + len;
-    while ((end - p >= BINLOG_RECORD_MIN_SIZE) && (rec_start=
-                (const char *)memchr(p, BINLOG_RECORD_START_TAG_CHAR,
-                    end - p)) != NULL)
-    {
-        const char *start;
-        start = rec_start - BINLOG_RECORD_SIZE_STRLEN;
-        if ((start >= str) && binlog_is_record_start(
-                    start, end - start, &pcontext))
-        {
+    for (p=str; end - p >= BINLOG_ANY_RECORD_MIN_SIZE; p++) {
+        if (binlog_is_any_record_start(str, end, p, &start, &pcontext)) {
             *rstart_offset = start - str;
             break;
         }
-
-        p = rec_start + 1;
     }
 
     if (*rstart_offset < 0) {
@@ -960,7 +1507,7 @@ int binlog_detect_record_forward(const char *str, const int len,
         return ENOENT;
     }
 
-    if ((result=binlog_parse_first_field(&pcontext, &record)) != 0) {
+    if ((result=binlog_parse_any_first_field(&pcontext, &record)) != 0) {
         return result;
     }
 
@@ -976,30 +1523,24 @@ int binlog_detect_record_reverse(const char *str, const int len,
     FDIRBinlogRecord record;
     FieldParserContext pcontext;
     const char *start;
-    const char *rec_start;
+    const char *p;
+    const char *end;
     int offset;
-    int l;
     int result;
 
     BINLOG_PACK_SET_ERROR_INFO(pcontext, error_info, error_size);
-    if ((result=binlog_check_rec_length(len, &pcontext)) != 0) {
-        return result;
+    if (len < BINLOG_ANY_RECORD_MIN_SIZE) {
+        sprintf(error_info, "string length: %d is too short", len);
+        return EAGAIN;
     }
 
     offset = -1;
-    l = len;
-    while (l > 0 && (rec_start=fc_memrchr(str,
-                    BINLOG_RECORD_START_TAG_CHAR, l)) != NULL)
-    {
-        start = rec_start - BINLOG_RECORD_SIZE_STRLEN;
-        if ((start >= str) && binlog_is_record_start(
-                    start, len - (start - str), &pcontext))
-        {
+    end = str + len;
+    for (p=end - BINLOG_ANY_RECORD_MIN_SIZE; p >= str; p--) {
+        if (binlog_is_any_record_start(str, end, p, &start, &pcontext)) {
             offset = start - str;
             break;
         }
-
-        l = (rec_start - 1) - str;
     }
 
     if (offset < 0) {
@@ -1011,7 +1552,7 @@ int binlog_detect_record_reverse(const char *str, const int len,
         *rec_end = pcontext.rec_end;
     }
 
-    if ((result=binlog_parse_first_field(&pcontext, &record)) != 0) {
+    if ((result=binlog_parse_any_first_field(&pcontext, &record)) != 0) {
         return result;
     }
 
@@ -1019,23 +1560,49 @@ int binlog_detect_record_reverse(const char *str, const int len,
     return 0;
 }
 
+static inline bool binlog_is_binary_record_end(const char *str,
+        const char *rec_end)
+{
+    int record_len;
+    const char *start;
+
+    if (rec_end - str < BINLOG_BINARY_RECORD_MIN_SIZE) {
+        return false;
+    }
+
+    record_len = (unsigned short)buff2short(rec_end -
+            BINLOG_BINARY_RECORD_TAIL_SIZE);
+    if (record_len < BINLOG_BINARY_RECORD_MIN_SIZE ||
+            record_len > rec_end - str)
+    {
+        return false;
+    }
+
+    start = rec_end - record_len;
+    return BINLOG_IS_BINARY_RECORD(start) &&
+        (unsigned short)buff2short(start + 1) == record_len;
+}
+
 int binlog_detect_last_record_end(const char *str, const int len,
         const char **rec_end)
 {
-    int l;
+    const char *p;
 
-    l = len;
-    while (l > 0 && (*rec_end=fc_memrchr(str,
-                    BINLOG_RECORD_END_TAG_CHAR, l)) != NULL)
-    {
-        *rec_end += 1;
-        l = *rec_end - str;
-        if ((l >= BINLOG_RECORD_END_TAG_LEN) && memcmp(
-                    *rec_end - BINLOG_RECORD_END_TAG_LEN,
-                    BINLOG_RECORD_END_TAG_STR,
-                    BINLOG_RECORD_END_TAG_LEN) == 0)
-        {
-            return 0;
+    for (p=str + len - 1; p >= str; p--) {
+        if (*((const unsigned char *)p) == BINLOG_BINARY_RECORD_END_MAGIC) {
+            if (binlog_is_binary_record_end(str, p + 1)) {
+                *rec_end = p + 1;
+                return 0;
+            }
+        } else if (*p == BINLOG_RECORD_END_TAG_CHAR) {
+            if ((p + 1 - str >= BINLOG_RECORD_END_TAG_LEN) && memcmp(
+                        p + 1 - BINLOG_RECORD_END_TAG_LEN,
+                        BINLOG_RECORD_END_TAG_STR,
+                        BINLOG_RECORD_END_TAG_LEN) == 0)
+            {
+                *rec_end = p + 1;
+                return 0;
+            }
         }
     }
 
@@ -21,18 +21,39 @@
 #include "binlog_types.h"
 
 #define BINLOG_RECORD_MIN_SIZE            64
+#define BINLOG_TEXT_RECORD_MIN_SIZE       BINLOG_RECORD_MIN_SIZE
+#define BINLOG_BINARY_RECORD_MIN_SIZE     12
 #define BINLOG_RECORD_MAX_SIZE          9999
 #define BINLOG_RECORD_SIZE_STRLEN          4
 #define BINLOG_RECORD_SIZE_PRINTF_FMT  "%04d"
 
+//the min record size of all formats, for the record detection only
+#define BINLOG_ANY_RECORD_MIN_SIZE  BINLOG_BINARY_RECORD_MIN_SIZE
+
+/* the binary record:
+ *   start magic (1 byte) + record length (2 bytes) +
+ *   data version, inode, operation (1 byte), timestamp, hash code,
+ *   field bitmap (the flags of FDIRStatModifyFlags) and the fields +
+ *   record length (2 bytes) + end magic (1 byte)
+ * the integers are varint encoded, the strings are length prefixed
+ * without escape. the text record starts with a digit, so the format
+ * is detected by the first byte of each record
+ */
+#define BINLOG_BINARY_RECORD_START_MAGIC  0xFD
+#define BINLOG_BINARY_RECORD_END_MAGIC    0xDF
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int binlog_pack_init();
 
+//pack with the format of BINLOG_RECORD_FORMAT
 int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer);
 
+int binlog_pack_record_ex(const FDIRBinlogRecord *record,
+        FastBuffer *buffer, const int format);
+
 int binlog_unpack_record(const char *str, const int len,
         FDIRBinlogRecord *record, const char **record_end,
         char *error_info, const int error_size);
@@ -68,12 +68,16 @@ static void *producer_thread_func(void *arg);
 
 int record_buffer_alloc_init_func(void *element, void *args)
 {
-    FastBuffer *buffer;
+    ServerBinlogRecordBuffer *rbuffer;
 
-    buffer = &((ServerBinlogRecordBuffer *)element)->buffer;
-    ((ServerBinlogRecordBuffer *)element)->release_func =
-        server_binlog_release_rbuffer;
-    return fast_buffer_init_ex(buffer, proceduer_ctx.rb_init_capacity);
+    rbuffer = (ServerBinlogRecordBuffer *)element;
+    rbuffer->release_func = server_binlog_release_rbuffer;
+    rbuffer->group.tasks = (struct fast_task_info **)
+        (rbuffer->nexts + CLUSTER_SERVER_ARRAY.count);
+    rbuffer->waiters = (FDIRReplicaAckWaiter **)(rbuffer->group.tasks +
+            BINLOG_GROUP_COMMIT_COUNT);
+    return fast_buffer_init_ex(&rbuffer->buffer,
+            proceduer_ctx.rb_init_capacity);
 }
 
 static int binlog_producer_init_queue()
@@ -123,7 +127,8 @@ int binlog_producer_init()
     proceduer_ctx.rb_init_capacity = 4 * 1024;
     element_size = sizeof(ServerBinlogRecordBuffer) +
         sizeof(struct server_binlog_record_buffer *) *
-        CLUSTER_SERVER_ARRAY.count;
+        CLUSTER_SERVER_ARRAY.count + (sizeof(struct fast_task_info *) +
+        sizeof(FDIRReplicaAckWaiter *)) * BINLOG_GROUP_COMMIT_COUNT;
     if ((result=fast_mblock_init_ex1(&proceduer_ctx.rb_allocator,
                     "record_buffer", element_size, 1024, 0,
                     record_buffer_alloc_init_func, NULL, true)) != 0)
@@ -181,6 +186,7 @@ ServerBinlogRecordBuffer *server_binlog_alloc_hold_rbuffer()
     }
 
     rbuffer->reffer_count = 1;
+    rbuffer->group.count = 0;
     return rbuffer;
 }
 
@@ -210,6 +216,7 @@ void binlog_push_to_producer_queue(ServerBinlogRecordBuffer *rbuffer)
     bool notify;
 
     rbuffer->next = NULL;
+    rbuffer->produce_time_ms = get_current_time_ms();
     PTHREAD_MUTEX_LOCK(&proceduer_ctx.queue.lock);
     if (proceduer_ctx.queue.tail == NULL) {
         proceduer_ctx.queue.head = rbuffer;
@@ -35,15 +35,46 @@
 #include "binlog_func.h"
 #include "binlog_reader.h"
 #include "binlog_producer.h"
+#include "binlog_pack.h"
 #include "binlog_read_thread.h"
 
 static void *binlog_read_thread_func(void *arg);
+static void *binlog_parse_thread_func(void *arg);
 
-int binlog_read_thread_init(BinlogReadThreadContext *ctx,
+static int init_parse_threads(BinlogReadThreadContext *ctx)
+{
+    pthread_t tid;
+    int result;
+    int i;
+
+    if ((result=init_pthread_lock_cond_pair(&ctx->parse.lcp)) != 0) {
+        return result;
+    }
+    if ((result=common_blocked_queue_init_ex(&ctx->parse.queue,
+                    ctx->buffer_count)) != 0)
+    {
+        return result;
+    }
+
+    ctx->parse.running_count = 0;
+    for (i=0; i<ctx->parse.count; i++) {
+        if ((result=fc_create_thread(&tid, binlog_parse_thread_func,
+                        ctx, SF_G_THREAD_STACK_SIZE)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+int binlog_read_thread_init_ex(BinlogReadThreadContext *ctx,
         const SFBinlogFilePosition *hint_pos, const int64_t
-        last_data_version, const int buffer_size)
+        last_data_version, const int buffer_size,
+        const int parse_thread_count)
 {
     int result;
+    int bytes;
     int i;
 
     if ((result=binlog_reader_init(&ctx->reader, hint_pos,
@@ -54,18 +85,28 @@ int binlog_read_thread_init(BinlogReadThreadContext *ctx,
 
     ctx->running = false;
     ctx->continue_flag = true;
+    ctx->parse.count = parse_thread_count;
+    //one buffer for reading and one for replaying besides the parsing
+    ctx->buffer_count = BINLOG_READ_THREAD_BUFFER_COUNT + parse_thread_count;
+    bytes = sizeof(BinlogReadThreadResult) * ctx->buffer_count;
+    ctx->results = (BinlogReadThreadResult *)fc_malloc(bytes);
+    if (ctx->results == NULL) {
+        return ENOMEM;
+    }
+    memset(ctx->results, 0, bytes);
+
     if ((result=common_blocked_queue_init_ex(&ctx->queues.waiting,
-                    BINLOG_READ_THREAD_BUFFER_COUNT)) != 0)
+                    ctx->buffer_count)) != 0)
     {
         return result;
     }
     if ((result=common_blocked_queue_init_ex(&ctx->queues.done,
-                    BINLOG_READ_THREAD_BUFFER_COUNT)) != 0)
+                    ctx->buffer_count)) != 0)
     {
         return result;
     }
 
-    for (i=0; i<BINLOG_READ_THREAD_BUFFER_COUNT; i++) {
+    for (i=0; i<ctx->buffer_count; i++) {
         if ((result=fc_init_buffer(&ctx->results[i].buffer,
                         buffer_size)) != 0)
         {
@@ -75,6 +116,12 @@ int binlog_read_thread_init(BinlogReadThreadContext *ctx,
         binlog_read_thread_return_result_buffer(ctx, ctx->results + i);
     }
 
+    if (ctx->parse.count > 0) {
+        if ((result=init_parse_threads(ctx)) != 0) {
+            return result;
+        }
+    }
+
     return fc_create_thread(&ctx->tid, binlog_read_thread_func,
         ctx, SF_G_THREAD_STACK_SIZE);
 }
@@ -87,26 +134,55 @@ void binlog_read_thread_terminate(BinlogReadThreadContext *ctx)
     ctx->continue_flag = false;
     common_blocked_queue_terminate(&ctx->queues.waiting);
     common_blocked_queue_terminate(&ctx->queues.done);
+    if (ctx->parse.count > 0) {
+        common_blocked_queue_terminate(&ctx->parse.queue);
+    }
 
     count = 0;
-    while (ctx->running && count++ < 300) {
+    while ((ctx->running || __sync_add_and_fetch(&ctx->
+                    parse.running_count, 0) > 0) && count++ < 300)
+    {
         fc_sleep_ms(10);
     }
 
-    if (ctx->running) {
+    if (ctx->running || ctx->parse.running_count > 0) {
         logWarning("file: "__FILE__", line: %d, "
                 "wait thread exit timeout", __LINE__);
     }
-    for (i=0; i<BINLOG_READ_THREAD_BUFFER_COUNT; i++) {
+    for (i=0; i<ctx->buffer_count; i++) {
         free(ctx->results[i].buffer.buff);
         ctx->results[i].buffer.buff = NULL;
+        if (ctx->results[i].record_array.records != NULL) {
+            free(ctx->results[i].record_array.records);
+            ctx->results[i].record_array.records = NULL;
+        }
     }
+    free(ctx->results);
+    ctx->results = NULL;
 
     common_blocked_queue_destroy(&ctx->queues.waiting);
     common_blocked_queue_destroy(&ctx->queues.done);
+    if (ctx->parse.count > 0) {
+        common_blocked_queue_destroy(&ctx->parse.queue);
+        destroy_pthread_lock_cond_pair(&ctx->parse.lcp);
+    }
     binlog_reader_destroy(&ctx->reader);
 }
 
+void binlog_read_thread_wait_parsed(BinlogReadThreadContext *ctx,
+        BinlogReadThreadResult *r)
+{
+    if (r->err_no != 0 || r->parsed) {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&ctx->parse.lcp.lock);
+    while (!r->parsed && ctx->continue_flag) {
+        pthread_cond_wait(&ctx->parse.lcp.cond, &ctx->parse.lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->parse.lcp.lock);
+}
+
 static void *binlog_read_thread_func(void *arg)
 {
     BinlogReadThreadContext *ctx;
@@ -121,13 +197,111 @@ static void *binlog_read_thread_func(void *arg)
             continue;
         }
 
+        r->parsed = false;
         r->binlog_position = ctx->reader.position;
         r->err_no = binlog_reader_integral_read(&ctx->reader,
                 r->buffer.buff, r->buffer.alloc_size,
                 &r->buffer.length, &r->data_version);
+        if (ctx->parse.count > 0 && r->err_no == 0) {
+            common_blocked_queue_push(&ctx->parse.queue, r);
+        }
         common_blocked_queue_push(&ctx->queues.done, r);
     }
 
     ctx->running = false;
     return NULL;
 }
+
+static int check_alloc_records(BinlogReadThreadResult *r)
+{
+    FDIRBinlogRecord *records;
+    int alloc;
+
+    if (r->record_array.alloc == 0) {
+        //estimate by the average record length
+        alloc = r->buffer.alloc_size / 128;
+        if (alloc < 256) {
+            alloc = 256;
+        }
+    } else {
+        alloc = r->record_array.alloc * 2;
+    }
+
+    records = (FDIRBinlogRecord *)fc_malloc(
+            sizeof(FDIRBinlogRecord) * alloc);
+    if (records == NULL) {
+        return ENOMEM;
+    }
+    memset(records, 0, sizeof(FDIRBinlogRecord) * alloc);
+
+    if (r->record_array.records != NULL) {
+        memcpy(records, r->record_array.records, sizeof(FDIRBinlogRecord) *
+                r->record_array.count);
+        free(r->record_array.records);
+    }
+    r->record_array.records = records;
+    r->record_array.alloc = alloc;
+    return 0;
+}
+
+//the buffer is record aligned by binlog_reader_integral_read
+static int parse_buffer(BinlogReadThreadResult *r)
+{
+    const char *p;
+    const char *end;
+    const char *rend;
+    char error_info[FDIR_ERROR_INFO_SIZE];
+    int result;
+
+    *error_info = '\0';
+    r->record_array.count = 0;
+    p = r->buffer.buff;
+    end = p + r->buffer.length;
+    while (p < end) {
+        if (r->record_array.count == r->record_array.alloc) {
+            if ((result=check_alloc_records(r)) != 0) {
+                return result;
+            }
+        }
+
+        if ((result=binlog_unpack_record(p, end - p, r->record_array.
+                        records + r->record_array.count, &rend,
+                        error_info, sizeof(error_info))) != 0)
+        {
+            binlog_log_unpack_error(r->buffer.buff, p,
+                    &r->binlog_position, error_info);
+            return result;
+        }
+
+        p = rend;
+        r->record_array.count++;
+    }
+
+    return 0;
+}
+
+static void *binlog_parse_thread_func(void *arg)
+{
+    BinlogReadThreadContext *ctx;
+    BinlogReadThreadResult *r;
+
+    ctx = (BinlogReadThreadContext *)arg;
+    __sync_add_and_fetch(&ctx->parse.running_count, 1);
+    while (ctx->continue_flag) {
+        r = (BinlogReadThreadResult *)common_blocked_queue_pop(
+                &ctx->parse.queue);
+        if (r == NULL) {
+            continue;
+        }
+
+        r->record_array.err_no = parse_buffer(r);
+
+        PTHREAD_MUTEX_LOCK(&ctx->parse.lcp.lock);
+        r->parsed = true;
+        pthread_cond_broadcast(&ctx->parse.lcp.cond);
+        PTHREAD_MUTEX_UNLOCK(&ctx->parse.lcp.lock);
+    }
+
+    __sync_sub_and_fetch(&ctx->parse.running_count, 1);
+    return NULL;
+}
@@ -28,6 +28,17 @@ typedef struct binlog_read_thread_result {
     SFBinlogFilePosition binlog_position;
     SFVersionRange data_version;
     BufferInfo buffer;
+
+    /* the records parsed from the buffer by the parse threads,
+     * the records refer to the buffer
+     */
+    struct {
+        int err_no;  //the errno of the unpack
+        int count;
+        int alloc;
+        FDIRBinlogRecord *records;
+    } record_array;
+    volatile bool parsed;
 } BinlogReadThreadResult;
 
 typedef struct binlog_read_thread_context {
@@ -35,20 +46,40 @@ typedef struct binlog_read_thread_context {
     volatile bool continue_flag;
     bool running;
     pthread_t tid;
-    BinlogReadThreadResult results[BINLOG_READ_THREAD_BUFFER_COUNT];
+    int buffer_count;
+    BinlogReadThreadResult *results;
     struct {
         struct common_blocked_queue waiting;
         struct common_blocked_queue done;
     } queues;
+
+    /* the buffers are parsed in parallel by the parse threads
+     * and fetched in the read order
+     */
+    struct {
+        int count;  //the parse thread count, 0 for disabled
+        volatile int running_count;
+        struct common_blocked_queue queue;
+        pthread_lock_cond_pair_t lcp;  //for waiting the parse done
+    } parse;
 } BinlogReadThreadContext;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int binlog_read_thread_init(BinlogReadThreadContext *ctx,
+int binlog_read_thread_init_ex(BinlogReadThreadContext *ctx,
         const SFBinlogFilePosition *hint_pos, const int64_t
-        last_data_version, const int buffer_size);
+        last_data_version, const int buffer_size,
+        const int parse_thread_count);
+
+#define binlog_read_thread_init(ctx, hint_pos, \
+        last_data_version, buffer_size) \
+    binlog_read_thread_init_ex(ctx, hint_pos, \
+            last_data_version, buffer_size, 0)
+
+void binlog_read_thread_wait_parsed(BinlogReadThreadContext *ctx,
+        BinlogReadThreadResult *r);
 
 static inline int binlog_read_thread_return_result_buffer(
         BinlogReadThreadContext *ctx, BinlogReadThreadResult *r)
@@ -59,8 +90,14 @@ static inline int binlog_read_thread_return_result_buffer(
 static inline BinlogReadThreadResult *binlog_read_thread_fetch_result_ex(
         BinlogReadThreadContext *ctx, const bool block)
 {
-    return (BinlogReadThreadResult *)common_blocked_queue_pop_ex(
+    BinlogReadThreadResult *r;
+
+    r = (BinlogReadThreadResult *)common_blocked_queue_pop_ex(
             &ctx->queues.done, block);
+    if (r != NULL && ctx->parse.count > 0) {
+        binlog_read_thread_wait_parsed(ctx, r);
+    }
+    return r;
 }
 
 #define binlog_read_thread_fetch_result(ctx) \
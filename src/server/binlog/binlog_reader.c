@@ -274,7 +274,7 @@ int binlog_reader_next_record(ServerBinlogReader *reader,
     char error_info[FDIR_ERROR_INFO_SIZE];
 
     len = BINLOG_BUFFER_REMAIN(reader->binlog_buffer);
-    if (len < BINLOG_RECORD_MIN_SIZE &&
+    if (len < BINLOG_ANY_RECORD_MIN_SIZE &&
             (result=binlog_reader_read(reader)) != 0)
     {
         return result;
@@ -506,7 +506,7 @@ static int binlog_reader_detect_open(ServerBinlogReader *reader,
 
     p = buff;
     remain = bytes;
-    while (remain >= BINLOG_RECORD_MIN_SIZE) {
+    while (remain >= BINLOG_ANY_RECORD_MIN_SIZE) {
         result = binlog_detect_record_forward(p, remain, &data_version,
                 &rstart_offset, &rend_offset, error_info, sizeof(error_info));
         if (result == 0) {
@@ -695,6 +695,33 @@ int binlog_get_last_record_version(const int file_index,
     return result;
 }
 
+void binlog_log_unpack_error(const char *buff, const char *p,
+        const SFBinlogFilePosition *binlog_position,
+        const char *error_info)
+{
+    char filename[PATH_MAX];
+    int64_t line_count;
+
+    if (binlog_position == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "%s", __LINE__, error_info);
+        return;
+    }
+
+    sf_binlog_writer_get_filename(FDIR_BINLOG_SUBDIR_NAME,
+            binlog_position->index, filename, sizeof(filename));
+    if (fc_get_file_line_count_ex(filename, binlog_position->
+                offset + (p - buff), &line_count) == 0)
+    {
+        ++line_count;
+    }
+    logError("file: "__FILE__", line: %d, "
+            "binlog file: %s, offset: %"PRId64", "
+            "line no: %"PRId64", %s", __LINE__, filename,
+            binlog_position->offset + (p - buff),
+            line_count, error_info);
+}
+
 int binlog_get_max_record_version(int64_t *data_version)
 {
     int file_index;
@@ -850,6 +877,19 @@ static int compare_record(const FDIRBinlogRecord *r1,
         return sub;
     }
 
+    if (r1->operation == BINLOG_OP_SET_QUOTA_INT) {
+        if ((sub=fc_compare_int64(r1->quota.inodes,
+                        r2->quota.inodes)) != 0)
+        {
+            return sub;
+        }
+        if ((sub=fc_compare_int64(r1->quota.bytes,
+                        r2->quota.bytes)) != 0)
+        {
+            return sub;
+        }
+    }
+
     return memcmp(&r1->stat, &r2->stat, sizeof(FDIRDEntryStatus));
 }
 
@@ -54,6 +54,13 @@ int binlog_get_last_record_version(const int file_index,
 
 int binlog_get_max_record_version(int64_t *data_version);
 
+/* log the unpack error with the binlog filename and the line no
+ * when binlog_position not NULL, p: the position of the record in buff
+ */
+void binlog_log_unpack_error(const char *buff, const char *p,
+        const SFBinlogFilePosition *binlog_position,
+        const char *error_info);
+
 int binlog_check_consistency(const string_t *sbinlog,
         const SFBinlogFilePosition *hint_pos,
         int *binlog_count, uint64_t *first_unmatched_dv);
@@ -41,6 +41,9 @@ static void data_thread_deal_done_callback(
         const int result, const bool is_error)
 {
     BinlogReplayContext *replay_ctx;
+    BinlogReplaySlot *slot;
+    int64_t seq;
+    int thread_index;
     int log_level;
 
     replay_ctx = (BinlogReplayContext *)record->notify.args;
@@ -69,11 +72,21 @@ static void data_thread_deal_done_callback(
         replay_ctx->notify.func(is_error ? result : 0,
                 record, replay_ctx->notify.args);
     }
-    PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
-    if (--replay_ctx->waiting_count == 0) {
+
+    //the slot can be reused by the parser after the done sequence set
+    slot = replay_ctx->record_array.slots +
+        (record - replay_ctx->record_array.records);
+    seq = slot->seq;
+    thread_index = slot->thread_index;
+    __sync_synchronize();
+    replay_ctx->thread_seqs[thread_index].done = seq;
+    __sync_synchronize();
+
+    if (replay_ctx->waiting) {
+        PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
         pthread_cond_signal(&replay_ctx->lcp.cond);
+        PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
     }
-    PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
 }
 
 int binlog_replay_init_ex(BinlogReplayContext *replay_ctx,
@@ -87,10 +100,15 @@ int binlog_replay_init_ex(BinlogReplayContext *replay_ctx,
 
     replay_ctx->record_count = 0;
     replay_ctx->skip_count = 0;
+    replay_ctx->dependency_wait_count = 0;
     replay_ctx->warning_count = 0;
     replay_ctx->fail_count = 0;
     replay_ctx->last_errno = 0;
-    replay_ctx->waiting_count = 0;
+    replay_ctx->next_seq = 1;
+    replay_ctx->waiting = 0;
+    replay_ctx->pipeline = BINLOG_REPLAY_PIPELINE;
+    replay_ctx->batch_size = batch_size;
+    replay_ctx->pending.count = 0;
     replay_ctx->notify.func = notify_func;
     replay_ctx->notify.args = args;
     replay_ctx->data_current_version = __sync_add_and_fetch(
@@ -103,6 +121,27 @@ int binlog_replay_init_ex(BinlogReplayContext *replay_ctx,
     }
     memset(replay_ctx->record_array.records, 0, bytes);
 
+    bytes = sizeof(BinlogReplaySlot) * replay_ctx->record_array.size;
+    replay_ctx->record_array.slots = (BinlogReplaySlot *)fc_malloc(bytes);
+    if (replay_ctx->record_array.slots == NULL) {
+        return ENOMEM;
+    }
+    memset(replay_ctx->record_array.slots, 0, bytes);
+
+    bytes = sizeof(BinlogReplayThreadSeq) * DATA_THREAD_COUNT;
+    replay_ctx->thread_seqs = (BinlogReplayThreadSeq *)fc_malloc(bytes);
+    if (replay_ctx->thread_seqs == NULL) {
+        return ENOMEM;
+    }
+    memset(replay_ctx->thread_seqs, 0, bytes);
+
+    bytes = sizeof(struct fc_queue_info) * DATA_THREAD_COUNT;
+    replay_ctx->pending.chains = (struct fc_queue_info *)fc_malloc(bytes);
+    if (replay_ctx->pending.chains == NULL) {
+        return ENOMEM;
+    }
+    memset(replay_ctx->pending.chains, 0, bytes);
+
     if ((result=init_pthread_lock_cond_pair(&replay_ctx->lcp)) != 0) {
         return result;
     }
@@ -113,6 +152,26 @@ int binlog_replay_init_ex(BinlogReplayContext *replay_ctx,
         record->notify.args = replay_ctx;
     }
 
+    if (DATA_DISPATCH_MODE == FDIR_DATA_DISPATCH_MODE_PARENT) {
+        replay_ctx->inode_table.capacity = 64 * 1024;
+        while (replay_ctx->inode_table.capacity <
+                64 * replay_ctx->record_array.size)
+        {
+            replay_ctx->inode_table.capacity *= 2;
+        }
+        bytes = sizeof(BinlogReplayInodeEntry) *
+            replay_ctx->inode_table.capacity;
+        replay_ctx->inode_table.entries = (BinlogReplayInodeEntry *)
+            fc_malloc(bytes);
+        if (replay_ctx->inode_table.entries == NULL) {
+            return ENOMEM;
+        }
+        memset(replay_ctx->inode_table.entries, 0, bytes);
+    } else {
+        replay_ctx->inode_table.capacity = 0;
+        replay_ctx->inode_table.entries = NULL;
+    }
+
     return 0;
 }
 
@@ -123,9 +182,241 @@ void binlog_replay_destroy(BinlogReplayContext *replay_ctx)
         replay_ctx->record_array.records = NULL;
     }
 
+    if (replay_ctx->record_array.slots != NULL) {
+        free(replay_ctx->record_array.slots);
+        replay_ctx->record_array.slots = NULL;
+    }
+
+    if (replay_ctx->thread_seqs != NULL) {
+        free(replay_ctx->thread_seqs);
+        replay_ctx->thread_seqs = NULL;
+    }
+
+    if (replay_ctx->pending.chains != NULL) {
+        free(replay_ctx->pending.chains);
+        replay_ctx->pending.chains = NULL;
+    }
+
+    if (replay_ctx->inode_table.entries != NULL) {
+        free(replay_ctx->inode_table.entries);
+        replay_ctx->inode_table.entries = NULL;
+    }
+
     destroy_pthread_lock_cond_pair(&replay_ctx->lcp);
 }
 
+static inline bool record_is_done(BinlogReplayContext *replay_ctx,
+        const int thread_index, const int64_t seq)
+{
+    return replay_ctx->thread_seqs[thread_index].done >= seq;
+}
+
+//one locked push per data thread
+static void push_pending_records(BinlogReplayContext *replay_ctx)
+{
+    struct fc_queue_info *chain;
+    struct fc_queue_info *end;
+
+    if (replay_ctx->pending.count == 0) {
+        return;
+    }
+
+    end = replay_ctx->pending.chains + DATA_THREAD_COUNT;
+    for (chain=replay_ctx->pending.chains; chain<end; chain++) {
+        if (chain->head != NULL) {
+            fc_queue_push_queue_to_tail(&g_data_thread_vars.thread_array.
+                    contexts[chain - replay_ctx->pending.chains].queue,
+                    chain);
+            chain->head = chain->tail = NULL;
+        }
+    }
+    replay_ctx->pending.count = 0;
+}
+
+static void wait_for_record_done(BinlogReplayContext *replay_ctx,
+        const int thread_index, const int64_t seq)
+{
+    if (record_is_done(replay_ctx, thread_index, seq)) {
+        return;
+    }
+
+    push_pending_records(replay_ctx);
+    PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
+    __sync_bool_compare_and_swap(&replay_ctx->waiting, 0, 1);
+    while (!record_is_done(replay_ctx, thread_index, seq)) {
+        pthread_cond_wait(&replay_ctx->lcp.cond, &replay_ctx->lcp.lock);
+    }
+    __sync_bool_compare_and_swap(&replay_ctx->waiting, 1, 0);
+    PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
+}
+
+//wait for all dispatched records done
+static int wait_for_all_done(BinlogReplayContext *replay_ctx)
+{
+    BinlogReplayThreadSeq *ts;
+    BinlogReplayThreadSeq *end;
+
+    end = replay_ctx->thread_seqs + DATA_THREAD_COUNT;
+    for (ts=replay_ctx->thread_seqs; ts<end; ts++) {
+        wait_for_record_done(replay_ctx, ts - replay_ctx->
+                thread_seqs, ts->dispatched);
+    }
+
+    return replay_ctx->fail_count > 0 ? replay_ctx->last_errno : 0;
+}
+
+static inline BinlogReplayInodeEntry *inode_table_get(
+        BinlogReplayContext *replay_ctx, const int64_t inode)
+{
+    unsigned int index;
+
+    index = ((uint64_t)inode * 0x9E3779B97F4A7C15ULL) >> 32;
+    return replay_ctx->inode_table.entries + (index &
+            (replay_ctx->inode_table.capacity - 1));
+}
+
+static int record_get_inodes(const FDIRBinlogRecord *record, int64_t *inodes)
+{
+    int count;
+
+    count = 0;
+    if (record->inode != 0) {
+        inodes[count++] = record->inode;
+    }
+    if (record->me.pname.parent_inode != 0) {
+        inodes[count++] = record->me.pname.parent_inode;
+    }
+    if (record->operation == BINLOG_OP_RENAME_DENTRY_INT) {
+        if (record->rename.src.pname.parent_inode != 0) {
+            inodes[count++] = record->rename.src.pname.parent_inode;
+        }
+    } else if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+            record->options.src_inode && record->hdlink.src_inode != 0)
+    {
+        inodes[count++] = record->hdlink.src_inode;
+    }
+
+    return count;
+}
+
+/* wait for the in-flight records touched the same inodes which
+ * dispatched to the other data threads, the records dispatched to
+ * the same data thread are applied in order.
+ * the serial mode waits for all the dispatched records instead
+ */
+static void wait_for_dependencies(BinlogReplayContext *replay_ctx,
+        const int thread_index, const int64_t seq,
+        const FDIRBinlogRecord *record)
+{
+    BinlogReplayInodeEntry *entries[4];
+    int64_t inodes[4];
+    int count;
+    int i;
+
+    count = record_get_inodes(record, inodes);
+    for (i=0; i<count; i++) {
+        entries[i] = inode_table_get(replay_ctx, inodes[i]);
+        if (entries[i]->seq > 0 && entries[i]->thread_index !=
+                thread_index && !record_is_done(replay_ctx,
+                    entries[i]->thread_index, entries[i]->seq))
+        {
+            replay_ctx->dependency_wait_count++;
+            if (replay_ctx->pipeline) {
+                wait_for_record_done(replay_ctx, entries[i]->thread_index,
+                        entries[i]->seq);
+            } else {
+                wait_for_all_done(replay_ctx);
+                break;
+            }
+        }
+    }
+
+    for (i=0; i<count; i++) {
+        entries[i]->seq = seq;
+        entries[i]->thread_index = thread_index;
+    }
+}
+
+static inline void append_pending_record(BinlogReplayContext *replay_ctx,
+        const int thread_index, FDIRBinlogRecord *record)
+{
+    struct fc_queue_info *chain;
+
+    chain = replay_ctx->pending.chains + thread_index;
+    record->next = NULL;
+    if (chain->tail == NULL) {
+        chain->head = record;
+    } else {
+        ((FDIRBinlogRecord *)chain->tail)->next = record;
+    }
+    chain->tail = record;
+    replay_ctx->pending.count++;
+}
+
+static inline void dispatch_record(BinlogReplayContext *replay_ctx,
+        FDIRBinlogRecord *record, BinlogReplaySlot *slot)
+{
+    FDIRDataThreadContext *thread_ctx;
+
+    thread_ctx = data_thread_get_context(record);
+    slot->seq = replay_ctx->next_seq++;
+    slot->thread_index = thread_ctx->index;
+    if (replay_ctx->inode_table.entries != NULL) {
+        wait_for_dependencies(replay_ctx, slot->thread_index,
+                slot->seq, record);
+    }
+
+    replay_ctx->thread_seqs[slot->thread_index].dispatched = slot->seq;
+    append_pending_record(replay_ctx, slot->thread_index, record);
+    if (replay_ctx->pipeline) {
+        if (replay_ctx->pending.count >= replay_ctx->batch_size) {
+            push_pending_records(replay_ctx);
+        }
+    } else if (replay_ctx->pending.count ==
+            replay_ctx->record_array.size)
+    {
+        wait_for_all_done(replay_ctx);
+    }
+}
+
+static inline int get_free_slot(BinlogReplayContext *replay_ctx,
+        FDIRBinlogRecord **record, BinlogReplaySlot **slot)
+{
+    int index;
+
+    index = replay_ctx->next_seq % replay_ctx->record_array.size;
+    *record = replay_ctx->record_array.records + index;
+    *slot = replay_ctx->record_array.slots + index;
+    if ((*slot)->seq > 0) {  //wait for the slot free
+        wait_for_record_done(replay_ctx, (*slot)->thread_index,
+                (*slot)->seq);
+        if (replay_ctx->fail_count > 0) {
+            return replay_ctx->last_errno;
+        }
+    }
+
+    return 0;
+}
+
+static inline void replay_record(BinlogReplayContext *replay_ctx,
+        FDIRBinlogRecord *record, BinlogReplaySlot *slot)
+{
+    replay_ctx->record_count++;
+    if (record->data_version <= replay_ctx->data_current_version) {
+        replay_ctx->skip_count++;
+        if (replay_ctx->notify.func != NULL) {
+            replay_ctx->notify.func(0, record, replay_ctx->notify.args);
+        }
+        return;
+    }
+
+    replay_ctx->data_current_version = record->data_version;
+    dispatch_record(replay_ctx, record, slot);
+}
+
+/* the records refer to the buffer, so all records should be done
+ * before return
+ */
 int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
          const char *buff, const int len,
          SFBinlogFilePosition *binlog_position)
@@ -134,7 +425,7 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
     const char *end;
     const char *rend;
     FDIRBinlogRecord *record;
-    FDIRBinlogRecord *rec_end;
+    BinlogReplaySlot *slot;
     char error_info[FDIR_ERROR_INFO_SIZE];
     int result;
 
@@ -142,85 +433,50 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
     p = buff;
     end = p + len;
     while (p < end) {
-        record = replay_ctx->record_array.records;
-        while (p < end) {
-            if ((result=binlog_unpack_record(p, end - p, record,
-                            &rend, error_info, sizeof(error_info))) != 0)
-            {
-                if (binlog_position != NULL) {
-                    char filename[PATH_MAX];
-                    int64_t line_count;
-
-                    sf_binlog_writer_get_filename(FDIR_BINLOG_SUBDIR_NAME,
-                            binlog_position->index, filename, sizeof(filename));
-                    if (fc_get_file_line_count_ex(filename, binlog_position->
-                            offset + (p - buff), &line_count) == 0)
-                    {
-                        ++line_count;
-                    }
-                    logError("file: "__FILE__", line: %d, "
-                            "binlog file: %s, line no: %"PRId64", %s",
-                            __LINE__, filename, line_count, error_info);
-                } else {
-                    logError("file: "__FILE__", line: %d, "
-                            "%s", __LINE__, error_info);
-                }
-                return result;
-            }
-            p = rend;
-
-            replay_ctx->record_count++;
-            if (record->data_version <= replay_ctx->data_current_version) {
-                replay_ctx->skip_count++;
-                if (replay_ctx->notify.func != NULL) {
-                    replay_ctx->notify.func(0, record, replay_ctx->notify.args);
-                }
-                continue;
-            }
-
-            replay_ctx->data_current_version = record->data_version;
-            if (++record - replay_ctx->record_array.records ==
-                    replay_ctx->record_array.size)
-            {
-                break;
-            }
+        if (get_free_slot(replay_ctx, &record, &slot) != 0) {
+            break;
         }
 
-        rec_end = record;
-        PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
-        replay_ctx->waiting_count = rec_end -
-            replay_ctx->record_array.records;
-        PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
-
-        for (record=replay_ctx->record_array.records;
-                record<rec_end; record++)
+        if ((result=binlog_unpack_record(p, end - p, record,
+                        &rend, error_info, sizeof(error_info))) != 0)
         {
-            push_to_data_thread_queue(record);
-        }
-
-        /*
-        logInfo("count2: %d, waiting_count: %d",
-                (int)(rec_end - replay_ctx->record_array.records),
-                replay_ctx->waiting_count);
-                */
-
-        PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
-        while (replay_ctx->waiting_count != 0) {
-            pthread_cond_wait(&replay_ctx->lcp.cond,
-                    &replay_ctx->lcp.lock);
+            binlog_log_unpack_error(buff, p, binlog_position, error_info);
+            wait_for_all_done(replay_ctx);
+            return result;
         }
-        PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
+        p = rend;
 
-        if (replay_ctx->fail_count > 0) {
-            return replay_ctx->last_errno;
-        }
+        replay_record(replay_ctx, record, slot);
     }
 
     /*
-    logInfo("record_count: %"PRId64", waiting_count: %d, skip_count: %"PRId64,
-            replay_ctx->record_count, __sync_add_and_fetch(&replay_ctx->waiting_count, 0),
-            replay_ctx->skip_count);
+    logInfo("record_count: %"PRId64", skip_count: %"PRId64", "
+            "dependency_wait_count: %"PRId64, replay_ctx->record_count,
+            replay_ctx->skip_count, replay_ctx->dependency_wait_count);
             */
 
-    return replay_ctx->fail_count > 0 ? replay_ctx->last_errno : 0;
+    return wait_for_all_done(replay_ctx);
+}
+
+int binlog_replay_deal_records(BinlogReplayContext *replay_ctx,
+        const FDIRBinlogRecord *records, const int count)
+{
+    const FDIRBinlogRecord *src;
+    const FDIRBinlogRecord *end;
+    FDIRBinlogRecord *record;
+    BinlogReplaySlot *slot;
+
+    end = records + count;
+    for (src=records; src<end; src++) {
+        if (get_free_slot(replay_ctx, &record, &slot) != 0) {
+            break;
+        }
+
+        *record = *src;
+        record->notify.func = data_thread_deal_done_callback;
+        record->notify.args = replay_ctx;
+        replay_record(replay_ctx, record, slot);
+    }
+
+    return wait_for_all_done(replay_ctx);
 }
@@ -19,21 +19,70 @@
 #define _BINLOG_REPLAY_H_
 
 #include <pthread.h>
+#include "fastcommon/fc_queue.h"
 #include "binlog_types.h"
 
 typedef void (*binlog_replay_notify_func)(const int result,
         struct fdir_binlog_record *record, void *args);
 
+typedef struct binlog_replay_inode_entry {
+    int64_t seq;  //the sequence of the last record touched the inode
+    int thread_index;
+} BinlogReplayInodeEntry;
+
+typedef struct binlog_replay_slot {
+    int64_t seq;  //0 for free
+    int thread_index;
+} BinlogReplaySlot;
+
+typedef struct binlog_replay_thread_seq {
+    int64_t dispatched;     //the sequence of the last record pushed
+    volatile int64_t done;  //the sequence of the last record done
+    char padding[48];       //avoid false sharing between data threads
+} BinlogReplayThreadSeq;
+
+/* the records are chained per data thread and pushed in batches, the
+ * pending chains are pushed before any wait.
+ * in the serial mode, the parser waits for all the pushed records done
+ * when the ring is full or a record depends on the record which
+ * dispatched to the other data thread.
+ * in the pipeline mode, the parser keeps dispatching the records into
+ * the ring while the data threads applying, and waits only for the free
+ * slot or the dependent record. the data thread deals the records in
+ * FIFO order, so the sequence of the last record done by each data
+ * thread is enough to tell whether a record is done.
+ */
 typedef struct binlog_replay_context {
     struct {
         int size;
-        FDIRBinlogRecord *records;
+        FDIRBinlogRecord *records;  //as ring
+        BinlogReplaySlot *slots;
     } record_array;
+
+    /* for parent dispatch mode, the last records touched the inodes,
+     * direct mapped by the inode, the collision causes an extra wait only
+     */
+    struct {
+        int capacity;  //power of 2
+        BinlogReplayInodeEntry *entries;
+    } inode_table;
+
+    struct {
+        int count;
+        struct fc_queue_info *chains;  //indexed by the data thread
+    } pending;
+
+    bool pipeline;
+    int batch_size;
+    int64_t next_seq;
+    BinlogReplayThreadSeq *thread_seqs;  //indexed by the data thread
+    volatile int waiting;  //the parser is waiting
+
     int64_t data_current_version;
-    volatile int waiting_count;
     int last_errno;
     int64_t record_count;
     int64_t skip_count;
+    int64_t dependency_wait_count;
     int64_t warning_count;
     volatile int64_t fail_count;
     pthread_lock_cond_pair_t lcp;
@@ -60,6 +109,10 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
          const char *buff, const int len,
          SFBinlogFilePosition *binlog_position);
 
+//replay the records parsed by the binlog read thread
+int binlog_replay_deal_records(BinlogReplayContext *replay_ctx,
+        const FDIRBinlogRecord *records, const int count);
+
 #ifdef __cplusplus
 }
 #endif
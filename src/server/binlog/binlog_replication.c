@@ -16,6 +16,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdio.h>
@@ -37,6 +38,7 @@
 #include "../../common/fdir_proto.h"
 #include "../server_global.h"
 #include "../cluster_info.h"
+#include "../data_checkpoint.h"
 #include "binlog_func.h"
 #include "binlog_pack.h"
 #include "push_result_ring.h"
@@ -44,6 +46,8 @@
 #include "binlog_read_thread.h"
 #include "binlog_replication.h"
 
+#define REPLICATION_MAX_IOV_COUNT  256
+
 static void replication_queue_discard_all(FDIRSlaveReplication *replication);
 
 static int check_alloc_ptr_array(FDIRSlaveReplicationPtrArray *array)
@@ -109,6 +113,7 @@ static inline void set_replication_stage(FDIRSlaveReplication *
             }
             break;
 
+        case FDIR_REPLICATION_STAGE_SYNC_FROM_SNAPSHOT:
         case FDIR_REPLICATION_STAGE_SYNC_FROM_DISK:
             status = __sync_add_and_fetch(&replication->slave->status, 0);
             if (status == FDIR_SERVER_STATUS_INIT) {
@@ -150,6 +155,8 @@ int binlog_replication_bind_thread(FDIRSlaveReplication *replication)
         sf_release_task(task);
         return result;
     }
+    replication->context.push_result_ctx.ack_stat =
+        &replication->slave->ack_stat;
 
     task->thread_data = CLUSTER_SF_CTX.thread_data +
         replication->index % CLUSTER_SF_CTX.work_threads;
@@ -163,6 +170,9 @@ int binlog_replication_bind_thread(FDIRSlaveReplication *replication)
     replication->context.sync_by_disk_stat.start_time_ms = 0;
     replication->context.sync_by_disk_stat.binlog_size = 0;
     replication->context.sync_by_disk_stat.record_count = 0;
+    replication->context.snapshot.fd = -1;
+    replication->context.snapshot.waiting_resp = false;
+    replication->context.snapshot.diverged = false;
 
     SERVER_TASK_TYPE = FDIR_SERVER_TASK_TYPE_REPLICA_MASTER;
     CLUSTER_REPLICA = replication;
@@ -186,6 +196,15 @@ int binlog_replication_bind_thread(FDIRSlaveReplication *replication)
     return 0;
 }
 
+static void snapshot_close(FDIRSlaveReplication *replication)
+{
+    if (replication->context.snapshot.fd >= 0) {
+        close(replication->context.snapshot.fd);
+        replication->context.snapshot.fd = -1;
+    }
+    replication->context.snapshot.waiting_resp = false;
+}
+
 int binlog_replication_rebind_thread(FDIRSlaveReplication *replication)
 {
     int result;
@@ -197,6 +216,7 @@ int binlog_replication_rebind_thread(FDIRSlaveReplication *replication)
     {
         replication_queue_discard_all(replication);
         push_result_ring_clear_all(&replication->context.push_result_ctx);
+        snapshot_close(replication);
         if (CLUSTER_MYSELF_PTR == CLUSTER_MASTER_ATOM_PTR) {
             result = binlog_replication_bind_thread(replication);
         }
@@ -329,15 +349,48 @@ static int send_join_slave_package(FDIRSlaveReplication *replication)
     return result;
 }
 
-static void decrease_task_waiting_rpc_count(ServerBinlogRecordBuffer *rb)
+static void ack_waiters_discard(FDIRSlaveReplication *replication,
+        ServerBinlogRecordBuffer *rb)
 {
-    struct fast_task_info *task;
-    task = (struct fast_task_info *)rb->args;
-    if (__sync_sub_and_fetch(&((FDIRServerTaskArg *)task->arg)->
-                context.service.waiting_rpc_count, 1) == 0)
-    {
-        sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    int count;
+    int i;
+
+    if (!rb->wait_replica) {
+        return;
+    }
+
+    count = (rb->group.count > 0 ? rb->group.count : 1);
+    for (i=0; i<count; i++) {
+        if (rb->waiters[i] != NULL) {
+            push_result_waiter_done(rb->waiters[i],
+                    &replication->slave->ack_stat, false);
+        }
+    }
+}
+
+static int push_result_ring_add_rbuffer(FDIRBinlogPushResultContext *ctx,
+        ServerBinlogRecordBuffer *rb)
+{
+    SFVersionRange data_version;
+    int result;
+    int i;
+
+    if (rb->group.count == 0) {
+        return push_result_ring_add(ctx, &rb->data_version,
+                rb->wait_replica ? rb->waiters[0] : NULL);
+    }
+
+    //each task of the group waits for its own data version
+    for (i=0; i<rb->group.count; i++) {
+        data_version.first = data_version.last = rb->data_version.first + i;
+        if ((result=push_result_ring_add(ctx, &data_version,
+                        rb->wait_replica ? rb->waiters[i] : NULL)) != 0)
+        {
+            return result;
+        }
     }
+
+    return 0;
 }
 
 static void discard_queue(FDIRSlaveReplication *replication,
@@ -350,7 +403,7 @@ static void discard_queue(FDIRSlaveReplication *replication,
 
         replication->context.last_data_versions.by_queue =
             rb->data_version.last;
-        decrease_task_waiting_rpc_count(rb);
+        ack_waiters_discard(replication, rb);
         rb->release_func(rb);
     }
 }
@@ -484,6 +537,7 @@ static int deal_replication_connectings(FDIRServerContext *server_ctx)
             replication->slave->last_data_version = -1;
             replication->slave->binlog_pos_hint.index = -1;
             replication->slave->binlog_pos_hint.offset = -1;
+            replication->context.snapshot.diverged = false;
 
             add_to_replication_ptr_array(&server_ctx->
                     cluster.connected, replication);
@@ -524,16 +578,76 @@ static void repush_to_replication_queue(FDIRSlaveReplication *replication,
     PTHREAD_MUTEX_UNLOCK(&replication->context.queue.lock);
 }
 
+/* write the binlog buffers to the socket directly without copying them
+ * into the task buffer, only the unsent tail is copied and then sent by
+ * the nio thread. the caller MUST ensure the task is idle
+ */
+static int send_iovec_to_slave(FDIRSlaveReplication *replication,
+        const struct iovec *iov, const int iovcnt)
+{
+    struct fast_task_info *task;
+    ssize_t bytes;
+    char *p;
+    int remain;
+    int result;
+    int i;
+
+    task = replication->task;
+    do {
+        bytes = writev(task->event.fd, iov, iovcnt);
+    } while (bytes < 0 && errno == EINTR);
+
+    if (bytes < 0) {
+        result = errno != 0 ? errno : EIO;
+        if (!(result == EAGAIN || result == EWOULDBLOCK)) {
+            logError("file: "__FILE__", line: %d, "
+                    "send to slave %s:%u fail, errno: %d, error info: %s",
+                    __LINE__, CLUSTER_GROUP_ADDRESS_FIRST_IP(
+                        replication->slave->server),
+                    CLUSTER_GROUP_ADDRESS_FIRST_PORT(
+                        replication->slave->server),
+                    result, STRERROR(result));
+            return result;
+        }
+        bytes = 0;
+    }
+
+    p = task->data;
+    for (i=0; i<iovcnt; i++) {
+        if (bytes >= (ssize_t)iov[i].iov_len) {
+            bytes -= iov[i].iov_len;
+            continue;
+        }
+
+        remain = iov[i].iov_len - bytes;
+        memcpy(p, (char *)iov[i].iov_base + bytes, remain);
+        p += remain;
+        bytes = 0;
+    }
+
+    if (p > task->data) {
+        task->length = p - task->data;
+        sf_send_add_event(task);
+    }
+    return 0;
+}
+
 static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
 {
     ServerBinlogRecordBuffer *rb;
     ServerBinlogRecordBuffer *head;
     ServerBinlogRecordBuffer *tail;
-    struct fast_task_info *waiting_task;
+    ServerBinlogRecordBuffer *rbs[REPLICATION_MAX_IOV_COUNT];
+    struct iovec iov[REPLICATION_MAX_IOV_COUNT];
+    char front[sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoPushBinlogReqBodyHeader)];
     FDIRProtoPushBinlogReqBodyHeader *body_header;
     SFVersionRange data_version;
+    int total_length;
     int body_len;
+    int count;
     int result;
+    int i;
 
     PTHREAD_MUTEX_LOCK(&replication->context.queue.lock);
     head = replication->context.queue.head;
@@ -549,53 +663,68 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
 
     data_version.first = head->data_version.first;
     data_version.last = head->data_version.last;
-    replication->task->length = sizeof(FDIRProtoHeader) +
-        sizeof(FDIRProtoPushBinlogReqBodyHeader);
-    while (head != NULL) {
+    total_length = sizeof(front);
+    count = 0;
+    result = 0;
+    while (head != NULL && count < REPLICATION_MAX_IOV_COUNT - 1) {
         rb = head;
 
-        waiting_task = (struct fast_task_info *)rb->args;
-        if (replication->task->length + rb->buffer.length >
-                replication->task->size)
-        {
+        //the slave's receive buffer has the same size
+        if (total_length + rb->buffer.length > replication->task->size) {
             break;
         }
 
         data_version.last = rb->data_version.last;
         replication->context.last_data_versions.by_queue =
             rb->data_version.last;
-        memcpy(replication->task->data + replication->task->length,
-                rb->buffer.data, rb->buffer.length);
-        replication->task->length += rb->buffer.length;
-
-        if ((result=push_result_ring_add(&replication->context.
-                        push_result_ctx, &rb->data_version,
-                        waiting_task)) != 0)
+        if ((result=push_result_ring_add_rbuffer(&replication->
+                        context.push_result_ctx, rb)) != 0)
         {
             sf_terminate_myself();
-            return result;
+            break;
         }
 
+        rbs[count] = rb;
+        iov[++count].iov_base = rb->buffer.data;
+        iov[count].iov_len = rb->buffer.length;
+        total_length += rb->buffer.length;
         head = head->nexts[replication->index];
-        rb->release_func(rb);
     }
 
-    body_header = (FDIRProtoPushBinlogReqBodyHeader *)
-        (replication->task->data + sizeof(FDIRProtoHeader));
-    body_len = replication->task->length - sizeof(FDIRProtoHeader);
-    int2buff(body_len - sizeof(FDIRProtoPushBinlogReqBodyHeader),
-            body_header->binlog_length);
-    long2buff(data_version.first, body_header->data_version.first);
-    long2buff(data_version.last, body_header->data_version.last);
+    if (result == 0) {
+        body_header = (FDIRProtoPushBinlogReqBodyHeader *)
+            (front + sizeof(FDIRProtoHeader));
+        body_len = total_length - sizeof(FDIRProtoHeader);
+        int2buff(body_len - sizeof(FDIRProtoPushBinlogReqBodyHeader),
+                body_header->binlog_length);
+        long2buff(data_version.first, body_header->data_version.first);
+        long2buff(data_version.last, body_header->data_version.last);
+        SF_PROTO_SET_HEADER((FDIRProtoHeader *)front,
+                FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ, body_len);
+
+        iov[0].iov_base = front;
+        iov[0].iov_len = sizeof(front);
+        if ((result=send_iovec_to_slave(replication, iov, count + 1)) == 0) {
+            replication->context.push_credits--;
+            if (replication->context.lag_sample.data_version == 0 &&
+                    count > 0)
+            {
+                replication->context.lag_sample.data_version =
+                    data_version.last;
+                replication->context.lag_sample.produce_time_ms =
+                    rbs[count - 1]->produce_time_ms;
+            }
+        }
+    }
 
-    SF_PROTO_SET_HEADER((FDIRProtoHeader *)replication->task->data,
-            FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ, body_len);
-    sf_send_add_event(replication->task);
+    for (i=0; i<count; i++) {
+        rbs[i]->release_func(rbs[i]);
+    }
 
     if (head != NULL) {
         repush_to_replication_queue(replication, head, tail);
     }
-    return 0;
+    return result;
 }
 
 static int start_binlog_read_thread(FDIRSlaveReplication *replication)
@@ -629,6 +758,15 @@ int binlog_replications_check_response_data_version(
 {
     if (data_version > replication->context.last_data_versions.by_resp) {
         replication->context.last_data_versions.by_resp = data_version;
+        replication->slave->replica_lag.data_version = data_version;
+    }
+
+    if (replication->context.lag_sample.data_version > 0 &&
+            data_version >= replication->context.lag_sample.data_version)
+    {
+        replication->slave->replica_lag.delay_ms = get_current_time_ms() -
+            replication->context.lag_sample.produce_time_ms;
+        replication->context.lag_sample.data_version = 0;
     }
 
     if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_QUEUE) {
@@ -641,32 +779,41 @@ int binlog_replications_check_response_data_version(
     return 0;
 }
 
-static void sync_binlog_to_slave(FDIRSlaveReplication *replication,
+static int sync_binlog_to_slave(FDIRSlaveReplication *replication,
         BinlogReadThreadResult *r)
 {
     int body_len;
+    int result;
+    char front[sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoPushBinlogReqBodyHeader)];
     FDIRProtoPushBinlogReqBodyHeader *body_header;
+    struct iovec iov[2];
 
     body_header = (FDIRProtoPushBinlogReqBodyHeader *)
-        (replication->task->data + sizeof(FDIRProtoHeader));
+        (front + sizeof(FDIRProtoHeader));
     body_len = sizeof(FDIRProtoPushBinlogReqBodyHeader) + r->buffer.length;
-    SF_PROTO_SET_HEADER((FDIRProtoHeader *)replication->task->data,
+    SF_PROTO_SET_HEADER((FDIRProtoHeader *)front,
             FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ, body_len);
 
     int2buff(r->buffer.length, body_header->binlog_length);
     long2buff(r->data_version.first, body_header->data_version.first);
     long2buff(r->data_version.last, body_header->data_version.last);
-    memcpy(replication->task->data + sizeof(FDIRProtoHeader) +
-            sizeof(FDIRProtoPushBinlogReqBodyHeader),
-            r->buffer.buff, r->buffer.length);
-    replication->task->length = sizeof(FDIRProtoHeader) + body_len;
-    sf_send_add_event(replication->task);
+
+    iov[0].iov_base = front;
+    iov[0].iov_len = sizeof(front);
+    iov[1].iov_base = r->buffer.buff;
+    iov[1].iov_len = r->buffer.length;
+    if ((result=send_iovec_to_slave(replication, iov, 2)) == 0) {
+        replication->context.push_credits--;
+    }
+    return result;
 }
 
 static int sync_binlog_from_disk(FDIRSlaveReplication *replication)
 {
     BinlogReadThreadResult *r;
     const bool block = false;
+    int result;
 
     r = binlog_read_thread_fetch_result_ex(replication->context.
             reader_ctx, block);
@@ -696,7 +843,11 @@ static int sync_binlog_from_disk(FDIRSlaveReplication *replication)
                 r->data_version.last, r->buffer.length);
 
         replication->context.sync_by_disk_stat.binlog_size += r->buffer.length;
-        sync_binlog_to_slave(replication, r);
+        if ((result=sync_binlog_to_slave(replication, r)) != 0) {
+            binlog_read_thread_return_result_buffer(
+                    replication->context.reader_ctx, r);
+            return result;
+        }
     }
     binlog_read_thread_return_result_buffer(replication->context.reader_ctx, r);
 
@@ -734,6 +885,161 @@ static int sync_binlog_from_disk(FDIRSlaveReplication *replication)
     return 0;
 }
 
+static int start_sync_from_disk(FDIRSlaveReplication *replication)
+{
+    int result;
+
+    if ((result=start_binlog_read_thread(replication)) == 0) {
+        set_replication_stage(replication,
+                FDIR_REPLICATION_STAGE_SYNC_FROM_DISK);
+        replication->context.sync_by_disk_stat.start_time_ms =
+            get_current_time_ms();
+    }
+    return result;
+}
+
+static int start_sync_from_snapshot(FDIRSlaveReplication *replication)
+{
+    int result;
+
+    if ((result=data_checkpoint_open_snapshot(&replication->context.
+                    snapshot.fd, &replication->context.snapshot.file_size,
+                    &replication->context.snapshot.data_version,
+                    &replication->context.snapshot.binlog_pos_hint)) != 0)
+    {
+        return result;
+    }
+
+    if (replication->context.snapshot.data_version == 0) {
+        snapshot_close(replication);
+        return ENOENT;
+    }
+
+    if ((result=free_queue_realloc_max_buffer(replication->task)) != 0) {
+        snapshot_close(replication);
+        return result;
+    }
+
+    replication->context.snapshot.offset = 0;
+    replication->context.snapshot.waiting_resp = false;
+    replication->context.snapshot.start_time_ms = get_current_time_ms();
+    set_replication_stage(replication,
+            FDIR_REPLICATION_STAGE_SYNC_FROM_SNAPSHOT);
+
+    logInfo("file: "__FILE__", line: %d, "
+            "push snapshot to %sslave %s:%u, data version: %"PRId64", "
+            "file size: %"PRId64, __LINE__, replication->context.
+            snapshot.diverged ? "the diverged " : "",
+            CLUSTER_GROUP_ADDRESS_FIRST_IP(replication->slave->server),
+            CLUSTER_GROUP_ADDRESS_FIRST_PORT(replication->slave->server),
+            replication->context.snapshot.data_version,
+            replication->context.snapshot.file_size);
+    return 0;
+}
+
+static int sync_snapshot_done(FDIRSlaveReplication *replication)
+{
+    int64_t time_used;
+    char time_buff[32];
+    char size_buff[32];
+
+    snapshot_close(replication);
+    time_used = get_current_time_ms() -
+        replication->context.snapshot.start_time_ms;
+    logInfo("file: "__FILE__", line: %d, "
+            "push snapshot to slave %s:%u done, data version: %"PRId64", "
+            "file size: %s, time used: %s ms", __LINE__,
+            CLUSTER_GROUP_ADDRESS_FIRST_IP(replication->slave->server),
+            CLUSTER_GROUP_ADDRESS_FIRST_PORT(replication->slave->server),
+            replication->context.snapshot.data_version,
+            long_to_comma_str(replication->context.snapshot.
+                file_size, size_buff),
+            long_to_comma_str(time_used, time_buff));
+
+    if (replication->context.snapshot.diverged) {
+        /* the slave restarts to load the snapshot,
+         * then joins again with the binlog after it
+         */
+        logInfo("file: "__FILE__", line: %d, "
+                "the diverged slave %s:%u restarts to load the snapshot",
+                __LINE__, CLUSTER_GROUP_ADDRESS_FIRST_IP(
+                    replication->slave->server),
+                CLUSTER_GROUP_ADDRESS_FIRST_PORT(
+                    replication->slave->server));
+        return ECONNRESET;
+    }
+
+    //the binlog records after the snapshot
+    replication->slave->last_data_version =
+        replication->context.snapshot.data_version;
+    replication->slave->binlog_pos_hint =
+        replication->context.snapshot.binlog_pos_hint;
+    return start_sync_from_disk(replication);
+}
+
+static int sync_snapshot_to_slave(FDIRSlaveReplication *replication)
+{
+    FDIRProtoPushSnapshotReqBodyHeader *body_header;
+    char *buff;
+    int front_length;
+    int length;
+    int bytes;
+    int result;
+
+    if (replication->context.snapshot.waiting_resp) {
+        return 0;
+    }
+
+    if (replication->context.snapshot.offset ==
+            replication->context.snapshot.file_size)
+    {
+        return sync_snapshot_done(replication);
+    }
+
+    front_length = sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoPushSnapshotReqBodyHeader);
+    length = replication->task->size - front_length;
+    if (length > replication->context.snapshot.file_size -
+            replication->context.snapshot.offset)
+    {
+        length = replication->context.snapshot.file_size -
+            replication->context.snapshot.offset;
+    }
+
+    buff = replication->task->data + front_length;
+    for (bytes=0; bytes<length; ) {
+        result = pread(replication->context.snapshot.fd, buff + bytes,
+                length - bytes, replication->context.snapshot.offset + bytes);
+        if (result <= 0) {
+            result = (result < 0 && errno != 0) ? errno : ENODATA;
+            logError("file: "__FILE__", line: %d, "
+                    "read checkpoint file fail, offset: %"PRId64", "
+                    "errno: %d, error info: %s", __LINE__,
+                    replication->context.snapshot.offset + bytes,
+                    result, STRERROR(result));
+            return result;
+        }
+        bytes += result;
+    }
+
+    body_header = (FDIRProtoPushSnapshotReqBodyHeader *)
+        (replication->task->data + sizeof(FDIRProtoHeader));
+    long2buff(replication->context.snapshot.file_size,
+            body_header->file_size);
+    long2buff(replication->context.snapshot.offset, body_header->offset);
+    int2buff(length, body_header->length);
+    body_header->diverged = replication->context.snapshot.diverged;
+    SF_PROTO_SET_HEADER((FDIRProtoHeader *)replication->task->data,
+            FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_REQ,
+            sizeof(FDIRProtoPushSnapshotReqBodyHeader) + length);
+    replication->task->length = front_length + length;
+
+    replication->context.snapshot.offset += length;
+    replication->context.snapshot.waiting_resp = true;
+    sf_send_add_event(replication->task);
+    return 0;
+}
+
 static int deal_connected_replication(FDIRSlaveReplication *replication)
 {
     int result;
@@ -752,25 +1058,41 @@ static int deal_connected_replication(FDIRSlaveReplication *replication)
             return 0;
         }
 
-        if ((result=start_binlog_read_thread(replication)) == 0) {
-            set_replication_stage(replication,
-                    FDIR_REPLICATION_STAGE_SYNC_FROM_DISK);
-            replication->context.sync_by_disk_stat.start_time_ms =
-                get_current_time_ms();
+        replication->context.push_credits = REPLICA_PUSH_WINDOW;
+        replication->context.lag_sample.data_version = 0;
+
+        //the diverged slave can't sync the binlog
+        if (replication->context.snapshot.diverged) {
+            return start_sync_from_snapshot(replication);
         }
-        return result;
+
+        //the empty slave, such as the new one
+        if (replication->slave->last_data_version == 0 &&
+                REPLICA_SNAPSHOT_BOOTSTRAP)
+        {
+            //fall back to sync the whole binlog when no checkpoint
+            if (start_sync_from_snapshot(replication) == 0) {
+                return 0;
+            }
+        }
+
+        return start_sync_from_disk(replication);
     }
 
     if (!(replication->task->offset == 0 && replication->task->length == 0)) {
         return 0;
     }
 
+    if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_SNAPSHOT) {
+        return sync_snapshot_to_slave(replication);
+    }
+
+    if (replication->context.push_credits <= 0) {  //flow control
+        return 0;
+    }
+
     if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_DISK) {
-        if (replication->context.last_data_versions.by_resp >=
-                replication->context.last_data_versions.by_disk.previous) //flow control
-        {
-            return sync_binlog_from_disk(replication);
-        }
+        return sync_binlog_from_disk(replication);
     } else if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_QUEUE) {
         push_result_ring_clear_timeouts(&replication->context.push_result_ctx);
         return sync_binlog_from_queue(replication);
@@ -31,17 +31,20 @@
 #define BINLOG_OP_REMOVE_DENTRY_INT  2
 #define BINLOG_OP_RENAME_DENTRY_INT  3
 #define BINLOG_OP_UPDATE_DENTRY_INT  4
+#define BINLOG_OP_SET_QUOTA_INT      5  //the quota of the namespace
 
 #define BINLOG_OP_NONE_STR           ""
 #define BINLOG_OP_CREATE_DENTRY_STR  "cr"
 #define BINLOG_OP_REMOVE_DENTRY_STR  "rm"
 #define BINLOG_OP_RENAME_DENTRY_STR  "rn"
 #define BINLOG_OP_UPDATE_DENTRY_STR  "up"
+#define BINLOG_OP_SET_QUOTA_STR      "sq"
 
 #define BINLOG_OP_CREATE_DENTRY_LEN  (sizeof(BINLOG_OP_CREATE_DENTRY_STR) - 1)
 #define BINLOG_OP_REMOVE_DENTRY_LEN  (sizeof(BINLOG_OP_REMOVE_DENTRY_STR) - 1)
 #define BINLOG_OP_RENAME_DENTRY_LEN  (sizeof(BINLOG_OP_RENAME_DENTRY_STR) - 1)
 #define BINLOG_OP_UPDATE_DENTRY_LEN  (sizeof(BINLOG_OP_UPDATE_DENTRY_STR) - 1)
+#define BINLOG_OP_SET_QUOTA_LEN      (sizeof(BINLOG_OP_SET_QUOTA_STR) - 1)
 
 #define BINLOG_OPTIONS_PATH_ENABLED  (1 | (1 << 1))
 
@@ -91,11 +94,13 @@ typedef struct fdir_binlog_record {
 
     FDIRDEntryStatus stat;
     string_t link;
+    FDIRNamespaceQuota quota;  //for set quota
 
     //must be the last to avoid being overwritten by memset
     struct {
         data_thread_notify_func func;
         void *args;    //for thread continue deal
+        struct server_binlog_record_buffer *rbuffer; //by group commit
     } notify;
 
     struct fdir_binlog_record *next; //for data thread queue
@@ -106,6 +111,22 @@ typedef struct server_binlog_record_buffer {
     volatile int reffer_count;
     void *args;  //for notify & release 
     release_binlog_rbuffer_func release_func;
+    bool wait_replica;  //the tasks wait for the slave acks
+    int64_t produce_time_ms;  //for the replica delay
+
+    /* the records of the concurrent requests packed together, the task
+     * of data_version.first + i is tasks[i] instead of args
+     */
+    struct {
+        int count;      //0 for the single task
+        volatile int ready_count;  //push to producer when all tasks ready
+        volatile int done_count;   //write binlog when all tasks done
+        struct fast_task_info **tasks;
+    } group;
+
+    //set by the local consumer, one per task
+    FDIRReplicaAckWaiter **waiters;
+
     FastBuffer buffer;
     struct server_binlog_record_buffer *next;      //for producer
     struct server_binlog_record_buffer *nexts[0];  //for slave replications
@@ -126,6 +147,8 @@ static inline const char *get_operation_caption(const int operation)
             return "RENAME";
         case BINLOG_OP_UPDATE_DENTRY_INT:
             return "UPDATE";
+        case BINLOG_OP_SET_QUOTA_INT:
+            return "SET_QUOTA";
         default:
             return "UNKOWN";
     }
@@ -35,6 +35,57 @@
 
 #define DATA_VERSION_FOR_RING(version)  (version).last
 
+static struct fast_mblock_man waiter_allocator;
+
+int push_result_waiter_init()
+{
+    return fast_mblock_init_ex1(&waiter_allocator, "ack_waiter",
+            sizeof(FDIRReplicaAckWaiter), 4096, 0, NULL, NULL, true);
+}
+
+FDIRReplicaAckWaiter *push_result_waiter_alloc(struct fast_task_info *task,
+        const int wait_count, const int reffer_count)
+{
+    FDIRReplicaAckWaiter *waiter;
+
+    waiter = (FDIRReplicaAckWaiter *)fast_mblock_alloc_object(
+            &waiter_allocator);
+    if (waiter == NULL) {
+        return NULL;
+    }
+
+    waiter->task = task;
+    waiter->wait_count = wait_count;
+    waiter->reffer_count = reffer_count;
+    return waiter;
+}
+
+void push_result_waiter_done(FDIRReplicaAckWaiter *waiter,
+        FDIRReplicaAckStat *stat, const bool acked)
+{
+    int wait_count;
+
+    wait_count = __sync_sub_and_fetch(&waiter->wait_count, 1);
+    if (acked && stat != NULL) {
+        if (wait_count > 0) {
+            stat->acked_count++;
+        } else if (wait_count == 0) {
+            stat->acked_count++;
+            stat->satisfied_count++;
+        } else {
+            stat->late_count++;
+        }
+    }
+
+    if (wait_count == 0) {
+        sf_nio_notify(waiter->task, SF_NIO_STAGE_CONTINUE);
+    }
+
+    if (__sync_sub_and_fetch(&waiter->reffer_count, 1) == 0) {
+        fast_mblock_free_object(&waiter_allocator, waiter);
+    }
+}
+
 int push_result_ring_check_init(FDIRBinlogPushResultContext *ctx,
         const int alloc_size)
 {
@@ -60,18 +111,11 @@ int push_result_ring_check_init(FDIRBinlogPushResultContext *ctx,
         0, NULL, NULL, false);
 }
 
-static inline void desc_task_waiting_rpc_count(
-        FDIRBinlogPushResultEntry *entry)
+static inline void entry_waiter_done(FDIRBinlogPushResultContext *ctx,
+        FDIRBinlogPushResultEntry *entry, const bool acked)
 {
-    if (entry->waiting_task == NULL) {
-        return;
-    }
-
-    if (__sync_sub_and_fetch(&((FDIRServerTaskArg *)
-                    entry->waiting_task->arg)->context.
-                service.waiting_rpc_count, 1) == 0)
-    {
-        sf_nio_notify(entry->waiting_task, SF_NIO_STAGE_CONTINUE);
+    if (entry->waiter != NULL) {
+        push_result_waiter_done(entry->waiter, ctx->ack_stat, acked);
     }
 }
 
@@ -89,7 +133,7 @@ static void push_result_ring_clear_queue_all(FDIRBinlogPushResultContext *ctx)
         deleted = current;
         current = current->next;
 
-        desc_task_waiting_rpc_count(deleted);
+        entry_waiter_done(ctx, deleted, false);
         fast_mblock_free_object(&ctx->queue.rentry_allocator, deleted);
     }
 
@@ -107,9 +151,9 @@ void push_result_ring_clear_all(FDIRBinlogPushResultContext *ctx)
 
     index = ctx->ring.start - ctx->ring.entries;
     while (ctx->ring.start != ctx->ring.end) {
-        desc_task_waiting_rpc_count(ctx->ring.start);
+        entry_waiter_done(ctx, ctx->ring.start, false);
         ctx->ring.start->data_version = 0;
-        ctx->ring.start->waiting_task = NULL;
+        ctx->ring.start->waiter = NULL;
 
         ctx->ring.start = ctx->ring.entries +
             (++index % ctx->ring.size);
@@ -141,9 +185,9 @@ static int  push_result_ring_clear_queue_timeouts(
 
         logWarning("file: "__FILE__", line: %d, "
                 "waiting push response timeout, data_version: "
-                "%"PRId64", task: %p", __LINE__, deleted->data_version,
-                deleted->waiting_task);
-        desc_task_waiting_rpc_count(deleted);
+                "%"PRId64", waiter: %p", __LINE__, deleted->data_version,
+                deleted->waiter);
+        entry_waiter_done(ctx, deleted, false);
         fast_mblock_free_object(&ctx->queue.rentry_allocator, deleted);
         ++count;
     }
@@ -173,17 +217,12 @@ void push_result_ring_clear_timeouts(FDIRBinlogPushResultContext *ctx)
                 ctx->ring.start->expires < g_current_time)
         {
             logWarning("file: "__FILE__", line: %d, "
-                    "waiting push response from server %s:%u timeout, "
-                    "data_version: %"PRId64, __LINE__, (ctx->ring.start->
-                        waiting_task != NULL ? ctx->ring.start->
-                        waiting_task->server_ip : ""),
-                    (ctx->ring.start->waiting_task != NULL ?
-                     ctx->ring.start->waiting_task->port : 0),
-                    ctx->ring.start->data_version);
-
-            desc_task_waiting_rpc_count(ctx->ring.start);
+                    "waiting push response timeout, data_version: "
+                    "%"PRId64, __LINE__, ctx->ring.start->data_version);
+
+            entry_waiter_done(ctx, ctx->ring.start, false);
             ctx->ring.start->data_version = 0;
-            ctx->ring.start->waiting_task = NULL;
+            ctx->ring.start->waiter = NULL;
 
             ctx->ring.start = ctx->ring.entries +
                 (++index % ctx->ring.size);
@@ -211,7 +250,7 @@ void push_result_ring_destroy(FDIRBinlogPushResultContext *ctx)
 }
 
 static int add_to_queue(FDIRBinlogPushResultContext *ctx,
-            const uint64_t data_version, struct fast_task_info *waiting_task)
+            const uint64_t data_version, FDIRReplicaAckWaiter *waiter)
 {
     FDIRBinlogPushResultEntry *entry;
     FDIRBinlogPushResultEntry *previous;
@@ -224,7 +263,7 @@ static int add_to_queue(FDIRBinlogPushResultContext *ctx,
     }
 
     entry->data_version = data_version;
-    entry->waiting_task = waiting_task;
+    entry->waiter = waiter;
     entry->expires = g_current_time + SF_G_NETWORK_TIMEOUT;
 
     if (ctx->queue.tail == NULL) {  //empty queue
@@ -260,7 +299,7 @@ static int add_to_queue(FDIRBinlogPushResultContext *ctx,
 
 int push_result_ring_add(FDIRBinlogPushResultContext *ctx,
         const SFVersionRange *data_version,
-        struct fast_task_info *waiting_task)
+        FDIRReplicaAckWaiter *waiter)
 {
     FDIRBinlogPushResultEntry *entry;
     FDIRBinlogPushResultEntry *previous;
@@ -302,7 +341,7 @@ int push_result_ring_add(FDIRBinlogPushResultContext *ctx,
 
         entry = ctx->ring.entries + data_version->last % ctx->ring.size;
         entry->data_version = data_version->last;
-        entry->waiting_task = waiting_task;
+        entry->waiter = waiter;
         entry->expires = g_current_time + SF_G_NETWORK_TIMEOUT;
         return 0;
     }
@@ -317,7 +356,7 @@ int push_result_ring_add(FDIRBinlogPushResultContext *ctx,
         }
     }
 
-    return add_to_queue(ctx, data_version->last, waiting_task);
+    return add_to_queue(ctx, data_version->last, waiter);
 }
 
 static int remove_from_queue(FDIRBinlogPushResultContext *ctx,
@@ -356,7 +395,7 @@ static int remove_from_queue(FDIRBinlogPushResultContext *ctx,
         }
     }
 
-    desc_task_waiting_rpc_count(entry);
+    entry_waiter_done(ctx, entry, true);
     fast_mblock_free_object(&ctx->queue.rentry_allocator, entry);
     return 0;
 }
@@ -383,9 +422,9 @@ int push_result_ring_remove(FDIRBinlogPushResultContext *ctx,
                 }
             }
 
-            desc_task_waiting_rpc_count(entry);
+            entry_waiter_done(ctx, entry, true);
             entry->data_version = 0;
-            entry->waiting_task = NULL;
+            entry->waiter = NULL;
             return 0;
         }
     }
@@ -24,6 +24,18 @@
 extern "C" {
 #endif
 
+int push_result_waiter_init();
+
+FDIRReplicaAckWaiter *push_result_waiter_alloc(struct fast_task_info *task,
+        const int wait_count, const int reffer_count);
+
+/* one slave done for the waiter, notify the task when the acks required
+ * by the ack policy reached
+ * acked: true for the slave response, false for discard or timeout
+ */
+void push_result_waiter_done(FDIRReplicaAckWaiter *waiter,
+        FDIRReplicaAckStat *stat, const bool acked);
+
 int push_result_ring_check_init(FDIRBinlogPushResultContext *ctx,
         const int alloc_size);
 
@@ -31,7 +43,7 @@ void push_result_ring_destroy(FDIRBinlogPushResultContext *ctx);
 
 int push_result_ring_add(FDIRBinlogPushResultContext *ctx,
         const SFVersionRange *data_version,
-        struct fast_task_info *waiting_task);
+        FDIRReplicaAckWaiter *waiter);
 
 int push_result_ring_remove(FDIRBinlogPushResultContext *ctx,
         const uint64_t data_version);
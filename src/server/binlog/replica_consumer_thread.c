@@ -34,6 +34,8 @@
 #include "sf/sf_nio.h"
 #include "common/fdir_proto.h"
 #include "../server_global.h"
+#include "../version_waiter.h"
+#include "../data_checkpoint.h"
 #include "binlog_func.h"
 #include "binlog_reader.h"
 #include "binlog_producer.h"
@@ -220,6 +222,8 @@ static inline int push_and_set_next_recv_buffer(
     }
 
     ctx->recv_rbuffer = rb;
+    ctx->credits.granting += ctx->credits.pending;
+    ctx->credits.pending = 0;
     return 0;
 }
 
@@ -227,12 +231,14 @@ int deal_replica_push_request(ReplicaConsumerThreadContext *ctx,
         char *binlog_buff, const int length,
         const SFVersionRange *data_version)
 {
-    ServerBinlogRecordBuffer *rb = NULL;
-    static int max_waiting_count = 0;
+    ServerBinlogRecordBuffer *rb;
     int result;
-    int waiting_count;
 
-    ctx->recv_rbuffer->data_version = *data_version;
+    if (ctx->recv_rbuffer->buffer.length == 0) {
+        ctx->recv_rbuffer->data_version = *data_version;
+    } else {
+        ctx->recv_rbuffer->data_version.last = data_version->last;
+    }
     if ((result=fast_buffer_check(&ctx->recv_rbuffer->buffer,
                     length)) != 0)
     {
@@ -243,40 +249,19 @@ int deal_replica_push_request(ReplicaConsumerThreadContext *ctx,
             ctx->recv_rbuffer->buffer.length,
             binlog_buff, length);
     ctx->recv_rbuffer->buffer.length += length;
+    ctx->credits.pending++;
 
+    /* keep appending when no free buffer, the master stops pushing
+     * after its credits used up, check_retry_push_request hands the
+     * buffer off when the replay thread returns one
+     */
     rb = (ServerBinlogRecordBuffer *)common_blocked_queue_pop_ex(
                 &ctx->queues.free, false);
     if (rb != NULL) {
         return push_and_set_next_recv_buffer(ctx, rb);
     }
 
-    if (ctx->recv_rbuffer->buffer.length < ctx->task->size) { //flow control
-        return 0;
-    }
-
-    waiting_count = 0;
-    while (ctx->continue_flag) {
-        rb = (ServerBinlogRecordBuffer *)common_blocked_queue_pop_ex(
-                &ctx->queues.free, false);
-        if (rb != NULL) {
-            break;
-        }
-
-        ++waiting_count;
-        fc_sleep_ms(10);
-    }
-
-    if (waiting_count > max_waiting_count) {
-        max_waiting_count = waiting_count;
-        logWarning("file: "__FILE__", line: %d, "
-                "alloc record buffer reachs max waiting count: %d, "
-                "buffer length: %d", __LINE__, max_waiting_count, length);
-    }
-    if (rb == NULL) {
-        return EAGAIN;
-    }
-
-    return push_and_set_next_recv_buffer(ctx, rb);
+    return 0;
 }
 
 static inline int check_retry_push_request(ReplicaConsumerThreadContext *ctx)
@@ -300,6 +285,7 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
     struct common_blocked_node *current;
     struct common_blocked_node *last;
     RecordProcessResult *r;
+    FDIRProtoPushBinlogRespBodyHeader *body_header;
     char *p;
     int count;
 
@@ -307,9 +293,8 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
         return 0;
     }
 
-    if ((node=common_blocked_queue_try_pop_all_nodes(
-                    &ctx->queues.result)) == NULL)
-    {
+    node = common_blocked_queue_try_pop_all_nodes(&ctx->queues.result);
+    if (node == NULL && ctx->credits.granting == 0) {
         return EAGAIN;
     }
 
@@ -319,7 +304,7 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
 
     last = NULL;
     current = node;
-    do {
+    while (current != NULL) {
         if ((p - ctx->task->data) + sizeof(FDIRProtoPushBinlogRespBodyPart) >
                 ctx->task->size)
         {
@@ -341,11 +326,16 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
 
         last = current;
         current = current->next;
-    } while (current != NULL);
-    common_blocked_queue_free_all_nodes(&ctx->queues.result, node);
+    }
+    if (node != NULL) {
+        common_blocked_queue_free_all_nodes(&ctx->queues.result, node);
+    }
 
-    int2buff(count, ((FDIRProtoPushBinlogRespBodyHeader *)
-                (ctx->task->data + sizeof(FDIRProtoHeader)))->count);
+    body_header = (FDIRProtoPushBinlogRespBodyHeader *)
+        (ctx->task->data + sizeof(FDIRProtoHeader));
+    int2buff(count, body_header->count);
+    int2buff(ctx->credits.granting, body_header->credits);
+    ctx->credits.granting = 0;
 
     ctx->task->length = p - ctx->task->data;
     SF_PROTO_SET_HEADER((FDIRProtoHeader *)ctx->task->data,
@@ -371,6 +361,7 @@ static void *deal_binlog_thread_func(void *arg)
     struct common_blocked_node *node;
     struct common_blocked_node *current;
     ServerBinlogRecordBuffer *rb;
+    int result;
 
     logDebug("file: "__FILE__", line: %d, "
             "deal_binlog_thread_func start", __LINE__);
@@ -393,9 +384,19 @@ static void *deal_binlog_thread_func(void *arg)
                     __LINE__, rb->buffer.length, rb->data_version);
                     */
 
-            if (binlog_replay_deal_buffer(&ctx->replay_ctx,
-                    rb->buffer.data, rb->buffer.length, NULL) == 0)
+            /* the pipelined replay applies the records out of order,
+             * the checkpoint waits until the whole buffer applied
+             */
+            data_checkpoint_update_begin();
+            if ((result=binlog_replay_deal_buffer(&ctx->replay_ctx,
+                    rb->buffer.data, rb->buffer.length, NULL)) == 0)
             {
+                //all the records of the buffer applied
+                version_waiter_set_readable(rb->data_version.last);
+            }
+            data_checkpoint_update_end();
+
+            if (result == 0) {
                 if (push_to_binlog_write_queue(rb) != 0) {
                     logCrit("file: "__FILE__", line: %d, "
                             "push_to_binlog_write_queue fail, "
@@ -46,6 +46,14 @@ typedef struct replica_consumer_thread_context {
     struct fast_task_info *task;
     ServerBinlogRecordBuffer *recv_rbuffer;
 
+    /* the push requests appended to recv_rbuffer are granted back to
+     * the master after the buffer handed to the replay thread
+     */
+    struct {
+        int pending;
+        int granting;
+    } credits;
+
     BinlogReplayContext replay_ctx;
 } ReplicaConsumerThreadContext;
 
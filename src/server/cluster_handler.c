@@ -45,6 +45,9 @@
 #include "server_func.h"
 #include "dentry.h"
 #include "server_binlog.h"
+#include "data_checkpoint.h"
+#include "version_waiter.h"
+#include "load_stat.h"
 #include "cluster_relationship.h"
 #include "common_handler.h"
 #include "cluster_handler.h"
@@ -234,12 +237,15 @@ static int cluster_deal_ping_master(struct fast_task_info *task)
 {
     int result;
     int cluster_change_version;
+    FDIRProtoPingMasterReq *req;
     FDIRProtoPingMasterRespHeader *resp_header;
     FDIRProtoPingMasterRespBodyPart *body_part;
     FDIRClusterServerInfo *cs;
     FDIRClusterServerInfo *end;
 
-    if ((result=server_expect_body_length(task, 0)) != 0) {
+    if ((result=server_expect_body_length(task,
+                    sizeof(FDIRProtoPingMasterReq))) != 0)
+    {
         return result;
     }
 
@@ -257,24 +263,38 @@ static int cluster_deal_ping_master(struct fast_task_info *task)
         return EINVAL;
     }
 
+    req = (FDIRProtoPingMasterReq *)REQUEST.body;
+    CLUSTER_PEER->load.in_flight = buff2int(req->load.in_flight);
+    CLUSTER_PEER->load.p99_latency_us = buff2int(req->load.p99_latency_us);
+
     resp_header = (FDIRProtoPingMasterRespHeader *)REQUEST.body;
     body_part = (FDIRProtoPingMasterRespBodyPart *)(REQUEST.body +
             sizeof(FDIRProtoPingMasterRespHeader));
     long2buff(CURRENT_INODE_SN, resp_header->inode_sn);
+    memset(resp_header->padding, 0, sizeof(resp_header->padding));
 
     cluster_change_version = __sync_add_and_fetch(
             &CLUSTER_SERVER_ARRAY.change_version, 0);
     if (CLUSTER_PEER->last_change_version != cluster_change_version) {
         CLUSTER_PEER->last_change_version = cluster_change_version;
-        int2buff(CLUSTER_SERVER_ARRAY.count, resp_header->server_count);
-
-        end = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
-        for (cs=CLUSTER_SERVER_ARRAY.servers; cs<end; cs++, body_part++) {
-            int2buff(cs->server->id, body_part->server_id);
-            body_part->status = __sync_fetch_and_add(&cs->status, 0);
-        }
+        resp_header->status_changed = 1;
     } else {
-        int2buff(0, resp_header->server_count);
+        resp_header->status_changed = 0;
+    }
+
+    //the load of all servers for the readable server selection
+    int2buff(CLUSTER_SERVER_ARRAY.count, resp_header->server_count);
+    end = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
+    for (cs=CLUSTER_SERVER_ARRAY.servers; cs<end; cs++, body_part++) {
+        int2buff(cs->server->id, body_part->server_id);
+        body_part->status = __sync_fetch_and_add(&cs->status, 0);
+        memset(body_part->padding, 0, sizeof(body_part->padding));
+        long2buff(load_stat_get_lag_versions(cs),
+                body_part->replica_lag.data_versions);
+        int2buff(cs->replica_lag.delay_ms, body_part->replica_lag.delay_ms);
+        int2buff(__sync_add_and_fetch(&cs->load.in_flight, 0),
+                body_part->load.in_flight);
+        int2buff(cs->load.p99_latency_us, body_part->load.p99_latency_us);
     }
 
     TASK_ARG->context.response_done = true;
@@ -345,7 +365,7 @@ static int cluster_deal_push_binlog_req(struct fast_task_info *task)
 
     if ((result=server_check_min_body_length(task,
                     sizeof(FDIRProtoPushBinlogReqBodyHeader) +
-                    BINLOG_RECORD_MIN_SIZE)) != 0)
+                    BINLOG_ANY_RECORD_MIN_SIZE)) != 0)
     {
         return result;
     }
@@ -408,9 +428,9 @@ static int cluster_deal_push_binlog_resp(struct fast_task_info *task)
         return result;
     }
 
+    //the response without results only grants the credits
     if ((result=server_check_min_body_length(task,
-                    sizeof(FDIRProtoPushBinlogRespBodyHeader) +
-                    sizeof(FDIRProtoPushBinlogRespBodyPart))) != 0)
+                    sizeof(FDIRProtoPushBinlogRespBodyHeader))) != 0)
     {
         return result;
     }
@@ -428,6 +448,7 @@ static int cluster_deal_push_binlog_resp(struct fast_task_info *task)
         return EINVAL;
     }
 
+    CLUSTER_REPLICA->context.push_credits += buff2int(body_header->credits);
     body_part = (FDIRProtoPushBinlogRespBodyPart *)(REQUEST.body +
             sizeof(FDIRProtoPushBinlogRespBodyHeader));
     bp_end = body_part + count;
@@ -476,6 +497,170 @@ static int fill_binlog_last_lines(struct fast_task_info *task,
             buffer_size, binlog_count, binlog_length);
 }
 
+static int cluster_deal_push_snapshot_resp(struct fast_task_info *task)
+{
+    int result;
+
+    if ((result=check_replication_master_task(task)) != 0) {
+        return result;
+    }
+
+    if (REQUEST_STATUS != 0) {
+        RESPONSE.error.length = snprintf(RESPONSE.error.message,
+                sizeof(RESPONSE.error.message), "slave install "
+                "snapshot fail, errno: %d, error info: %.*s",
+                REQUEST_STATUS, REQUEST.header.body_len, REQUEST.body);
+        return REQUEST_STATUS;
+    }
+
+    if (CLUSTER_REPLICA->stage != FDIR_REPLICATION_STAGE_SYNC_FROM_SNAPSHOT ||
+            !CLUSTER_REPLICA->context.snapshot.waiting_resp)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "unexpect push snapshot response, replication stage: %d",
+                CLUSTER_REPLICA->stage);
+        return EINVAL;
+    }
+
+    CLUSTER_REPLICA->context.snapshot.waiting_resp = false;
+    return 0;
+}
+
+static int push_snapshot_install_done(struct fast_task_info *task)
+{
+    if (RESPONSE_STATUS != 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "install snapshot fail, errno: %d, error info: %s",
+                RESPONSE_STATUS, STRERROR(RESPONSE_STATUS));
+    }
+
+    task->continue_callback = NULL;
+    return RESPONSE_STATUS;
+}
+
+static int push_diverged_snapshot_install_done(struct fast_task_info *task)
+{
+    int result;
+
+    if ((result=push_snapshot_install_done(task)) == 0) {
+        logCrit("file: "__FILE__", line: %d, "
+                "my binlog diverged from the master, the snapshot "
+                "pushed by the master installed, program exit for "
+                "loading it! please restart me", __LINE__);
+        sf_terminate_myself();
+    }
+
+    return result;
+}
+
+static void *install_snapshot_thread_func(void *arg)
+{
+    struct fast_task_info *task;
+    int result;
+
+    task = (struct fast_task_info *)arg;
+    if ((result=data_checkpoint_install_snapshot()) != 0) {
+        if (__sync_add_and_fetch(&DATA_CURRENT_VERSION, 0) > 0) {
+            logCrit("file: "__FILE__", line: %d, "
+                    "install snapshot fail, the dentries are incomplete, "
+                    "program exit!", __LINE__);
+            sf_terminate_myself();
+        }
+    } else {
+        version_waiter_set_readable(__sync_add_and_fetch(
+                    &DATA_CURRENT_VERSION, 0));
+    }
+
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    return NULL;
+}
+
+static void *install_diverged_snapshot_thread_func(void *arg)
+{
+    struct fast_task_info *task;
+
+    task = (struct fast_task_info *)arg;
+    RESPONSE_STATUS = data_checkpoint_install_diverged_snapshot();
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    return NULL;
+}
+
+static int cluster_deal_push_snapshot_req(struct fast_task_info *task)
+{
+    int result;
+    int length;
+    int64_t file_size;
+    int64_t offset;
+    bool diverged;
+    pthread_t tid;
+    FDIRProtoPushSnapshotReqBodyHeader *body_header;
+
+    if ((result=server_check_min_body_length(task,
+                    sizeof(FDIRProtoPushSnapshotReqBodyHeader))) != 0)
+    {
+        return result;
+    }
+
+    if ((result=check_replication_slave_task(task)) != 0) {
+        return result;
+    }
+
+    body_header = (FDIRProtoPushSnapshotReqBodyHeader *)REQUEST.body;
+    file_size = buff2long(body_header->file_size);
+    offset = buff2long(body_header->offset);
+    length = buff2int(body_header->length);
+    diverged = body_header->diverged;
+    if (sizeof(FDIRProtoPushSnapshotReqBodyHeader) + length !=
+            REQUEST.header.body_len)
+    {
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "body length: %d != expect: %d", REQUEST.header.body_len,
+                (int)(sizeof(FDIRProtoPushSnapshotReqBodyHeader) + length));
+        return EINVAL;
+    }
+
+    if (!diverged && __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0) != 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "i am not empty, data version: %"PRId64,
+                __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0));
+        return EEXIST;
+    }
+
+    RESPONSE.header.cmd = FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_RESP;
+    if ((result=data_checkpoint_recv_snapshot(file_size, offset,
+                    (char *)(body_header + 1), length)) != 0)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "write snapshot fail, offset: %"PRId64, offset);
+        return result;
+    }
+
+    if (offset + length < file_size) {
+        return 0;
+    }
+
+    /* restore the dentries in the background for the large snapshot,
+     * the diverged slave restarts to restore them
+     */
+    if (diverged) {
+        task->continue_callback = push_diverged_snapshot_install_done;
+        result = fc_create_thread(&tid, install_diverged_snapshot_thread_func,
+                task, SF_G_THREAD_STACK_SIZE);
+    } else {
+        task->continue_callback = push_snapshot_install_done;
+        result = fc_create_thread(&tid, install_snapshot_thread_func,
+                task, SF_G_THREAD_STACK_SIZE);
+    }
+    if (result != 0) {
+        task->continue_callback = NULL;
+        return result;
+    }
+
+    return TASK_STATUS_CONTINUE;
+}
+
 static int cluster_deal_join_slave_req(struct fast_task_info *task)
 {
     int result;
@@ -625,6 +810,20 @@ static int cluster_check_binlog_consistency(
     {
         char prompt[128];
         if (result == SF_CLUSTER_ERROR_BINLOG_INCONSISTENT) {
+            //push the snapshot to the diverged slave as the empty one
+            if (REPLICA_SNAPSHOT_BOOTSTRAP &&
+                    data_checkpoint_snapshot_exists())
+            {
+                logWarning("file: "__FILE__", line: %d, "
+                        "slave server id: %d, the last %d binlogs NOT "
+                        "consistent, first unmatched data version: %"PRId64
+                        ", push the snapshot to it", __LINE__,
+                        CLUSTER_REPLICA->slave->server->id,
+                        new_binlog_count, first_unmatched_dv);
+                CLUSTER_REPLICA->context.snapshot.diverged = true;
+                return 0;
+            }
+
             sprintf(prompt, "first unmatched data "
                     "version: %"PRId64, first_unmatched_dv);
 
@@ -714,8 +913,10 @@ static int cluster_deal_notify_slave_quit(struct fast_task_info *task)
     first_unmatched_dv = buff2long(req->first_unmatched_dv);
     logCrit("file: "__FILE__", line: %d, "
             "my last %d binlogs NOT consistent with master server: %d, "
-            "the first unmatched data version: %"PRId64", program exit!",
-            __LINE__, binlog_count, server_id, first_unmatched_dv);
+            "the first unmatched data version: %"PRId64", program exit! "
+            "you can remove the files of the data path then restart, "
+            "the master will push the snapshot to me", __LINE__,
+            binlog_count, server_id, first_unmatched_dv);
     sf_terminate_myself();
     return -EBUSY;
 }
@@ -792,6 +993,13 @@ int cluster_deal_task(struct fast_task_info *task, const int stage)
                 result = cluster_deal_push_binlog_resp(task);
                 TASK_ARG->context.need_response = false;
                 break;
+            case FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_REQ:
+                result = cluster_deal_push_snapshot_req(task);
+                break;
+            case FDIR_REPLICA_PROTO_PUSH_SNAPSHOT_RESP:
+                result = cluster_deal_push_snapshot_resp(task);
+                TASK_ARG->context.need_response = false;
+                break;
             case FDIR_REPLICA_PROTO_NOTIFY_SLAVE_QUIT:
                 result = cluster_deal_notify_slave_quit(task);
                 TASK_ARG->context.need_response = false;
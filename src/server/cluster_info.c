@@ -135,6 +135,45 @@ FDIRClusterServerInfo *fdir_get_server_by_id(const int server_id)
             FC_SID_SERVERS(CLUSTER_CONFIG_CTX));
 }
 
+static bool address_array_contains(const FCAddressPtrArray *addr_array,
+        const char *ip_addr)
+{
+    FCAddressInfo **addr;
+    FCAddressInfo **end;
+
+    end = addr_array->addrs + addr_array->count;
+    for (addr=addr_array->addrs; addr<end; addr++) {
+        if (strcmp((*addr)->conn.ip_addr, ip_addr) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool cluster_info_is_peer_ip(const char *ip_addr)
+{
+    FDIRClusterServerInfo *cs;
+    FDIRClusterServerInfo *end;
+
+    if (is_local_host_ip(ip_addr)) {
+        return true;
+    }
+
+    end = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
+    for (cs=CLUSTER_SERVER_ARRAY.servers; cs<end; cs++) {
+        if (address_array_contains(&CLUSTER_GROUP_ADDRESS_ARRAY(
+                        cs->server), ip_addr) ||
+                address_array_contains(&SERVICE_GROUP_ADDRESS_ARRAY(
+                        cs->server), ip_addr))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static int load_servers_from_ini_ctx(IniContext *ini_context)
 {
     FDIRClusterServerInfo *cs;
@@ -31,6 +31,9 @@ int cluster_info_destroy();
 
 FDIRClusterServerInfo *fdir_get_server_by_id(const int server_id);
 
+//the local host or one of the cluster servers, for the admin requests
+bool cluster_info_is_peer_ip(const char *ip_addr);
+
 int cluster_info_setup_sync_to_file_task();
 
 static inline void cluster_info_set_status(FDIRClusterServerInfo *cs,
@@ -147,7 +147,9 @@ static int proto_join_master(ConnectionInfo *conn)
 
 static int proto_ping_master(ConnectionInfo *conn)
 {
-    FDIRProtoHeader header;
+    FDIRProtoHeader *header;
+    FDIRProtoPingMasterReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoPingMasterReq)];
     SFResponseInfo response;
     char in_buff[8 * 1024];
     FDIRProtoPingMasterRespHeader *body_header;
@@ -159,11 +161,18 @@ static int proto_ping_master(ConnectionInfo *conn)
     int server_id;
     int result;
 
-    SF_PROTO_SET_HEADER(&header, FDIR_CLUSTER_PROTO_PING_MASTER_REQ, 0);
+    header = (FDIRProtoHeader *)out_buff;
+    req = (FDIRProtoPingMasterReq *)(header + 1);
+    SF_PROTO_SET_HEADER(header, FDIR_CLUSTER_PROTO_PING_MASTER_REQ,
+            sizeof(FDIRProtoPingMasterReq));
+    int2buff(__sync_add_and_fetch(&CLUSTER_MYSELF_PTR->load.in_flight, 0),
+            req->load.in_flight);
+    int2buff(CLUSTER_MYSELF_PTR->load.p99_latency_us,
+            req->load.p99_latency_us);
 
     response.error.length = 0;
-    if ((result=sf_send_and_check_response_header(conn, (char *)&header,
-                    sizeof(header), &response, SF_G_NETWORK_TIMEOUT,
+    if ((result=sf_send_and_check_response_header(conn, out_buff,
+                    sizeof(out_buff), &response, SF_G_NETWORK_TIMEOUT,
                     FDIR_CLUSTER_PROTO_PING_MASTER_RESP)) == 0)
     {
         if (response.header.body_len > sizeof(in_buff)) {
@@ -212,9 +221,21 @@ static int proto_ping_master(ConnectionInfo *conn)
     body_end = body_part + server_count;
     for (; body_part < body_end; body_part++) {
         server_id = buff2int(body_part->server_id);
-        if ((cs=fdir_get_server_by_id(server_id)) != NULL) {
+        if ((cs=fdir_get_server_by_id(server_id)) == NULL) {
+            continue;
+        }
+
+        if (body_header->status_changed) {
             cluster_info_set_status(cs, body_part->status);
         }
+        cs->load.lag_versions = buff2long(
+                body_part->replica_lag.data_versions);
+        cs->replica_lag.delay_ms = buff2int(body_part->replica_lag.delay_ms);
+        if (cs != CLUSTER_MYSELF_PTR) {
+            cs->load.in_flight = buff2int(body_part->load.in_flight);
+            cs->load.p99_latency_us = buff2int(
+                    body_part->load.p99_latency_us);
+        }
     }
 
     return 0;
@@ -0,0 +1,1386 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/hash.h"
+#include "sf/sf_global.h"
+#include "server_global.h"
+#include "server_binlog.h"
+#include "binlog/binlog_reader.h"
+#include "data_thread.h"
+#include "dentry.h"
+#include "dentry_children.h"
+#include "inode_index.h"
+#include "data_checkpoint.h"
+
+#define CHECKPOINT_MAGIC_STR       "FDCK"
+#define CHECKPOINT_MAGIC_LEN       (sizeof(CHECKPOINT_MAGIC_STR) - 1)
+#define CHECKPOINT_FORMAT_VERSION  2
+#define CHECKPOINT_BUFFER_SIZE     (1024 * 1024)
+#define CHECKPOINT_WAIT_BINLOG_TIMEOUT_MS  (30 * 1000)
+
+#define CHECKPOINT_REC_NAMESPACE   'S'
+#define CHECKPOINT_REC_QUOTA       'Q'  //the quota of the namespace
+#define CHECKPOINT_REC_DENTRY      'D'
+#define CHECKPOINT_REC_ORPHAN      'O'  //hard link source removed from tree
+#define CHECKPOINT_REC_HARD_LINK   'H'
+#define CHECKPOINT_REC_END         'E'
+
+typedef struct {
+    char magic[4];
+    char format_version[4];
+    char data_version[8];
+    char inode_sn[8];
+    char binlog_index[4];
+    char binlog_offset[8];
+    char from_snapshot;  //pushed by the master, the binlog starts after it
+    char padding[7];
+} CheckpointFileHeader;
+
+typedef struct {
+    char type;
+    unsigned char ns_len;
+    char ns_str[0];
+} CheckpointNamespaceRecord;
+
+typedef struct {
+    char type;
+    char inodes[8];
+    char bytes[8];
+    unsigned char ns_len;
+    char ns_str[0];
+} CheckpointQuotaRecord;
+
+/* followed by the link for symlink or the source inode for hard link */
+typedef struct {
+    char type;
+    char inode[8];
+    char parent_inode[8];
+    char mode[4];
+    char uid[4];
+    char gid[4];
+    char btime[4];
+    char atime[4];
+    char ctime[4];
+    char mtime[4];
+    char size[8];
+    char alloc[8];
+    char space_end[8];
+    char name_len[2];
+    char name_str[0];
+} CheckpointDentryRecord;
+
+typedef struct {
+    char type;
+    char dentry_count[8];
+} CheckpointEndRecord;
+
+typedef struct {
+    int fd;
+    char filename[PATH_MAX];
+    char *buff;
+    char *current;
+    char *end;
+    int64_t dentry_count;
+    FDIRNamespaceEntry *ns_entry;  //current namespace
+    FDIRServerDentryArray hdlinks;
+    FDIRServerDentryArray orphans;
+} CheckpointWriterContext;
+
+typedef struct {
+    int fd;
+    char filename[PATH_MAX];
+    char *buff;
+    char *current;
+    char *end;
+    int64_t dentry_count;
+    char ns_holder[NAME_MAX + 1];
+    string_t ns;
+} CheckpointReaderContext;
+
+typedef struct {
+    int fd;
+    int64_t offset;
+    char filename[PATH_MAX];
+} CheckpointSnapshotReceiver;
+
+FDIRCheckpointUpdateGate g_checkpoint_update_gate;
+static volatile int checkpoint_in_progress = 0;
+static CheckpointSnapshotReceiver snapshot_receiver = {-1, 0};
+
+#define GET_CHECKPOINT_FILENAME(filename, size) \
+    snprintf(filename, size, "%s/%s", DATA_PATH_STR, FDIR_CHECKPOINT_FILENAME)
+
+int data_checkpoint_init()
+{
+    g_checkpoint_update_gate.updating_count = 0;
+    g_checkpoint_update_gate.suspended = 0;
+    return init_pthread_lock_cond_pair(&g_checkpoint_update_gate.lcp);
+}
+
+static void suspend_updates()
+{
+    __sync_bool_compare_and_swap(&g_checkpoint_update_gate.suspended, 0, 1);
+    while (__sync_add_and_fetch(&g_checkpoint_update_gate.
+                updating_count, 0) > 0)
+    {
+        fc_sleep_ms(1);
+    }
+
+    data_thread_suspend();
+}
+
+static void resume_updates()
+{
+    data_thread_resume();
+
+    PTHREAD_MUTEX_LOCK(&g_checkpoint_update_gate.lcp.lock);
+    __sync_bool_compare_and_swap(&g_checkpoint_update_gate.suspended, 1, 0);
+    pthread_cond_broadcast(&g_checkpoint_update_gate.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&g_checkpoint_update_gate.lcp.lock);
+}
+
+static int writer_flush(CheckpointWriterContext *ctx)
+{
+    int len;
+    int result;
+
+    len = ctx->current - ctx->buff;
+    if (len == 0) {
+        return 0;
+    }
+
+    if (fc_safe_write(ctx->fd, ctx->buff, len) != len) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "write to file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, ctx->filename, result, STRERROR(result));
+        return result;
+    }
+
+    ctx->current = ctx->buff;
+    return 0;
+}
+
+static inline int writer_check_space(CheckpointWriterContext *ctx,
+        const int size)
+{
+    if (ctx->end - ctx->current >= size) {
+        return 0;
+    }
+    return writer_flush(ctx);
+}
+
+static int dentry_array_append(FDIRServerDentryArray *array,
+        FDIRServerDentry *dentry)
+{
+    FDIRServerDentry **entries;
+    int new_alloc;
+
+    if (array->count == array->alloc) {
+        new_alloc = (array->alloc > 0) ? array->alloc * 2 : 1024;
+        entries = (FDIRServerDentry **)fc_malloc(
+                sizeof(FDIRServerDentry *) * new_alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+
+        if (array->entries != NULL) {
+            memcpy(entries, array->entries,
+                    sizeof(FDIRServerDentry *) * array->count);
+            free(array->entries);
+        }
+        array->entries = entries;
+        array->alloc = new_alloc;
+    }
+
+    array->entries[array->count++] = dentry;
+    return 0;
+}
+
+static int write_namespace(CheckpointWriterContext *ctx,
+        FDIRNamespaceEntry *ns_entry)
+{
+    CheckpointNamespaceRecord *rec;
+    int result;
+
+    if (ctx->ns_entry == ns_entry) {
+        return 0;
+    }
+
+    if ((result=writer_check_space(ctx, sizeof(CheckpointNamespaceRecord) +
+                    ns_entry->name.len)) != 0)
+    {
+        return result;
+    }
+
+    rec = (CheckpointNamespaceRecord *)ctx->current;
+    rec->type = CHECKPOINT_REC_NAMESPACE;
+    rec->ns_len = ns_entry->name.len;
+    memcpy(rec->ns_str, ns_entry->name.str, ns_entry->name.len);
+    ctx->current = rec->ns_str + ns_entry->name.len;
+    ctx->ns_entry = ns_entry;
+    return 0;
+}
+
+static int write_dentry(CheckpointWriterContext *ctx,
+        const char type, FDIRServerDentry *dentry)
+{
+    CheckpointDentryRecord *rec;
+    char *p;
+    int extra_len;
+    int result;
+
+    if ((result=write_namespace(ctx, dentry->ns_entry)) != 0) {
+        return result;
+    }
+
+    if (type == CHECKPOINT_REC_HARD_LINK) {
+        extra_len = 8;
+    } else if (S_ISLNK(dentry->stat.mode)) {
+        extra_len = 2 + dentry->extra->link.len;
+    } else {
+        extra_len = 0;
+    }
+
+    if ((result=writer_check_space(ctx, sizeof(CheckpointDentryRecord) +
+                    dentry->name.len + extra_len)) != 0)
+    {
+        return result;
+    }
+
+    rec = (CheckpointDentryRecord *)ctx->current;
+    rec->type = type;
+    long2buff(dentry->inode, rec->inode);
+    long2buff(dentry->parent != NULL ? dentry->parent->inode : 0,
+            rec->parent_inode);
+    int2buff(dentry->stat.mode, rec->mode);
+    int2buff(dentry->stat.uid, rec->uid);
+    int2buff(dentry->stat.gid, rec->gid);
+    int2buff(dentry->stat.btime, rec->btime);
+    int2buff(dentry->stat.atime, rec->atime);
+    int2buff(dentry->stat.ctime, rec->ctime);
+    int2buff(dentry->stat.mtime, rec->mtime);
+    long2buff(dentry->stat.size, rec->size);
+    long2buff(dentry->stat.alloc, rec->alloc);
+    long2buff(dentry->stat.space_end, rec->space_end);
+    short2buff(dentry->name.len, rec->name_len);
+    memcpy(rec->name_str, dentry->name.str, dentry->name.len);
+    p = rec->name_str + dentry->name.len;
+
+    if (type == CHECKPOINT_REC_HARD_LINK) {
+        long2buff(dentry->extra->src_dentry->inode, p);
+        p += 8;
+    } else if (S_ISLNK(dentry->stat.mode)) {
+        short2buff(dentry->extra->link.len, p);
+        p += 2;
+        memcpy(p, dentry->extra->link.str, dentry->extra->link.len);
+        p += dentry->extra->link.len;
+    }
+
+    ctx->current = p;
+    ctx->dentry_count++;
+    return 0;
+}
+
+/* parents are written before their children,
+ * hard links are deferred until all trees are written
+ */
+static int dump_subtree(CheckpointWriterContext *ctx,
+        FDIRServerDentry *dentry)
+{
+    FDIRServerDentry *child;
+    FDIRChildrenIterator iterator;
+    int result;
+
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        return dentry_array_append(&ctx->hdlinks, dentry);
+    }
+
+    if ((result=write_dentry(ctx, CHECKPOINT_REC_DENTRY, dentry)) != 0) {
+        return result;
+    }
+
+    if (!S_ISDIR(dentry->stat.mode) || dentry->children == NULL) {
+        return 0;
+    }
+
+    dentry_children_iterator(dentry->children, &iterator);
+    while ((child=dentry_children_next(&iterator)) != NULL) {
+        if ((result=dump_subtree(ctx, child)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int write_quota(CheckpointWriterContext *ctx,
+        FDIRNamespaceEntry *ns_entry)
+{
+    CheckpointQuotaRecord *rec;
+    int result;
+
+    if ((result=writer_check_space(ctx, sizeof(CheckpointQuotaRecord) +
+                    ns_entry->name.len)) != 0)
+    {
+        return result;
+    }
+
+    rec = (CheckpointQuotaRecord *)ctx->current;
+    rec->type = CHECKPOINT_REC_QUOTA;
+    long2buff(ns_entry->quota.inodes, rec->inodes);
+    long2buff(ns_entry->quota.bytes, rec->bytes);
+    rec->ns_len = ns_entry->name.len;
+    memcpy(rec->ns_str, ns_entry->name.str, ns_entry->name.len);
+    ctx->current = rec->ns_str + ns_entry->name.len;
+    return 0;
+}
+
+static int dump_namespace(FDIRNamespaceEntry *ns_entry, void *args)
+{
+    int result;
+
+    if (ns_entry->quota.inodes > 0 || ns_entry->quota.bytes > 0) {
+        if ((result=write_quota((CheckpointWriterContext *)
+                        args, ns_entry)) != 0)
+        {
+            return result;
+        }
+    }
+
+    if (ns_entry->dentry_root == NULL) {
+        return 0;
+    }
+    return dump_subtree((CheckpointWriterContext *)args,
+            ns_entry->dentry_root);
+}
+
+static int compare_dentry_ptr(const void *p1, const void *p2)
+{
+    const FDIRServerDentry *d1;
+    const FDIRServerDentry *d2;
+
+    d1 = *((const FDIRServerDentry **)p1);
+    d2 = *((const FDIRServerDentry **)p2);
+    return (d1 > d2) ? 1 : ((d1 < d2) ? -1 : 0);
+}
+
+static int dump_hard_links(CheckpointWriterContext *ctx)
+{
+    FDIRServerDentry **pp;
+    FDIRServerDentry **end;
+    FDIRServerDentry *src;
+    FDIRServerDentry *last;
+    int result;
+
+    end = ctx->hdlinks.entries + ctx->hdlinks.count;
+    for (pp=ctx->hdlinks.entries; pp<end; pp++) {
+        src = (*pp)->extra->src_dentry;
+        if (src->parent == NULL && src != src->ns_entry->dentry_root) {
+            if ((result=dentry_array_append(&ctx->orphans, src)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    if (ctx->orphans.count > 1) {
+        qsort(ctx->orphans.entries, ctx->orphans.count,
+                sizeof(FDIRServerDentry *), compare_dentry_ptr);
+    }
+
+    last = NULL;
+    end = ctx->orphans.entries + ctx->orphans.count;
+    for (pp=ctx->orphans.entries; pp<end; pp++) {
+        if (*pp == last) {
+            continue;
+        }
+        if ((result=write_dentry(ctx, CHECKPOINT_REC_ORPHAN, *pp)) != 0) {
+            return result;
+        }
+        last = *pp;
+    }
+
+    end = ctx->hdlinks.entries + ctx->hdlinks.count;
+    for (pp=ctx->hdlinks.entries; pp<end; pp++) {
+        if ((result=write_dentry(ctx, CHECKPOINT_REC_HARD_LINK, *pp)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+//called while the updates suspended
+static int write_header(CheckpointWriterContext *ctx, int64_t *data_version)
+{
+    CheckpointFileHeader *header;
+    SFBinlogFilePosition position;
+    int64_t readable_version;
+
+    *data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
+    if (!MYSELF_IS_MASTER) {
+        /* the slave replays the buffers without the holes after
+         * suspended, check it for the version recorded
+         */
+        readable_version = __sync_add_and_fetch(&DATA_READABLE_VERSION, 0);
+        if (*data_version != readable_version) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "the replayed records are not contiguous, "
+                    "data version: %"PRId64", readable version: "
+                    "%"PRId64", skip the checkpoint", __LINE__,
+                    *data_version, readable_version);
+            return EAGAIN;
+        }
+    }
+    binlog_get_current_write_position(&position);
+
+    header = (CheckpointFileHeader *)ctx->current;
+    memset(header, 0, sizeof(CheckpointFileHeader));
+    memcpy(header->magic, CHECKPOINT_MAGIC_STR, CHECKPOINT_MAGIC_LEN);
+    int2buff(CHECKPOINT_FORMAT_VERSION, header->format_version);
+    long2buff(*data_version, header->data_version);
+    long2buff(__sync_add_and_fetch(&CURRENT_INODE_SN, 0), header->inode_sn);
+    int2buff(position.index, header->binlog_index);
+    long2buff(position.offset, header->binlog_offset);
+    ctx->current += sizeof(CheckpointFileHeader);
+    return 0;
+}
+
+static int dump_all(CheckpointWriterContext *ctx)
+{
+    CheckpointEndRecord *end_rec;
+    int result;
+
+    if ((result=dentry_namespace_walk(dump_namespace, ctx)) != 0) {
+        return result;
+    }
+
+    if ((result=dump_hard_links(ctx)) != 0) {
+        return result;
+    }
+
+    if ((result=writer_check_space(ctx, sizeof(CheckpointEndRecord))) != 0) {
+        return result;
+    }
+    end_rec = (CheckpointEndRecord *)ctx->current;
+    end_rec->type = CHECKPOINT_REC_END;
+    long2buff(ctx->dentry_count, end_rec->dentry_count);
+    ctx->current += sizeof(CheckpointEndRecord);
+
+    return writer_flush(ctx);
+}
+
+/* copy on write: the child process dumps the dentry trees as they were
+ * at fork, so the updates are suspended only for the fork. the child
+ * has only the forking thread, the locks held by the other threads,
+ * such as the logger lock, are never released in the child, so the
+ * child never logs and returns the error code by the exit status
+ */
+static int dump_by_child(CheckpointWriterContext *ctx, pid_t *pid)
+{
+    int result;
+
+    if ((*pid=fork()) < 0) {
+        result = errno != 0 ? errno : EAGAIN;
+        logError("file: "__FILE__", line: %d, "
+                "fork fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    if (*pid == 0) {
+        g_log_context.log_level = -1;
+        _exit(dump_all(ctx));
+    }
+
+    return 0;
+}
+
+static int wait_for_child(const pid_t pid)
+{
+    int status;
+    int result;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            result = errno != 0 ? errno : ECHILD;
+            logError("file: "__FILE__", line: %d, "
+                    "waitpid %d fail, errno: %d, error info: %s",
+                    __LINE__, (int)pid, result, STRERROR(result));
+            return result;
+        }
+    }
+
+    if (WIFEXITED(status)) {
+        if ((result=WEXITSTATUS(status)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "the dump process exit, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+        }
+        return result;
+    }
+
+    logError("file: "__FILE__", line: %d, "
+            "the dump process killed by signal %d", __LINE__,
+            WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    return EINTR;
+}
+
+/* the data version may be ahead of the binlog written, commit the
+ * checkpoint after the binlog records in it are written, so the binlog
+ * is never behind the checkpoint
+ */
+static int wait_for_binlog_written(const int64_t data_version)
+{
+    int64_t max_data_version;
+    int64_t deadline_ms;
+    int result;
+
+    deadline_ms = get_current_time_ms() + CHECKPOINT_WAIT_BINLOG_TIMEOUT_MS;
+    while (1) {
+        if ((result=binlog_get_max_record_version(&max_data_version)) != 0) {
+            return result;
+        }
+        if (max_data_version >= data_version) {
+            return 0;
+        }
+
+        if (get_current_time_ms() > deadline_ms) {
+            logError("file: "__FILE__", line: %d, "
+                    "wait for the binlog written timeout, max binlog "
+                    "data version: %"PRId64" < checkpoint data version: "
+                    "%"PRId64, __LINE__, max_data_version, data_version);
+            return ETIMEDOUT;
+        }
+        fc_sleep_ms(10);
+    }
+}
+
+static int writer_init(CheckpointWriterContext *ctx)
+{
+    int result;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->fd = -1;
+    if ((ctx->buff=(char *)fc_malloc(CHECKPOINT_BUFFER_SIZE)) == NULL) {
+        return ENOMEM;
+    }
+    ctx->current = ctx->buff;
+    ctx->end = ctx->buff + CHECKPOINT_BUFFER_SIZE;
+
+    snprintf(ctx->filename, sizeof(ctx->filename), "%s/%s.tmp",
+            DATA_PATH_STR, FDIR_CHECKPOINT_FILENAME);
+    if ((ctx->fd=open(ctx->filename, O_WRONLY |
+                    O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, ctx->filename, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+static void writer_destroy(CheckpointWriterContext *ctx)
+{
+    if (ctx->fd >= 0) {
+        close(ctx->fd);
+        ctx->fd = -1;
+    }
+
+    if (ctx->buff != NULL) {
+        free(ctx->buff);
+        ctx->buff = NULL;
+    }
+    dentry_array_free(&ctx->hdlinks);
+    dentry_array_free(&ctx->orphans);
+}
+
+static int writer_commit(CheckpointWriterContext *ctx)
+{
+    char filename[PATH_MAX];
+    int result;
+
+    if (fsync(ctx->fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "fsync file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, ctx->filename, result, STRERROR(result));
+        return result;
+    }
+    close(ctx->fd);
+    ctx->fd = -1;
+
+    GET_CHECKPOINT_FILENAME(filename, sizeof(filename));
+    if (rename(ctx->filename, filename) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "rename file \"%s\" to \"%s\" fail, "
+                "errno: %d, error info: %s", __LINE__,
+                ctx->filename, filename, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+int data_checkpoint_write()
+{
+    CheckpointWriterContext ctx;
+    int64_t start_time;
+    int64_t suspend_time;
+    int64_t data_version;
+    pid_t pid;
+    char time_buff[32];
+    char suspend_buff[32];
+    int result;
+
+    if (!__sync_bool_compare_and_swap(&checkpoint_in_progress, 0, 1)) {
+        return EINPROGRESS;
+    }
+
+    start_time = get_current_time_ms();
+    data_version = 0;
+    suspend_time = 0;
+    if ((result=writer_init(&ctx)) == 0) {
+        suspend_updates();
+        if ((result=write_header(&ctx, &data_version)) == 0) {
+            result = dump_by_child(&ctx, &pid);
+        }
+        resume_updates();
+        suspend_time = get_current_time_ms() - start_time;
+
+        if (result == 0 && (result=wait_for_child(pid)) == 0 &&
+                (result=wait_for_binlog_written(data_version)) == 0)
+        {
+            result = writer_commit(&ctx);
+        }
+    }
+    writer_destroy(&ctx);
+
+    if (result == 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "write checkpoint done, data version: %"PRId64", "
+                "updates suspended: %s ms, time used: %s ms", __LINE__,
+                data_version, long_to_comma_str(suspend_time, suspend_buff),
+                long_to_comma_str(get_current_time_ms() -
+                    start_time, time_buff));
+    } else {
+        unlink(ctx.filename);
+        if (result != EAGAIN) {
+            logError("file: "__FILE__", line: %d, "
+                    "write checkpoint fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+        }
+    }
+
+    __sync_bool_compare_and_swap(&checkpoint_in_progress, 1, 0);
+    return result;
+}
+
+static int checkpoint_schedule_func(void *args)
+{
+    data_checkpoint_write();
+    return 0;
+}
+
+int data_checkpoint_setup_schedule()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    if (DATA_CHECKPOINT_INTERVAL <= 0) {
+        return 0;
+    }
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, DATA_CHECKPOINT_INTERVAL,
+            checkpoint_schedule_func, NULL);
+    schedule_entry.new_thread = true;
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
+
+static int reader_ensure(CheckpointReaderContext *ctx, const int size)
+{
+    int remain;
+    int bytes;
+    int result;
+
+    remain = ctx->end - ctx->current;
+    if (remain >= size) {
+        return 0;
+    }
+
+    if (remain > 0 && ctx->current != ctx->buff) {
+        memmove(ctx->buff, ctx->current, remain);
+    }
+    ctx->current = ctx->buff;
+    ctx->end = ctx->buff + remain;
+
+    while (ctx->end - ctx->current < size) {
+        bytes = read(ctx->fd, ctx->end, CHECKPOINT_BUFFER_SIZE -
+                (ctx->end - ctx->buff));
+        if (bytes < 0) {
+            result = errno != 0 ? errno : EIO;
+            logError("file: "__FILE__", line: %d, "
+                    "read file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, ctx->filename, result, STRERROR(result));
+            return result;
+        } else if (bytes == 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "checkpoint file \"%s\" is truncated",
+                    __LINE__, ctx->filename);
+            return ENODATA;
+        }
+        ctx->end += bytes;
+    }
+
+    return 0;
+}
+
+static int load_header(CheckpointReaderContext *ctx,
+        SFBinlogFilePosition *hint_pos, int64_t *data_version,
+        int64_t *inode_sn, bool *from_snapshot)
+{
+    CheckpointFileHeader *header;
+    int format_version;
+    int result;
+
+    if ((result=reader_ensure(ctx, sizeof(CheckpointFileHeader))) != 0) {
+        return result;
+    }
+
+    header = (CheckpointFileHeader *)ctx->current;
+    if (memcmp(header->magic, CHECKPOINT_MAGIC_STR,
+                CHECKPOINT_MAGIC_LEN) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", invalid magic: %.*s",
+                __LINE__, ctx->filename, (int)CHECKPOINT_MAGIC_LEN,
+                header->magic);
+        return EINVAL;
+    }
+
+    format_version = buff2int(header->format_version);
+    if (format_version != CHECKPOINT_FORMAT_VERSION) {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", unsupport format version: %d",
+                __LINE__, ctx->filename, format_version);
+        return EINVAL;
+    }
+
+    *data_version = buff2long(header->data_version);
+    *inode_sn = buff2long(header->inode_sn);
+    hint_pos->index = buff2int(header->binlog_index);
+    hint_pos->offset = buff2long(header->binlog_offset);
+    *from_snapshot = header->from_snapshot;
+    ctx->current += sizeof(CheckpointFileHeader);
+    return 0;
+}
+
+/* the checkpoint written by myself is committed after the binlog
+ * records in it written, the binlog behind it means the binlog lost
+ */
+static int check_binlog_behind(CheckpointReaderContext *ctx,
+        const int64_t data_version)
+{
+    int64_t max_data_version;
+    int result;
+
+    if ((result=binlog_get_max_record_version(&max_data_version)) != 0) {
+        return result;
+    }
+
+    if (max_data_version < data_version) {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", max binlog data version: "
+                "%"PRId64" < checkpoint data version: %"PRId64", "
+                "the binlog is behind the checkpoint", __LINE__,
+                ctx->filename, max_data_version, data_version);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int load_namespace(CheckpointReaderContext *ctx)
+{
+    CheckpointNamespaceRecord *rec;
+    int result;
+
+    if ((result=reader_ensure(ctx, sizeof(
+                        CheckpointNamespaceRecord))) != 0)
+    {
+        return result;
+    }
+    rec = (CheckpointNamespaceRecord *)ctx->current;
+    if ((result=reader_ensure(ctx, sizeof(CheckpointNamespaceRecord) +
+                    rec->ns_len)) != 0)
+    {
+        return result;
+    }
+
+    rec = (CheckpointNamespaceRecord *)ctx->current;
+    memcpy(ctx->ns_holder, rec->ns_str, rec->ns_len);
+    ctx->ns.str = ctx->ns_holder;
+    ctx->ns.len = rec->ns_len;
+    ctx->current = rec->ns_str + rec->ns_len;
+    return 0;
+}
+
+static int load_quota(CheckpointReaderContext *ctx)
+{
+    CheckpointQuotaRecord *rec;
+    FDIRBinlogRecord record;
+    int result;
+
+    if ((result=reader_ensure(ctx, sizeof(CheckpointQuotaRecord))) != 0) {
+        return result;
+    }
+    rec = (CheckpointQuotaRecord *)ctx->current;
+    if ((result=reader_ensure(ctx, sizeof(CheckpointQuotaRecord) +
+                    rec->ns_len)) != 0)
+    {
+        return result;
+    }
+
+    rec = (CheckpointQuotaRecord *)ctx->current;
+    memset(&record, 0, sizeof(record));
+    record.operation = BINLOG_OP_SET_QUOTA_INT;
+    record.ns.str = rec->ns_str;
+    record.ns.len = rec->ns_len;
+    record.quota.inodes = buff2long(rec->inodes);
+    record.quota.bytes = buff2long(rec->bytes);
+    record.hash_code = simple_hash(record.ns.str, record.ns.len);
+    if ((result=dentry_namespace_set_quota(data_thread_get_context(
+                        &record), &record.ns, &record.quota)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", restore quota fail, "
+                "namespace: %.*s, errno: %d, error info: %s",
+                __LINE__, ctx->filename, rec->ns_len, rec->ns_str,
+                result, STRERROR(result));
+        return result;
+    }
+
+    ctx->current = rec->ns_str + rec->ns_len;
+    return 0;
+}
+
+static int load_dentry(CheckpointReaderContext *ctx)
+{
+    CheckpointDentryRecord *rec;
+    FDIRDataThreadContext *db_context;
+    FDIRBinlogRecord record;
+    char *p;
+    int fixed_len;
+    int extra_len;
+    int name_len;
+    int result;
+
+    if (ctx->ns.len == 0) {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", expect namespace record",
+                __LINE__, ctx->filename);
+        return EINVAL;
+    }
+
+    if ((result=reader_ensure(ctx, sizeof(CheckpointDentryRecord))) != 0) {
+        return result;
+    }
+    rec = (CheckpointDentryRecord *)ctx->current;
+    name_len = buff2short(rec->name_len);
+    fixed_len = sizeof(CheckpointDentryRecord) + name_len;
+    if (rec->type == CHECKPOINT_REC_HARD_LINK) {
+        extra_len = 8;
+    } else if (S_ISLNK(buff2int(rec->mode))) {
+        if ((result=reader_ensure(ctx, fixed_len + 2)) != 0) {
+            return result;
+        }
+        rec = (CheckpointDentryRecord *)ctx->current;
+        extra_len = 2 + buff2short(rec->name_str + name_len);
+    } else {
+        extra_len = 0;
+    }
+
+    if ((result=reader_ensure(ctx, fixed_len + extra_len)) != 0) {
+        return result;
+    }
+    rec = (CheckpointDentryRecord *)ctx->current;
+
+    memset(&record, 0, sizeof(record));
+    record.operation = BINLOG_OP_CREATE_DENTRY_INT;
+    record.ns = ctx->ns;
+    record.inode = buff2long(rec->inode);
+    record.me.pname.parent_inode = buff2long(rec->parent_inode);
+    record.me.pname.name.str = rec->name_str;
+    record.me.pname.name.len = name_len;
+    record.stat.mode = buff2int(rec->mode);
+    record.stat.uid = buff2int(rec->uid);
+    record.stat.gid = buff2int(rec->gid);
+    record.stat.btime = buff2int(rec->btime);
+    record.stat.atime = buff2int(rec->atime);
+    record.stat.ctime = buff2int(rec->ctime);
+    record.stat.mtime = buff2int(rec->mtime);
+    record.stat.size = buff2long(rec->size);
+
+    p = rec->name_str + name_len;
+    if (rec->type == CHECKPOINT_REC_HARD_LINK) {
+        record.hdlink.src_inode = buff2long(p);
+        if ((record.hdlink.src_dentry=inode_index_get_dentry(
+                        record.hdlink.src_inode)) == NULL)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "checkpoint file \"%s\", inode: %"PRId64", "
+                    "source inode: %"PRId64" not exist", __LINE__,
+                    ctx->filename, record.inode, record.hdlink.src_inode);
+            return ENOENT;
+        }
+    } else if (S_ISLNK(record.stat.mode)) {
+        record.link.len = buff2short(p);
+        record.link.str = p + 2;
+    }
+
+    if (record.me.pname.parent_inode != 0) {
+        if ((record.me.parent=inode_index_get_dentry(record.
+                        me.pname.parent_inode)) == NULL)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "checkpoint file \"%s\", inode: %"PRId64", "
+                    "parent inode: %"PRId64" not exist", __LINE__,
+                    ctx->filename, record.inode,
+                    record.me.pname.parent_inode);
+            return ENOENT;
+        }
+    }
+
+    record.hash_code = simple_hash(ctx->ns.str, ctx->ns.len);
+    db_context = data_thread_get_context(&record);
+    if (rec->type == CHECKPOINT_REC_ORPHAN) {
+        result = dentry_restore_orphan(db_context, &record);
+    } else {
+        result = dentry_create(db_context, &record);
+    }
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", restore dentry fail, "
+                "inode: %"PRId64", name: %.*s, errno: %d, error info: %s",
+                __LINE__, ctx->filename, record.inode, name_len,
+                rec->name_str, result, STRERROR(result));
+        return result;
+    }
+
+    if (rec->type != CHECKPOINT_REC_HARD_LINK) {
+        record.me.dentry->stat.alloc = buff2long(rec->alloc);
+        record.me.dentry->stat.space_end = buff2long(rec->space_end);
+    }
+
+    ctx->current += fixed_len + extra_len;
+    ctx->dentry_count++;
+    return 0;
+}
+
+static int load_end(CheckpointReaderContext *ctx)
+{
+    CheckpointEndRecord *end_rec;
+    int64_t dentry_count;
+    int result;
+
+    if ((result=reader_ensure(ctx, sizeof(CheckpointEndRecord))) != 0) {
+        return result;
+    }
+
+    end_rec = (CheckpointEndRecord *)ctx->current;
+    dentry_count = buff2long(end_rec->dentry_count);
+    if (dentry_count != ctx->dentry_count) {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", dentry count: %"PRId64" != "
+                "expected: %"PRId64, __LINE__, ctx->filename,
+                ctx->dentry_count, dentry_count);
+        return EINVAL;
+    }
+
+    ctx->current += sizeof(CheckpointEndRecord);
+    return 0;
+}
+
+static int load_records(CheckpointReaderContext *ctx)
+{
+    int result;
+
+    while (SF_G_CONTINUE_FLAG) {
+        if ((result=reader_ensure(ctx, 1)) != 0) {
+            return result;
+        }
+
+        switch (*ctx->current) {
+            case CHECKPOINT_REC_NAMESPACE:
+                result = load_namespace(ctx);
+                break;
+            case CHECKPOINT_REC_QUOTA:
+                result = load_quota(ctx);
+                break;
+            case CHECKPOINT_REC_DENTRY:
+            case CHECKPOINT_REC_ORPHAN:
+            case CHECKPOINT_REC_HARD_LINK:
+                result = load_dentry(ctx);
+                break;
+            case CHECKPOINT_REC_END:
+                return load_end(ctx);
+            default:
+                logError("file: "__FILE__", line: %d, "
+                        "checkpoint file \"%s\", invalid record type: "
+                        "0x%02x", __LINE__, ctx->filename,
+                        (unsigned char)*ctx->current);
+                return EINVAL;
+        }
+
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    return EINTR;
+}
+
+int data_checkpoint_load(SFBinlogFilePosition *hint_pos)
+{
+    CheckpointReaderContext ctx;
+    int64_t start_time;
+    int64_t data_version;
+    int64_t inode_sn;
+    bool from_snapshot;
+    char time_buff[32];
+    int result;
+
+    hint_pos->index = 0;
+    hint_pos->offset = 0;
+    memset(&ctx, 0, sizeof(ctx));
+    GET_CHECKPOINT_FILENAME(ctx.filename, sizeof(ctx.filename));
+    if (access(ctx.filename, F_OK) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        if (result == ENOENT) {
+            return 0;
+        }
+
+        logError("file: "__FILE__", line: %d, "
+                "access file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, ctx.filename, result, STRERROR(result));
+        return result;
+    }
+
+    start_time = get_current_time_ms();
+    if ((ctx.fd=open(ctx.filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, ctx.filename, result, STRERROR(result));
+        return result;
+    }
+
+    if ((ctx.buff=(char *)fc_malloc(CHECKPOINT_BUFFER_SIZE)) == NULL) {
+        close(ctx.fd);
+        return ENOMEM;
+    }
+    ctx.current = ctx.end = ctx.buff;
+
+    if ((result=load_header(&ctx, hint_pos, &data_version,
+                    &inode_sn, &from_snapshot)) == 0)
+    {
+        if (from_snapshot || (result=check_binlog_behind(
+                        &ctx, data_version)) == 0)
+        {
+            result = load_records(&ctx);
+        }
+    }
+    close(ctx.fd);
+    free(ctx.buff);
+
+    if (result != 0) {
+        return result;
+    }
+
+    DATA_CURRENT_VERSION = data_version;
+    if (inode_sn > CURRENT_INODE_SN) {
+        CURRENT_INODE_SN = inode_sn;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "load checkpoint done, data version: %"PRId64", "
+            "dentry count: %"PRId64", time used: %s ms", __LINE__,
+            data_version, ctx.dentry_count, long_to_comma_str(
+                get_current_time_ms() - start_time, time_buff));
+    return 0;
+}
+
+int data_checkpoint_open_snapshot(int *fd, int64_t *file_size,
+        int64_t *data_version, SFBinlogFilePosition *hint_pos)
+{
+    char filename[PATH_MAX];
+    CheckpointFileHeader header;
+    struct stat stbuf;
+    int result;
+
+    GET_CHECKPOINT_FILENAME(filename, sizeof(filename));
+    if ((*fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        if (result != ENOENT) {
+            logError("file: "__FILE__", line: %d, "
+                    "open file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, filename, result, STRERROR(result));
+        }
+        return result;
+    }
+
+    if (fstat(*fd, &stbuf) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "stat file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+    } else if (pread(*fd, &header, sizeof(header), 0) != sizeof(header)) {
+        result = errno != 0 ? errno : ENODATA;
+        logError("file: "__FILE__", line: %d, "
+                "read file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+    } else if (memcmp(header.magic, CHECKPOINT_MAGIC_STR,
+                CHECKPOINT_MAGIC_LEN) != 0 || buff2int(header.
+                    format_version) != CHECKPOINT_FORMAT_VERSION)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", invalid magic or "
+                "format version", __LINE__, filename);
+        result = EINVAL;
+    } else {
+        *file_size = stbuf.st_size;
+        *data_version = buff2long(header.data_version);
+        hint_pos->index = buff2int(header.binlog_index);
+        hint_pos->offset = buff2long(header.binlog_offset);
+        return 0;
+    }
+
+    close(*fd);
+    *fd = -1;
+    return result;
+}
+
+int data_checkpoint_recv_snapshot(const int64_t file_size,
+        const int64_t offset, const char *buff, const int length)
+{
+    CheckpointSnapshotReceiver *receiver;
+    int result;
+
+    receiver = &snapshot_receiver;
+    if (offset == 0) {
+        if (receiver->fd >= 0) {  //the previous pushing broken
+            close(receiver->fd);
+        }
+
+        snprintf(receiver->filename, sizeof(receiver->filename),
+                "%s/%s.snapshot", DATA_PATH_STR, FDIR_CHECKPOINT_FILENAME);
+        if ((receiver->fd=open(receiver->filename, O_WRONLY |
+                        O_CREAT | O_TRUNC, 0644)) < 0)
+        {
+            result = errno != 0 ? errno : EACCES;
+            logError("file: "__FILE__", line: %d, "
+                    "open file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, receiver->filename, result, STRERROR(result));
+            return result;
+        }
+        receiver->offset = 0;
+    } else if (receiver->fd < 0 || offset != receiver->offset) {
+        logError("file: "__FILE__", line: %d, "
+                "snapshot offset: %"PRId64" != expected: %"PRId64,
+                __LINE__, offset, receiver->offset);
+        return EINVAL;
+    }
+
+    if (offset + length > file_size) {
+        logError("file: "__FILE__", line: %d, "
+                "snapshot offset: %"PRId64" + length: %d > file size: "
+                "%"PRId64, __LINE__, offset, length, file_size);
+        return EINVAL;
+    }
+
+    if (fc_safe_write(receiver->fd, buff, length) != length) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "write to file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, receiver->filename, result, STRERROR(result));
+        return result;
+    }
+
+    receiver->offset += length;
+    return 0;
+}
+
+bool data_checkpoint_snapshot_exists()
+{
+    int fd;
+    int64_t file_size;
+    int64_t data_version;
+    SFBinlogFilePosition hint_pos;
+
+    if (data_checkpoint_open_snapshot(&fd, &file_size,
+                &data_version, &hint_pos) != 0)
+    {
+        return false;
+    }
+
+    close(fd);
+    return data_version > 0;
+}
+
+static int snapshot_commit(CheckpointSnapshotReceiver *receiver,
+        const SFBinlogFilePosition *position)
+{
+    char filename[PATH_MAX];
+    char pos_buff[13];
+    int result;
+
+    //the binlog position hint of the master is meaningless for me
+    int2buff(position->index, pos_buff);
+    long2buff(position->offset, pos_buff + 4);
+    pos_buff[12] = 1;  //from_snapshot
+    if (pwrite(receiver->fd, pos_buff, sizeof(pos_buff), offsetof(
+                    CheckpointFileHeader, binlog_index)) != sizeof(pos_buff))
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "write to file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, receiver->filename, result, STRERROR(result));
+        return result;
+    }
+
+    if (fsync(receiver->fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "fsync file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, receiver->filename, result, STRERROR(result));
+        return result;
+    }
+    close(receiver->fd);
+    receiver->fd = -1;
+
+    GET_CHECKPOINT_FILENAME(filename, sizeof(filename));
+    if (rename(receiver->filename, filename) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "rename file \"%s\" to \"%s\" fail, "
+                "errno: %d, error info: %s", __LINE__,
+                receiver->filename, filename, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+int data_checkpoint_install_snapshot()
+{
+    CheckpointSnapshotReceiver *receiver;
+    SFBinlogFilePosition hint_pos;
+    int result;
+
+    receiver = &snapshot_receiver;
+    if (receiver->fd < 0) {
+        return ENOENT;
+    }
+
+    if (!__sync_bool_compare_and_swap(&checkpoint_in_progress, 0, 1)) {
+        return EBUSY;
+    }
+
+    binlog_get_current_write_position(&hint_pos);
+    if ((result=snapshot_commit(receiver, &hint_pos)) == 0) {
+        result = data_checkpoint_load(&hint_pos);
+    }
+
+    __sync_bool_compare_and_swap(&checkpoint_in_progress, 1, 0);
+    return result;
+}
+
+static int move_binlog_aside()
+{
+    char binlog_path[PATH_MAX];
+    char backup_path[PATH_MAX];
+    int result;
+
+    snprintf(binlog_path, sizeof(binlog_path), "%s/%s",
+            SF_G_BASE_PATH, FDIR_BINLOG_SUBDIR_NAME);
+    snprintf(backup_path, sizeof(backup_path), "%s.diverged.%"PRId64,
+            binlog_path, (int64_t)g_current_time);
+    if (rename(binlog_path, backup_path) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "rename path \"%s\" to \"%s\" fail, "
+                "errno: %d, error info: %s", __LINE__,
+                binlog_path, backup_path, result, STRERROR(result));
+        return result;
+    }
+
+    logWarning("file: "__FILE__", line: %d, "
+            "the diverged binlog moved to \"%s\"",
+            __LINE__, backup_path);
+    return 0;
+}
+
+int data_checkpoint_install_diverged_snapshot()
+{
+    CheckpointSnapshotReceiver *receiver;
+    SFBinlogFilePosition hint_pos;
+    int result;
+
+    receiver = &snapshot_receiver;
+    if (receiver->fd < 0) {
+        return ENOENT;
+    }
+
+    if (!__sync_bool_compare_and_swap(&checkpoint_in_progress, 0, 1)) {
+        return EBUSY;
+    }
+
+    //the binlog starts over after the snapshot
+    if ((result=move_binlog_aside()) == 0) {
+        hint_pos.index = 0;
+        hint_pos.offset = 0;
+        result = snapshot_commit(receiver, &hint_pos);
+    }
+
+    //keep the checkpoint of the stale dentries from overwriting it
+    if (result != 0) {
+        __sync_bool_compare_and_swap(&checkpoint_in_progress, 1, 0);
+    }
+    return result;
+}
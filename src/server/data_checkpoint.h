@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//data_checkpoint.h
+
+#ifndef _DATA_CHECKPOINT_H_
+#define _DATA_CHECKPOINT_H_
+
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_binlog_writer.h"
+#include "server_types.h"
+
+#define FDIR_CHECKPOINT_FILENAME  "checkpoint.dat"
+
+//for the updates outside the data threads, such as set dentry size
+typedef struct fdir_checkpoint_update_gate {
+    volatile int updating_count;
+    volatile int suspended;
+    pthread_lock_cond_pair_t lcp;
+} FDIRCheckpointUpdateGate;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern FDIRCheckpointUpdateGate g_checkpoint_update_gate;
+
+    int data_checkpoint_init();
+
+    /* restore the dentries from the checkpoint file when it exists,
+     * DATA_CURRENT_VERSION and CURRENT_INODE_SN are set on success
+     */
+    int data_checkpoint_load(SFBinlogFilePosition *hint_pos);
+
+    int data_checkpoint_write();
+
+    int data_checkpoint_setup_schedule();
+
+    //open the checkpoint file for pushing to the empty slave
+    int data_checkpoint_open_snapshot(int *fd, int64_t *file_size,
+            int64_t *data_version, SFBinlogFilePosition *hint_pos);
+
+    //if the checkpoint file can be pushed to the slave
+    bool data_checkpoint_snapshot_exists();
+
+    //the slave writes the chunk pushed by the master
+    int data_checkpoint_recv_snapshot(const int64_t file_size,
+            const int64_t offset, const char *buff, const int length);
+
+    /* the slave replaces the checkpoint file by the received one
+     * and restores the dentries from it, should be empty before
+     */
+    int data_checkpoint_install_snapshot();
+
+    /* the diverged slave moves its binlog aside and replaces the
+     * checkpoint file by the received one, the dentries in memory are
+     * stale, so the snapshot is loaded on the next startup
+     */
+    int data_checkpoint_install_diverged_snapshot();
+
+    static inline void data_checkpoint_update_begin()
+    {
+        FDIRCheckpointUpdateGate *gate;
+
+        gate = &g_checkpoint_update_gate;
+        while (1) {
+            __sync_add_and_fetch(&gate->updating_count, 1);
+            if (__sync_add_and_fetch(&gate->suspended, 0) == 0) {
+                break;
+            }
+
+            __sync_sub_and_fetch(&gate->updating_count, 1);
+            PTHREAD_MUTEX_LOCK(&gate->lcp.lock);
+            while (gate->suspended) {
+                pthread_cond_wait(&gate->lcp.cond, &gate->lcp.lock);
+            }
+            PTHREAD_MUTEX_UNLOCK(&gate->lcp.lock);
+        }
+    }
+
+    static inline void data_checkpoint_update_end()
+    {
+        __sync_sub_and_fetch(&g_checkpoint_update_gate.updating_count, 1);
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,33 +33,25 @@
 #include "server_global.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "data_checkpoint.h"
+#include "version_waiter.h"
 #include "data_loader.h"
 
-int server_load_data()
+static int replay_binlog(BinlogReplayContext *replay_ctx,
+        const SFBinlogFilePosition *hint_pos,
+        const int64_t last_data_version)
 {
-    BinlogReplayContext replay_ctx;
     BinlogReadThreadContext reader_ctx;
     BinlogReadThreadResult *r;
-    int64_t start_time;
-    int64_t end_time;
-    char time_buff[32];
     int result;
 
-    start_time = get_current_time_ms();
-
-    if ((result=binlog_read_thread_init(&reader_ctx, NULL, 0,
-                    BINLOG_BUFFER_SIZE)) != 0)
+    if ((result=binlog_read_thread_init_ex(&reader_ctx, hint_pos,
+                    last_data_version, BINLOG_BUFFER_SIZE,
+                    BINLOG_PARSE_THREAD_COUNT)) != 0)
     {
         return result;
     }
 
-    if ((result=binlog_replay_init(&replay_ctx, 64)) != 0) {
-        return result;
-    }
-
-    logInfo("file: "__FILE__", line: %d, "
-            "loading data ...", __LINE__);
-
     result = 0;
     while (SF_G_CONTINUE_FLAG) {
         if ((r=binlog_read_thread_fetch_result(&reader_ctx)) == NULL) {
@@ -75,28 +67,83 @@ int server_load_data()
             break;
         }
 
-        if ((result=binlog_replay_deal_buffer(&replay_ctx, r->buffer.buff,
-                        r->buffer.length, &r->binlog_position)) != 0)
-        {
+        if (reader_ctx.parse.count > 0) {
+            if ((result=binlog_replay_deal_records(replay_ctx,
+                            r->record_array.records,
+                            r->record_array.count)) == 0)
+            {
+                result = r->record_array.err_no;
+            }
+        } else {
+            result = binlog_replay_deal_buffer(replay_ctx, r->buffer.buff,
+                    r->buffer.length, &r->binlog_position);
+        }
+        if (result != 0) {
             break;
         }
 
         binlog_read_thread_return_result_buffer(&reader_ctx, r);
     }
 
-    binlog_replay_destroy(&replay_ctx);
     binlog_read_thread_terminate(&reader_ctx);
+    return result;
+}
+
+int server_load_data()
+{
+    BinlogReplayContext replay_ctx;
+    SFBinlogFilePosition hint_pos;
+    int64_t start_time;
+    int64_t end_time;
+    int64_t last_data_version;
+    int64_t max_data_version;
+    char time_buff[32];
+    int result;
+
+    start_time = get_current_time_ms();
+
+    logInfo("file: "__FILE__", line: %d, "
+            "loading data ...", __LINE__);
+
+    if ((result=data_checkpoint_load(&hint_pos)) != 0) {
+        return result;
+    }
+
+    last_data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
+    if (last_data_version > 0) {
+        if ((result=binlog_get_max_record_version(&max_data_version)) != 0) {
+            return result;
+        }
+    } else {
+        max_data_version = 0;
+    }
+
+    if ((result=binlog_replay_init(&replay_ctx, 64)) != 0) {
+        return result;
+    }
+
+    /* the binlog behind the checkpoint fails the checkpoint loading,
+     * except the snapshot pushed by the master which the binlog
+     * starts after
+     */
+    if (last_data_version == 0 || max_data_version > last_data_version) {
+        result = replay_binlog(&replay_ctx, &hint_pos, last_data_version);
+    }
+    binlog_replay_destroy(&replay_ctx);
 
     if (result == 0) {
         end_time = get_current_time_ms();
         logInfo("file: "__FILE__", line: %d, "
                 "load data done. record count: %"PRId64", "
-                "skip count: %"PRId64", warning count: %"PRId64
-                ", fail count: %"PRId64", time used: %s ms",
-                __LINE__, replay_ctx.record_count,
-                replay_ctx.skip_count, replay_ctx.warning_count,
+                "skip count: %"PRId64", dependency wait count: %"PRId64
+                ", warning count: %"PRId64", fail count: %"PRId64
+                ", time used: %s ms", __LINE__, replay_ctx.record_count,
+                replay_ctx.skip_count, replay_ctx.dependency_wait_count,
+                replay_ctx.warning_count,
                 replay_ctx.fail_count, long_to_comma_str(
                     end_time - start_time, time_buff));
+        version_waiter_set_readable(__sync_add_and_fetch(
+                    &DATA_CURRENT_VERSION, 0));
     }
     return result;
 }
@@ -32,11 +32,14 @@
 #include "fastcommon/pthread_func.h"
 #include "sf/sf_global.h"
 #include "server_global.h"
+#include "server_binlog.h"
 #include "dentry.h"
 #include "inode_index.h"
 #include "data_thread.h"
 
 #define DATA_THREAD_RUNNING_COUNT g_data_thread_vars.running_count
+#define DATA_THREAD_RECLAIM_INTERVAL_MS  10
+#define DATA_THREAD_GROUP_MAX_BYTES      (16 * 1024)
 
 FDIRDataThreadVariables g_data_thread_vars = {{NULL, 0}, 0, 0};
 static void *data_thread_func(void *arg);
@@ -60,12 +63,48 @@ void data_thread_sum_counters(FDIRDentryCounters *counters)
     }
 }
 
+void data_thread_get_name_intern_stat(FDIRNameInternStat *stat)
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+
+    memset(stat, 0, sizeof(*stat));
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (context=g_data_thread_vars.thread_array.contexts;
+            context<end; context++)
+    {
+        name_intern_add_stat(&context->dentry_context.name_intern, stat);
+    }
+}
+
+int64_t data_thread_get_reclaim_waiting_count()
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+    int64_t waiting_count;
+
+    waiting_count = 0;
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (context=g_data_thread_vars.thread_array.contexts;
+            context<end; context++)
+    {
+        waiting_count += __sync_add_and_fetch(&context->
+                delay_free_context.waiting_count, 0);
+    }
+    return waiting_count;
+}
+
 static inline void add_to_delay_free_queue(ServerDelayFreeContext *pContext,
-        ServerDelayFreeNode *node, void *ptr, const int delay_seconds)
+        ServerDelayFreeNode *node, void *ptr)
 {
-    node->expires = g_current_time + delay_seconds;
     node->ptr = ptr;
     node->next = NULL;
+
+    PTHREAD_MUTEX_LOCK(&pContext->lock);
+    //the object is unlinked already, the epochs in the queue are ordered
+    node->epoch = epoch_reclaim_current();
     if (pContext->queue.head == NULL)
     {
         pContext->queue.head = node;
@@ -75,10 +114,12 @@ static inline void add_to_delay_free_queue(ServerDelayFreeContext *pContext,
         pContext->queue.tail->next = node;
     }
     pContext->queue.tail = node;
+    PTHREAD_MUTEX_UNLOCK(&pContext->lock);
+    __sync_add_and_fetch(&pContext->waiting_count, 1);
 }
 
 int server_add_to_delay_free_queue(ServerDelayFreeContext *pContext,
-        void *ptr, server_free_func free_func, const int delay_seconds)
+        void *ptr, server_free_func free_func)
 {
     ServerDelayFreeNode *node;
 
@@ -91,13 +132,12 @@ int server_add_to_delay_free_queue(ServerDelayFreeContext *pContext,
     node->free_func = free_func;
     node->free_func_ex = NULL;
     node->ctx = NULL;
-    add_to_delay_free_queue(pContext, node, ptr, delay_seconds);
+    add_to_delay_free_queue(pContext, node, ptr);
     return 0;
 }
 
 int server_add_to_delay_free_queue_ex(ServerDelayFreeContext *pContext,
-        void *ptr, void *ctx, server_free_func_ex free_func_ex,
-        const int delay_seconds)
+        void *ptr, void *ctx, server_free_func_ex free_func_ex)
 {
     ServerDelayFreeNode *node;
 
@@ -110,26 +150,51 @@ int server_add_to_delay_free_queue_ex(ServerDelayFreeContext *pContext,
     node->free_func = NULL;
     node->free_func_ex = free_func_ex;
     node->ctx = ctx;
-    add_to_delay_free_queue(pContext, node, ptr, delay_seconds);
+    add_to_delay_free_queue(pContext, node, ptr);
     return 0;
 }
 
 static int deal_delay_free_queque(FDIRDataThreadContext *thread_ctx)
 {
     ServerDelayFreeContext *delay_context;
+    ServerDelayFreeNode *head;
     ServerDelayFreeNode *node;
     ServerDelayFreeNode *deleted;
+    int64_t current_epoch;
+    int count;
 
     delay_context = &thread_ctx->delay_free_context;
-    if (delay_context->last_check_time == g_current_time ||
-            delay_context->queue.head == NULL)
-    {
+    if (delay_context->queue.head == NULL) {
         return 0;
     }
 
-    delay_context->last_check_time = g_current_time;
-    node = delay_context->queue.head;
-    while ((node != NULL) && (node->expires < g_current_time)) {
+    current_epoch = epoch_reclaim_try_advance();
+
+    //detach the nodes no reader can access, then free them without lock
+    PTHREAD_MUTEX_LOCK(&delay_context->lock);
+    head = delay_context->queue.head;
+    node = head;
+    deleted = NULL;
+    while ((node != NULL) && epoch_reclaim_can_free(
+                node->epoch, current_epoch))
+    {
+        deleted = node;
+        node = node->next;
+    }
+    if (deleted != NULL) {
+        deleted->next = NULL;
+        delay_context->queue.head = node;
+        if (node == NULL) {
+            delay_context->queue.tail = NULL;
+        }
+    } else {
+        head = NULL;
+    }
+    PTHREAD_MUTEX_UNLOCK(&delay_context->lock);
+
+    count = 0;
+    node = head;
+    while (node != NULL) {
         if (node->free_func != NULL) {
             node->free_func(node->ptr);
         } else {
@@ -139,13 +204,12 @@ static int deal_delay_free_queque(FDIRDataThreadContext *thread_ctx)
         deleted = node;
         node = node->next;
         fast_mblock_free_object(&delay_context->allocator, deleted);
+        ++count;
     }
 
-    delay_context->queue.head = node;
-    if (node == NULL) {
-        delay_context->queue.tail = NULL;
+    if (count > 0) {
+        __sync_sub_and_fetch(&delay_context->waiting_count, count);
     }
-
     return 0;
 }
 
@@ -156,6 +220,16 @@ static int init_thread_ctx(FDIRDataThreadContext *context)
         return result;
     }
 
+    if ((context->epoch_reader=epoch_reclaim_alloc_reader()) == NULL) {
+        return ENOMEM;
+    }
+
+    if ((result=init_pthread_lock(&context->
+                    delay_free_context.lock)) != 0)
+    {
+        return result;
+    }
+
     if ((result=fast_mblock_init_ex1(&context->delay_free_context.allocator,
                     "delay_free_node", sizeof(ServerDelayFreeNode), 16 * 1024,
                     0, NULL, NULL, true)) != 0)
@@ -168,6 +242,14 @@ static int init_thread_ctx(FDIRDataThreadContext *context)
     {
         return result;
     }
+
+    if (BINLOG_GROUP_COMMIT_COUNT > 1) {
+        context->group.records = (FDIRBinlogRecord **)fc_malloc(
+                sizeof(FDIRBinlogRecord *) * BINLOG_GROUP_COMMIT_COUNT);
+        if (context->group.records == NULL) {
+            return ENOMEM;
+        }
+    }
     return 0;
 }
 
@@ -190,6 +272,7 @@ static int init_data_thread_array()
     for (context=g_data_thread_vars.thread_array.contexts;
             context<end; context++)
     {
+        context->index = context - g_data_thread_vars.thread_array.contexts;
         if ((result=init_thread_ctx(context)) != 0) {
             return result;
         }
@@ -207,6 +290,12 @@ int data_thread_init()
         return result;
     }
 
+    if ((result=init_pthread_lock_cond_pair(&g_data_thread_vars.
+                    suspend.lcp)) != 0)
+    {
+        return result;
+    }
+
     g_data_thread_vars.error_mode = FDIR_DATA_ERROR_MODE_LOOSE;
     count = g_data_thread_vars.thread_array.count;
     if ((result=create_work_threads_ex(&count, data_thread_func,
@@ -224,6 +313,209 @@ int data_thread_init()
     return result;
 }
 
+void data_thread_suspend()
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    g_data_thread_vars.suspend.flag = true;
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (context=g_data_thread_vars.thread_array.contexts;
+            context<end; context++)
+    {
+        fc_queue_push(&context->queue, &context->suspend_record);
+    }
+
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    while (g_data_thread_vars.suspend.parked_count <
+            g_data_thread_vars.thread_array.count && SF_G_CONTINUE_FLAG)
+    {
+        pthread_cond_wait(&g_data_thread_vars.suspend.lcp.cond,
+                &g_data_thread_vars.suspend.lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
+void data_thread_resume()
+{
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    g_data_thread_vars.suspend.flag = false;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    while (g_data_thread_vars.suspend.parked_count > 0 && SF_G_CONTINUE_FLAG) {
+        pthread_cond_wait(&g_data_thread_vars.suspend.lcp.cond,
+                &g_data_thread_vars.suspend.lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
+#define EXCLUSIVE_BY_OTHER(thread_ctx) \
+    (g_data_thread_vars.exclusive.owner != NULL && \
+     g_data_thread_vars.exclusive.owner != thread_ctx)
+
+static void data_thread_park(FDIRDataThreadContext *thread_ctx)
+{
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    g_data_thread_vars.suspend.parked_count++;
+    g_data_thread_vars.exclusive.idle_count++;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    while ((g_data_thread_vars.suspend.flag || EXCLUSIVE_BY_OTHER(
+                    thread_ctx)) && SF_G_CONTINUE_FLAG)
+    {
+        pthread_cond_wait(&g_data_thread_vars.suspend.lcp.cond,
+                &g_data_thread_vars.suspend.lcp.lock);
+    }
+    g_data_thread_vars.suspend.parked_count--;
+    g_data_thread_vars.exclusive.idle_count--;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
+//caller must hold the lock
+static inline void wait_exclusive_done(FDIRDataThreadContext *thread_ctx)
+{
+    g_data_thread_vars.exclusive.idle_count++;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    while (EXCLUSIVE_BY_OTHER(thread_ctx) && SF_G_CONTINUE_FLAG) {
+        pthread_cond_wait(&g_data_thread_vars.suspend.lcp.cond,
+                &g_data_thread_vars.suspend.lcp.lock);
+    }
+    g_data_thread_vars.exclusive.idle_count--;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+}
+
+static void group_commit_notify(FDIRBinlogRecord **start,
+        FDIRBinlogRecord **end, ServerBinlogRecordBuffer *rbuffer)
+{
+    FDIRBinlogRecord **record;
+    int count;
+
+    if (rbuffer != NULL) {
+        count = end - start;
+        rbuffer->data_version.first = (*start)->data_version;
+        rbuffer->data_version.last = (*(end - 1))->data_version;
+        rbuffer->args = NULL;
+        rbuffer->reffer_count = count;
+        rbuffer->group.count = count;
+        rbuffer->wait_replica = REPLICA_WAIT_FOR_ACK;
+        rbuffer->group.ready_count = count;
+        rbuffer->group.done_count = count;
+    }
+
+    //the service produces one rbuffer per record when rbuffer is NULL
+    for (record=start; record<end; record++) {
+        (*record)->notify.rbuffer = rbuffer;
+        (*record)->notify.func(*record, 0, false);
+    }
+}
+
+static void group_commit_flush(FDIRDataThreadContext *thread_ctx)
+{
+    ServerBinlogRecordBuffer *rbuffer;
+    FDIRBinlogRecord **start;
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+    int count;
+
+    if ((count=thread_ctx->group.count) == 0) {
+        return;
+    }
+
+    thread_ctx->group.count = 0;
+    end = thread_ctx->group.records + count;
+
+    /* split to limit the size of the replication package, and one
+     * rbuffer holds the contiguous data versions only
+     */
+    start = thread_ctx->group.records;
+    while (start < end) {
+        rbuffer = server_binlog_alloc_hold_rbuffer();
+        for (record=start; record<end; record++) {
+            if (rbuffer == NULL) {
+                record = end;
+                break;
+            }
+
+            if (record > start && (*record)->data_version !=
+                    (*(record - 1))->data_version + 1)
+            {
+                break;
+            }
+
+            if (binlog_pack_record(*record, &rbuffer->buffer) != 0) {
+                server_binlog_release_rbuffer(rbuffer);
+                rbuffer = NULL;
+                record = end;
+                break;
+            }
+
+            if (rbuffer->buffer.length >= DATA_THREAD_GROUP_MAX_BYTES) {
+                record++;
+                break;
+            }
+        }
+
+        group_commit_notify(start, record, rbuffer);
+        start = record;
+    }
+
+    epoch_reclaim_leave(thread_ctx->epoch_reader, thread_ctx->group.epoch);
+}
+
+static void data_thread_pause(FDIRDataThreadContext *thread_ctx)
+{
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    wait_exclusive_done(thread_ctx);
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
+void data_thread_exclusive_begin(FDIRDataThreadContext *thread_ctx)
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+
+    group_commit_flush(thread_ctx);
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    while (g_data_thread_vars.exclusive.owner != NULL && SF_G_CONTINUE_FLAG) {
+        wait_exclusive_done(thread_ctx);  //yield to the current owner
+    }
+    g_data_thread_vars.exclusive.owner = thread_ctx;
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+
+    //wakeup the threads waiting for the queue
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (context=g_data_thread_vars.thread_array.contexts;
+            context<end; context++)
+    {
+        if (context != thread_ctx && __sync_bool_compare_and_swap(
+                    &context->wakeup_queued, 0, 1))
+        {
+            fc_queue_push(&context->queue, &context->wakeup_record);
+        }
+    }
+
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    while (g_data_thread_vars.exclusive.idle_count <
+            g_data_thread_vars.thread_array.count - 1 && SF_G_CONTINUE_FLAG)
+    {
+        pthread_cond_wait(&g_data_thread_vars.suspend.lcp.cond,
+                &g_data_thread_vars.suspend.lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
+void data_thread_exclusive_end(FDIRDataThreadContext *thread_ctx)
+{
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    g_data_thread_vars.exclusive.owner = NULL;
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+}
+
 void data_thread_destroy()
 {
     if (g_data_thread_vars.thread_array.contexts != NULL) {
@@ -256,6 +548,10 @@ void data_thread_terminate()
         fc_queue_terminate(&context->queue);
     }
 
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.suspend.lcp.lock);
+    pthread_cond_broadcast(&g_data_thread_vars.suspend.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.suspend.lcp.lock);
+
     count = 0;
     while (__sync_add_and_fetch(&DATA_THREAD_RUNNING_COUNT, 0) != 0 &&
             count++ < 100)
@@ -292,69 +588,168 @@ static inline int set_hdlink_src_dentry(FDIRBinlogRecord *record)
     return 0;
 }
 
-static inline int deal_record_rename_op(FDIRDataThreadContext *thread_ctx,
-        FDIRBinlogRecord *record)
+static int lookup_record_dentries(FDIRBinlogRecord *record)
 {
-    if ((record->rename.src.parent=inode_index_get_dentry(record->
-                    rename.src.pname.parent_inode)) == NULL)
-    {
-        return ENOENT;
+    int result;
+
+    switch (record->operation) {
+        case BINLOG_OP_CREATE_DENTRY_INT:
+        case BINLOG_OP_REMOVE_DENTRY_INT:
+            if ((result=check_parent(record)) != 0) {
+                return result;
+            }
+            if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+                    FDIR_IS_DENTRY_HARD_LINK(record->stat.mode))
+            {
+                return set_hdlink_src_dentry(record);
+            }
+            return 0;
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            if ((record->rename.src.parent=inode_index_get_dentry(record->
+                            rename.src.pname.parent_inode)) == NULL)
+            {
+                return ENOENT;
+            }
+            if ((record->rename.dest.parent=inode_index_get_dentry(record->
+                            rename.dest.pname.parent_inode)) == NULL)
+            {
+                return ENOENT;
+            }
+            return 0;
+        default:
+            return 0;
     }
+}
 
-    if ((record->rename.dest.parent=inode_index_get_dentry(record->
-                    rename.dest.pname.parent_inode)) == NULL)
-    {
-        return ENOENT;
+/* the exclusive begin may wait for the other exclusive owner, such as
+ * a rmdir, so the dentries looked up before are looked up again
+ */
+static inline int check_exclusive_begin(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, bool *exclusive)
+{
+    *exclusive = (DATA_DISPATCH_MODE == FDIR_DATA_DISPATCH_MODE_PARENT &&
+            g_data_thread_vars.thread_array.count > 1 &&
+            g_data_thread_vars.exclusive.owner != thread_ctx &&
+            dentry_is_cross_shard(record));
+    if (*exclusive) {
+        data_thread_exclusive_begin(thread_ctx);
+        return lookup_record_dentries(record);
     }
 
-    return dentry_rename(thread_ctx, record);
+    return 0;
 }
 
-static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
-        FDIRBinlogRecord *record)
+static int apply_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, int *ignore_errno, bool *exclusive)
 {
     int result;
-    int ignore_errno;
-    bool is_error;
 
+    *exclusive = false;
     switch (record->operation) {
         case BINLOG_OP_CREATE_DENTRY_INT:
         case BINLOG_OP_REMOVE_DENTRY_INT:
-            if ((result=check_parent(record)) != 0) {
-                ignore_errno = 0;
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            if ((result=lookup_record_dentries(record)) != 0 ||
+                    (result=check_exclusive_begin(thread_ctx,
+                        record, exclusive)) != 0)
+            {
+                *ignore_errno = 0;
                 break;
             }
+
             if (record->operation == BINLOG_OP_CREATE_DENTRY_INT) {
-                if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
-                    if ((result=set_hdlink_src_dentry(record)) != 0) {
-                        ignore_errno = 0;
-                        break;
-                    }
-                }
                 result = dentry_create(thread_ctx, record);
-                ignore_errno = EEXIST;
-            } else {
+                *ignore_errno = EEXIST;
+            } else if (record->operation == BINLOG_OP_REMOVE_DENTRY_INT) {
                 result = dentry_remove(thread_ctx, record);
-                ignore_errno = ENOENT;
+                *ignore_errno = ENOENT;
+            } else {
+                result = dentry_rename(thread_ctx, record);
+                *ignore_errno = 0;
             }
             break;
-        case BINLOG_OP_RENAME_DENTRY_INT:
-            ignore_errno = 0;
-            result = deal_record_rename_op(thread_ctx, record);
-            break;
         case BINLOG_OP_UPDATE_DENTRY_INT:
             record->me.dentry = inode_index_update_dentry(record);
             result = (record->me.dentry != NULL) ? 0 : ENOENT;
-            ignore_errno = 0;
+            *ignore_errno = 0;
+            break;
+        case BINLOG_OP_SET_QUOTA_INT:
+            result = dentry_namespace_set_quota(thread_ctx,
+                    &record->ns, &record->quota);
+            *ignore_errno = 0;
             break;
         default:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             result = 0;
             break;
     }
 
+    return result;
+}
+
+int data_thread_apply_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    int result;
+    int ignore_errno;
+    bool exclusive;
+
+    result = apply_record(thread_ctx, record, &ignore_errno, &exclusive);
+    if (exclusive) {
+        data_thread_exclusive_end(thread_ctx);
+    }
+    return result;
+}
+
+static inline void group_commit_add(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    if (thread_ctx->group.count == 0) {
+        thread_ctx->group.epoch = epoch_reclaim_enter(
+                thread_ctx->epoch_reader);
+    }
+
+    /* the change is visible once applied, so the data version is
+     * assigned now for the later updates on it, only the flush deferred
+     */
+    record->data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 1);
+    record->timestamp = g_current_time;
+    thread_ctx->group.records[thread_ctx->group.count++] = record;
+    if (thread_ctx->group.count == BINLOG_GROUP_COMMIT_COUNT) {
+        group_commit_flush(thread_ctx);
+    }
+}
+
+static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    int result;
+    int ignore_errno;
+    bool is_error;
+    bool exclusive;
+
+    if (record->operation == DATA_THREAD_OP_COMPOUND_INT) {
+        //the compound request allocates the data versions by itself
+        group_commit_flush(thread_ctx);
+
+        //the notify func applies all operations of the compound request
+        record->notify.func(record, 0, false);
+        return 0;
+    }
+
+    result = apply_record(thread_ctx, record, &ignore_errno, &exclusive);
     if (result == 0) {
         if (record->data_version == 0) {
+            if (thread_ctx->group.records != NULL &&
+                    record->notify.func != NULL)
+            {
+                if (exclusive) {
+                    data_thread_exclusive_end(thread_ctx);
+                }
+                group_commit_add(thread_ctx, record);
+                return 0;
+            }
+
             record->data_version = __sync_add_and_fetch(
                     &DATA_CURRENT_VERSION, 1);
         } else {
@@ -371,6 +766,10 @@ static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
             (g_data_thread_vars.error_mode == FDIR_DATA_ERROR_MODE_LOOSE));
     }
 
+    if (exclusive) {
+        data_thread_exclusive_end(thread_ctx);
+    }
+
     if (record->notify.func != NULL) {
         record->notify.func(record, result, is_error);
     }
@@ -391,11 +790,32 @@ static void *data_thread_func(void *arg)
     FDIRBinlogRecord *record;
     FDIRBinlogRecord *current;
     FDIRDataThreadContext *thread_ctx;
+    int64_t epoch;
 
     __sync_add_and_fetch(&DATA_THREAD_RUNNING_COUNT, 1);
     thread_ctx = (FDIRDataThreadContext *)arg;
     while (SF_G_CONTINUE_FLAG) {
-        record = (FDIRBinlogRecord *)fc_queue_pop_all(&thread_ctx->queue);
+        if (thread_ctx->delay_free_context.queue.head == NULL &&
+                !inode_index_resizing())
+        {
+            record = (FDIRBinlogRecord *)fc_queue_pop_all(
+                    &thread_ctx->queue);
+        } else {
+            /* wait for the records with timeout for reclaiming the
+             * retired objects and migrating the inode buckets,
+             * a new record wakes up at once
+             */
+            record = (FDIRBinlogRecord *)fc_queue_timedpop_ms(
+                    &thread_ctx->queue, DATA_THREAD_RECLAIM_INTERVAL_MS);
+            if (record != NULL) {
+                record->next = (FDIRBinlogRecord *)fc_queue_try_pop_all(
+                        &thread_ctx->queue);
+            } else {
+                deal_delay_free_queque(thread_ctx);
+                inode_index_migrate_idle();
+            }
+        }
+
         if (record == NULL) {
             continue;
         }
@@ -403,9 +823,25 @@ static void *data_thread_func(void *arg)
         do {
             current = record;
             record = record->next;
-            deal_binlog_one_record(thread_ctx, current);
+            if (EXCLUSIVE_BY_OTHER(thread_ctx)) {
+                group_commit_flush(thread_ctx);
+                data_thread_pause(thread_ctx);
+            }
+
+            if (current == &thread_ctx->suspend_record) {
+                group_commit_flush(thread_ctx);
+                data_thread_park(thread_ctx);
+            } else if (current == &thread_ctx->wakeup_record) {
+                __sync_bool_compare_and_swap(&thread_ctx->
+                        wakeup_queued, 1, 0);
+            } else {
+                epoch = epoch_reclaim_enter(thread_ctx->epoch_reader);
+                deal_binlog_one_record(thread_ctx, current);
+                epoch_reclaim_leave(thread_ctx->epoch_reader, epoch);
+            }
         } while (record != NULL);
 
+        group_commit_flush(thread_ctx);
         deal_delay_free_queque(thread_ctx);
     }
     __sync_sub_and_fetch(&DATA_THREAD_RUNNING_COUNT, 1);
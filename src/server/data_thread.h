@@ -22,10 +22,18 @@
 #include "fastcommon/server_id_func.h"
 #include "common/fdir_types.h"
 #include "binlog/binlog_types.h"
+#include "server_global.h"
+#include "epoch_reclaim.h"
+#include "name_intern.h"
 
 #define FDIR_DATA_ERROR_MODE_STRICT   1   //for master update operations
 #define FDIR_DATA_ERROR_MODE_LOOSE    2   //for data load or binlog replication
 
+/* the pseudo operation of the compound request which never written to
+ * binlog, the notify func of the record applies all the operations
+ */
+#define DATA_THREAD_OP_COMPOUND_INT   100
+
 typedef struct fdir_dentry_counters {
     int64_t ns;
     int64_t dir;
@@ -37,12 +45,13 @@ typedef struct fdir_dentry_context {
     UniqSkiplistFactory factory;
     struct fast_mblock_man dentry_allocator;
     struct fast_allocator_context name_acontext;
+    FDIRNameInternTable name_intern;  //the entries from name_acontext
     struct fdir_data_thread_context *db_context;
     FDIRDentryCounters counters;
 } FDIRDentryContext;
 
 typedef struct server_delay_free_node {
-    int expires;
+    int64_t epoch;  //the epoch when retired
     void *ctx;     //the context
     void *ptr;     //ptr to free
     server_free_func free_func;
@@ -55,16 +64,32 @@ typedef struct server_delay_free_queue {
     ServerDelayFreeNode *tail;
 } ServerDelayFreeQueue;
 
+//freed when no reader can hold the reference, see epoch_reclaim.h
 typedef struct server_delay_free_context {
-    time_t last_check_time;
     ServerDelayFreeQueue queue;
+    volatile int64_t waiting_count;
+    pthread_mutex_t lock;  //the objects may be freed by other data threads
     struct fast_mblock_man allocator;
 } ServerDelayFreeContext;
 
 typedef struct fdir_data_thread_context {
+    int index;
     struct fc_queue queue;
     FDIRDentryContext dentry_context;
     ServerDelayFreeContext delay_free_context;
+    FDIREpochReader *epoch_reader;
+    FDIRBinlogRecord suspend_record;  //barrier for data_thread_suspend
+    FDIRBinlogRecord wakeup_record;   //wakeup for the exclusive owner
+    volatile int wakeup_queued;
+
+    /* the master records done in the current batch, the data versions
+     * are assigned when applied, the notify funcs are called when flushing
+     */
+    struct {
+        int count;
+        int64_t epoch;  //hold the retired dentries until notified
+        FDIRBinlogRecord **records;
+    } group;  //for binlog group commit
 } FDIRDataThreadContext;
 
 typedef struct fdir_data_thread_array {
@@ -76,6 +101,16 @@ typedef struct fdir_data_thread_variables {
     FDIRDataThreadArray thread_array;
     volatile int running_count;
     int error_mode;
+    struct {
+        bool flag;
+        int parked_count;
+        pthread_lock_cond_pair_t lcp;
+    } suspend;  //for data checkpoint
+
+    struct {
+        FDIRDataThreadContext * volatile owner;
+        int idle_count;  //the other threads paused, protected by suspend.lcp
+    } exclusive;  //for the cross shard operations of parent dispatch mode
 } FDIRDataThreadVariables;
 
 #ifdef __cplusplus
@@ -90,20 +125,75 @@ extern "C" {
 
     void data_thread_sum_counters(FDIRDentryCounters *counters);
 
+    void data_thread_get_name_intern_stat(FDIRNameInternStat *stat);
+
+    //the retired objects waiting for the epoch to free
+    int64_t data_thread_get_reclaim_waiting_count();
+
+    //wait until all data threads are parked after their queued records
+    void data_thread_suspend();
+    void data_thread_resume();
+
     int server_add_to_delay_free_queue(ServerDelayFreeContext *pContext,
-            void *ptr, server_free_func free_func, const int delay_seconds);
+            void *ptr, server_free_func free_func);
 
     int server_add_to_delay_free_queue_ex(ServerDelayFreeContext *pContext,
-            void *ctx, void *ptr, server_free_func_ex free_func_ex,
-            const int delay_seconds);
+            void *ctx, void *ptr, server_free_func_ex free_func_ex);
 
 
-    static inline void push_to_data_thread_queue(FDIRBinlogRecord *record)
+    /* run the current record while the other data threads are paused,
+     * for the operations touch the directories of the other data threads
+     */
+    void data_thread_exclusive_begin(FDIRDataThreadContext *thread_ctx);
+    void data_thread_exclusive_end(FDIRDataThreadContext *thread_ctx);
+
+    /* apply the record without assigning the data version and calling
+     * the notify func, for the operations of the compound request
+     */
+    int data_thread_apply_record(FDIRDataThreadContext *thread_ctx,
+            FDIRBinlogRecord *record);
+
+    static inline FDIRDataThreadContext *data_thread_get_context_by_inode(
+            const int64_t inode)
     {
-        FDIRDataThreadContext *context;
-        context = g_data_thread_vars.thread_array.contexts +
+        return g_data_thread_vars.thread_array.contexts +
+            inode % g_data_thread_vars.thread_array.count;
+    }
+
+    static inline FDIRDataThreadContext *data_thread_get_context(
+            const FDIRBinlogRecord *record)
+    {
+        int64_t inode;
+
+        if (DATA_DISPATCH_MODE == FDIR_DATA_DISPATCH_MODE_PARENT) {
+            switch (record->operation) {
+                case BINLOG_OP_CREATE_DENTRY_INT:
+                case BINLOG_OP_REMOVE_DENTRY_INT:
+                    inode = record->me.pname.parent_inode;
+                    break;
+                case BINLOG_OP_RENAME_DENTRY_INT:
+                    inode = record->rename.dest.pname.parent_inode;
+                    break;
+                case BINLOG_OP_UPDATE_DENTRY_INT:
+                    inode = record->inode;
+                    break;
+                default:
+                    inode = 0;
+                    break;
+            }
+
+            if (inode != 0) {  //0 for the root of the namespace
+                return data_thread_get_context_by_inode(inode);
+            }
+        }
+
+        return g_data_thread_vars.thread_array.contexts +
             record->hash_code % g_data_thread_vars.thread_array.count;
-        fc_queue_push(&context->queue, record);
+    }
+
+    static inline void push_to_data_thread_queue(FDIRBinlogRecord *record)
+    {
+        fc_queue_push(&data_thread_get_context(record)->queue, record);
     }
 
 #ifdef __cplusplus
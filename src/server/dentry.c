@@ -29,6 +29,8 @@
 #include "service_handler.h"
 #include "inode_generator.h"
 #include "inode_index.h"
+#include "dentry_children.h"
+#include "path_cache.h"
 #include "dentry.h"
 
 #define INIT_LEVEL_COUNT 2
@@ -42,6 +44,7 @@ typedef struct fdir_namespace_hashtable {
 
 typedef struct fdir_manager {
     FDIRNamespaceHashtable hashtable;
+    struct fast_mblock_man extra_allocator;  //for the links and flock
 } FDIRManager;
 
 typedef struct {
@@ -50,6 +53,10 @@ typedef struct {
 } StringHolderPtrPair;
 
 const int max_level_count = 20;
+
+/* for the skiplist nodes freed by the skiplist factory only,
+ * the other objects are freed by epoch, see epoch_reclaim.h
+ */
 //const int delay_free_seconds = 3600;
 const int delay_free_seconds = 60;
 static FDIRManager fdir_manager;
@@ -64,10 +71,46 @@ static FDIRManager fdir_manager;
 #define SET_HARD_LINK_DENTRY(dentry)  \
     do { \
         if (FDIR_IS_DENTRY_HARD_LINK((dentry)->stat.mode)) {  \
-            dentry = (dentry)->src_dentry;  \
+            dentry = (dentry)->extra->src_dentry;  \
         } \
     } while (0)
 
+#define DENTRY_NAME_IS_INLINE(dentry, name_str) \
+    ((name_str) == (dentry)->name_buff)
+
+static inline int dentry_name_dup(FDIRDentryContext *context,
+        string_t *dest, const string_t *src)
+{
+    if (name_intern_enabled(&context->name_intern)) {
+        return name_intern_acquire(&context->name_intern, src, dest);
+    } else {
+        return dentry_strdup(context, dest, src);
+    }
+}
+
+static inline void dentry_name_free(FDIRDentryContext *context, char *str)
+{
+    if (name_intern_enabled(&context->name_intern)) {
+        name_intern_release(&context->name_intern, str);
+    } else {
+        fast_allocator_free(&context->name_acontext, str);
+    }
+}
+
+static inline int dentry_init_name(FDIRDentryContext *context,
+        FDIRServerDentry *dentry, const string_t *name)
+{
+    dentry->name_prefix = dentry_name_prefix(name);
+    if (name->len < FDIR_DENTRY_INLINE_NAME_SIZE) {
+        memcpy(dentry->name_buff, name->str, name->len);
+        dentry->name_buff[name->len] = '\0';
+        FC_SET_STRING_EX(dentry->name, dentry->name_buff, name->len);
+        return 0;
+    }
+
+    return dentry_name_dup(context, &dentry->name, name);
+}
+
 
 int dentry_init()
 {
@@ -95,27 +138,50 @@ int dentry_init()
         return result;
     }
 
-    return inode_index_init();
+    if ((result=fast_mblock_init_ex1(&fdir_manager.extra_allocator,
+                    "dentry_extra", sizeof(FDIRServerDentryExtra), 4096,
+                    0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=inode_index_init()) != 0) {
+        return result;
+    }
+
+    return path_cache_init();
 }
 
 void dentry_destroy()
 {
 }
 
+FDIRServerDentryExtra *dentry_alloc_extra()
+{
+    FDIRServerDentryExtra *extra;
+
+    extra = (FDIRServerDentryExtra *)fast_mblock_alloc_object(
+            &fdir_manager.extra_allocator);
+    if (extra != NULL) {
+        memset(extra, 0, sizeof(*extra));
+    }
+    return extra;
+}
+
 /*
 static void dentry_children_print(FDIRServerDentry *dentry)
 {
     FDIRServerDentry *current;
-    UniqSkiplistIterator iterator;
+    FDIRChildrenIterator iterator;
     int i = 0;
 
     if (dentry->children == NULL) {
-        logInfo("not skiplist");
+        logInfo("no children");
         return;
     }
 
-    uniq_skiplist_iterator(dentry->children, &iterator);
-    while ((current=(FDIRServerDentry *)uniq_skiplist_next(&iterator)) != NULL) {
+    dentry_children_iterator(dentry->children, &iterator);
+    while ((current=dentry_children_next(&iterator)) != NULL) {
         logInfo("%d. %.*s(%d)", ++i, current->name.len,
                 current->name.str, current->name.len);
     }
@@ -124,25 +190,64 @@ static void dentry_children_print(FDIRServerDentry *dentry)
 
 static int dentry_compare(const void *p1, const void *p2)
 {
-    return fc_string_compare(&((FDIRServerDentry *)p1)->name,
-            &((FDIRServerDentry *)p2)->name);
+    //the interned names are equal when the strings are the same
+    if (((FDIRServerDentry *)p1)->name.str ==
+            ((FDIRServerDentry *)p2)->name.str)
+    {
+        return 0;
+    }
+
+    return dentry_name_compare(&((FDIRServerDentry *)p1)->name,
+            ((FDIRServerDentry *)p1)->name_prefix, (FDIRServerDentry *)p2);
+}
+
+//the dentry context which owns the children of the directory
+static inline FDIRDentryContext *children_owner(FDIRServerDentry *dentry)
+{
+    if (DATA_DISPATCH_MODE == FDIR_DATA_DISPATCH_MODE_PARENT) {
+        return &data_thread_get_context_by_inode(
+                dentry->inode)->dentry_context;
+    } else {
+        return dentry->context;
+    }
+}
+
+static void dentry_children_free_func(void *ptr)
+{
+    dentry_children_free((FDIRDentryChildren *)ptr);
 }
 
 static void dentry_do_free(void *ptr)
 {
     FDIRServerDentry *dentry;
-    dentry = (FDIRServerDentry *)ptr;
+    FDIRDentryContext *owner;
 
+    dentry = (FDIRServerDentry *)ptr;
     if (dentry->children != NULL) {
-        uniq_skiplist_free(dentry->children);
+        if ((owner=children_owner(dentry)) != dentry->context) {
+            //the children skiplist belongs to the owner data thread
+            server_add_to_delay_free_queue(&owner->db_context->
+                    delay_free_context, dentry->children,
+                    dentry_children_free_func);
+        } else {
+            dentry_children_free(dentry->children);
+        }
     }
 
-    fast_allocator_free(&dentry->context->name_acontext, dentry->name.str);
-    if ((!FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode) &&
-            S_ISLNK(dentry->stat.mode)) && dentry->link.str != NULL)
-    {
-        fast_allocator_free(&dentry->context->name_acontext,
-                dentry->link.str);
+    if (!DENTRY_NAME_IS_INLINE(dentry, dentry->name.str)) {
+        dentry_name_free(dentry->context, dentry->name.str);
+    }
+    if (dentry->extra != NULL) {
+        if ((!FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode) &&
+                    S_ISLNK(dentry->stat.mode)) &&
+                dentry->extra->link.str != NULL)
+        {
+            fast_allocator_free(&dentry->context->name_acontext,
+                    dentry->extra->link.str);
+        }
+        fast_mblock_free_object(&fdir_manager.extra_allocator,
+                dentry->extra);
+        dentry->extra = NULL;
     }
     fast_mblock_free_object(&dentry->context->dentry_allocator,
             (void *)dentry);
@@ -155,7 +260,7 @@ static void dentry_free_func(void *ptr, const int delay_seconds)
 
     if (delay_seconds > 0) {
         server_add_to_delay_free_queue(&dentry->context->db_context->
-                delay_free_context, ptr, dentry_do_free, delay_seconds);
+                delay_free_context, ptr, dentry_do_free);
     } else {
         dentry_do_free(ptr);
     }
@@ -166,6 +271,8 @@ int dentry_init_obj(void *element, void *init_args)
     FDIRServerDentry *dentry;
     dentry = (FDIRServerDentry *)element;
     dentry->context = (FDIRDentryContext *)init_args;
+    dentry->generation = 0;  //kept for the reused dentry
+    dentry->children_version = 0;
     return 0;
 }
 
@@ -213,8 +320,17 @@ int dentry_init_context(FDIRDataThreadContext *db_context)
         }
     }
 
+    //the names of the moved dentries are changed by other data threads
     if ((result=fast_allocator_init_ex(&context->name_acontext,
-                    "name", regions, count, 0, 0.00, 0, false)) != 0)
+                    "name", regions, count, 0, 0.00, 0, DATA_DISPATCH_MODE ==
+                    FDIR_DATA_DISPATCH_MODE_PARENT)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=name_intern_init(&context->name_intern,
+                    &context->name_acontext, NAME_INTERN_CAPACITY,
+                    DATA_DISPATCH_MODE == FDIR_DATA_DISPATCH_MODE_PARENT)) != 0)
     {
         return result;
     }
@@ -244,6 +360,10 @@ static FDIRNamespaceEntry *create_namespace(FDIRDentryContext *context,
             */
 
     entry->dentry_root = NULL;
+    entry->dentry_count = 0;
+    entry->used_bytes = 0;
+    entry->quota.inodes = 0;
+    entry->quota.bytes = 0;
     entry->next = *bucket;
     *bucket = entry;
     *err_no = 0;
@@ -292,41 +412,410 @@ static FDIRNamespaceEntry *get_namespace(FDIRDentryContext *context,
     return entry;
 }
 
+static inline FDIRServerDentry *dentry_find_child_by_key(
+        FDIRServerDentry *parent, const FDIRDentryNameKey *key)
+{
+    if (parent->children == NULL) {
+        return NULL;
+    }
+
+    return dentry_children_find(parent->children, key);
+}
+
+static inline FDIRServerDentry *dentry_find_child(
+        FDIRServerDentry *parent, const string_t *name)
+{
+    FDIRDentryNameKey key;
+
+    dentry_name_key_init(&key, name);
+    return dentry_find_child_by_key(parent, &key);
+}
+
+static inline bool dentry_children_empty(FDIRServerDentry *dentry)
+{
+    return dentry_children_count(dentry->children) == 0;
+}
+
+//the children are created on the first insertion
+static int dentry_check_children(FDIRServerDentry *dentry)
+{
+    FDIRDentryChildren *children;
+
+    if (dentry->children != NULL) {
+        return 0;
+    }
+
+    if ((children=dentry_children_create()) == NULL) {
+        return ENOMEM;
+    }
+
+    __sync_synchronize();
+    dentry->children = children;
+    return 0;
+}
+
+static inline int dentry_insert_child(FDIRServerDentry *parent,
+        FDIRServerDentry *dentry)
+{
+    int result;
+
+    if ((result=dentry_check_children(parent)) != 0) {
+        return result;
+    }
+
+    path_cache_change_begin(&parent->children_version);
+    result = dentry_children_insert(children_owner(parent),
+            parent->children, dentry);
+    path_cache_change_end(&parent->children_version);
+    return result;
+}
+
+static inline int dentry_delete_child(FDIRServerDentry *parent,
+        FDIRServerDentry *dentry, const bool need_free)
+{
+    int result;
+
+    if (parent->children == NULL) {
+        return ENOENT;
+    }
+    path_cache_change_begin(&parent->children_version);
+    result = dentry_children_delete(children_owner(parent),
+            parent->children, dentry);
+    path_cache_change_end(&parent->children_version);
+    if (result != 0) {
+        return result;
+    }
+
+    if (need_free) {
+        dentry_free_func(dentry, delay_free_seconds);
+    }
+    return 0;
+}
+
+static inline int dentry_replace_child(FDIRServerDentry *parent,
+        FDIRServerDentry *dentry, const bool need_free_old)
+{
+    FDIRServerDentry *old;
+    int result;
+
+    if (parent->children == NULL) {
+        return ENOENT;
+    }
+    path_cache_change_begin(&parent->children_version);
+    result = dentry_children_replace(children_owner(parent),
+            parent->children, dentry, &old);
+    path_cache_change_end(&parent->children_version);
+    if (result != 0) {
+        return result;
+    }
+
+    if (need_free_old) {
+        dentry_free_func(old, delay_free_seconds);
+    }
+    return 0;
+}
+
+void dentry_get_usage(FDIRServerDentry *dentry, FDIRDEntryUsage *usage)
+{
+    FDIRDentryChildren *children;
+
+    if (S_ISDIR(dentry->stat.mode)) {
+        if ((children=dentry->children) != NULL) {
+            usage->file_count = __sync_add_and_fetch(
+                    &children->usage.file_count, 0);
+            usage->dir_count = __sync_add_and_fetch(
+                    &children->usage.dir_count, 0);
+            usage->bytes = __sync_add_and_fetch(&children->usage.bytes, 0);
+        } else {
+            memset(usage, 0, sizeof(*usage));
+        }
+        usage->dir_count++;
+    } else {
+        usage->file_count = 1;
+        usage->dir_count = 0;
+        usage->bytes = DENTRY_USAGE_HAS_BYTES(dentry->stat.mode) ?
+            dentry->stat.size : 0;
+    }
+}
+
+//sign: 1 for add and -1 for subtract
+static void dentry_usage_propagate(FDIRServerDentry *parent,
+        const FDIRDEntryUsage *usage, const int sign)
+{
+    FDIRDentryChildren *children;
+
+    for (; parent != NULL; parent=parent->parent) {
+        if ((children=parent->children) == NULL) {
+            continue;
+        }
+
+        if (usage->file_count != 0) {
+            __sync_add_and_fetch(&children->usage.file_count,
+                    sign * usage->file_count);
+        }
+        if (usage->dir_count != 0) {
+            __sync_add_and_fetch(&children->usage.dir_count,
+                    sign * usage->dir_count);
+        }
+        if (usage->bytes != 0) {
+            __sync_add_and_fetch(&children->usage.bytes,
+                    sign * usage->bytes);
+        }
+    }
+}
+
+//sign: 1 for add and -1 for subtract
+static inline void namespace_usage_add(FDIRServerDentry *dentry,
+        const int sign)
+{
+    if (DENTRY_USAGE_HAS_BYTES(dentry->stat.mode) && dentry->stat.size != 0) {
+        __sync_add_and_fetch(&dentry->ns_entry->used_bytes,
+                sign * dentry->stat.size);
+    }
+}
+
+void dentry_usage_set_size(FDIRServerDentry *dentry, const int64_t size)
+{
+    FDIRServerDentry *parent;
+    int64_t delta;
+
+    delta = size - dentry->stat.size;
+    dentry->stat.size = size;
+    if (delta == 0 || !DENTRY_USAGE_HAS_BYTES(dentry->stat.mode)) {
+        return;
+    }
+
+    __sync_add_and_fetch(&dentry->ns_entry->used_bytes, delta);
+
+    for (parent=dentry->parent; parent != NULL; parent=parent->parent) {
+        if (parent->children != NULL) {
+            __sync_add_and_fetch(&parent->children->usage.bytes, delta);
+        }
+    }
+}
+
+typedef struct {
+    int count;
+    int64_t inodes[INODE_INDEX_LOCK_INODES_MAX];
+} DentryMoveLockInodes;
+
+//the files with the size in the subtree, the caller checks the count
+static void collect_move_lock_inodes(FDIRServerDentry *dentry,
+        DentryMoveLockInodes *lock_inodes)
+{
+    FDIRServerDentry *child;
+    FDIRChildrenIterator iterator;
+
+    if (dentry->children == NULL) {
+        return;
+    }
+
+    dentry_children_iterator(dentry->children, &iterator);
+    while ((child=dentry_children_next(&iterator)) != NULL) {
+        if (S_ISDIR(child->stat.mode)) {
+            collect_move_lock_inodes(child, lock_inodes);
+        } else if (DENTRY_USAGE_HAS_BYTES(child->stat.mode) &&
+                lock_inodes->count < INODE_INDEX_LOCK_INODES_MAX)
+        {
+            lock_inodes->inodes[lock_inodes->count++] = child->inode;
+        }
+    }
+}
+
+/* change the parent of the dentry, NULL for detach. the size updates of
+ * the files change the usage of the ancestors under the inode lock, so
+ * the usage of the moved subtree is stable when holding the locks.
+ * the subtree does not change during the move, because the namespace
+ * is served by one data thread, or the cross shard rename and the rmdir
+ * are exclusive. so only the locks of its files are held when it is
+ * small, otherwise all of the locks
+ */
+static void dentry_usage_move(FDIRServerDentry *dentry,
+        FDIRServerDentry *new_parent)
+{
+    DentryMoveLockInodes lock_inodes;
+    FDIRDEntryUsage usage;
+    bool lock_all;
+
+    if (dentry->parent == new_parent) {
+        return;
+    }
+
+    lock_all = false;
+    lock_inodes.count = 0;
+    if (S_ISDIR(dentry->stat.mode)) {
+        dentry_get_usage(dentry, &usage);
+        if (usage.file_count <= INODE_INDEX_LOCK_INODES_MAX &&
+                usage.dir_count <= INODE_INDEX_LOCK_INODES_MAX)
+        {
+            collect_move_lock_inodes(dentry, &lock_inodes);
+        } else {
+            lock_all = true;
+        }
+    } else {
+        lock_inodes.inodes[lock_inodes.count++] = dentry->inode;
+    }
+
+    if (lock_all) {
+        inode_index_lock_all();
+    } else if (lock_inodes.count > 0) {
+        inode_index_lock_inodes(lock_inodes.inodes, lock_inodes.count);
+    }
+
+    dentry_get_usage(dentry, &usage);
+    dentry_usage_propagate(dentry->parent, &usage, -1);
+    dentry->parent = new_parent;
+    dentry_usage_propagate(new_parent, &usage, 1);
+
+    if (lock_all) {
+        inode_index_unlock_all();
+    } else if (lock_inodes.count > 0) {
+        inode_index_unlock_inodes(lock_inodes.inodes, lock_inodes.count);
+    }
+}
+
 static const FDIRServerDentry *do_find_ex(FDIRNamespaceEntry *ns_entry,
-        const string_t *paths, const int count)
+        const string_t *paths, const int count, FDIRPathCacheChain *chain)
 {
     const string_t *p;
     const string_t *end;
     FDIRServerDentry *current;
-    FDIRServerDentry target;
+    FDIRDentryNameKey key;
 
     current = ns_entry->dentry_root;
+    if (chain != NULL) {
+        chain->count = 0;
+        chain->found = false;
+        chain->notdir = false;
+        PATH_CACHE_CHAIN_ADD(chain, current);
+    }
+
     end = paths + count;
     for (p=paths; p<end; p++) {
         if (!S_ISDIR(current->stat.mode)) {
+            if (chain != NULL) {
+                chain->notdir = true;
+            }
             return NULL;
         }
 
-        target.name = *p;
-        current = (FDIRServerDentry *)uniq_skiplist_find(
-                current->children, &target);
+        if (chain != NULL) {
+            chain->nodes[chain->count - 1].children_version =
+                current->children_version;
+        }
+        dentry_name_key_init(&key, p);
+        current = dentry_find_child_by_key(current, &key);
         if (current == NULL) {
             return NULL;
         }
+
+        if (chain != NULL) {
+            PATH_CACHE_CHAIN_ADD(chain, current);
+        }
     }
 
+    if (chain != NULL) {
+        chain->found = true;
+    }
     return current;
 }
 
-int64_t dentry_get_namespace_inode_count(const string_t *ns)
+/* find the dentry by the path cache first,
+ * return ENOTDIR when the parent of the last part is not a directory
+ */
+static int find_dentry_by_paths(FDIRNamespaceEntry *ns_entry,
+        const string_t *paths, const int count, FDIRServerDentry **dentry)
+{
+    FDIRPathCacheChain chain;
+    string_t path;
+
+    if (count < FDIR_PATH_CACHE_MIN_PATH_COUNT || PATH_CACHE_CAPACITY == 0) {
+        *dentry = (FDIRServerDentry *)do_find_ex(ns_entry,
+                paths, count, NULL);
+        return (*dentry != NULL) ? 0 : ENOENT;
+    }
+
+    path.str = paths[0].str;
+    path.len = (paths[count - 1].str + paths[count - 1].len) - path.str;
+    if (path_cache_find(ns_entry, &path, dentry)) {
+        return (*dentry != NULL) ? 0 : ENOENT;
+    }
+
+    *dentry = (FDIRServerDentry *)do_find_ex(ns_entry, paths, count, &chain);
+    path_cache_add(ns_entry, &path, &chain);
+    if (*dentry != NULL) {
+        return 0;
+    }
+
+    //the nodes include the root
+    return (chain.notdir && chain.count == count) ? ENOTDIR : ENOENT;
+}
+
+int dentry_namespace_walk(dentry_namespace_walk_func walk_func, void *args)
+{
+    FDIRNamespaceEntry **bucket;
+    FDIRNamespaceEntry **end;
+    FDIRNamespaceEntry *entry;
+    int result;
+
+    end = fdir_manager.hashtable.buckets + g_server_global_vars.
+        namespace_hashtable_capacity;
+    for (bucket=fdir_manager.hashtable.buckets; bucket<end; bucket++) {
+        for (entry=*bucket; entry!=NULL; entry=entry->next) {
+            if ((result=walk_func(entry, args)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void dentry_get_namespace_stat(const string_t *ns, FDIRNamespaceStat *stat)
 {
     int result;
     FDIRNamespaceEntry *ns_entry;
 
+    memset(stat, 0, sizeof(*stat));
     if ((ns_entry=get_namespace(NULL, ns, false, &result)) == NULL) {
-        return 0;
+        return;
     }
-    return __sync_add_and_fetch(&ns_entry->dentry_count, 0);
+
+    stat->inode.used = __sync_add_and_fetch(&ns_entry->dentry_count, 0);
+    stat->used_bytes = __sync_add_and_fetch(&ns_entry->used_bytes, 0);
+    stat->quota.inodes = __sync_add_and_fetch(&ns_entry->quota.inodes, 0);
+    stat->quota.bytes = __sync_add_and_fetch(&ns_entry->quota.bytes, 0);
+}
+
+//the quota is read without lock by the service threads
+static inline void quota_set_value(volatile int64_t *target,
+        const int64_t value)
+{
+    int64_t old_value;
+
+    do {
+        old_value = __sync_add_and_fetch(target, 0);
+        if (old_value == value) {
+            break;
+        }
+    } while (!__sync_bool_compare_and_swap(target, old_value, value));
+}
+
+int dentry_namespace_set_quota(FDIRDataThreadContext *db_context,
+        const string_t *ns, const FDIRNamespaceQuota *quota)
+{
+    int result;
+    FDIRNamespaceEntry *ns_entry;
+
+    if ((ns_entry=get_namespace(&db_context->dentry_context,
+                    ns, true, &result)) == NULL)
+    {
+        return result;
+    }
+
+    quota_set_value(&ns_entry->quota.inodes, quota->inodes);
+    quota_set_value(&ns_entry->quota.bytes, quota->bytes);
+    return 0;
 }
 
 int dentry_find_parent(const FDIRDEntryFullName *fullname,
@@ -373,78 +862,19 @@ int dentry_find_parent(const FDIRDEntryFullName *fullname,
     if (path_info.count == 1) {
         *parent = ns_entry->dentry_root;
     } else {
-        *parent = (FDIRServerDentry *)do_find_ex(ns_entry,
-                path_info.paths, path_info.count - 1);
-        if (*parent == NULL) {
-            return ENOENT;
-        }
-    }
-
-    if (!S_ISDIR((*parent)->stat.mode)) {
-        *parent = NULL;
-        return ENOTDIR;
-    }
-
-    return 0;
-}
-
-static int dentry_find_parent_and_me(FDIRDentryContext *context,
-        const FDIRDEntryFullName *fullname, FDIRPathInfo *path_info,
-        string_t *my_name, FDIRNamespaceEntry **ns_entry,
-        FDIRServerDentry **parent, FDIRServerDentry **me,
-        const bool create_ns)
-{
-    FDIRServerDentry target;
-    int result;
-
-    if (fullname->path.len == 0 || fullname->path.str[0] != '/') {
-        *ns_entry = NULL;
-        *parent = *me = NULL;
-        return EINVAL;
-    }
-
-    *ns_entry = get_namespace(context, &fullname->ns,
-            create_ns, &result);
-    if (*ns_entry == NULL) {
-        *parent = *me = NULL;
-        return result;
-    }
-
-    if ((*ns_entry)->dentry_root == NULL) {
-        *parent = *me = NULL;
-        return ENOENT;
-    }
-
-    path_info->count = split_string_ex(&fullname->path, '/',
-            path_info->paths, FDIR_MAX_PATH_COUNT, true);
-    if (path_info->count == 0) {
-        *parent = NULL;
-        *me = (*ns_entry)->dentry_root;
-        my_name->len = 0;
-        my_name->str = "";
-        return 0;
-    }
-
-    *my_name = path_info->paths[path_info->count - 1];
-    if (path_info->count == 1) {
-        *parent = (*ns_entry)->dentry_root;
-    } else {
-        *parent = (FDIRServerDentry *)do_find_ex(*ns_entry,
-                path_info->paths, path_info->count - 1);
-        if (*parent == NULL) {
-            *me = NULL;
+        if (find_dentry_by_paths(ns_entry, path_info.paths,
+                    path_info.count - 1, parent) != 0)
+        {
+            *parent = NULL;
             return ENOENT;
         }
     }
 
     if (!S_ISDIR((*parent)->stat.mode)) {
         *parent = NULL;
-        *me = NULL;
         return ENOTDIR;
     }
 
-    target.name = *my_name;
-    *me = (FDIRServerDentry *)uniq_skiplist_find((*parent)->children, &target);
     return 0;
 }
 
@@ -452,7 +882,6 @@ static int dentry_find_me(FDIRDentryContext *context, const string_t *ns,
         FDIRRecordDEntry *rec_entry, FDIRNamespaceEntry **ns_entry,
         const bool create_ns)
 {
-    FDIRServerDentry target;
     int result;
 
     if (rec_entry->parent == NULL) {
@@ -475,9 +904,70 @@ static int dentry_find_me(FDIRDentryContext *context, const string_t *ns,
         *ns_entry = rec_entry->parent->ns_entry;
     }
 
-    target.name = rec_entry->pname.name;
-    rec_entry->dentry = (FDIRServerDentry *)uniq_skiplist_find(
-            rec_entry->parent->children, &target);
+    rec_entry->dentry = dentry_find_child(rec_entry->parent,
+            &rec_entry->pname.name);
+    return 0;
+}
+
+static int init_dentry_by_record(FDIRDataThreadContext *db_context,
+        FDIRBinlogRecord *record, FDIRNamespaceEntry *ns_entry,
+        FDIRServerDentry **dentry)
+{
+    FDIRServerDentry *current;
+    int result;
+
+    current = (FDIRServerDentry *)fast_mblock_alloc_object(
+            &db_context->dentry_context.dentry_allocator);
+    if (current == NULL) {
+        return ENOMEM;
+    }
+
+    current->children = NULL;
+    current->extra = NULL;
+
+    current->parent = record->me.parent;
+    if ((result=dentry_init_name(&db_context->dentry_context,
+                    current, &record->me.pname.name)) != 0)
+    {
+        return result;
+    }
+
+    if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode) ||
+            S_ISLNK(record->stat.mode))
+    {
+        if ((current->extra=dentry_alloc_extra()) == NULL) {
+            return ENOMEM;
+        }
+
+        if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
+            current->extra->src_dentry = record->hdlink.src_dentry;
+        } else if ((result=dentry_strdup(&db_context->dentry_context,
+                        &current->extra->link, &record->link)) != 0)
+        {
+            return result;
+        }
+    }
+
+    if (record->inode == 0) {
+        current->inode = inode_generator_next();
+    } else {
+        current->inode = record->inode;
+    }
+
+    current->ns_entry = ns_entry;
+    current->stat.mode = record->stat.mode;
+    current->stat.atime = record->stat.atime;
+    current->stat.btime = record->stat.btime;
+    current->stat.ctime = record->stat.ctime;
+    current->stat.mtime = record->stat.mtime;
+    current->stat.uid = record->stat.uid;
+    current->stat.gid = record->stat.gid;
+    current->stat.size = record->stat.size;
+    current->stat.nlink = 1;
+    current->stat.alloc = 0;
+    current->stat.space_end = 0;
+
+    *dentry = current;
     return 0;
 }
 
@@ -485,6 +975,7 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
 {
     FDIRNamespaceEntry *ns_entry;
     FDIRServerDentry *current;
+    FDIRDEntryUsage usage;
     bool is_dir;
     int result;
 
@@ -512,79 +1003,45 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
         return EEXIST;
     }
 
-    current = (FDIRServerDentry *)fast_mblock_alloc_object(
-            &db_context->dentry_context.dentry_allocator);
-    if (current == NULL) {
-        return ENOMEM;
-    }
-
-    is_dir = S_ISDIR(record->stat.mode);
-    if (is_dir) {
-        current->children = uniq_skiplist_new(&db_context->
-                dentry_context.factory, INIT_LEVEL_COUNT);
-        if (current->children == NULL) {
-            return ENOMEM;
+    /* the quota is checked by the master only (STRICT mode): the
+     * concurrent creates of the other data threads can overrun the quota
+     * on the master, so the binlog replay (LOOSE mode) MUST apply the
+     * records accepted by the master, or the slave diverges
+     */
+    if (g_data_thread_vars.error_mode == FDIR_DATA_ERROR_MODE_STRICT) {
+        int64_t inodes;
+        inodes = __sync_add_and_fetch(&ns_entry->quota.inodes, 0);
+        if (inodes > 0 && __sync_add_and_fetch(&ns_entry->
+                    dentry_count, 0) >= inodes)
+        {
+            return EDQUOT;
         }
-    } else {
-        current->children = NULL;
     }
 
-    current->parent = record->me.parent;
-    if ((result=dentry_strdup(&db_context->dentry_context,
-                    &current->name, &record->me.pname.name)) != 0)
+    is_dir = S_ISDIR(record->stat.mode);
+    if ((result=init_dentry_by_record(db_context, record,
+                    ns_entry, &current)) != 0)
     {
         return result;
     }
 
-    if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
-        current->src_dentry = record->hdlink.src_dentry;
-    } else if (S_ISLNK(record->stat.mode)) {
-        if ((result=dentry_strdup(&db_context->dentry_context,
-                        &current->link, &record->link)) != 0)
-        {
+    //added before the size updates can find the dentry by inode
+    if (current->parent != NULL) {
+        if ((result=dentry_check_children(current->parent)) != 0) {
+            dentry_do_free(current);
             return result;
         }
-    } else {
-        FC_SET_STRING_NULL(current->link);
+        dentry_get_usage(current, &usage);
+        dentry_usage_propagate(current->parent, &usage, 1);
     }
-
-    /*
-    {
-        char hex1[256];
-        char hex2[256];
-        bin2hex(current->name.str, current->name.len, hex1);
-        bin2hex(record->me.pname.name.str, record->me.pname.name.len, hex2);
-        logInfo("file: "__FILE__", line: %d, "
-            "current name: %p => %.*s(%d), hex1: %s, input name: %.*s(%d), hex2: %s",
-            __LINE__, current->name.str, current->name.len,
-            current->name.str, current->name.len, hex1, record->me.pname.name.len,
-            record->me.pname.name.str, record->me.pname.name.len, hex2);
-    }
-    */
-
-    if (record->inode == 0) {
-        current->inode = inode_generator_next();
-    } else {
-        current->inode = record->inode;
-    }
-
-    current->ns_entry = ns_entry;
-    current->stat.mode = record->stat.mode;
-    current->stat.atime = record->stat.atime;
-    current->stat.btime = record->stat.btime;
-    current->stat.ctime = record->stat.ctime;
-    current->stat.mtime = record->stat.mtime;
-    current->stat.uid = record->stat.uid;
-    current->stat.gid = record->stat.gid;
-    current->stat.size = record->stat.size;
-    current->stat.nlink = 1;
-    current->stat.alloc = 0;
-    current->stat.space_end = 0;
+    namespace_usage_add(current, 1);
 
     if (FDIR_IS_DENTRY_HARD_LINK(current->stat.mode)) {
-        current->src_dentry->stat.nlink++;
+        current->extra->src_dentry->stat.nlink++;
     } else {
         if ((result=inode_index_add_dentry(current)) != 0) {
+            dentry_usage_propagate(current->parent, &usage, -1);
+            namespace_usage_add(current, -1);
             dentry_do_free(current);
             return result;
         }
@@ -592,11 +1049,13 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
 
     if (current->parent == NULL) {
         ns_entry->dentry_root = current;
-    } else if ((result=uniq_skiplist_insert(current->parent->children,
+    } else if ((result=dentry_insert_child(current->parent,
                     current)) == 0)
     {
         current->parent->stat.nlink++;
     } else {
+        dentry_usage_propagate(current->parent, &usage, -1);
+        namespace_usage_add(current, -1);
         return result;
     }
 
@@ -614,6 +1073,41 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
     return 0;
 }
 
+int dentry_restore_orphan(FDIRDataThreadContext *db_context,
+        FDIRBinlogRecord *record)
+{
+    FDIRNamespaceEntry *ns_entry;
+    FDIRServerDentry *current;
+    int result;
+
+    if ((ns_entry=get_namespace(&db_context->dentry_context,
+                    &record->ns, true, &result)) == NULL)
+    {
+        return result;
+    }
+
+    record->me.parent = NULL;
+    if ((result=init_dentry_by_record(db_context, record,
+                    ns_entry, &current)) != 0)
+    {
+        return result;
+    }
+
+    //the references are restored by the hard links later
+    current->stat.nlink = 0;
+    namespace_usage_add(current, 1);
+    if ((result=inode_index_add_dentry(current)) != 0) {
+        namespace_usage_add(current, -1);
+        dentry_do_free(current);
+        return result;
+    }
+
+    record->me.dentry = current;
+    db_context->dentry_context.counters.file++;
+    __sync_add_and_fetch(&ns_entry->dentry_count, 1);
+    return 0;
+}
+
 static inline int remove_src_dentry(FDIRDataThreadContext *db_context,
         FDIRServerDentry *dentry)
 {
@@ -623,6 +1117,7 @@ static inline int remove_src_dentry(FDIRDataThreadContext *db_context,
         return result;
     }
 
+    namespace_usage_add(dentry, -1);
     dentry_free_func(dentry, delay_free_seconds);
     db_context->dentry_context.counters.file--;
     __sync_sub_and_fetch(&dentry->ns_entry->dentry_count, 1);
@@ -632,24 +1127,25 @@ static inline int remove_src_dentry(FDIRDataThreadContext *db_context,
 static int do_remove_dentry(FDIRDataThreadContext *db_context,
         FDIRServerDentry *dentry, bool *free_dentry)
 {
+    FDIRDEntryUsage usage;
     int result;
 
     if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
-        if (dentry->src_dentry->stat.nlink == 1) {
+        if (dentry->extra->src_dentry->stat.nlink == 1) {
 
             /*
             logInfo("file: "__FILE__", line: %d, "
                     "remove hard link src dentry: %"PRId64, __LINE__,
-                    dentry->src_dentry->inode);
+                    dentry->extra->src_dentry->inode);
                     */
 
             if ((result=remove_src_dentry(db_context,
-                            dentry->src_dentry)) != 0)
+                            dentry->extra->src_dentry)) != 0)
             {
                 return result;
             }
         } else {
-            dentry->src_dentry->stat.nlink--;
+            dentry->extra->src_dentry->stat.nlink--;
         }
         *free_dentry = true;
     } else {
@@ -665,11 +1161,18 @@ static int do_remove_dentry(FDIRDataThreadContext *db_context,
                     "dentry: %"PRId64", nlink: %d > 0, skip remove",
                     __LINE__, dentry->inode, dentry->stat.nlink);
                     */
+            //detached, referenced by hard links only
+            dentry_usage_move(dentry, NULL);
             *free_dentry = false;
         }
     }
 
     if (*free_dentry) {
+        //not found by the size updates after removed from the inode index
+        dentry_get_usage(dentry, &usage);
+        dentry_usage_propagate(dentry->parent, &usage, -1);
+        namespace_usage_add(dentry, -1);
+
         if (S_ISDIR(dentry->stat.mode)) {
             db_context->dentry_context.counters.dir--;
         } else {
@@ -686,6 +1189,7 @@ int dentry_remove(FDIRDataThreadContext *db_context,
         FDIRBinlogRecord *record)
 {
     FDIRNamespaceEntry *ns_entry;
+    FDIRServerDentry *dentry;
     bool free_dentry;
     int result;
 
@@ -700,29 +1204,32 @@ int dentry_remove(FDIRDataThreadContext *db_context,
     }
 
     if (S_ISDIR(record->me.dentry->stat.mode)) {
-        if (!uniq_skiplist_empty(record->me.dentry->children)) {
+        if (!dentry_children_empty(record->me.dentry)) {
             return ENOTEMPTY;
         }
     }
 
     record->inode = record->me.dentry->inode;
-    if ((result=do_remove_dentry(db_context, record->me.
-                    dentry, &free_dentry)) != 0)
-    {
-        return result;
-    }
+    dentry = record->me.dentry;
+    path_cache_change_begin(&dentry->generation);
+    do {
+        if ((result=do_remove_dentry(db_context, dentry,
+                        &free_dentry)) != 0)
+        {
+            break;
+        }
 
-    if (record->me.parent == NULL) {
-        ns_entry->dentry_root = NULL;
-    } else if ((result=uniq_skiplist_delete_ex(record->me.parent->children,
-                    record->me.dentry, free_dentry)) == 0)
-    {
-        record->me.parent->stat.nlink--;
-    } else {
-        return result;
-    }
+        if (record->me.parent == NULL) {
+            ns_entry->dentry_root = NULL;
+        } else if ((result=dentry_delete_child(record->me.parent,
+                        dentry, free_dentry)) == 0)
+        {
+            record->me.parent->stat.nlink--;
+        }
+    } while (0);
+    path_cache_change_end(&dentry->generation);
 
-    return 0;
+    return result;
 }
 
 static bool dentry_is_ancestor(FDIRServerDentry *dentry, FDIRServerDentry *parent)
@@ -739,24 +1246,20 @@ static bool dentry_is_ancestor(FDIRServerDentry *dentry, FDIRServerDentry *paren
 static int rename_check(FDIRDataThreadContext *db_context,
         FDIRBinlogRecord *record)
 {
-    FDIRServerDentry target;
-
     if (record->rename.src.parent == NULL ||
             record->rename.dest.parent == NULL)
     {
         return EINVAL;
     }
 
-    target.name = record->rename.src.pname.name;
-    if ((record->rename.src.dentry=(FDIRServerDentry *)uniq_skiplist_find(
-                    record->rename.src.parent->children, &target)) == NULL)
+    if ((record->rename.src.dentry=dentry_find_child(record->rename.
+                    src.parent, &record->rename.src.pname.name)) == NULL)
     {
         return ENOENT;
     }
 
-    target.name = record->rename.dest.pname.name;
-    if ((record->rename.dest.dentry=(FDIRServerDentry *)uniq_skiplist_find(
-                    record->rename.dest.parent->children, &target)) == NULL)
+    if ((record->rename.dest.dentry=dentry_find_child(record->rename.
+                    dest.parent, &record->rename.dest.pname.name)) == NULL)
     {
         if ((record->rename.flags & RENAME_EXCHANGE)) {
             return ENOENT;
@@ -785,7 +1288,7 @@ static int rename_check(FDIRDataThreadContext *db_context,
     }
 
     if (S_ISDIR(record->rename.dest.dentry->stat.mode)) {
-        if (!uniq_skiplist_empty(record->rename.dest.dentry->children)) {
+        if (!dentry_children_empty(record->rename.dest.dentry)) {
             return ENOTEMPTY;
         }
     }
@@ -795,7 +1298,7 @@ static int rename_check(FDIRDataThreadContext *db_context,
 
 static void free_dentry_name(void *ctx, void *ptr)
 {
-    fast_allocator_free((struct fast_allocator_context *)ctx, ptr);
+    dentry_name_free((FDIRDentryContext *)ctx, (char *)ptr);
 }
 
 static inline void restore_dentry_name(FDIRServerDentry *dentry,
@@ -805,17 +1308,25 @@ static inline void restore_dentry_name(FDIRServerDentry *dentry,
 
     name_to_free = dentry->name.str;
     dentry->name = *old_name;
+    dentry->name_prefix = dentry_name_prefix(old_name);
+    if (DENTRY_NAME_IS_INLINE(dentry, name_to_free)) {
+        return;
+    }
 
     server_add_to_delay_free_queue_ex(&dentry->context->db_context->
-            delay_free_context, name_to_free, &dentry->context->
-            name_acontext, free_dentry_name, delay_free_seconds);
+            delay_free_context, name_to_free, dentry->context,
+            free_dentry_name);
 }
 
 static inline void free_dname(FDIRServerDentry *dentry, string_t *old_name)
 {
+    if (DENTRY_NAME_IS_INLINE(dentry, old_name->str)) {
+        return;
+    }
+
     server_add_to_delay_free_queue_ex(&dentry->context->db_context->
-            delay_free_context, old_name->str, &dentry->context->
-            name_acontext, free_dentry_name, delay_free_seconds);
+            delay_free_context, old_name->str, dentry->context,
+            free_dentry_name);
 }
 
 static int set_and_store_dentry_name(FDIRDataThreadContext *db_context,
@@ -830,8 +1341,8 @@ static int set_and_store_dentry_name(FDIRDataThreadContext *db_context,
         return 0;
     }
 
-    if ((result=dentry_strdup(&dentry->context->db_context->
-                    dentry_context, &cloned_name, new_name)) != 0)
+    if ((result=dentry_name_dup(dentry->context,
+                    &cloned_name, new_name)) != 0)
     {
         return result;
     }
@@ -839,6 +1350,7 @@ static int set_and_store_dentry_name(FDIRDataThreadContext *db_context,
     pair->ptr = &pair->holder;
     pair->holder = dentry->name;
     dentry->name = cloned_name;
+    dentry->name_prefix = dentry_name_prefix(&cloned_name);
 
     /*
     logInfo("file: "__FILE__", line: %d, "
@@ -869,8 +1381,8 @@ static int exchange_dentry(FDIRDataThreadContext *db_context,
             record->rename.src.parent->inode);
             */
 
-    if ((result=uniq_skiplist_delete_ex(record->rename.src.parent->
-                    children, record->rename.src.dentry, false)) != 0) {
+    if ((result=dentry_delete_child(record->rename.src.parent,
+                    record->rename.src.dentry, false)) != 0) {
         return result;
     }
 
@@ -884,8 +1396,8 @@ static int exchange_dentry(FDIRDataThreadContext *db_context,
             break;
         }
 
-        if ((result=uniq_skiplist_replace_ex(record->rename.dest.parent->
-                        children, record->rename.src.dentry, false)) != 0)
+        if ((result=dentry_replace_child(record->rename.dest.parent,
+                    record->rename.src.dentry, false)) != 0)
         {
             break;
         }
@@ -895,26 +1407,28 @@ static int exchange_dentry(FDIRDataThreadContext *db_context,
                         rename.src.pname.name, name_changed,
                         &old_dest_pair)) != 0)
         {
-            uniq_skiplist_replace_ex(record->rename.dest.parent->
-                    children, record->rename.dest.dentry, false);  //rollback
+            dentry_replace_child(record->rename.dest.parent,
+                    record->rename.dest.dentry, false);  //rollback
             break;
         }
 
-        if ((result=uniq_skiplist_insert(record->rename.src.parent->
-                        children, record->rename.dest.dentry)) != 0)
+        if ((result=dentry_insert_child(record->rename.src.parent,
+                record->rename.dest.dentry)) != 0)
         {
             if (name_changed) {
                 restore_dentry_name(record->rename.dest.dentry,
                         old_dest_pair.ptr);
             }
 
-            uniq_skiplist_replace_ex(record->rename.dest.parent->
-                    children, record->rename.dest.dentry, false);  //rollback
+            dentry_replace_child(record->rename.dest.parent,
+                    record->rename.dest.dentry, false);  //rollback
             break;
         }
 
-        record->rename.src.dentry->parent = record->rename.dest.parent;
-        record->rename.dest.dentry->parent = record->rename.src.parent;
+        dentry_usage_move(record->rename.src.dentry,
+                record->rename.dest.parent);
+        dentry_usage_move(record->rename.dest.dentry,
+                record->rename.src.parent);
         record->inode = record->rename.src.dentry->inode;
         if (name_changed) {
             free_dname(record->rename.src.dentry, old_src_pair.ptr);
@@ -928,7 +1442,7 @@ static int exchange_dentry(FDIRDataThreadContext *db_context,
                     old_src_pair.ptr);
         }
 
-        uniq_skiplist_insert(record->rename.src.parent->children,
+        dentry_insert_child(record->rename.src.parent,
                 record->rename.src.dentry);
     }
 
@@ -941,8 +1455,8 @@ static int move_dentry(FDIRDataThreadContext *db_context,
     int result;
     StringHolderPtrPair old_src_pair;
 
-    if ((result=uniq_skiplist_delete_ex(record->rename.src.parent->
-                    children, record->rename.src.dentry, false)) != 0) {
+    if ((result=dentry_delete_child(record->rename.src.parent,
+                    record->rename.src.dentry, false)) != 0) {
         return result;
     }
 
@@ -971,12 +1485,12 @@ static int move_dentry(FDIRDataThreadContext *db_context,
             if ((result=do_remove_dentry(db_context, record->rename.
                             dest.dentry, &free_dentry)) == 0)
             {
-                result = uniq_skiplist_replace_ex(record->rename.dest.parent->
-                        children, record->rename.src.dentry, free_dentry);
+                result = dentry_replace_child(record->rename.dest.parent,
+                        record->rename.src.dentry, free_dentry);
             }
         } else {
-            result = uniq_skiplist_insert(record->rename.dest.
-                    parent->children, record->rename.src.dentry);
+            result = dentry_insert_child(record->rename.dest.parent,
+                    record->rename.src.dentry);
         }
 
         if (result != 0) {
@@ -987,7 +1501,8 @@ static int move_dentry(FDIRDataThreadContext *db_context,
             break;
         }
 
-        record->rename.src.dentry->parent = record->rename.dest.parent;
+        dentry_usage_move(record->rename.src.dentry,
+                record->rename.dest.parent);
         record->inode = record->rename.src.dentry->inode;
         if (name_changed) {
             free_dname(record->rename.src.dentry, old_src_pair.ptr);
@@ -995,7 +1510,7 @@ static int move_dentry(FDIRDataThreadContext *db_context,
     } while (0);
 
     if (result != 0) {  //rollback
-        uniq_skiplist_insert(record->rename.src.parent->children,
+        dentry_insert_child(record->rename.src.parent,
                 record->rename.src.dentry);
     }
 
@@ -1005,6 +1520,8 @@ static int move_dentry(FDIRDataThreadContext *db_context,
 int dentry_rename(FDIRDataThreadContext *db_context,
         FDIRBinlogRecord *record)
 {
+    FDIRServerDentry *src;
+    FDIRServerDentry *dest;
     int result;
     bool name_changed;
 
@@ -1049,11 +1566,65 @@ int dentry_rename(FDIRDataThreadContext *db_context,
             record->rename.dest.pname.name.len, (record->rename.flags & RENAME_EXCHANGE));
             */
 
+    src = record->rename.src.dentry;
+    dest = record->rename.dest.dentry;
+    path_cache_change_begin(&src->generation);
+    if (dest != NULL) {
+        path_cache_change_begin(&dest->generation);
+    }
+
     if ((record->rename.flags & RENAME_EXCHANGE)) {
-        return exchange_dentry(db_context, record, name_changed);
+        result = exchange_dentry(db_context, record, name_changed);
     } else {
         //dentry_children_print(record->rename.src.parent);
-        return move_dentry(db_context, record, name_changed);
+        result = move_dentry(db_context, record, name_changed);
+    }
+
+    if (dest != NULL) {
+        path_cache_change_end(&dest->generation);
+    }
+    path_cache_change_end(&src->generation);
+    return result;
+}
+
+static inline bool unlink_touch_others(FDIRServerDentry *dentry)
+{
+    return S_ISDIR(dentry->stat.mode) ||
+        FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode) ||
+        dentry->stat.nlink > 1;
+}
+
+bool dentry_is_cross_shard(const FDIRBinlogRecord *record)
+{
+    FDIRServerDentry *dentry;
+
+    switch (record->operation) {
+        case BINLOG_OP_CREATE_DENTRY_INT:
+            return FDIR_IS_DENTRY_HARD_LINK(record->stat.mode);
+        case BINLOG_OP_REMOVE_DENTRY_INT:
+            if (record->me.parent == NULL) {  //the root of the namespace
+                return true;
+            }
+            dentry = dentry_find_child(record->me.parent,
+                    &record->me.pname.name);
+            return (dentry != NULL && unlink_touch_others(dentry));
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            if (record->rename.src.parent == NULL ||
+                    record->rename.dest.parent == NULL)
+            {
+                return false;
+            }
+            if (record->rename.src.parent != record->rename.dest.parent) {
+                return true;
+            }
+            if ((record->rename.flags & RENAME_EXCHANGE)) {
+                return false;
+            }
+            dentry = dentry_find_child(record->rename.dest.parent,
+                    &record->rename.dest.pname.name);
+            return (dentry != NULL && unlink_touch_others(dentry));
+        default:
+            return false;
     }
 }
 
@@ -1062,20 +1633,35 @@ int dentry_find_ex(const FDIRDEntryFullName *fullname,
 {
     FDIRPathInfo path_info;
     FDIRNamespaceEntry *ns_entry;
-    FDIRServerDentry *parent;
-    string_t my_name;
     int result;
 
-    if ((result=dentry_find_parent_and_me(NULL, fullname, &path_info,
-                    &my_name, &ns_entry, &parent, dentry, false)) != 0)
+    if (fullname->path.len == 0 || fullname->path.str[0] != '/') {
+        *dentry = NULL;
+        return EINVAL;
+    }
+
+    if ((ns_entry=get_namespace(NULL, &fullname->ns,
+                    false, &result)) == NULL)
     {
+        *dentry = NULL;
         return result;
     }
 
-    if (*dentry == NULL) {
+    if (ns_entry->dentry_root == NULL) {
+        *dentry = NULL;
         return ENOENT;
     }
 
+    path_info.count = split_string_ex(&fullname->path, '/',
+            path_info.paths, FDIR_MAX_PATH_COUNT, true);
+    if (path_info.count == 0) {
+        *dentry = ns_entry->dentry_root;
+    } else if ((result=find_dentry_by_paths(ns_entry, path_info.paths,
+                    path_info.count, dentry)) != 0)
+    {
+        return result;
+    }
+
     if (hdlink_follow) {
         SET_HARD_LINK_DENTRY(*dentry);
     }
@@ -1085,16 +1671,12 @@ int dentry_find_ex(const FDIRDEntryFullName *fullname,
 int dentry_find_by_pname(FDIRServerDentry *parent, const string_t *name,
         FDIRServerDentry **dentry)
 {
-    FDIRServerDentry target;
-
     if (!S_ISDIR(parent->stat.mode)) {
         *dentry = NULL;
         return ENOENT;
     }
 
-    target.name = *name;
-    if ((*dentry=(FDIRServerDentry *)uniq_skiplist_find(
-                    parent->children, &target)) != NULL)
+    if ((*dentry=dentry_find_child(parent, name)) != NULL)
     {
         SET_HARD_LINK_DENTRY(*dentry);
         return 0;
@@ -1103,72 +1685,6 @@ int dentry_find_by_pname(FDIRServerDentry *parent, const string_t *name,
     }
 }
 
-static int check_alloc_dentry_array(FDIRServerDentryArray *array, const int target_count)
-{
-    FDIRServerDentry **entries;
-    int new_alloc;
-    int bytes;
-
-    if (array->alloc >= target_count) {
-        return 0;
-    }
-
-    new_alloc = (array->alloc > 0) ? array->alloc : 4 * 1024;
-    while (new_alloc < target_count) {
-        new_alloc *= 2;
-    }
-
-    bytes = sizeof(FDIRServerDentry *) * new_alloc;
-    entries = (FDIRServerDentry **)fc_malloc(bytes);
-    if (entries == NULL) {
-        return ENOMEM;
-    }
-
-    if (array->entries != NULL) {
-        if (array->count > 0) {
-            memcpy(entries, array->entries,
-                    sizeof(FDIRServerDentry *) * array->count);
-        }
-        free(array->entries);
-    }
-
-    array->alloc = new_alloc;
-    array->entries = entries;
-    return 0;
-}
-
-int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array)
-{
-    FDIRServerDentry *current;
-    FDIRServerDentry **pp;
-    UniqSkiplistIterator iterator;
-    int result;
-    int count;
-
-    if (!S_ISDIR(dentry->stat.mode)) {
-        count = 1;
-    } else {
-        count = uniq_skiplist_count(dentry->children);
-    }
-
-    if ((result=check_alloc_dentry_array(array, count)) != 0) {
-        return result;
-    }
-
-    if (!S_ISDIR(dentry->stat.mode)) {
-        array->entries[array->count++] = dentry;
-    } else {
-        pp = array->entries;
-        uniq_skiplist_iterator(dentry->children, &iterator);
-        while ((current=(FDIRServerDentry *)uniq_skiplist_next(&iterator)) != NULL) {
-            *pp++ = current;
-        }
-        array->count = pp - array->entries;
-    }
-
-    return 0;
-}
-
 int dentry_get_full_path(const FDIRServerDentry *dentry, BufferInfo *full_path,
         SFErrorInfo *error_info)
 {
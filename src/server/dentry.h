@@ -20,9 +20,15 @@
 #include "server_types.h"
 #include "data_thread.h"
 
+#define DENTRY_USAGE_HAS_BYTES(mode) \
+    (S_ISREG(mode) && !FDIR_IS_DENTRY_HARD_LINK(mode))
+
 #define FDIR_GET_REAL_DENTRY(dentry)  \
     FDIR_IS_DENTRY_HARD_LINK((dentry)->stat.mode) ? \
-    (dentry)->src_dentry : dentry
+    (dentry)->extra->src_dentry : dentry
+
+typedef int (*dentry_namespace_walk_func)(FDIRNamespaceEntry *ns_entry,
+        void *args);
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,19 +37,40 @@ extern "C" {
     int dentry_init();
     void dentry_destroy();
 
-    int64_t dentry_get_namespace_inode_count(const string_t *ns);
+    //thread safe, for the flock of the dentry without extra
+    FDIRServerDentryExtra *dentry_alloc_extra();
+
+    //the used inodes and bytes with the quota, all 0 for nonexistent
+    void dentry_get_namespace_stat(const string_t *ns,
+            FDIRNamespaceStat *stat);
+
+    //called by the data thread, the namespace created when not exist
+    int dentry_namespace_set_quota(FDIRDataThreadContext *db_context,
+            const string_t *ns, const FDIRNamespaceQuota *quota);
+
+    int dentry_namespace_walk(dentry_namespace_walk_func walk_func,
+            void *args);
 
     int dentry_init_context(FDIRDataThreadContext *db_context);
 
     int dentry_create(FDIRDataThreadContext *db_context,
             FDIRBinlogRecord *record);
 
+    int dentry_restore_orphan(FDIRDataThreadContext *db_context,
+            FDIRBinlogRecord *record);
+
     int dentry_remove(FDIRDataThreadContext *db_context,
             FDIRBinlogRecord *record);
 
     int dentry_rename(FDIRDataThreadContext *db_context,
             FDIRBinlogRecord *record);
 
+    /* for parent dispatch mode, check if the record changes the data
+     * which belong to the other data threads, such as a cross directory
+     * rename or hard link. the parent dentries of the record must be set
+     */
+    bool dentry_is_cross_shard(const FDIRBinlogRecord *record);
+
     int dentry_find_parent(const FDIRDEntryFullName *fullname,
             FDIRServerDentry **parent, string_t *my_name);
 
@@ -63,21 +90,35 @@ extern "C" {
     int dentry_get_full_path(const FDIRServerDentry *dentry,
             BufferInfo *full_path, SFErrorInfo *error_info);
 
-    int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array);
+    //the usage of the subtree, the dentry itself included
+    void dentry_get_usage(FDIRServerDentry *dentry, FDIRDEntryUsage *usage);
 
-    static inline int dentry_list_by_path(const FDIRDEntryFullName *fullname,
-            FDIRServerDentryArray *array)
-    {
-        const bool hdlink_follow = false;
-        int result;
-        FDIRServerDentry *dentry;
+    //the caller MUST hold the inode lock, see inode_index_lock
+    void dentry_usage_set_size(FDIRServerDentry *dentry, const int64_t size);
 
-        array->count = 0;
-        if ((result=dentry_find_ex(fullname, &dentry, hdlink_follow)) != 0) {
-            return result;
+    /* return EDQUOT when the new size exceeds the space quota of the
+     * namespace, the concurrent updates of the other inodes may overrun
+     * the quota by their increments
+     */
+    static inline int dentry_check_space_quota(
+            const FDIRServerDentry *dentry, const int64_t new_size)
+    {
+        FDIRNamespaceEntry *ns_entry;
+        int64_t quota_bytes;
+        int64_t increment;
+
+        ns_entry = dentry->ns_entry;
+        quota_bytes = __sync_add_and_fetch(&ns_entry->quota.bytes, 0);
+        if (quota_bytes <= 0 || !DENTRY_USAGE_HAS_BYTES(dentry->stat.mode)) {
+            return 0;
         }
 
-        return dentry_list(dentry, array);
+        increment = new_size - dentry->stat.size;
+        if (increment <= 0) {
+            return 0;
+        }
+        return (__sync_add_and_fetch(&ns_entry->used_bytes, 0) +
+                increment > quota_bytes) ? EDQUOT : 0;
     }
 
     static inline void dentry_array_free(FDIRServerDentryArray *array)
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/hash.h"
+#include "dentry.h"
+#include "dentry_children.h"
+
+/* the readers access the children without lock, so the array and the
+ * hash index are copied on write and the old ones are freed by the
+ * delay free queue of the owner data thread after the readers done
+ */
+
+#define LARGE_INIT_LEVEL_COUNT  8
+#define INDEX_MIN_CAPACITY      256
+#define INDEX_DELETED_DENTRY    ((FDIRServerDentry *)1)
+
+#define NAME_HASH_CODE(name) ((unsigned int)simple_hash((name)->str, \
+            (name)->len))
+
+static inline void delay_free(FDIRDentryContext *owner, void *ptr)
+{
+    server_add_to_delay_free_queue(&owner->db_context->delay_free_context,
+            ptr, free);
+}
+
+static FDIRChildrenArray *alloc_array(const int count)
+{
+    FDIRChildrenArray *array;
+
+    array = (FDIRChildrenArray *)fc_malloc(sizeof(FDIRChildrenArray) +
+            sizeof(FDIRServerDentry *) * count);
+    if (array != NULL) {
+        array->count = count;
+    }
+    return array;
+}
+
+FDIRDentryChildren *dentry_children_create()
+{
+    FDIRDentryChildren *children;
+
+    children = (FDIRDentryChildren *)fc_malloc(sizeof(FDIRDentryChildren));
+    if (children == NULL) {
+        return NULL;
+    }
+
+    if ((children->array=alloc_array(0)) == NULL) {
+        free(children);
+        return NULL;
+    }
+    children->skiplist = NULL;
+    children->index = NULL;
+    children->count = 0;
+    memset(&children->usage, 0, sizeof(children->usage));
+    return children;
+}
+
+void dentry_children_free(FDIRDentryChildren *children)
+{
+    if (children->array != NULL) {
+        free(children->array);
+    }
+    if (children->skiplist != NULL) {
+        uniq_skiplist_free(children->skiplist);
+    }
+    if (children->index != NULL) {
+        free(children->index);
+    }
+    free(children);
+}
+
+//return the insert position when not found
+static int array_bsearch(FDIRChildrenArray *array, const string_t *name,
+        const uint64_t prefix, bool *found)
+{
+    int low;
+    int high;
+    int mid;
+    int result;
+
+    low = 0;
+    high = array->count - 1;
+    while (low <= high) {
+        mid = (low + high) / 2;
+        result = dentry_name_compare(name, prefix, array->entries[mid]);
+        if (result == 0) {
+            *found = true;
+            return mid;
+        } else if (result < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static FDIRServerDentry *index_find(FDIRChildrenIndex *index,
+        const FDIRDentryNameKey *key)
+{
+    FDIRChildrenIndexSlot *slot;
+    FDIRServerDentry *dentry;
+    int64_t i;
+
+    i = key->hash_code & (index->capacity - 1);
+    while (1) {
+        slot = index->slots + i;
+        if ((dentry=slot->dentry) == NULL) {
+            return NULL;
+        }
+
+        if (dentry != INDEX_DELETED_DENTRY && slot->hash_code ==
+                key->hash_code && fc_string_equal(&dentry->name, key->name))
+        {
+            return dentry;
+        }
+        i = (i + 1) & (index->capacity - 1);
+    }
+}
+
+static FDIRChildrenIndexSlot *index_find_slot(FDIRChildrenIndex *index,
+        const unsigned int hash_code, const FDIRServerDentry *dentry)
+{
+    FDIRChildrenIndexSlot *slot;
+    int64_t i;
+
+    i = hash_code & (index->capacity - 1);
+    while (1) {
+        slot = index->slots + i;
+        if (slot->dentry == NULL) {
+            return NULL;
+        }
+        if (slot->dentry != INDEX_DELETED_DENTRY && fc_string_equal(
+                    &slot->dentry->name, &dentry->name))
+        {
+            return slot;
+        }
+        i = (i + 1) & (index->capacity - 1);
+    }
+}
+
+//the caller makes sure the name not exist
+static void index_add(FDIRChildrenIndex *index, const unsigned int
+        hash_code, FDIRServerDentry *dentry)
+{
+    FDIRChildrenIndexSlot *slot;
+    int64_t i;
+
+    i = hash_code & (index->capacity - 1);
+    while (1) {
+        slot = index->slots + i;
+        if (slot->dentry == NULL || slot->dentry == INDEX_DELETED_DENTRY) {
+            break;
+        }
+        i = (i + 1) & (index->capacity - 1);
+    }
+
+    if (slot->dentry == NULL) {
+        index->used++;
+    }
+    slot->hash_code = hash_code;
+    __sync_synchronize();
+    slot->dentry = dentry;
+}
+
+static FDIRChildrenIndex *index_alloc(const int count)
+{
+    FDIRChildrenIndex *index;
+    int64_t capacity;
+    int64_t bytes;
+
+    capacity = INDEX_MIN_CAPACITY;
+    while (capacity < 2 * (int64_t)count) {
+        capacity *= 2;
+    }
+
+    bytes = sizeof(FDIRChildrenIndex) + sizeof(
+            FDIRChildrenIndexSlot) * capacity;
+    if ((index=(FDIRChildrenIndex *)fc_malloc(bytes)) == NULL) {
+        return NULL;
+    }
+    memset(index, 0, bytes);
+    index->capacity = capacity;
+    return index;
+}
+
+//rebuild without the deleted slots when 3/4 used
+static int index_check_rebuild(FDIRDentryContext *owner,
+        FDIRDentryChildren *children)
+{
+    FDIRChildrenIndex *index;
+    FDIRChildrenIndexSlot *slot;
+    FDIRChildrenIndexSlot *end;
+
+    if ((children->index->used + 1) * 4 <= children->index->capacity * 3) {
+        return 0;
+    }
+
+    if ((index=index_alloc(children->count + 1)) == NULL) {
+        return ENOMEM;
+    }
+
+    end = children->index->slots + children->index->capacity;
+    for (slot=children->index->slots; slot<end; slot++) {
+        if (slot->dentry != NULL && slot->dentry != INDEX_DELETED_DENTRY) {
+            index_add(index, slot->hash_code, slot->dentry);
+        }
+    }
+
+    delay_free(owner, children->index);
+    __sync_synchronize();
+    children->index = index;
+    return 0;
+}
+
+//convert the sorted array to the skiplist and the hash index
+static int convert_to_large(FDIRDentryContext *owner,
+        FDIRDentryChildren *children)
+{
+    FDIRChildrenArray *array;
+    UniqSkiplist *skiplist;
+    FDIRChildrenIndex *index;
+    FDIRServerDentry **entry;
+    FDIRServerDentry **end;
+    FDIRServerDentry **pp;
+    int result;
+
+    array = children->array;
+    if ((skiplist=uniq_skiplist_new(&owner->factory,
+                    LARGE_INIT_LEVEL_COUNT)) == NULL)
+    {
+        return ENOMEM;
+    }
+    if ((index=index_alloc(array->count + 1)) == NULL) {
+        uniq_skiplist_free(skiplist);
+        return ENOMEM;
+    }
+
+    end = array->entries + array->count;
+    for (entry=array->entries; entry<end; entry++) {
+        if ((result=uniq_skiplist_insert(skiplist, *entry)) != 0) {
+            //remove the entries without free before free the skiplist
+            for (pp=array->entries; pp<entry; pp++) {
+                uniq_skiplist_delete_ex(skiplist, *pp, false);
+            }
+            uniq_skiplist_free(skiplist);
+            free(index);
+            return result;
+        }
+        index_add(index, NAME_HASH_CODE(&(*entry)->name), *entry);
+    }
+
+    children->skiplist = skiplist;
+    children->index = index;
+    __sync_synchronize();
+    children->array = NULL;
+    delay_free(owner, array);
+    return 0;
+}
+
+int dentry_children_insert(FDIRDentryContext *owner,
+        FDIRDentryChildren *children, FDIRServerDentry *dentry)
+{
+    FDIRChildrenArray *array;
+    FDIRChildrenArray *new_array;
+    bool found;
+    int pos;
+    int result;
+
+    if ((array=children->array) != NULL) {
+        pos = array_bsearch(array, &dentry->name,
+                dentry->name_prefix, &found);
+        if (found) {
+            return EEXIST;
+        }
+
+        if (array->count >= FDIR_CHILDREN_ARRAY_MAX_COUNT) {
+            if ((result=convert_to_large(owner, children)) != 0) {
+                return result;
+            }
+        } else {
+            if ((new_array=alloc_array(array->count + 1)) == NULL) {
+                return ENOMEM;
+            }
+            memcpy(new_array->entries, array->entries,
+                    sizeof(FDIRServerDentry *) * pos);
+            new_array->entries[pos] = dentry;
+            memcpy(new_array->entries + pos + 1, array->entries + pos,
+                    sizeof(FDIRServerDentry *) * (array->count - pos));
+
+            __sync_synchronize();
+            children->array = new_array;
+            delay_free(owner, array);
+            children->count++;
+            return 0;
+        }
+    }
+
+    if ((result=index_check_rebuild(owner, children)) != 0) {
+        return result;
+    }
+    if ((result=uniq_skiplist_insert(children->skiplist, dentry)) != 0) {
+        return result;
+    }
+    index_add(children->index, NAME_HASH_CODE(&dentry->name), dentry);
+    children->count++;
+    return 0;
+}
+
+int dentry_children_delete(FDIRDentryContext *owner,
+        FDIRDentryChildren *children, FDIRServerDentry *dentry)
+{
+    FDIRChildrenArray *array;
+    FDIRChildrenArray *new_array;
+    FDIRChildrenIndexSlot *slot;
+    bool found;
+    int pos;
+    int result;
+
+    if ((array=children->array) != NULL) {
+        pos = array_bsearch(array, &dentry->name,
+                dentry->name_prefix, &found);
+        if (!found) {
+            return ENOENT;
+        }
+
+        if ((new_array=alloc_array(array->count - 1)) == NULL) {
+            return ENOMEM;
+        }
+        memcpy(new_array->entries, array->entries,
+                sizeof(FDIRServerDentry *) * pos);
+        memcpy(new_array->entries + pos, array->entries + pos + 1,
+                sizeof(FDIRServerDentry *) * (array->count - pos - 1));
+
+        __sync_synchronize();
+        children->array = new_array;
+        delay_free(owner, array);
+    } else {
+        if ((result=uniq_skiplist_delete_ex(children->skiplist,
+                        dentry, false)) != 0)
+        {
+            return result;
+        }
+
+        slot = index_find_slot(children->index,
+                NAME_HASH_CODE(&dentry->name), dentry);
+        if (slot != NULL) {
+            slot->dentry = INDEX_DELETED_DENTRY;
+        }
+    }
+
+    children->count--;
+    return 0;
+}
+
+int dentry_children_replace(FDIRDentryContext *owner,
+        FDIRDentryChildren *children, FDIRServerDentry *dentry,
+        FDIRServerDentry **old)
+{
+    FDIRChildrenArray *array;
+    FDIRChildrenIndexSlot *slot;
+    bool found;
+    int pos;
+    int result;
+
+    if ((array=children->array) != NULL) {
+        pos = array_bsearch(array, &dentry->name,
+                dentry->name_prefix, &found);
+        if (!found) {
+            return ENOENT;
+        }
+
+        *old = array->entries[pos];
+        __sync_synchronize();
+        array->entries[pos] = dentry;  //pointer store is atomic
+        return 0;
+    }
+
+    slot = index_find_slot(children->index,
+            NAME_HASH_CODE(&dentry->name), dentry);
+    if (slot == NULL) {
+        return ENOENT;
+    }
+
+    *old = slot->dentry;
+    if ((result=uniq_skiplist_replace_ex(children->skiplist,
+                    dentry, false)) != 0)
+    {
+        return result;
+    }
+    __sync_synchronize();
+    slot->dentry = dentry;
+    return 0;
+}
+
+FDIRServerDentry *dentry_children_find(FDIRDentryChildren *children,
+        const FDIRDentryNameKey *key)
+{
+    FDIRChildrenArray *array;
+    bool found;
+    int pos;
+
+    if ((array=children->array) != NULL) {
+        pos = array_bsearch(array, key->name, key->prefix, &found);
+        return found ? array->entries[pos] : NULL;
+    }
+
+    //the index is set before the array cleared
+    return index_find(children->index, key);
+}
+
+void dentry_children_iterator(FDIRDentryChildren *children,
+        FDIRChildrenIterator *iterator)
+{
+    iterator->index = 0;
+    if ((iterator->array=children->array) == NULL) {
+        uniq_skiplist_iterator(children->skiplist, &iterator->it);
+    }
+}
+
+static FDIRChildrenArray empty_array = {0};
+
+void dentry_children_iterator_ex(FDIRDentryChildren *children,
+        const string_t *start_after, FDIRChildrenIterator *iterator)
+{
+    FDIRServerDentry target;
+    UniqSkiplistNode *node;
+    FDIRServerDentry *dentry;
+    bool found;
+
+    if ((iterator->array=children->array) != NULL) {
+        iterator->index = array_bsearch(iterator->array, start_after,
+                dentry_name_prefix(start_after), &found);
+        if (found) {
+            iterator->index++;
+        }
+        return;
+    }
+
+    iterator->index = 0;
+    target.name = *start_after;
+    target.name_prefix = dentry_name_prefix(start_after);
+    if ((node=uniq_skiplist_find_ge_node(children->skiplist,
+                    &target)) == NULL)
+    {
+        iterator->array = &empty_array;  //no more children
+        return;
+    }
+
+    uniq_skiplist_iterator_at(children->skiplist, node, &iterator->it);
+    dentry = (FDIRServerDentry *)node->data;
+    if (fc_string_equal(&dentry->name, start_after)) {
+        uniq_skiplist_next(&iterator->it);  //skip the cursor itself
+    }
+}
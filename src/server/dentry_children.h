@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//dentry_children.h
+
+#ifndef _DENTRY_CHILDREN_H_
+#define _DENTRY_CHILDREN_H_
+
+#include "fastcommon/uniq_skiplist.h"
+#include "fastcommon/hash.h"
+#include "server_types.h"
+#include "data_thread.h"
+
+//switch to skiplist and hash index when exceeds
+#define FDIR_CHILDREN_ARRAY_MAX_COUNT  64
+
+//the lookup key of one path component, computed once before searching
+typedef struct fdir_dentry_name_key {
+    const string_t *name;
+    uint64_t prefix;
+    unsigned int hash_code;  //for the hash index of the large directory
+} FDIRDentryNameKey;
+
+typedef struct fdir_children_iterator {
+    FDIRChildrenArray *array;
+    int index;
+    UniqSkiplistIterator it;
+} FDIRChildrenIterator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* the first 8 bytes of the name in big endian padded with zero,
+     * so the order of the prefixes is the order of fc_string_compare
+     * when they are different
+     */
+    static inline uint64_t dentry_name_prefix(const string_t *name)
+    {
+        const unsigned char *s;
+        uint64_t prefix;
+        int count;
+        int i;
+
+        s = (const unsigned char *)name->str;
+        count = (name->len < 8) ? name->len : 8;
+        prefix = 0;
+        for (i=0; i<count; i++) {
+            prefix |= (uint64_t)s[i] << (56 - 8 * i);
+        }
+        return prefix;
+    }
+
+    //the name prefix resolves the most compares without the name string
+    static inline int dentry_name_compare(const string_t *name,
+            const uint64_t prefix, const FDIRServerDentry *dentry)
+    {
+        if (prefix != dentry->name_prefix) {
+            return (prefix < dentry->name_prefix) ? -1 : 1;
+        }
+        return fc_string_compare(name, &dentry->name);
+    }
+
+    static inline void dentry_name_key_init(FDIRDentryNameKey *key,
+            const string_t *name)
+    {
+        key->name = name;
+        key->prefix = dentry_name_prefix(name);
+        key->hash_code = (unsigned int)simple_hash(name->str, name->len);
+    }
+
+    FDIRDentryChildren *dentry_children_create();
+
+    //the children must be empty
+    void dentry_children_free(FDIRDentryChildren *children);
+
+    /* the following modify functions are called by the data thread
+     * which owns the children, the owner context is for skiplist
+     * allocation and delay free
+     */
+
+    //return EEXIST when the name exists
+    int dentry_children_insert(FDIRDentryContext *owner,
+            FDIRDentryChildren *children, FDIRServerDentry *dentry);
+
+    int dentry_children_delete(FDIRDentryContext *owner,
+            FDIRDentryChildren *children, FDIRServerDentry *dentry);
+
+    //replace the child with the same name, the old one returned
+    int dentry_children_replace(FDIRDentryContext *owner,
+            FDIRDentryChildren *children, FDIRServerDentry *dentry,
+            FDIRServerDentry **old);
+
+    FDIRServerDentry *dentry_children_find(FDIRDentryChildren *children,
+            const FDIRDentryNameKey *key);
+
+    void dentry_children_iterator(FDIRDentryChildren *children,
+            FDIRChildrenIterator *iterator);
+
+    //iterate from the first child whose name greater than start_after
+    void dentry_children_iterator_ex(FDIRDentryChildren *children,
+            const string_t *start_after, FDIRChildrenIterator *iterator);
+
+    static inline FDIRServerDentry *dentry_children_next(
+            FDIRChildrenIterator *iterator)
+    {
+        if (iterator->array != NULL) {
+            if (iterator->index < iterator->array->count) {
+                return iterator->array->entries[iterator->index++];
+            }
+            return NULL;
+        }
+
+        return (FDIRServerDentry *)uniq_skiplist_next(&iterator->it);
+    }
+
+    static inline int dentry_children_count(FDIRDentryChildren *children)
+    {
+        return (children != NULL) ? children->count : 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
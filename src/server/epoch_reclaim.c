@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "epoch_reclaim.h"
+
+FDIREpochReclaimVars g_epoch_reclaim_vars = {0, NULL};
+
+FDIREpochReader *epoch_reclaim_alloc_reader()
+{
+    FDIREpochReader *reader;
+    FDIREpochReader *head;
+
+    reader = (FDIREpochReader *)fc_malloc(sizeof(FDIREpochReader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    memset(reader, 0, sizeof(FDIREpochReader));
+
+    do {
+        head = g_epoch_reclaim_vars.readers;
+        reader->next = head;
+    } while (!__sync_bool_compare_and_swap(&g_epoch_reclaim_vars.
+                readers, head, reader));
+    return reader;
+}
+
+int64_t epoch_reclaim_try_advance()
+{
+    FDIREpochReader *reader;
+    int64_t epoch;
+    int prev;
+
+    epoch = __sync_add_and_fetch(&g_epoch_reclaim_vars.current, 0);
+    prev = (epoch + FDIR_EPOCH_SLOT_COUNT - 1) % FDIR_EPOCH_SLOT_COUNT;
+    for (reader=g_epoch_reclaim_vars.readers; reader!=NULL;
+            reader=reader->next)
+    {
+        if (reader->counts[prev] != 0) {
+            return epoch;
+        }
+    }
+
+    //the other thread maybe advanced already
+    if (__sync_bool_compare_and_swap(&g_epoch_reclaim_vars.
+                current, epoch, epoch + 1))
+    {
+        return epoch + 1;
+    } else {
+        return __sync_add_and_fetch(&g_epoch_reclaim_vars.current, 0);
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//epoch_reclaim.h
+
+#ifndef _FDIR_EPOCH_RECLAIM_H
+#define _FDIR_EPOCH_RECLAIM_H
+
+#include "server_types.h"
+
+/* epoch based memory reclamation for the lock-free readers:
+ *
+ * the reader threads (the network threads and the data threads) enter
+ * the current epoch before accessing the dentries and leave after done,
+ * the global epoch advances only when no reader in the previous epoch,
+ * so the objects retired in epoch E can be freed when the global epoch
+ * reaches E + 2.
+ */
+
+#define FDIR_EPOCH_SLOT_COUNT   3
+#define FDIR_EPOCH_NONE        -1
+
+typedef struct fdir_epoch_reader {
+    volatile int64_t counts[FDIR_EPOCH_SLOT_COUNT]; //active sections by epoch
+    struct fdir_epoch_reader *next;
+} FDIREpochReader;
+
+typedef struct fdir_epoch_reclaim_vars {
+    volatile int64_t current;
+    FDIREpochReader * volatile readers;
+} FDIREpochReclaimVars;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern FDIREpochReclaimVars g_epoch_reclaim_vars;
+
+    //the reader never unregisters
+    FDIREpochReader *epoch_reclaim_alloc_reader();
+
+    //return the epoch entered
+    static inline int64_t epoch_reclaim_enter(FDIREpochReader *reader)
+    {
+        int64_t epoch;
+
+        while (1) {
+            epoch = g_epoch_reclaim_vars.current;
+            __sync_add_and_fetch(reader->counts +
+                    epoch % FDIR_EPOCH_SLOT_COUNT, 1);
+            if (epoch == g_epoch_reclaim_vars.current) {
+                return epoch;
+            }
+
+            //the epoch advanced, retry
+            __sync_sub_and_fetch(reader->counts +
+                    epoch % FDIR_EPOCH_SLOT_COUNT, 1);
+        }
+    }
+
+    static inline void epoch_reclaim_leave(FDIREpochReader *reader,
+            const int64_t epoch)
+    {
+        __sync_sub_and_fetch(reader->counts +
+                epoch % FDIR_EPOCH_SLOT_COUNT, 1);
+    }
+
+    //the epoch for the retired objects
+    static inline int64_t epoch_reclaim_current()
+    {
+        return __sync_add_and_fetch(&g_epoch_reclaim_vars.current, 0);
+    }
+
+    //try to advance the global epoch, return the current epoch
+    int64_t epoch_reclaim_try_advance();
+
+    static inline bool epoch_reclaim_can_free(const int64_t retired_epoch,
+            const int64_t current_epoch)
+    {
+        return current_epoch >= retired_epoch + 2;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -47,7 +47,11 @@
 #include "inode_generator.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "epoch_reclaim.h"
 #include "data_loader.h"
+#include "data_checkpoint.h"
+#include "version_waiter.h"
+#include "load_stat.h"
 #include "cluster_info.h"
 #include "service_handler.h"
 #include "cluster_handler.h"
@@ -61,6 +65,7 @@ int init_nio_task(struct fast_task_info *task)
     task->connect_timeout = SF_G_CONNECT_TIMEOUT;
     task->network_timeout = SF_G_NETWORK_TIMEOUT;
     FC_INIT_LIST_HEAD(FTASK_HEAD_PTR);
+    TASK_EPOCH = FDIR_EPOCH_NONE;
     return 0;
 }
 
@@ -160,10 +165,26 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=data_checkpoint_init()) != 0) {
+            break;
+        }
+
         if ((result=server_load_data()) != 0) {
             break;
         }
 
+        if ((result=data_checkpoint_setup_schedule()) != 0) {
+            break;
+        }
+
+        if ((result=version_waiter_init()) != 0) {
+            break;
+        }
+
+        if ((result=load_stat_init()) != 0) {
+            break;
+        }
+
         fdir_proto_init();
         //sched_print_all_entries();
 
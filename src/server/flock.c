@@ -205,7 +205,7 @@ static inline FLockTask *get_conflict_flock_task(FLockTask *ftask,
     FLockTask *wait;
     int conflict_regions;
 
-    if ((found=get_conflict_ftask_by_region(ftask->dentry->flock_entry,
+    if ((found=get_conflict_ftask_by_region(ftask->entry,
                     ftask, check_waiting, &conflict_regions)) == NULL)
     {
         if (ftask->type == LOCK_EX) {
@@ -217,8 +217,7 @@ static inline FLockTask *get_conflict_flock_task(FLockTask *ftask,
         return found;
     }
 
-    fc_list_for_each_entry(wait, &ftask->dentry->
-            flock_entry->waiting_tasks, flink)
+    fc_list_for_each_entry(wait, &ftask->entry->waiting_tasks, flink)
     {
         if (is_region_overlap(ftask->region, wait->region)) {
             *global_conflict = true;
@@ -240,7 +239,7 @@ int flock_apply(FLockContext *ctx, const int64_t offset,
     FLockTask *holder;
     bool global_conflict;
 
-    if ((ftask->region=get_region(ctx, ftask->dentry->flock_entry,
+    if ((ftask->region=get_region(ctx, ftask->entry,
                     offset, length)) == NULL)
     {
         return ENOMEM;
@@ -261,8 +260,7 @@ int flock_apply(FLockContext *ctx, const int64_t offset,
 
     if (global_conflict) {
         ftask->which_queue = FDIR_FLOCK_TASK_IN_GLOBAL_WAITING_QUEUE;
-        fc_list_add_tail(&ftask->flink, &ftask->dentry->
-                flock_entry->waiting_tasks);
+        fc_list_add_tail(&ftask->flink, &ftask->entry->waiting_tasks);
     } else {
         ftask->which_queue = FDIR_FLOCK_TASK_IN_REGION_WAITING_QUEUE;
         fc_list_add_tail(&ftask->flink, &ftask->region->waiting);
@@ -381,7 +379,7 @@ int sys_lock_release(FLockEntry *entry, SysLockTask *sys_task,
     }
 
     if (callback != NULL) {
-        callback(sys_task->dentry, args);
+        callback(sys_task->inode, args);
     }
 
     if ((wait=fc_list_first_entry(&entry->sys_lock.waiting,
@@ -30,7 +30,7 @@
 #define FDIR_SYS_TASK_STATUS_LOCKED    1
 #define FDIR_SYS_TASK_STATUS_WAITING   2
 
-typedef void (*sys_lock_release_callback)(FDIRServerDentry *dentry, void *args);
+typedef void (*sys_lock_release_callback)(const int64_t inode, void *args);
 
 struct flock_region;
 typedef struct flock_owner {
@@ -45,7 +45,8 @@ typedef struct flock_task {
     FlockOwner owner;
     struct flock_region *region;
     struct fast_task_info *task;
-    FDIRServerDentry *dentry;
+    int64_t inode;
+    struct flock_entry *entry;  //outlives the dentry, never freed
     struct fc_list_head flink;  //for flock queue
     struct fc_list_head clink;  //for connection double link chain
 } FLockTask;
@@ -53,7 +54,8 @@ typedef struct flock_task {
 typedef struct sys_lock_task {
     short status;
     struct fast_task_info *task;
-    FDIRServerDentry *dentry;
+    int64_t inode;
+    struct flock_entry *entry;
     struct fc_list_head dlink;
 } SysLockTask;
 
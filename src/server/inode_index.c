@@ -26,6 +26,8 @@
 typedef struct {
     pthread_mutex_t lock;
     FLockContext flock_ctx;
+    volatile int rehash_seq;  //odd during the buckets migration
+    int64_t migrate_index;    //the next bucket of the old table to migrate
 } InodeSharedContext;
 
 typedef struct {
@@ -34,13 +36,36 @@ typedef struct {
 } InodeSharedContextArray;
 
 typedef struct {
-    int64_t count;
     int64_t capacity;
     FDIRServerDentry **buckets;
+} InodeBucketArray;
+
+/* the state is immutable after published,
+ * the old buckets are not NULL during resizing
+ */
+typedef struct {
+    InodeBucketArray current;
+    InodeBucketArray old;
+} InodeHashtableState;
+
+typedef struct {
+    volatile int64_t count;
+    InodeHashtableState * volatile state;
+    struct {
+        pthread_mutex_t lock;  //for resize start
+        int64_t threshold;     //grow when count exceeds it
+        volatile int done_count;  //the shared contexts migrate done
+    } resize;
 } InodeHashtable;
 
+//the old buckets migrated by each update within the shared context
+#define INODE_HT_MIGRATE_BUCKETS_ONCE  4
+
+//the old buckets migrated by each idle pass within the shared context
+#define INODE_HT_MIGRATE_BUCKETS_IDLE  1024
+
 static InodeSharedContextArray inode_shared_ctx_array = {0, NULL};
-static InodeHashtable inode_hashtable = {0, 0, NULL};
+static InodeHashtable inode_hashtable;
 
 static int init_inode_shared_ctx_array()
 {
@@ -55,6 +80,7 @@ static int init_inode_shared_ctx_array()
     if (inode_shared_ctx_array.contexts == NULL) {
         return ENOMEM;
     }
+    memset(inode_shared_ctx_array.contexts, 0, bytes);
 
     end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
     for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
@@ -73,18 +99,57 @@ static int init_inode_shared_ctx_array()
     return 0;
 }
 
-static int init_inode_hashtable()
+static int alloc_bucket_array(InodeBucketArray *array, const int64_t capacity)
 {
     int64_t bytes;
 
-    inode_hashtable.capacity = INODE_HASHTABLE_CAPACITY;
-    bytes = sizeof(FDIRServerDentry *) * inode_hashtable.capacity;
-    inode_hashtable.buckets = (FDIRServerDentry **)fc_malloc(bytes);
-    if (inode_hashtable.buckets == NULL) {
+    bytes = sizeof(FDIRServerDentry *) * capacity;
+    array->buckets = (FDIRServerDentry **)fc_malloc(bytes);
+    if (array->buckets == NULL) {
+        return ENOMEM;
+    }
+    memset(array->buckets, 0, bytes);
+    array->capacity = capacity;
+    return 0;
+}
+
+static inline int64_t calc_resize_threshold(const int64_t capacity)
+{
+    if (INODE_HASHTABLE_MAX_LOAD_FACTOR <= 0.00) {
+        return INT64_MAX;
+    }
+    return (int64_t)(capacity * INODE_HASHTABLE_MAX_LOAD_FACTOR);
+}
+
+static int init_inode_hashtable()
+{
+    InodeHashtableState *state;
+    int64_t capacity;
+    int result;
+
+    if ((result=init_pthread_lock(&inode_hashtable.resize.lock)) != 0) {
+        return result;
+    }
+
+    state = (InodeHashtableState *)fc_malloc(sizeof(InodeHashtableState));
+    if (state == NULL) {
         return ENOMEM;
     }
-    memset(inode_hashtable.buckets, 0, bytes);
+    memset(state, 0, sizeof(InodeHashtableState));
+
+    /* the capacity must be multiple of the shared locks count,
+     * so the buckets split from the same bucket share the same lock
+     */
+    capacity = (INODE_HASHTABLE_CAPACITY + inode_shared_ctx_array.count - 1)
+        / inode_shared_ctx_array.count * inode_shared_ctx_array.count;
+    if ((result=alloc_bucket_array(&state->current, capacity)) != 0) {
+        return result;
+    }
 
+    inode_hashtable.count = 0;
+    inode_hashtable.resize.threshold = calc_resize_threshold(capacity);
+    inode_hashtable.resize.done_count = 0;
+    inode_hashtable.state = state;
     return 0;
 }
 
@@ -141,17 +206,35 @@ static FDIRServerDentry *find_dentry_for_update(FDIRServerDentry **bucket,
     return NULL;
 }
 
+/* the readers traverse the chain without lock:
+ * 1. the writers are serialized by the shared context lock
+ * 2. a dentry is published after its ht_next is set
+ * 3. the ht_next of a removed dentry is kept, and the dentry is freed
+ *    by the delay free queue of the data thread
+ * 4. the readers retry when the buckets of the shared context
+ *    are migrated during the lookup
+ */
+#define INODE_HT_LOAD(ptr) (*((FDIRServerDentry * volatile *)&(ptr)))
+
+#define INODE_HT_PUBLISH(ptr, dentry) \
+    do { \
+        __sync_synchronize();  \
+        INODE_HT_LOAD(ptr) = dentry; \
+    } while (0)
+
+#define INODE_HT_BUCKET(array, inode) \
+    ((array)->buckets + ((uint64_t)(inode)) % (array)->capacity)
+
+#define INODE_SHARED_CTX(inode) (inode_shared_ctx_array.contexts + \
+        ((uint64_t)(inode)) % inode_shared_ctx_array.count)
+
 static FDIRServerDentry *find_inode_entry(FDIRServerDentry **bucket,
         const int64_t inode)
 {
     int64_t cmpr;
     FDIRServerDentry *dentry;
 
-    if (*bucket == NULL) {
-        return NULL;
-    }
-
-    dentry = *bucket;
+    dentry = INODE_HT_LOAD(*bucket);
     while (dentry != NULL) {
         cmpr = inode - dentry->inode;
         if (cmpr == 0) {
@@ -160,44 +243,256 @@ static FDIRServerDentry *find_inode_entry(FDIRServerDentry **bucket,
             break;
         }
 
-        dentry = dentry->ht_next;
+        dentry = INODE_HT_LOAD(dentry->ht_next);
     }
 
     return NULL;
 }
 
-#define SET_INODE_HASHTABLE_CTX(inode)  \
-    uint64_t bucket_index;       \
-    InodeSharedContext *ctx;    \
-    do {  \
-        bucket_index = ((uint64_t)inode) % inode_hashtable.capacity;  \
-        ctx = inode_shared_ctx_array.contexts + bucket_index %    \
-            inode_shared_ctx_array.count;   \
-    } while (0)
+static inline FDIRServerDentry *find_inode_in_state(
+        InodeHashtableState *state, const int64_t inode)
+{
+    FDIRServerDentry *dentry;
 
+    dentry = find_inode_entry(INODE_HT_BUCKET(&state->current, inode), inode);
+    if (dentry == NULL && state->old.buckets != NULL) {
+        dentry = find_inode_entry(INODE_HT_BUCKET(&state->old, inode), inode);
+    }
+    return dentry;
+}
 
-#define SET_INODE_HT_BUCKET_AND_CTX(inode)  \
-    FDIRServerDentry **bucket;  \
-    SET_INODE_HASHTABLE_CTX(inode);  \
-    do {  \
-        bucket = inode_hashtable.buckets + bucket_index;   \
-    } while (0)
+/* split the old bucket into the two buckets of the new table,
+ * the new buckets are empty because the old bucket is migrated
+ * before any insertion into them
+ */
+static void migrate_bucket(InodeSharedContext *ctx,
+        InodeHashtableState *state, FDIRServerDentry **old_bucket)
+{
+    FDIRServerDentry *dentry;
+    FDIRServerDentry *next;
+    FDIRServerDentry **bucket;
+    FDIRServerDentry **tails[2];
+    FDIRServerDentry **new_buckets[2];
+    int64_t index;
+    int i;
+
+    if (*old_bucket == NULL) {
+        return;
+    }
+
+    index = old_bucket - state->old.buckets;
+    new_buckets[0] = state->current.buckets + index;
+    new_buckets[1] = state->current.buckets + index + state->old.capacity;
+    tails[0] = new_buckets[0];
+    tails[1] = new_buckets[1];
+
+    __sync_add_and_fetch(&ctx->rehash_seq, 1);
+    dentry = *old_bucket;
+    while (dentry != NULL) {
+        next = dentry->ht_next;
+        bucket = INODE_HT_BUCKET(&state->current, dentry->inode);
+        i = (bucket == new_buckets[0]) ? 0 : 1;
+        dentry->ht_next = NULL;
+        *tails[i] = dentry;
+        tails[i] = &dentry->ht_next;
+        dentry = next;
+    }
+    INODE_HT_LOAD(*old_bucket) = NULL;
+    __sync_add_and_fetch(&ctx->rehash_seq, 1);
+}
+
+static void finish_resize(InodeHashtableState *state)
+{
+    InodeHashtableState *new_state;
+
+    new_state = (InodeHashtableState *)fc_malloc(sizeof(InodeHashtableState));
+    if (new_state == NULL) {
+        return;  //retry by the next update
+    }
+
+    new_state->current = state->current;
+    new_state->old.capacity = 0;
+    new_state->old.buckets = NULL;
+    if (!__sync_bool_compare_and_swap(&inode_hashtable.state,
+                state, new_state))
+    {
+        free(new_state);  //done by other thread
+        return;
+    }
+
+    //the lockless readers may still use the old table
+    server_add_to_delay_free_queue(&g_data_thread_vars.thread_array.
+            contexts[0].delay_free_context, state->old.buckets,
+            free);
+    server_add_to_delay_free_queue(&g_data_thread_vars.thread_array.
+            contexts[0].delay_free_context, state,
+            free);
+
+    logInfo("file: "__FILE__", line: %d, "
+            "inode hashtable resize done, capacity: %"PRId64", "
+            "inode count: %"PRId64, __LINE__, new_state->current.capacity,
+            __sync_add_and_fetch(&inode_hashtable.count, 0));
+}
+
+/* migrate the next buckets of the shared context,
+ * caller must hold the lock of the context
+ */
+static void migrate_next_buckets(InodeSharedContext *ctx,
+        InodeHashtableState *state, const int bucket_count)
+{
+    int64_t end_index;
+
+    if (ctx->migrate_index < state->old.capacity) {
+        end_index = ctx->migrate_index + inode_shared_ctx_array.count *
+            bucket_count;
+        while (ctx->migrate_index < end_index && ctx->migrate_index <
+                state->old.capacity)
+        {
+            migrate_bucket(ctx, state, state->old.buckets +
+                    ctx->migrate_index);
+            ctx->migrate_index += inode_shared_ctx_array.count;
+        }
+
+        if (ctx->migrate_index >= state->old.capacity &&
+                __sync_add_and_fetch(&inode_hashtable.resize.done_count,
+                    1) == inode_shared_ctx_array.count)
+        {
+            finish_resize(state);
+        }
+    } else if (inode_hashtable.resize.done_count ==
+            inode_shared_ctx_array.count)
+    {
+        finish_resize(state);  //retry
+    }
+}
+
+/* migrate the old bucket of the inode and some of the other buckets
+ * within the shared context, caller must hold the lock of the context
+ */
+static FDIRServerDentry **get_bucket_for_update(InodeSharedContext *ctx,
+        const int64_t inode)
+{
+    InodeHashtableState *state;
+
+    state = inode_hashtable.state;
+    if (state->old.buckets == NULL) {
+        return INODE_HT_BUCKET(&state->current, inode);
+    }
+
+    if (ctx->migrate_index < state->old.capacity) {
+        migrate_bucket(ctx, state, INODE_HT_BUCKET(&state->old, inode));
+    }
+    migrate_next_buckets(ctx, state, INODE_HT_MIGRATE_BUCKETS_ONCE);
+    return INODE_HT_BUCKET(&state->current, inode);
+}
+
+bool inode_index_resizing()
+{
+    return inode_hashtable.state->old.buckets != NULL;
+}
+
+/* the shared contexts without updates never finish their migration,
+ * so the idle data threads migrate the buckets of all contexts.
+ * the busy contexts are skipped because their updates migrate
+ */
+void inode_index_migrate_idle()
+{
+    InodeHashtableState *state;
+    InodeSharedContext *ctx;
+    InodeSharedContext *end;
+
+    if (!inode_index_resizing()) {
+        return;
+    }
+
+    end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+    for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
+        if (pthread_mutex_trylock(&ctx->lock) != 0) {
+            continue;
+        }
+
+        state = inode_hashtable.state;
+        if (state->old.buckets != NULL) {
+            migrate_next_buckets(ctx, state,
+                    INODE_HT_MIGRATE_BUCKETS_IDLE);
+        }
+        PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+    }
+}
+
+static void check_start_resize()
+{
+    InodeHashtableState *state;
+    InodeHashtableState *new_state;
+    InodeSharedContext *ctx;
+    InodeSharedContext *end;
+    int64_t capacity;
+
+    PTHREAD_MUTEX_LOCK(&inode_hashtable.resize.lock);
+    state = inode_hashtable.state;
+    do {
+        if (state->old.buckets != NULL || inode_hashtable.count <=
+                inode_hashtable.resize.threshold)
+        {
+            break;
+        }
+
+        new_state = (InodeHashtableState *)fc_malloc(
+                sizeof(InodeHashtableState));
+        if (new_state == NULL) {
+            break;
+        }
+
+        capacity = state->current.capacity * 2;
+        if (alloc_bucket_array(&new_state->current, capacity) != 0) {
+            free(new_state);
+            inode_hashtable.resize.threshold = INT64_MAX;  //give up
+            break;
+        }
+        new_state->old = state->current;
+
+        end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+        for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
+            PTHREAD_MUTEX_LOCK(&ctx->lock);
+            ctx->migrate_index = ctx - inode_shared_ctx_array.contexts;
+            PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+        }
 
+        inode_hashtable.resize.done_count = 0;
+        inode_hashtable.resize.threshold = calc_resize_threshold(capacity);
+        __sync_synchronize();
+        inode_hashtable.state = new_state;
+
+        //the state is referenced by the migrate operations only
+        server_add_to_delay_free_queue(&g_data_thread_vars.thread_array.
+                contexts[0].delay_free_context, state,
+                free);
+
+        logInfo("file: "__FILE__", line: %d, "
+                "inode count: %"PRId64", resize inode hashtable "
+                "from %"PRId64" to %"PRId64, __LINE__,
+                inode_hashtable.count, state->current.capacity, capacity);
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&inode_hashtable.resize.lock);
+}
 
 int inode_index_add_dentry(FDIRServerDentry *dentry)
 {
     int result;
+    InodeSharedContext *ctx;
+    FDIRServerDentry **bucket;
     FDIRServerDentry *previous;
 
-    SET_INODE_HT_BUCKET_AND_CTX(dentry->inode);
+    ctx = INODE_SHARED_CTX(dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
+    bucket = get_bucket_for_update(ctx, dentry->inode);
     if (find_dentry_for_update(bucket, dentry, &previous) == NULL) {
         if (previous == NULL) {
             dentry->ht_next = *bucket;
-            *bucket = dentry;
+            INODE_HT_PUBLISH(*bucket, dentry);
         } else {
             dentry->ht_next = previous->ht_next;
-            previous->ht_next = dentry;
+            INODE_HT_PUBLISH(previous->ht_next, dentry);
         }
         result = 0;
     } else {
@@ -205,22 +500,31 @@ int inode_index_add_dentry(FDIRServerDentry *dentry)
     }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
+    if (result == 0 && __sync_add_and_fetch(&inode_hashtable.count, 1) >
+            inode_hashtable.resize.threshold)
+    {
+        check_start_resize();
+    }
+
     return result;
 }
 
 int inode_index_del_dentry(FDIRServerDentry *dentry)
 {
     int result;
+    InodeSharedContext *ctx;
+    FDIRServerDentry **bucket;
     FDIRServerDentry *previous;
     FDIRServerDentry *deleted;
 
-    SET_INODE_HT_BUCKET_AND_CTX(dentry->inode);
+    ctx = INODE_SHARED_CTX(dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
+    bucket = get_bucket_for_update(ctx, dentry->inode);
     if ((deleted=find_dentry_for_update(bucket, dentry, &previous)) != NULL) {
         if (previous == NULL) {
-            *bucket = (*bucket)->ht_next;
+            INODE_HT_LOAD(*bucket) = deleted->ht_next;
         } else {
-            previous->ht_next = deleted->ht_next;
+            INODE_HT_LOAD(previous->ht_next) = deleted->ht_next;
         }
         result = 0;
     } else {
@@ -228,19 +532,77 @@ int inode_index_del_dentry(FDIRServerDentry *dentry)
     }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
+    if (result == 0) {
+        __sync_sub_and_fetch(&inode_hashtable.count, 1);
+    }
     return result;
 }
 
+static inline FDIRServerDentry *find_inode_for_update(
+        InodeSharedContext *ctx, const int64_t inode)
+{
+    return find_inode_entry(get_bucket_for_update(ctx, inode), inode);
+}
+
 FDIRServerDentry *inode_index_get_dentry(const int64_t inode)
 {
+    InodeSharedContext *ctx;
     FDIRServerDentry *dentry;
+    int seq;
+
+    ctx = INODE_SHARED_CTX(inode);
+    while (1) {
+        seq = __sync_add_and_fetch(&ctx->rehash_seq, 0);
+        if ((seq & 1) != 0) {  //migrating
+            PTHREAD_MUTEX_LOCK(&ctx->lock);
+            dentry = find_inode_in_state(inode_hashtable.state, inode);
+            PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+            return dentry;
+        }
 
-    SET_INODE_HT_BUCKET_AND_CTX(inode);
-    PTHREAD_MUTEX_LOCK(&ctx->lock);
-    dentry = find_inode_entry(bucket, inode);
-    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+        dentry = find_inode_in_state(inode_hashtable.state, inode);
+        if (__sync_add_and_fetch(&ctx->rehash_seq, 0) == seq) {
+            return dentry;
+        }
+    }
+}
 
-    return dentry;
+void inode_index_get_stat(FDIRInodeIndexStat *stat)
+{
+    InodeHashtableState *state;
+    FDIRServerDentry **bucket;
+    FDIRServerDentry **end;
+    FDIRServerDentry *dentry;
+    InodeBucketArray *arrays[2];
+    int chain_length;
+    int i;
+
+    state = inode_hashtable.state;
+    stat->capacity = state->current.capacity;
+    stat->count = __sync_add_and_fetch(&inode_hashtable.count, 0);
+    stat->resizing = (state->old.buckets != NULL);
+    stat->max_chain_length = 0;
+
+    arrays[0] = &state->current;
+    arrays[1] = &state->old;
+    for (i=0; i<2; i++) {
+        if (arrays[i]->buckets == NULL) {
+            continue;
+        }
+
+        end = arrays[i]->buckets + arrays[i]->capacity;
+        for (bucket=arrays[i]->buckets; bucket<end; bucket++) {
+            chain_length = 0;
+            dentry = INODE_HT_LOAD(*bucket);
+            while (dentry != NULL) {
+                chain_length++;
+                dentry = INODE_HT_LOAD(dentry->ht_next);
+            }
+            if (chain_length > stat->max_chain_length) {
+                stat->max_chain_length = chain_length;
+            }
+        }
+    }
 }
 
 FDIRServerDentry *inode_index_get_dentry_by_pname(
@@ -258,24 +620,35 @@ FDIRServerDentry *inode_index_get_dentry_by_pname(
 }
 
 FDIRServerDentry *inode_index_check_set_dentry_size(
-        const FDIRSetDEntrySizeInfo *dsize,
-        const bool need_lock, int *modified_flags)
+        const FDIRSetDEntrySizeInfo *dsize, const bool need_lock,
+        int *modified_flags, int *result)
 {
+    InodeSharedContext *ctx;
     FDIRServerDentry *dentry;
     int flags;
 
-    SET_INODE_HT_BUCKET_AND_CTX(dsize->inode);
+    ctx = INODE_SHARED_CTX(dsize->inode);
     flags = dsize->flags;
     *modified_flags = 0;
     if (need_lock) {
         PTHREAD_MUTEX_LOCK(&ctx->lock);
+        dentry = find_inode_for_update(ctx, dsize->inode);
+    } else {
+        dentry = inode_index_get_dentry(dsize->inode);
     }
-    dentry = find_inode_entry(bucket, dsize->inode);
-    if (dentry != NULL) {
+    if (dentry == NULL) {
+        *result = ENOENT;
+    } else if ((flags & FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE) &&
+            (*result=dentry_check_space_quota(dentry,
+                dsize->file_size)) != 0)
+    {
+        dentry = NULL;
+    } else {
+        *result = 0;
         if ((flags & FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE)) {
             if (dsize->force || (dentry->stat.size < dsize->file_size)) {
                 if (dentry->stat.size != dsize->file_size) {
-                    dentry->stat.size = dsize->file_size;
+                    dentry_usage_set_size(dentry, dsize->file_size);
                     *modified_flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE;
                 }
             }
@@ -340,7 +713,7 @@ static void update_dentry(FDIRServerDentry *dentry,
         dentry->stat.gid = record->stat.gid;
     }
     if (record->options.size) {
-        dentry->stat.size = record->stat.size;
+        dentry_usage_set_size(dentry, record->stat.size);
     }
     if (record->options.space_end) {
         dentry->stat.space_end = record->stat.space_end;
@@ -350,45 +723,158 @@ static void update_dentry(FDIRServerDentry *dentry,
     }
 }
 
-FDIRServerDentry *inode_index_update_dentry(
-        const FDIRBinlogRecord *record)
+FDIRServerDentry *inode_index_update_dentry_ex(
+        const FDIRBinlogRecord *record, const bool check_quota,
+        int *result)
 {
+    InodeSharedContext *ctx;
     FDIRServerDentry *dentry;
 
-    SET_INODE_HT_BUCKET_AND_CTX(record->inode);
+    ctx = INODE_SHARED_CTX(record->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    dentry = find_inode_entry(bucket, record->inode);
-    if (dentry != NULL) {
+    dentry = find_inode_for_update(ctx, record->inode);
+    if (dentry == NULL) {
+        *result = ENOENT;
+    } else if (check_quota && record->options.size &&
+            (*result=dentry_check_space_quota(dentry,
+                record->stat.size)) != 0)
+    {
+        dentry = NULL;
+    } else {
         update_dentry(dentry, record);
+        *result = 0;
     }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
     return dentry;
 }
 
+void inode_index_lock(const int64_t inode)
+{
+    PTHREAD_MUTEX_LOCK(&INODE_SHARED_CTX(inode)->lock);
+}
+
+void inode_index_unlock(const int64_t inode)
+{
+    PTHREAD_MUTEX_UNLOCK(&INODE_SHARED_CTX(inode)->lock);
+}
+
+//the distinct shared contexts of the inodes in the lock order
+static int get_shared_contexts(const int64_t *inodes, const int count,
+        InodeSharedContext **contexts)
+{
+    InodeSharedContext *ctx;
+    int ctx_count;
+    int i;
+    int k;
+
+    ctx_count = 0;
+    for (i=0; i<count; i++) {
+        ctx = INODE_SHARED_CTX(inodes[i]);
+        for (k=ctx_count; k > 0 && contexts[k - 1] > ctx; k--) {
+        }
+        if (k > 0 && contexts[k - 1] == ctx) {
+            continue;
+        }
+
+        memmove(contexts + k + 1, contexts + k,
+                sizeof(InodeSharedContext *) * (ctx_count - k));
+        contexts[k] = ctx;
+        ctx_count++;
+    }
+
+    return ctx_count;
+}
+
+void inode_index_lock_inodes(const int64_t *inodes, const int count)
+{
+    InodeSharedContext *contexts[INODE_INDEX_LOCK_INODES_MAX];
+    int ctx_count;
+    int i;
+
+    //the same order as inode_index_lock_all
+    ctx_count = get_shared_contexts(inodes, count, contexts);
+    for (i=0; i<ctx_count; i++) {
+        PTHREAD_MUTEX_LOCK(&contexts[i]->lock);
+    }
+}
+
+void inode_index_unlock_inodes(const int64_t *inodes, const int count)
+{
+    InodeSharedContext *contexts[INODE_INDEX_LOCK_INODES_MAX];
+    int ctx_count;
+
+    ctx_count = get_shared_contexts(inodes, count, contexts);
+    while (--ctx_count >= 0) {
+        PTHREAD_MUTEX_UNLOCK(&contexts[ctx_count]->lock);
+    }
+}
+
+void inode_index_lock_all()
+{
+    InodeSharedContext *ctx;
+    InodeSharedContext *end;
+
+    end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+    for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
+        PTHREAD_MUTEX_LOCK(&ctx->lock);
+    }
+}
+
+void inode_index_unlock_all()
+{
+    InodeSharedContext *ctx;
+
+    ctx = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+    while (--ctx >= inode_shared_ctx_array.contexts) {
+        PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+    }
+}
+
+#define DENTRY_FLOCK_ENTRY(dentry) \
+    ((dentry)->extra != NULL ? (dentry)->extra->flock_entry : NULL)
+
+//the extra of the regular file and dir is allocated for the first lock
+static inline int check_alloc_flock_entry(InodeSharedContext *ctx,
+        FDIRServerDentry *dentry)
+{
+    if (dentry->extra == NULL) {
+        if ((dentry->extra=dentry_alloc_extra()) == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if (dentry->extra->flock_entry == NULL) {
+        if ((dentry->extra->flock_entry=flock_alloc_entry(
+                        &ctx->flock_ctx)) == NULL)
+        {
+            return ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
 FLockTask *inode_index_flock_apply(const int64_t inode, const short type,
         const int64_t offset, const int64_t length, const bool block,
         const FlockOwner *owner, struct fast_task_info *task, int *result)
 {
+    InodeSharedContext *ctx;
     FDIRServerDentry *dentry;
     FLockTask *ftask;
 
-    SET_INODE_HT_BUCKET_AND_CTX(inode);
+    ctx = INODE_SHARED_CTX(inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
     do {
-        if ((dentry=find_inode_entry(bucket, inode)) == NULL) {
+        if ((dentry=find_inode_for_update(ctx, inode)) == NULL) {
             *result = ENOENT;
             ftask = NULL;
             break;
         }
 
-        if (dentry->flock_entry == NULL) {
-            dentry->flock_entry = flock_alloc_entry(&ctx->flock_ctx);
-            if (dentry->flock_entry == NULL) {
-                *result = ENOMEM;
-                ftask = NULL;
-                break;
-            }
+        if ((*result=check_alloc_flock_entry(ctx, dentry)) != 0) {
+            ftask = NULL;
+            break;
         }
 
         if ((ftask=flock_alloc_ftask(&ctx->flock_ctx)) == NULL) {
@@ -399,7 +885,8 @@ FLockTask *inode_index_flock_apply(const int64_t inode, const short type,
 
         ftask->type = type;
         ftask->owner = *owner;
-        ftask->dentry = dentry;
+        ftask->inode = inode;
+        ftask->entry = dentry->extra->flock_entry;
         ftask->task = task;
         *result = flock_apply(&ctx->flock_ctx, offset, length, ftask, block);
         if (!(*result == 0 || *result == EINPROGRESS)) {
@@ -414,20 +901,23 @@ FLockTask *inode_index_flock_apply(const int64_t inode, const short type,
 
 int inode_index_flock_getlk(const int64_t inode, FLockTask *ftask)
 {
+    InodeSharedContext *ctx;
+    FDIRServerDentry *dentry;
     int result;
 
-    SET_INODE_HT_BUCKET_AND_CTX(inode);
+    ctx = INODE_SHARED_CTX(inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
     do {
-        if ((ftask->dentry=find_inode_entry(bucket, inode)) == NULL) {
+        if ((dentry=find_inode_for_update(ctx, inode)) == NULL) {
             result = ENOENT;
             break;
         }
 
-        if (ftask->dentry->flock_entry == NULL) {
+        if ((ftask->entry=DENTRY_FLOCK_ENTRY(dentry)) == NULL) {
             result = ENOENT;
             break;
         }
+        ftask->inode = inode;
 
         result = flock_get_conflict_lock(&ctx->flock_ctx, ftask);
     } while (0);
@@ -437,11 +927,11 @@ int inode_index_flock_getlk(const int64_t inode, FLockTask *ftask)
 
 void inode_index_flock_release(FLockTask *ftask)
 {
-    SET_INODE_HASHTABLE_CTX(ftask->dentry->inode);
+    InodeSharedContext *ctx;
+
+    ctx = INODE_SHARED_CTX(ftask->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if (ftask->dentry->flock_entry != NULL) {
-        flock_release(&ctx->flock_ctx, ftask->dentry->flock_entry, ftask);
-    }
+    flock_release(&ctx->flock_ctx, ftask->entry, ftask);
     flock_free_ftask(&ctx->flock_ctx, ftask);
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 }
@@ -449,25 +939,22 @@ void inode_index_flock_release(FLockTask *ftask)
 SysLockTask *inode_index_sys_lock_apply(const int64_t inode, const bool block,
         struct fast_task_info *task, int *result)
 {
+    InodeSharedContext *ctx;
     FDIRServerDentry *dentry;
     SysLockTask  *sys_task;
 
-    SET_INODE_HT_BUCKET_AND_CTX(inode);
+    ctx = INODE_SHARED_CTX(inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
     do {
-        if ((dentry=find_inode_entry(bucket, inode)) == NULL) {
+        if ((dentry=find_inode_for_update(ctx, inode)) == NULL) {
             *result = ENOENT;
             sys_task = NULL;
             break;
         }
 
-        if (dentry->flock_entry == NULL) {
-            dentry->flock_entry = flock_alloc_entry(&ctx->flock_ctx);
-            if (dentry->flock_entry == NULL) {
-                *result = ENOMEM;
-                sys_task = NULL;
-                break;
-            }
+        if ((*result=check_alloc_flock_entry(ctx, dentry)) != 0) {
+            sys_task = NULL;
+            break;
         }
 
         if ((sys_task=flock_alloc_sys_task(&ctx->flock_ctx)) == NULL) {
@@ -475,9 +962,11 @@ SysLockTask *inode_index_sys_lock_apply(const int64_t inode, const bool block,
             break;
         }
 
-        sys_task->dentry = dentry;
+        sys_task->inode = inode;
+        sys_task->entry = dentry->extra->flock_entry;
         sys_task->task = task;
-        *result = sys_lock_apply(dentry->flock_entry, sys_task, block);
+        *result = sys_lock_apply(dentry->extra->flock_entry,
+                sys_task, block);
         if (!(*result == 0 || *result == EINPROGRESS)) {
             flock_free_sys_task(&ctx->flock_ctx, sys_task);
             sys_task = NULL;
@@ -491,15 +980,12 @@ SysLockTask *inode_index_sys_lock_apply(const int64_t inode, const bool block,
 int inode_index_sys_lock_release_ex(SysLockTask *sys_task,
         sys_lock_release_callback callback, void *args)
 {
+    InodeSharedContext *ctx;
     int result;
-    SET_INODE_HASHTABLE_CTX(sys_task->dentry->inode);
+
+    ctx = INODE_SHARED_CTX(sys_task->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if (sys_task->dentry->flock_entry != NULL) {
-        result = sys_lock_release(sys_task->dentry->flock_entry,
-                sys_task, callback, args);
-    } else {
-        result = ENOENT;
-    }
+    result = sys_lock_release(sys_task->entry, sys_task, callback, args);
     flock_free_sys_task(&ctx->flock_ctx, sys_task);
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
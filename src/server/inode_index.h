@@ -22,6 +22,16 @@
 #include "server_types.h"
 #include "flock.h"
 
+//the max inodes locked together by inode_index_lock_inodes
+#define INODE_INDEX_LOCK_INODES_MAX  64
+
+typedef struct fdir_inode_index_stat {
+    int64_t capacity;
+    int64_t count;
+    int max_chain_length;
+    bool resizing;
+} FDIRInodeIndexStat;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,15 +45,46 @@ extern "C" {
 
     FDIRServerDentry *inode_index_get_dentry(const int64_t inode);
 
+    //walk all buckets for the max chain length, for admin only
+    void inode_index_get_stat(FDIRInodeIndexStat *stat);
+
+    bool inode_index_resizing();
+
+    //migrate the old buckets by the idle data threads during resizing
+    void inode_index_migrate_idle();
+
     FDIRServerDentry *inode_index_get_dentry_by_pname(
             const int64_t parent_inode, const string_t *name);
 
+    //result: ENOENT or EDQUOT when return NULL
     FDIRServerDentry *inode_index_check_set_dentry_size(
-            const FDIRSetDEntrySizeInfo *dsize,
-            const bool need_lock, int *modified_flags);
+            const FDIRSetDEntrySizeInfo *dsize, const bool need_lock,
+            int *modified_flags, int *result);
+
+    //check the space quota of the namespace for the master only
+    FDIRServerDentry *inode_index_update_dentry_ex(
+            const FDIRBinlogRecord *record, const bool check_quota,
+            int *result);
+
+    static inline FDIRServerDentry *inode_index_update_dentry(
+            const FDIRBinlogRecord *record)
+    {
+        int result;
+        return inode_index_update_dentry_ex(record, false, &result);
+    }
 
-    FDIRServerDentry *inode_index_update_dentry(
-            const FDIRBinlogRecord *record);
+    /* the size updates change the usage of the ancestors under the
+     * inode lock, the directory move holds the locks of the files in
+     * the small subtree, or all of the locks for the large subtree
+     */
+    void inode_index_lock(const int64_t inode);
+    void inode_index_unlock(const int64_t inode);
+    void inode_index_lock_all();
+    void inode_index_unlock_all();
+
+    //count <= INODE_INDEX_LOCK_INODES_MAX
+    void inode_index_lock_inodes(const int64_t *inodes, const int count);
+    void inode_index_unlock_inodes(const int64_t *inodes, const int count);
 
     FLockTask *inode_index_flock_apply(const int64_t inode, const short type,
             const int64_t offset, const int64_t length, const bool block,
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "server_global.h"
+#include "load_stat.h"
+
+//the bucket i for the time used in [2^i, 2^(i+1)) us
+#define LOAD_STAT_LATENCY_BUCKETS  32
+
+#define LOAD_STAT_WEIGHT_BASE  (1000 * 1000)
+
+typedef struct fdir_load_stat_context {
+    volatile int64_t counts[LOAD_STAT_LATENCY_BUCKETS];
+    int64_t last_counts[LOAD_STAT_LATENCY_BUCKETS];  //for the window
+} FDIRLoadStatContext;
+
+static FDIRLoadStatContext load_ctx;
+
+void load_stat_request_end(const int64_t time_used_us)
+{
+    int index;
+
+    __sync_sub_and_fetch(&CLUSTER_MYSELF_PTR->load.in_flight, 1);
+    if (time_used_us <= 0) {
+        return;
+    }
+
+    index = 63 - __builtin_clzll(time_used_us);
+    if (index >= LOAD_STAT_LATENCY_BUCKETS) {
+        index = LOAD_STAT_LATENCY_BUCKETS - 1;
+    }
+    __sync_add_and_fetch(load_ctx.counts + index, 1);
+}
+
+//the p99 of the requests done in the last second
+static int calc_p99_latency_func(void *args)
+{
+    int64_t deltas[LOAD_STAT_LATENCY_BUCKETS];
+    int64_t current;
+    int64_t total;
+    int64_t threshold;
+    int64_t sum;
+    int p99_latency_us;
+    int i;
+
+    total = 0;
+    for (i=0; i<LOAD_STAT_LATENCY_BUCKETS; i++) {
+        current = __sync_add_and_fetch(load_ctx.counts + i, 0);
+        deltas[i] = current - load_ctx.last_counts[i];
+        load_ctx.last_counts[i] = current;
+        total += deltas[i];
+    }
+
+    p99_latency_us = 0;
+    if (total > 0) {
+        threshold = total - total / 100;
+        sum = 0;
+        for (i=0; i<LOAD_STAT_LATENCY_BUCKETS; i++) {
+            sum += deltas[i];
+            if (sum >= threshold) {
+                p99_latency_us = (i < 30 ? (2 << i) : INT32_MAX);
+                break;
+            }
+        }
+    }
+
+    CLUSTER_MYSELF_PTR->load.p99_latency_us = p99_latency_us;
+    return 0;
+}
+
+int64_t load_stat_get_weight(FDIRClusterServerInfo *cs)
+{
+    int64_t cost;
+
+    //one unit for one request in flight, one ms or 64 versions behind
+    cost = 1 + __sync_add_and_fetch(&cs->load.in_flight, 0) +
+        cs->load.p99_latency_us / 1000 +
+        load_stat_get_lag_versions(cs) / 64 +
+        cs->replica_lag.delay_ms;
+    return LOAD_STAT_WEIGHT_BASE / cost + 1;
+}
+
+int load_stat_init()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    memset(&load_ctx, 0, sizeof(load_ctx));
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, 1, calc_p99_latency_func, NULL);
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
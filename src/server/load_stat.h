@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//load_stat.h
+
+#ifndef _LOAD_STAT_H_
+#define _LOAD_STAT_H_
+
+#include "server_global.h"
+
+/* the load of the service requests for the readable server selection,
+ * published to the other servers by the ping of the master
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int load_stat_init();
+
+static inline void load_stat_request_begin()
+{
+    __sync_add_and_fetch(&CLUSTER_MYSELF_PTR->load.in_flight, 1);
+}
+
+//the time used is 0 when the request is aborted
+void load_stat_request_end(const int64_t time_used_us);
+
+/* the selection weight, the lower for the more lagged or loaded server,
+ * the caller MUST skip the server which not active
+ */
+int64_t load_stat_get_weight(FDIRClusterServerInfo *cs);
+
+static inline int64_t load_stat_get_lag_versions(FDIRClusterServerInfo *cs)
+{
+    int64_t lag_versions;
+
+    if (cs == CLUSTER_MYSELF_PTR && MYSELF_IS_MASTER) {
+        return 0;
+    }
+
+    if (!MYSELF_IS_MASTER) {  //published by the master
+        return __sync_add_and_fetch(&cs->load.lag_versions, 0);
+    }
+
+    lag_versions = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0) -
+        __sync_add_and_fetch(&cs->replica_lag.data_version, 0);
+    return (lag_versions > 0 ? lag_versions : 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/hash.h"
+#include "name_intern.h"
+
+#define NAME_INTERN_HEADER_SIZE  ((int)offsetof(FDIRNameInternEntry, str))
+
+#define NAME_INTERN_ENTRY_PTR(str) \
+    ((FDIRNameInternEntry *)((str) - NAME_INTERN_HEADER_SIZE))
+
+#define NAME_INTERN_LOCK(table) \
+    do { \
+        if ((table)->need_lock) { \
+            PTHREAD_MUTEX_LOCK(&(table)->lock); \
+        } \
+    } while (0)
+
+#define NAME_INTERN_UNLOCK(table) \
+    do { \
+        if ((table)->need_lock) { \
+            PTHREAD_MUTEX_UNLOCK(&(table)->lock); \
+        } \
+    } while (0)
+
+static FDIRNameInternEntry **alloc_buckets(const int64_t capacity)
+{
+    FDIRNameInternEntry **buckets;
+    int64_t bytes;
+
+    bytes = sizeof(FDIRNameInternEntry *) * capacity;
+    buckets = (FDIRNameInternEntry **)fc_malloc(bytes);
+    if (buckets != NULL) {
+        memset(buckets, 0, bytes);
+    }
+    return buckets;
+}
+
+int name_intern_init(FDIRNameInternTable *table,
+        struct fast_allocator_context *acontext,
+        const int64_t capacity, const bool need_lock)
+{
+    int result;
+
+    memset(table, 0, sizeof(*table));
+    if (capacity <= 0) {
+        return 0;
+    }
+
+    if ((result=init_pthread_lock(&table->lock)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "init_pthread_lock fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    if ((table->buckets=alloc_buckets(capacity)) == NULL) {
+        return ENOMEM;
+    }
+    table->capacity = capacity;
+    table->acontext = acontext;
+    table->need_lock = need_lock;
+    return 0;
+}
+
+void name_intern_destroy(FDIRNameInternTable *table)
+{
+    if (table->buckets != NULL) {
+        free(table->buckets);
+        table->buckets = NULL;
+        pthread_mutex_destroy(&table->lock);
+    }
+}
+
+//the caller MUST hold the lock
+static void expand_buckets(FDIRNameInternTable *table)
+{
+    FDIRNameInternEntry **new_buckets;
+    FDIRNameInternEntry **old_bucket;
+    FDIRNameInternEntry **old_end;
+    FDIRNameInternEntry **new_bucket;
+    FDIRNameInternEntry *entry;
+    FDIRNameInternEntry *next;
+    int64_t new_capacity;
+
+    new_capacity = table->capacity * 2 + 1;
+    if ((new_buckets=alloc_buckets(new_capacity)) == NULL) {
+        return;  //keep the longer chains
+    }
+
+    old_end = table->buckets + table->capacity;
+    for (old_bucket=table->buckets; old_bucket<old_end; old_bucket++) {
+        entry = *old_bucket;
+        while (entry != NULL) {
+            next = entry->next;
+            new_bucket = new_buckets + entry->hash_code % new_capacity;
+            entry->next = *new_bucket;
+            *new_bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(table->buckets);
+    table->buckets = new_buckets;
+    table->capacity = new_capacity;
+}
+
+int name_intern_acquire(FDIRNameInternTable *table,
+        const string_t *src, string_t *dest)
+{
+    FDIRNameInternEntry **bucket;
+    FDIRNameInternEntry *entry;
+    unsigned int hash_code;
+    int result;
+
+    hash_code = (unsigned int)simple_hash_ex(src->str, src->len, 0);
+    NAME_INTERN_LOCK(table);
+    bucket = table->buckets + hash_code % table->capacity;
+    entry = *bucket;
+    while (entry != NULL) {
+        if (entry->hash_code == hash_code && entry->len == src->len &&
+                memcmp(entry->str, src->str, src->len) == 0)
+        {
+            break;
+        }
+        entry = entry->next;
+    }
+
+    if (entry != NULL) {
+        entry->refer_count++;
+        table->saved_bytes += src->len + 1;
+        result = 0;
+    } else if ((entry=(FDIRNameInternEntry *)fast_allocator_alloc(
+                    table->acontext, NAME_INTERN_HEADER_SIZE +
+                    src->len + 1)) == NULL)
+    {
+        result = ENOMEM;
+    } else {
+        entry->hash_code = hash_code;
+        entry->refer_count = 1;
+        entry->len = src->len;
+        memcpy(entry->str, src->str, src->len);
+        entry->str[src->len] = '\0';
+        entry->next = *bucket;
+        *bucket = entry;
+        table->saved_bytes -= NAME_INTERN_HEADER_SIZE;
+        if (++table->count > table->capacity) {
+            expand_buckets(table);
+        }
+        result = 0;
+    }
+
+    if (result == 0) {
+        table->refer_count++;
+        FC_SET_STRING_EX(*dest, entry->str, src->len);
+    }
+    NAME_INTERN_UNLOCK(table);
+    return result;
+}
+
+void name_intern_release(FDIRNameInternTable *table, char *str)
+{
+    FDIRNameInternEntry **previous;
+    FDIRNameInternEntry *entry;
+
+    entry = NAME_INTERN_ENTRY_PTR(str);
+    NAME_INTERN_LOCK(table);
+    table->refer_count--;
+    if (--entry->refer_count > 0) {
+        table->saved_bytes -= entry->len + 1;
+        entry = NULL;
+    } else {
+        previous = table->buckets + entry->hash_code % table->capacity;
+        while (*previous != NULL && *previous != entry) {
+            previous = &(*previous)->next;
+        }
+        if (*previous != NULL) {
+            *previous = entry->next;
+        }
+        table->count--;
+        table->saved_bytes += NAME_INTERN_HEADER_SIZE;
+    }
+    NAME_INTERN_UNLOCK(table);
+
+    if (entry != NULL) {
+        fast_allocator_free(table->acontext, entry);
+    }
+}
+
+void name_intern_add_stat(FDIRNameInternTable *table,
+        FDIRNameInternStat *stat)
+{
+    if (table->buckets == NULL) {
+        return;
+    }
+
+    NAME_INTERN_LOCK(table);
+    stat->count += table->count;
+    stat->refer_count += table->refer_count;
+    stat->saved_bytes += table->saved_bytes;
+    NAME_INTERN_UNLOCK(table);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//name_intern.h
+
+#ifndef _FDIR_NAME_INTERN_H
+#define _FDIR_NAME_INTERN_H
+
+#include <pthread.h>
+#include "fastcommon/common_define.h"
+#include "fastcommon/fast_allocator.h"
+
+/* the repeated dentry names (such as Makefile, index.html) of one data
+ * thread share the same refcounted string, the string of the entry is
+ * the dentry name, so the entry is got from the name by container_of
+ */
+typedef struct fdir_name_intern_entry {
+    struct fdir_name_intern_entry *next;
+    unsigned int hash_code;
+    int refer_count;  //protected by the lock of the table
+    unsigned short len;
+    char str[0];      //terminated with '\0'
+} FDIRNameInternEntry;
+
+typedef struct fdir_name_intern_table {
+    FDIRNameInternEntry **buckets;  //NULL for disabled
+    int64_t capacity;
+    int64_t count;        //the entry count
+    int64_t refer_count;  //the names which reference the entries
+    int64_t saved_bytes;  //the duplicated strings minus the entry headers
+    struct fast_allocator_context *acontext;
+    pthread_mutex_t lock;
+    bool need_lock;  //the names of the moved dentries in parent mode
+} FDIRNameInternTable;
+
+typedef struct fdir_name_intern_stat {
+    int64_t count;
+    int64_t refer_count;
+    int64_t saved_bytes;
+} FDIRNameInternStat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* capacity: the initial bucket count, 0 for disabled,
+     * the table doubles the capacity when the entry count exceeds it
+     */
+    int name_intern_init(FDIRNameInternTable *table,
+            struct fast_allocator_context *acontext,
+            const int64_t capacity, const bool need_lock);
+
+    void name_intern_destroy(FDIRNameInternTable *table);
+
+    //dest->str points to the shared string of the entry
+    int name_intern_acquire(FDIRNameInternTable *table,
+            const string_t *src, string_t *dest);
+
+    //str MUST be acquired from this table
+    void name_intern_release(FDIRNameInternTable *table, char *str);
+
+    //add the stat of the table to the output
+    void name_intern_add_stat(FDIRNameInternTable *table,
+            FDIRNameInternStat *stat);
+
+    static inline bool name_intern_enabled(FDIRNameInternTable *table)
+    {
+        return table->buckets != NULL;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
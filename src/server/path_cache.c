@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/hash.h"
+#include "server_global.h"
+#include "path_cache.h"
+
+/* the cache entry is valid when the generations of all the dentries along
+ * the path not changed, and for the negative entry, the children version
+ * of the last directory not changed also.
+ *
+ * the dentries are allocated from fast_mblock which never returns the
+ * memory, and the generation is kept after the dentry freed, so it is
+ * safe to check the generation of the freed dentry.
+ */
+
+#define PATH_CACHE_LOCK_COUNT  163
+
+typedef struct {
+    FDIRServerDentry *dentry;
+    unsigned int generation;
+} PathCacheNode;
+
+typedef struct {
+    FDIRNamespaceEntry *ns_entry;
+    unsigned int hash_code;
+    unsigned int dir_version;  //for the negative entry
+    short count;  //the node count
+    bool found;
+    string_t path;
+    PathCacheNode nodes[0];
+} PathCacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int64_t count;
+    int64_t hit_count;
+    int64_t miss_count;
+} PathCacheSharedContext;
+
+typedef struct {
+    int64_t capacity;
+    PathCacheEntry **buckets;
+    PathCacheSharedContext *contexts;
+} PathCacheHashtable;
+
+static PathCacheHashtable path_cache = {0, NULL, NULL};
+
+#define PATH_CACHE_HASH_CODE(ns_entry, path) \
+    ((unsigned int)simple_hash_ex((path)->str, (path)->len, \
+        (int)((long)(ns_entry) >> 4)))
+
+#define PATH_CACHE_SHARED_CTX(bucket_index) \
+    (path_cache.contexts + (bucket_index) % PATH_CACHE_LOCK_COUNT)
+
+int path_cache_init()
+{
+    PathCacheSharedContext *ctx;
+    PathCacheSharedContext *end;
+    int64_t bytes;
+    int result;
+
+    if (PATH_CACHE_CAPACITY <= 0) {
+        return 0;
+    }
+
+    bytes = sizeof(PathCacheSharedContext) * PATH_CACHE_LOCK_COUNT;
+    path_cache.contexts = (PathCacheSharedContext *)fc_malloc(bytes);
+    if (path_cache.contexts == NULL) {
+        return ENOMEM;
+    }
+    memset(path_cache.contexts, 0, bytes);
+
+    end = path_cache.contexts + PATH_CACHE_LOCK_COUNT;
+    for (ctx=path_cache.contexts; ctx<end; ctx++) {
+        if ((result=init_pthread_lock(&ctx->lock)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "init_pthread_lock fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            return result;
+        }
+    }
+
+    bytes = sizeof(PathCacheEntry *) * PATH_CACHE_CAPACITY;
+    path_cache.buckets = (PathCacheEntry **)fc_malloc(bytes);
+    if (path_cache.buckets == NULL) {
+        return ENOMEM;
+    }
+    memset(path_cache.buckets, 0, bytes);
+    path_cache.capacity = PATH_CACHE_CAPACITY;
+    return 0;
+}
+
+void path_cache_destroy()
+{
+}
+
+static bool entry_is_valid(const PathCacheEntry *entry)
+{
+    const PathCacheNode *node;
+    const PathCacheNode *end;
+
+    end = entry->nodes + entry->count;
+    for (node=entry->nodes; node<end; node++) {
+        if (node->dentry->generation != node->generation) {
+            return false;
+        }
+    }
+
+    if (!entry->found) {
+        return (entry->nodes[entry->count - 1].dentry->
+                children_version == entry->dir_version);
+    }
+    return true;
+}
+
+bool path_cache_find(FDIRNamespaceEntry *ns_entry,
+        const string_t *path, FDIRServerDentry **dentry)
+{
+    PathCacheSharedContext *ctx;
+    PathCacheEntry **bucket;
+    PathCacheEntry *entry;
+    unsigned int hash_code;
+    int64_t bucket_index;
+    bool hit;
+
+    if (path_cache.capacity == 0) {
+        return false;
+    }
+
+    hash_code = PATH_CACHE_HASH_CODE(ns_entry, path);
+    bucket_index = hash_code % path_cache.capacity;
+    bucket = path_cache.buckets + bucket_index;
+    ctx = PATH_CACHE_SHARED_CTX(bucket_index);
+
+    hit = false;
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    if ((entry=*bucket) != NULL && entry->hash_code == hash_code &&
+            entry->ns_entry == ns_entry &&
+            fc_string_equal(&entry->path, path))
+    {
+        if (entry_is_valid(entry)) {
+            *dentry = entry->found ? entry->nodes[entry->
+                count - 1].dentry : NULL;
+            hit = true;
+        } else {
+            *bucket = NULL;
+            ctx->count--;
+            free(entry);
+        }
+    }
+
+    if (hit) {
+        ctx->hit_count++;
+    } else {
+        ctx->miss_count++;
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    return hit;
+}
+
+//the lookup result is consistent when all versions not changed
+static bool chain_is_valid(const FDIRPathCacheChain *chain)
+{
+    const FDIRPathCacheNode *node;
+    const FDIRPathCacheNode *end;
+    int dir_count;
+
+    __sync_synchronize();
+    end = chain->nodes + chain->count;
+    for (node=chain->nodes; node<end; node++) {
+        if ((node->generation & 1) != 0 ||
+                node->dentry->generation != node->generation)
+        {
+            return false;
+        }
+    }
+
+    dir_count = chain->found ? chain->count - 1 : chain->count;
+    end = chain->nodes + dir_count;
+    for (node=chain->nodes; node<end; node++) {
+        if ((node->children_version & 1) != 0 ||
+                node->dentry->children_version != node->children_version)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void path_cache_add(FDIRNamespaceEntry *ns_entry, const string_t *path,
+        const FDIRPathCacheChain *chain)
+{
+    PathCacheSharedContext *ctx;
+    PathCacheEntry **bucket;
+    PathCacheEntry *entry;
+    PathCacheEntry *old;
+    int64_t bucket_index;
+    int bytes;
+    int i;
+
+    if (path_cache.capacity == 0 || chain->notdir || chain->count == 0) {
+        return;
+    }
+
+    if (!chain_is_valid(chain)) {
+        return;
+    }
+
+    bytes = sizeof(PathCacheEntry) + sizeof(PathCacheNode) *
+        chain->count + path->len;
+    if ((entry=(PathCacheEntry *)fc_malloc(bytes)) == NULL) {
+        return;
+    }
+
+    entry->ns_entry = ns_entry;
+    entry->hash_code = PATH_CACHE_HASH_CODE(ns_entry, path);
+    entry->count = chain->count;
+    entry->found = chain->found;
+    entry->dir_version = chain->nodes[chain->count - 1].children_version;
+    for (i=0; i<chain->count; i++) {
+        entry->nodes[i].dentry = chain->nodes[i].dentry;
+        entry->nodes[i].generation = chain->nodes[i].generation;
+    }
+    entry->path.str = (char *)(entry->nodes + chain->count);
+    entry->path.len = path->len;
+    memcpy(entry->path.str, path->str, path->len);
+
+    bucket_index = entry->hash_code % path_cache.capacity;
+    bucket = path_cache.buckets + bucket_index;
+    ctx = PATH_CACHE_SHARED_CTX(bucket_index);
+
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    old = *bucket;
+    *bucket = entry;
+    if (old == NULL) {
+        ctx->count++;
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    if (old != NULL) {
+        free(old);
+    }
+}
+
+void path_cache_get_stat(FDIRPathCacheStat *stat)
+{
+    PathCacheSharedContext *ctx;
+    PathCacheSharedContext *end;
+
+    memset(stat, 0, sizeof(FDIRPathCacheStat));
+    if (path_cache.capacity == 0) {
+        return;
+    }
+
+    stat->capacity = path_cache.capacity;
+    end = path_cache.contexts + PATH_CACHE_LOCK_COUNT;
+    for (ctx=path_cache.contexts; ctx<end; ctx++) {
+        PTHREAD_MUTEX_LOCK(&ctx->lock);
+        stat->count += ctx->count;
+        stat->hit_count += ctx->hit_count;
+        stat->miss_count += ctx->miss_count;
+        PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+    }
+}
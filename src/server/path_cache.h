@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//path_cache.h
+
+#ifndef _FDIR_PATH_CACHE_H
+#define _FDIR_PATH_CACHE_H
+
+#include "server_types.h"
+
+//the shorter paths are found from the dentry tree directly
+#define FDIR_PATH_CACHE_MIN_PATH_COUNT  2
+
+typedef struct fdir_path_cache_node {
+    FDIRServerDentry *dentry;
+    unsigned int generation;
+    unsigned int children_version;  //before searching the child
+} FDIRPathCacheNode;
+
+/* the dentries along the path filled by the lookup, the root included,
+ * the last node is the directory which the missing child searched from
+ * when not found
+ */
+typedef struct fdir_path_cache_chain {
+    FDIRPathCacheNode nodes[FDIR_MAX_PATH_COUNT + 1];
+    int count;
+    bool found;
+    bool notdir;  //a component is not directory, no negative entry
+} FDIRPathCacheChain;
+
+typedef struct fdir_path_cache_stat {
+    int64_t capacity;
+    int64_t count;
+    int64_t hit_count;
+    int64_t miss_count;
+} FDIRPathCacheStat;
+
+#define PATH_CACHE_CHAIN_ADD(chain, d) \
+    do { \
+        (chain)->nodes[(chain)->count].dentry = d;  \
+        (chain)->nodes[(chain)->count++].generation = (d)->generation; \
+    } while (0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int path_cache_init();
+    void path_cache_destroy();
+
+    /* return true when hit, the dentry is NULL for the negative entry,
+     * path: the path of the namespace without the leading slash
+     */
+    bool path_cache_find(FDIRNamespaceEntry *ns_entry,
+            const string_t *path, FDIRServerDentry **dentry);
+
+    //the chain is added only when it is still valid
+    void path_cache_add(FDIRNamespaceEntry *ns_entry, const string_t *path,
+            const FDIRPathCacheChain *chain);
+
+    void path_cache_get_stat(FDIRPathCacheStat *stat);
+
+    /* the writer (data thread) changes the generation or the
+     * children_version of the dentry as a seqlock
+     */
+    static inline void path_cache_change_begin(volatile unsigned int *version)
+    {
+        __sync_add_and_fetch(version, 1);
+    }
+
+    static inline void path_cache_change_end(volatile unsigned int *version)
+    {
+        __sync_add_and_fetch(version, 1);
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
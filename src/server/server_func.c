@@ -322,7 +322,7 @@ static int load_dentry_max_data_size(IniContext *ini_context,
 
 static void server_log_configs()
 {
-    char sz_server_config[512];
+    char sz_server_config[1024];
     char sz_global_config[512];
     char sz_service_config[128];
     char sz_cluster_config[128];
@@ -335,27 +335,48 @@ static void server_log_configs()
 
     snprintf(sz_server_config, sizeof(sz_server_config),
             "cluster_id = %d, my server id = %d, data_path = %s, "
-            "data_threads = %d, dentry_max_data_size = %d, "
-            "binlog_buffer_size = %d KB, "
+            "data_threads = %d, data_dispatch_mode = %s, "
+            "checkpoint_interval = %d s, "
+            "dentry_max_data_size = %d, "
+            "binlog_buffer_size = %d KB, binlog_format = %s, "
             "slave_binlog_check_last_rows = %d, "
+            "binlog_group_commit_count = %d, "
+            "replica_ack_policy = %s, "
+            "binlog_parse_threads = %d, "
+            "binlog_replay_pipeline = %d, "
+            "replica_snapshot_bootstrap = %d, "
+            "replica_push_window = %d, "
+            "read_version_wait_timeout = %d s, "
             "admin config {username: %s, secret_key: %s}, "
             "reload_interval_ms = %d ms, "
             "check_alive_interval = %d s, "
             "namespace_hashtable_capacity = %d, "
             "inode_hashtable_capacity = %"PRId64", "
+            "inode_hashtable_max_load_factor = %.2f, "
             "inode_shared_locks_count = %d, "
+            "path_cache_capacity = %"PRId64", "
+            "name_intern_capacity = %"PRId64", "
             "cluster server count = %d",
             CLUSTER_ID, CLUSTER_MY_SERVER_ID,
-            DATA_PATH_STR, DATA_THREAD_COUNT,
+            DATA_PATH_STR, DATA_THREAD_COUNT, DATA_DISPATCH_MODE ==
+            FDIR_DATA_DISPATCH_MODE_PARENT ? FDIR_DATA_DISPATCH_MODE_PARENT_STR
+            : FDIR_DATA_DISPATCH_MODE_NAMESPACE_STR, DATA_CHECKPOINT_INTERVAL,
             DENTRY_MAX_DATA_SIZE, BINLOG_BUFFER_SIZE / 1024,
-            SLAVE_BINLOG_CHECK_LAST_ROWS,
+            BINLOG_RECORD_FORMAT == FDIR_BINLOG_FORMAT_BINARY ?
+            FDIR_BINLOG_FORMAT_BINARY_STR : FDIR_BINLOG_FORMAT_TEXT_STR,
+            SLAVE_BINLOG_CHECK_LAST_ROWS, BINLOG_GROUP_COMMIT_COUNT,
+            fdir_get_replica_ack_policy_caption(REPLICA_ACK_POLICY),
+            BINLOG_PARSE_THREAD_COUNT, BINLOG_REPLAY_PIPELINE,
+            REPLICA_SNAPSHOT_BOOTSTRAP,
+            REPLICA_PUSH_WINDOW, READ_VERSION_WAIT_TIMEOUT,
             g_server_global_vars.admin.username.str,
             g_server_global_vars.admin.secret_key.str,
             g_server_global_vars.reload_interval_ms,
             g_server_global_vars.check_alive_interval,
             g_server_global_vars.namespace_hashtable_capacity,
-            INODE_HASHTABLE_CAPACITY, INODE_SHARED_LOCKS_COUNT,
-            FC_SID_SERVER_COUNT(CLUSTER_CONFIG_CTX));
+            INODE_HASHTABLE_CAPACITY, INODE_HASHTABLE_MAX_LOAD_FACTOR,
+            INODE_SHARED_LOCKS_COUNT, PATH_CACHE_CAPACITY,
+            NAME_INTERN_CAPACITY, FC_SID_SERVER_COUNT(CLUSTER_CONFIG_CTX));
 
     logInfo("%s, service: {%s}, cluster: {%s}, %s",
             sz_global_config, sz_service_config,
@@ -389,6 +410,113 @@ static int load_binlog_buffer_size(IniContext *ini_context,
     return 0;
 }
 
+static int load_binlog_format(IniContext *ini_context,
+        const char *filename)
+{
+    char *format;
+
+    format = iniGetStrValue(NULL, "binlog_format", ini_context);
+    if (format == NULL || *format == '\0' || strcasecmp(format,
+                FDIR_BINLOG_FORMAT_TEXT_STR) == 0)
+    {
+        BINLOG_RECORD_FORMAT = FDIR_BINLOG_FORMAT_TEXT;
+    } else if (strcasecmp(format, FDIR_BINLOG_FORMAT_BINARY_STR) == 0) {
+        BINLOG_RECORD_FORMAT = FDIR_BINLOG_FORMAT_BINARY;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s , invalid binlog_format: %s, "
+                "expect %s or %s", __LINE__, filename, format,
+                FDIR_BINLOG_FORMAT_TEXT_STR, FDIR_BINLOG_FORMAT_BINARY_STR);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int load_replica_ack_policy(IniContext *ini_context,
+        const char *filename)
+{
+    char *policy;
+
+    policy = iniGetStrValue(NULL, "replica_ack_policy", ini_context);
+    if (policy == NULL || *policy == '\0' || strcasecmp(policy,
+                FDIR_REPLICA_ACK_POLICY_ALL_STR) == 0)
+    {
+        REPLICA_ACK_POLICY = FDIR_REPLICA_ACK_POLICY_ALL;
+    } else if (strcasecmp(policy, FDIR_REPLICA_ACK_POLICY_MAJORITY_STR) == 0) {
+        REPLICA_ACK_POLICY = FDIR_REPLICA_ACK_POLICY_MAJORITY;
+    } else if (strcasecmp(policy, FDIR_REPLICA_ACK_POLICY_ASYNC_STR) == 0) {
+        REPLICA_ACK_POLICY = FDIR_REPLICA_ACK_POLICY_ASYNC;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s , invalid replica_ack_policy: %s, "
+                "expect %s, %s or %s", __LINE__, filename, policy,
+                FDIR_REPLICA_ACK_POLICY_ALL_STR,
+                FDIR_REPLICA_ACK_POLICY_MAJORITY_STR,
+                FDIR_REPLICA_ACK_POLICY_ASYNC_STR);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static void load_binlog_group_commit_count(IniContext *ini_context,
+        const char *filename)
+{
+    BINLOG_GROUP_COMMIT_COUNT = iniGetIntValue(NULL,
+            "binlog_group_commit_count", ini_context,
+            FDIR_DEFAULT_BINLOG_GROUP_COMMIT_COUNT);
+    if (BINLOG_GROUP_COMMIT_COUNT <= 0) {
+        BINLOG_GROUP_COMMIT_COUNT = 1;
+    } else if (BINLOG_GROUP_COMMIT_COUNT >
+            FDIR_MAX_BINLOG_GROUP_COMMIT_COUNT)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s , binlog_group_commit_count: %d "
+                "is too large, set it to %d", __LINE__, filename,
+                BINLOG_GROUP_COMMIT_COUNT,
+                FDIR_MAX_BINLOG_GROUP_COMMIT_COUNT);
+        BINLOG_GROUP_COMMIT_COUNT = FDIR_MAX_BINLOG_GROUP_COMMIT_COUNT;
+    }
+
+    /* the record of one data thread maybe depends on the record
+     * of another data thread which data version not assigned yet
+     */
+    if (BINLOG_GROUP_COMMIT_COUNT > 1 && DATA_DISPATCH_MODE ==
+            FDIR_DATA_DISPATCH_MODE_PARENT && DATA_THREAD_COUNT > 1)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s , binlog group commit is disabled "
+                "for data_dispatch_mode: %s", __LINE__, filename,
+                FDIR_DATA_DISPATCH_MODE_PARENT_STR);
+        BINLOG_GROUP_COMMIT_COUNT = 1;
+    }
+}
+
+static int load_data_dispatch_mode(IniContext *ini_context,
+        const char *filename)
+{
+    char *mode;
+
+    mode = iniGetStrValue(NULL, "data_dispatch_mode", ini_context);
+    if (mode == NULL || *mode == '\0' || strcasecmp(mode,
+                FDIR_DATA_DISPATCH_MODE_NAMESPACE_STR) == 0)
+    {
+        DATA_DISPATCH_MODE = FDIR_DATA_DISPATCH_MODE_NAMESPACE;
+    } else if (strcasecmp(mode, FDIR_DATA_DISPATCH_MODE_PARENT_STR) == 0) {
+        DATA_DISPATCH_MODE = FDIR_DATA_DISPATCH_MODE_PARENT;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s , invalid data_dispatch_mode: %s, "
+                "expect %s or %s", __LINE__, filename, mode,
+                FDIR_DATA_DISPATCH_MODE_NAMESPACE_STR,
+                FDIR_DATA_DISPATCH_MODE_PARENT_STR);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
 int server_load_config(const char *filename)
 {
     const int task_buffer_extra_size = 0;
@@ -432,6 +560,13 @@ int server_load_config(const char *filename)
         DATA_THREAD_COUNT = FDIR_DEFAULT_DATA_THREAD_COUNT;
     }
 
+    if ((result=load_data_dispatch_mode(&ini_context, filename)) != 0) {
+        return result;
+    }
+
+    DATA_CHECKPOINT_INTERVAL = iniGetIntValue(NULL, "checkpoint_interval",
+            &ini_context, FDIR_DEFAULT_CHECKPOINT_INTERVAL);
+
     if ((result=server_load_admin_config(&ini_context)) != 0) {
         return result;
     }
@@ -440,6 +575,10 @@ int server_load_config(const char *filename)
         return result;
     }
 
+    if ((result=load_binlog_format(&ini_context, filename)) != 0) {
+        return result;
+    }
+
     SLAVE_BINLOG_CHECK_LAST_ROWS = iniGetIntValue(NULL,
             "slave_binlog_check_last_rows", &ini_context,
             FDIR_DEFAULT_SLAVE_BINLOG_CHECK_LAST_ROWS);
@@ -452,6 +591,53 @@ int server_load_config(const char *filename)
         SLAVE_BINLOG_CHECK_LAST_ROWS = FDIR_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS;
     }
 
+    load_binlog_group_commit_count(&ini_context, filename);
+
+    BINLOG_PARSE_THREAD_COUNT = iniGetIntValue(NULL,
+            "binlog_parse_threads", &ini_context,
+            FDIR_DEFAULT_BINLOG_PARSE_THREAD_COUNT);
+    if (BINLOG_PARSE_THREAD_COUNT < 0) {
+        BINLOG_PARSE_THREAD_COUNT = 0;
+    } else if (BINLOG_PARSE_THREAD_COUNT >
+            FDIR_MAX_BINLOG_PARSE_THREAD_COUNT)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s , binlog_parse_threads: %d "
+                "is too large, set it to %d", __LINE__, filename,
+                BINLOG_PARSE_THREAD_COUNT,
+                FDIR_MAX_BINLOG_PARSE_THREAD_COUNT);
+        BINLOG_PARSE_THREAD_COUNT = FDIR_MAX_BINLOG_PARSE_THREAD_COUNT;
+    }
+
+    BINLOG_REPLAY_PIPELINE = iniGetBoolValue(NULL,
+            "binlog_replay_pipeline", &ini_context, false);
+
+    REPLICA_SNAPSHOT_BOOTSTRAP = iniGetBoolValue(NULL,
+            "replica_snapshot_bootstrap", &ini_context, true);
+
+    REPLICA_PUSH_WINDOW = iniGetIntValue(NULL, "replica_push_window",
+            &ini_context, FDIR_DEFAULT_REPLICA_PUSH_WINDOW);
+    if (REPLICA_PUSH_WINDOW <= 0) {
+        REPLICA_PUSH_WINDOW = FDIR_DEFAULT_REPLICA_PUSH_WINDOW;
+    } else if (REPLICA_PUSH_WINDOW > FDIR_MAX_REPLICA_PUSH_WINDOW) {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s , replica_push_window: %d "
+                "is too large, set it to %d", __LINE__, filename,
+                REPLICA_PUSH_WINDOW, FDIR_MAX_REPLICA_PUSH_WINDOW);
+        REPLICA_PUSH_WINDOW = FDIR_MAX_REPLICA_PUSH_WINDOW;
+    }
+
+    READ_VERSION_WAIT_TIMEOUT = iniGetIntValue(NULL,
+            "read_version_wait_timeout", &ini_context,
+            FDIR_DEFAULT_READ_VERSION_WAIT_TIMEOUT);
+    if (READ_VERSION_WAIT_TIMEOUT <= 0) {
+        READ_VERSION_WAIT_TIMEOUT = FDIR_DEFAULT_READ_VERSION_WAIT_TIMEOUT;
+    }
+
+    if ((result=load_replica_ack_policy(&ini_context, filename)) != 0) {
+        return result;
+    }
+
     g_server_global_vars.reload_interval_ms = iniGetIntValue(NULL,
             "reload_interval_ms", &ini_context,
             FDIR_SERVER_DEFAULT_RELOAD_INTERVAL);
@@ -483,6 +669,10 @@ int server_load_config(const char *filename)
         INODE_HASHTABLE_CAPACITY = FDIR_INODE_HASHTABLE_DEFAULT_CAPACITY;
     }
 
+    INODE_HASHTABLE_MAX_LOAD_FACTOR = iniGetDoubleValue(NULL,
+            "inode_hashtable_max_load_factor", &ini_context,
+            FDIR_INODE_HASHTABLE_DEFAULT_MAX_LOAD_FACTOR);
+
     INODE_SHARED_LOCKS_COUNT = iniGetIntValue(NULL,
             "inode_shared_locks_count", &ini_context,
             FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT);
@@ -490,6 +680,20 @@ int server_load_config(const char *filename)
         INODE_SHARED_LOCKS_COUNT = FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT;
     }
 
+    PATH_CACHE_CAPACITY = iniGetIntValue(NULL,
+            "path_cache_capacity", &ini_context,
+            FDIR_PATH_CACHE_DEFAULT_CAPACITY);
+    if (PATH_CACHE_CAPACITY < 0) {
+        PATH_CACHE_CAPACITY = 0;
+    }
+
+    NAME_INTERN_CAPACITY = iniGetIntValue(NULL,
+            "name_intern_capacity", &ini_context,
+            FDIR_NAME_INTERN_DEFAULT_CAPACITY);
+    if (NAME_INTERN_CAPACITY < 0) {
+        NAME_INTERN_CAPACITY = 0;
+    }
+
     if ((result=load_cluster_config(&ini_context, filename)) != 0) {
         return result;
     }
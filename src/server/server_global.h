@@ -60,16 +60,36 @@ typedef struct server_global_vars {
 
         struct {
             int shared_locks_count;
-            int64_t hashtable_capacity;
+            int64_t hashtable_capacity;  //the initial capacity
+            double hashtable_max_load_factor;
         } entries;
     } inode;
 
+    struct {
+        int64_t capacity;  //0 for disabled
+    } path_cache;
+
+    struct {
+        int64_t capacity;  //the initial capacity per data thread
+    } name_intern;
+
     struct {
         volatile uint64_t current_version; //binlog version
+        volatile int64_t readable_version; //the records applied through
+        int read_version_wait_timeout;  //in seconds
         string_t path;   //data path
         int binlog_buffer_size;
+        int binlog_format;  //for the new records
         int slave_binlog_check_last_rows;
+        int group_commit_count;  //the max records of one rbuffer, 1 for disabled
+        int replica_ack_policy;
+        int parse_thread_count;  //for load data, 0 for parsing by the loader
+        bool replay_pipeline;    //replay without the barrier per batch
+        bool snapshot_bootstrap; //push the checkpoint to the empty slave
+        int push_window;  //the max in-flight push requests per slave
         int thread_count;
+        int dispatch_mode;        //dispatch the records to data threads
+        int checkpoint_interval;  //in seconds
     } data;
 
 } FDIRServerGlobalVars;
@@ -93,21 +113,41 @@ typedef struct server_global_vars {
 
 #define DENTRY_MAX_DATA_SIZE    g_server_global_vars.dentry_max_data_size
 #define BINLOG_BUFFER_SIZE      g_server_global_vars.data.binlog_buffer_size
+#define BINLOG_RECORD_FORMAT    g_server_global_vars.data.binlog_format
 #define SLAVE_BINLOG_CHECK_LAST_ROWS  g_server_global_vars.data. \
     slave_binlog_check_last_rows
+#define BINLOG_GROUP_COMMIT_COUNT g_server_global_vars.data.group_commit_count
+#define REPLICA_ACK_POLICY      g_server_global_vars.data.replica_ack_policy
+#define BINLOG_PARSE_THREAD_COUNT g_server_global_vars.data.parse_thread_count
+#define BINLOG_REPLAY_PIPELINE  g_server_global_vars.data.replay_pipeline
+#define REPLICA_SNAPSHOT_BOOTSTRAP g_server_global_vars.data.snapshot_bootstrap
+#define REPLICA_PUSH_WINDOW     g_server_global_vars.data.push_window
 
 #define CURRENT_INODE_SN        g_server_global_vars.inode.generator.sn
 #define INODE_CLUSTER_PART      g_server_global_vars.inode.generator.cluster
 #define INODE_SHARED_LOCKS_COUNT g_server_global_vars.inode.entries.shared_locks_count
 #define INODE_HASHTABLE_CAPACITY g_server_global_vars.inode.entries.hashtable_capacity
+#define INODE_HASHTABLE_MAX_LOAD_FACTOR \
+    g_server_global_vars.inode.entries.hashtable_max_load_factor
+#define PATH_CACHE_CAPACITY     g_server_global_vars.path_cache.capacity
+#define NAME_INTERN_CAPACITY    g_server_global_vars.name_intern.capacity
 #define DATA_CURRENT_VERSION    g_server_global_vars.data.current_version
+#define DATA_READABLE_VERSION   g_server_global_vars.data.readable_version
+#define READ_VERSION_WAIT_TIMEOUT g_server_global_vars.data. \
+    read_version_wait_timeout
 #define DATA_THREAD_COUNT       g_server_global_vars.data.thread_count
+#define DATA_DISPATCH_MODE      g_server_global_vars.data.dispatch_mode
+#define DATA_CHECKPOINT_INTERVAL g_server_global_vars.data.checkpoint_interval
 #define DATA_PATH               g_server_global_vars.data.path
 #define DATA_PATH_STR           DATA_PATH.str
 #define DATA_PATH_LEN           DATA_PATH.len
 
 #define SLAVE_SERVER_COUNT      (FC_SID_SERVER_COUNT(CLUSTER_CONFIG_CTX) - 1)
 
+//the update request waits for the slave acks
+#define REPLICA_WAIT_FOR_ACK    (SLAVE_SERVER_COUNT > 0 && \
+        REPLICA_ACK_POLICY != FDIR_REPLICA_ACK_POLICY_ASYNC)
+
 #define REPLICA_KEY_BUFF        CLUSTER_MYSELF_PTR->key
 
 #define CLUSTER_GROUP_INDEX     g_server_global_vars.cluster.config.cluster_group_index
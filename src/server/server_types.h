@@ -37,9 +37,33 @@
 #define FDIR_NAMESPACE_HASHTABLE_DEFAULT_CAPACITY 1361
 #define FDIR_INODE_HASHTABLE_DEFAULT_CAPACITY     1403641
 #define FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT     163
+#define FDIR_INODE_HASHTABLE_DEFAULT_MAX_LOAD_FACTOR  1.00
+#define FDIR_PATH_CACHE_DEFAULT_CAPACITY          1048573
+#define FDIR_NAME_INTERN_DEFAULT_CAPACITY         0
 #define FDIR_DEFAULT_DATA_THREAD_COUNT              1
+#define FDIR_DEFAULT_CHECKPOINT_INTERVAL         3600
 #define FDIR_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS      64
 #define FDIR_DEFAULT_SLAVE_BINLOG_CHECK_LAST_ROWS   3
+#define FDIR_DEFAULT_BINLOG_GROUP_COMMIT_COUNT     64
+#define FDIR_MAX_BINLOG_GROUP_COMMIT_COUNT        256
+#define FDIR_DEFAULT_BINLOG_PARSE_THREAD_COUNT      4
+#define FDIR_MAX_BINLOG_PARSE_THREAD_COUNT         64
+#define FDIR_DEFAULT_REPLICA_PUSH_WINDOW            8
+#define FDIR_MAX_REPLICA_PUSH_WINDOW              256
+#define FDIR_DEFAULT_READ_VERSION_WAIT_TIMEOUT      3
+
+//including the tail \0, keep sizeof(FDIRServerDentry) 8 bytes aligned
+#define FDIR_DENTRY_INLINE_NAME_SIZE  16
+
+#define FDIR_BINLOG_FORMAT_TEXT          0
+#define FDIR_BINLOG_FORMAT_BINARY        1
+#define FDIR_BINLOG_FORMAT_TEXT_STR      "text"
+#define FDIR_BINLOG_FORMAT_BINARY_STR    "binary"
+
+#define FDIR_DATA_DISPATCH_MODE_NAMESPACE      0
+#define FDIR_DATA_DISPATCH_MODE_PARENT         1
+#define FDIR_DATA_DISPATCH_MODE_NAMESPACE_STR  "namespace"
+#define FDIR_DATA_DISPATCH_MODE_PARENT_STR     "parent"
 
 #define FDIR_SERVER_TASK_TYPE_RELATIONSHIP       1   //slave  -> master
 #define FDIR_SERVER_TASK_TYPE_REPLICA_MASTER     2   //[Master] -> slave
@@ -50,6 +74,7 @@
 #define FDIR_REPLICATION_STAGE_WAITING_JOIN_RESP  2
 #define FDIR_REPLICATION_STAGE_SYNC_FROM_DISK     3
 #define FDIR_REPLICATION_STAGE_SYNC_FROM_QUEUE    4
+#define FDIR_REPLICATION_STAGE_SYNC_FROM_SNAPSHOT 5  //before sync from disk
 
 #define TASK_STATUS_CONTINUE           12345
 #define TASK_UPDATE_FLAG_OUTPUT_DENTRY     1
@@ -63,10 +88,12 @@
 #define REQUEST_STATUS    REQUEST.header.status
 #define RECORD            TASK_ARG->context.service.record
 #define RBUFFER           TASK_ARG->context.service.rbuffer
+#define READ_VERSION_CTX  TASK_ARG->context.service.read_version
 #define FTASK_HEAD_PTR    &TASK_ARG->context.service.ftasks
 #define SYS_LOCK_TASK     TASK_ARG->context.service.sys_lock_task
-#define WAITING_RPC_COUNT TASK_ARG->context.service.waiting_rpc_count
-#define DENTRY_LIST_CACHE TASK_ARG->context.service.dentry_list_cache
+#define TASK_EPOCH        TASK_ARG->context.service.epoch
+#define LIST_STREAM       TASK_ARG->context.service.list_stream
+#define COMPOUND_CTX      TASK_ARG->context.service.compound
 
 #define SERVER_TASK_TYPE  TASK_ARG->context.task_type
 #define CLUSTER_PEER      TASK_ARG->context.shared.cluster.peer
@@ -87,31 +114,80 @@ typedef struct fdir_path_info {
 
 struct fdir_dentry_context;
 struct fdir_server_dentry;
+struct fdir_epoch_reader;
 struct flock_entry;
 
 typedef struct fdir_namespace_entry {
     string_t name;
     struct fdir_server_dentry *dentry_root;
     volatile int64_t dentry_count;
+    volatile int64_t used_bytes;  //the size of the regular files
+    struct {
+        volatile int64_t inodes;
+        volatile int64_t bytes;
+    } quota;  //0 for unlimited, set by the data thread with atomic stores
     struct fdir_namespace_entry *next;  //for hashtable
 } FDIRNamespaceEntry;
 
-typedef struct fdir_server_dentry {
-    int64_t inode;
-    unsigned int hash_code;   //data thread dispach & mutex lock
-    string_t name;
-    FDIRDEntryStatus stat;
-
+/* the children of a directory: the small directory uses a sorted array,
+ * the large one uses a skiplist for listing and a hash index for lookup
+ */
+typedef struct fdir_children_array {
+    int count;
+    struct fdir_server_dentry *entries[0];  //sorted by name
+} FDIRChildrenArray;
+
+typedef struct fdir_children_index_slot {
+    volatile unsigned int hash_code;
+    struct fdir_server_dentry * volatile dentry;
+} FDIRChildrenIndexSlot;
+
+typedef struct fdir_children_index {
+    int64_t capacity;  //power of 2
+    int64_t used;      //including the deleted slots
+    FDIRChildrenIndexSlot slots[0];
+} FDIRChildrenIndex;
+
+typedef struct fdir_dentry_children {
+    FDIRChildrenArray * volatile array;  //NULL for large directory
+    UniqSkiplist *skiplist;
+    FDIRChildrenIndex * volatile index;
+    volatile int count;
+    FDIRDEntryUsage usage;  //the descendants, changed by atomic adds
+} FDIRDentryChildren;
+
+//the rarely used fields, allocated for the links and the locked dentries
+typedef struct fdir_server_dentry_extra {
     union {
         string_t link;    //for symlink
         struct fdir_server_dentry *src_dentry;  //for hard link
     };
+    struct flock_entry *flock_entry;
+} FDIRServerDentryExtra;
+
+typedef struct fdir_server_dentry {
+    int64_t inode;
+    uint64_t name_prefix;  //see dentry_name_prefix in dentry_children.h
+
+    /* for the path cache, both are odd during changing:
+     * generation changes when the dentry removed or renamed,
+     * children_version changes when the children changed
+     */
+    volatile unsigned int generation;
+    volatile unsigned int children_version;
+
+    /* the short name created with the dentry is stored inline,
+     * the new name of rename is always allocated
+     */
+    char name_buff[FDIR_DENTRY_INLINE_NAME_SIZE];
+    string_t name;
+    FDIRDEntryStatus stat;
+    FDIRServerDentryExtra *extra;  //NULL for the regular file and dir
 
     struct fdir_dentry_context *context;
-    UniqSkiplist *children;
+    FDIRDentryChildren *children;
     struct fdir_server_dentry *parent;
     struct fdir_namespace_entry *ns_entry;
-    struct flock_entry *flock_entry;
     struct fdir_server_dentry *ht_next;  //for inode hash table;
 } FDIRServerDentry;
 
@@ -121,6 +197,13 @@ typedef struct fdir_server_dentry_array {
     struct fdir_server_dentry **entries;
 } FDIRServerDentryArray;  //for list entry
 
+//counted by the replication thread of the slave on the master
+typedef struct fdir_replica_ack_stat {
+    int64_t acked_count;      //the acks while the request waiting
+    int64_t satisfied_count;  //the acks satisfied the ack policy
+    int64_t late_count;       //the acks after the ack policy satisfied
+} FDIRReplicaAckStat;
+
 typedef struct fdir_cluster_server_info {
     FCServerInfo *server;
     char key[FDIR_REPLICA_KEY_SIZE];  //for slave server
@@ -129,6 +212,16 @@ typedef struct fdir_cluster_server_info {
     SFBinlogFilePosition binlog_pos_hint;  //for replication
     volatile int64_t last_data_version;  //for replication
     volatile int last_change_version;    //for push server status to the slave
+    FDIRReplicaAckStat ack_stat;         //for the slave
+    struct {
+        volatile int64_t data_version;   //the last acked by the slave
+        volatile int delay_ms;   //sampled from the record produced to acked
+    } replica_lag;  //for the slave, set by the master
+    struct {
+        volatile int64_t lag_versions;  //published by the master
+        volatile int in_flight;  //the service requests in progress
+        volatile int p99_latency_us;  //of the requests in the last second
+    } load;  //for the readable server selection
 } FDIRClusterServerInfo;
 
 typedef struct fdir_cluster_server_array {
@@ -145,10 +238,20 @@ typedef struct fdir_record_buffer_queue {
     pthread_mutex_t lock;
 } FDIRRecordBufferQueue;
 
+/* the request waits for the slave acks required by the ack policy,
+ * the waiter is freed after all slaves acked (or discarded, timeout),
+ * so the late acks never touch the task which maybe reused
+ */
+typedef struct fdir_replica_ack_waiter {
+    struct fast_task_info *task;
+    volatile int wait_count;    //notify the task when reaches 0
+    volatile int reffer_count;  //the slaves not done
+} FDIRReplicaAckWaiter;
+
 typedef struct fdir_binlog_push_result_entry {
     uint64_t data_version;
     time_t expires;
-    struct fast_task_info *waiting_task;
+    FDIRReplicaAckWaiter *waiter;
     struct fdir_binlog_push_result_entry *next;
 } FDIRBinlogPushResultEntry;
 
@@ -167,6 +270,7 @@ typedef struct fdir_binlog_push_result_context {
     } queue;   //for overflow exceptions
 
     time_t last_check_timeout_time;
+    FDIRReplicaAckStat *ack_stat;
 } FDIRBinlogPushResultContext;
 
 struct binlog_read_thread_context;
@@ -183,11 +287,36 @@ typedef struct fdir_replication_context {
         int64_t by_resp;  //for flow control
     } last_data_versions;
 
+    /* the push requests the slave can accept, the slave grants the
+     * credits back when the received buffers are handed to the replay
+     */
+    int push_credits;
+
+    struct {
+        int64_t data_version;  //0 for no sample in flight
+        int64_t produce_time_ms;
+    } lag_sample;
+
     struct {
         int64_t start_time_ms;
         int64_t binlog_size;
         int64_t record_count;
     } sync_by_disk_stat;
+
+    /* for the empty slave, push the checkpoint file then
+     * sync the binlog after it from disk. the diverged slave
+     * restarts to load the checkpoint file after pushed
+     */
+    struct {
+        int fd;  //the checkpoint file, -1 for not opened
+        bool waiting_resp;
+        bool diverged;
+        int64_t file_size;
+        int64_t offset;
+        int64_t data_version;
+        SFBinlogFilePosition binlog_pos_hint;
+        int64_t start_time_ms;
+    } snapshot;
 } FDIRReplicationContext;
 
 typedef struct fdir_slave_replication {
@@ -220,6 +349,25 @@ struct fdir_binlog_record;
 struct flock_task;
 struct sys_lock_task;
 
+typedef struct server_compound_op {
+    unsigned char cmd;  //the request cmd of the operation
+    bool changed;       //generate the binlog record
+    string_t path;      //for the operations by path
+    FDIRSetDEntrySizeInfo dsize;  //for set dentry size
+    struct fdir_binlog_record *record;
+} ServerCompoundOp;
+
+typedef struct server_compound_context {
+    int count;
+    int changed_count;
+    bool exclusive;  //touch the dentries of the other data threads
+    SFVersionRange data_version;
+    struct fdir_binlog_record *carrier;  //dispatched to the data thread
+    struct server_binlog_record_buffer *rbuffer;
+    ServerCompoundOp *ops;
+    char *body;  //the copy of the request body
+} ServerCompoundContext;
+
 typedef struct server_task_arg {
     int64_t req_start_time;
 
@@ -245,11 +393,14 @@ typedef struct server_task_arg {
 
         struct {
             struct {
-                FDIRServerDentryArray array;
-                int64_t token;
-                int offset;
-                time_t expires;  //expire time
-            } dentry_list_cache; //for dentry_list
+                int64_t inode;  //0 when no more dentries to push
+                uint16_t token; //changed by each new list
+                unsigned char name_len;
+                char name_buff[NAME_MAX];  //the last name pushed
+            } list_stream;  //for streaming list
+
+            int64_t epoch;  //the epoch entered by the request
+            ServerCompoundContext *compound;  //for compound request
 
             struct fc_list_head ftasks;  //for flock
             struct sys_lock_task *sys_lock_task; //for append and ftruncate
@@ -257,7 +408,17 @@ typedef struct server_task_arg {
             struct idempotency_request *idempotency_request;
             struct fdir_binlog_record *record;
             struct server_binlog_record_buffer *rbuffer;
-            volatile int waiting_rpc_count;
+
+            struct {
+                int64_t min_data_version;  //for the next read request
+                //the read request waiting for the data version
+                int (*query_func)(struct fast_task_info *task);
+                bool is_update;
+                bool resp_data_version;  //joined with the flag
+                int64_t data_version;  //of the update, 0 for unknown
+            } read_version;  //for read-your-writes
+
+            bool load_counted;  //the request counted in flight
         } service;
 
     } context;
@@ -270,6 +431,7 @@ typedef struct fdir_server_context {
         struct {
             struct fast_mblock_man record_allocator;
             struct fast_mblock_man request_allocator; //for idempotency_request
+            struct fdir_epoch_reader *epoch_reader;
         } service;
 
         struct {
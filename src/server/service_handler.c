@@ -47,12 +47,17 @@
 #include "server_global.h"
 #include "server_func.h"
 #include "dentry.h"
+#include "dentry_children.h"
 #include "inode_index.h"
+#include "path_cache.h"
+#include "epoch_reclaim.h"
+#include "data_checkpoint.h"
 #include "cluster_relationship.h"
+#include "version_waiter.h"
+#include "load_stat.h"
 #include "common_handler.h"
 #include "service_handler.h"
 
-static volatile int64_t next_token = 0;   //next token for dentry list
 static int64_t dstat_mflags_mask = 0;
 
 typedef int (*deal_task_func)(struct fast_task_info *task);
@@ -71,8 +76,6 @@ int service_handler_init()
     mask.size = 1;
     dstat_mflags_mask = mask.flags;
 
-    next_token = ((int64_t)g_current_time) << 32;
-
     return idempotency_channel_init(SF_IDEMPOTENCY_MAX_CHANNEL_ID,
             SF_IDEMPOTENCY_DEFAULT_REQUEST_HINT_CAPACITY,
             SF_IDEMPOTENCY_DEFAULT_CHANNEL_RESERVE_INTERVAL,
@@ -84,6 +87,21 @@ int service_handler_destroy()
     return 0;
 }
 
+static inline void service_enter_epoch(struct fast_task_info *task)
+{
+    if (TASK_EPOCH == FDIR_EPOCH_NONE) {
+        TASK_EPOCH = epoch_reclaim_enter(SERVER_CTX->service.epoch_reader);
+    }
+}
+
+static inline void service_leave_epoch(struct fast_task_info *task)
+{
+    if (TASK_EPOCH != FDIR_EPOCH_NONE) {
+        epoch_reclaim_leave(SERVER_CTX->service.epoch_reader, TASK_EPOCH);
+        TASK_EPOCH = FDIR_EPOCH_NONE;
+    }
+}
+
 static inline void release_flock_task(struct fast_task_info *task,
         FLockTask *flck)
 {
@@ -93,6 +111,11 @@ static inline void release_flock_task(struct fast_task_info *task,
 
 void service_task_finish_cleanup(struct fast_task_info *task)
 {
+    if (TASK_ARG->context.service.load_counted) {
+        TASK_ARG->context.service.load_counted = false;
+        load_stat_request_end(0);
+    }
+
     switch (SERVER_TASK_TYPE) {
         case SF_SERVER_TASK_TYPE_CHANNEL_HOLDER:
         case SF_SERVER_TASK_TYPE_CHANNEL_USER:
@@ -133,7 +156,10 @@ void service_task_finish_cleanup(struct fast_task_info *task)
         SYS_LOCK_TASK = NULL;
     }
 
-    dentry_array_free(&DENTRY_LIST_CACHE.array);
+    LIST_STREAM.inode = 0;
+    READ_VERSION_CTX.min_data_version = 0;
+    READ_VERSION_CTX.resp_data_version = false;
+    service_leave_epoch(task);
     sf_task_finish_clean_up(task);
 }
 
@@ -175,6 +201,8 @@ static int service_deal_client_join(struct fast_task_info *task)
 
         SERVER_TASK_TYPE = SF_SERVER_TASK_TYPE_CHANNEL_USER;
     }
+    READ_VERSION_CTX.resp_data_version = (flags &
+            FDIR_CLIENT_JOIN_FLAGS_UPDATE_DATA_VERSION) != 0;
 
     join_resp = (FDIRProtoClientJoinResp *)REQUEST.body;
     int2buff(g_sf_global_vars.min_buff_size - 128,
@@ -189,6 +217,9 @@ static int service_deal_service_stat(struct fast_task_info *task)
 {
     int result;
     FDIRDentryCounters counters;
+    FDIRInodeIndexStat inode_stat;
+    FDIRPathCacheStat path_stat;
+    FDIRNameInternStat intern_stat;
     FDIRProtoServiceStatResp *stat_resp;
 
     if ((result=server_expect_body_length(task, 0)) != 0) {
@@ -196,6 +227,9 @@ static int service_deal_service_stat(struct fast_task_info *task)
     }
 
     data_thread_sum_counters(&counters);
+    inode_index_get_stat(&inode_stat);
+    path_cache_get_stat(&path_stat);
+    data_thread_get_name_intern_stat(&intern_stat);
     stat_resp = (FDIRProtoServiceStatResp *)REQUEST.body;
 
     stat_resp->is_master = (CLUSTER_MYSELF_PTR ==
@@ -211,6 +245,24 @@ static int service_deal_service_stat(struct fast_task_info *task)
     long2buff(counters.dir, stat_resp->dentry.counters.dir);
     long2buff(counters.file, stat_resp->dentry.counters.file);
 
+    long2buff(inode_stat.capacity, stat_resp->inode_hashtable.capacity);
+    long2buff(inode_stat.count, stat_resp->inode_hashtable.count);
+    int2buff(inode_stat.max_chain_length,
+            stat_resp->inode_hashtable.max_chain_length);
+    stat_resp->inode_hashtable.resizing = inode_stat.resizing ? 1 : 0;
+
+    long2buff(path_stat.capacity, stat_resp->path_cache.capacity);
+    long2buff(path_stat.count, stat_resp->path_cache.count);
+    long2buff(path_stat.hit_count, stat_resp->path_cache.hit_count);
+    long2buff(path_stat.miss_count, stat_resp->path_cache.miss_count);
+
+    long2buff(intern_stat.count, stat_resp->name_intern.count);
+    long2buff(intern_stat.refer_count, stat_resp->name_intern.refer_count);
+    long2buff(intern_stat.saved_bytes, stat_resp->name_intern.saved_bytes);
+    long2buff(epoch_reclaim_current(), stat_resp->reclaim.epoch);
+    long2buff(data_thread_get_reclaim_waiting_count(),
+            stat_resp->reclaim.waiting_count);
+
     RESPONSE.header.body_len = sizeof(FDIRProtoServiceStatResp);
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_SERVICE_STAT_RESP;
     TASK_ARG->context.response_done = true;
@@ -235,6 +287,7 @@ static int service_deal_cluster_stat(struct fast_task_info *task)
             sizeof(FDIRProtoClusterStatRespBodyHeader));
 
     int2buff(CLUSTER_SERVER_ARRAY.count, body_header->count);
+    body_header->replica_ack_policy = REPLICA_ACK_POLICY;
 
     send = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
     for (cs=CLUSTER_SERVER_ARRAY.servers; cs<send; cs++, body_part++) {
@@ -246,6 +299,20 @@ static int service_deal_cluster_stat(struct fast_task_info *task)
                 SERVICE_GROUP_ADDRESS_FIRST_IP(cs->server));
         short2buff(SERVICE_GROUP_ADDRESS_FIRST_PORT(cs->server),
                 body_part->port);
+
+        long2buff(cs->ack_stat.acked_count,
+                body_part->replica_ack.acked_count);
+        long2buff(cs->ack_stat.satisfied_count,
+                body_part->replica_ack.satisfied_count);
+        long2buff(cs->ack_stat.late_count,
+                body_part->replica_ack.late_count);
+
+        long2buff(load_stat_get_lag_versions(cs),
+                body_part->replica_lag.data_versions);
+        int2buff(cs->replica_lag.delay_ms, body_part->replica_lag.delay_ms);
+        int2buff(__sync_add_and_fetch(&cs->load.in_flight, 0),
+                body_part->load.in_flight);
+        int2buff(cs->load.p99_latency_us, body_part->load.p99_latency_us);
     }
 
     RESPONSE.header.body_len = (char *)body_part - REQUEST.body;
@@ -259,8 +326,8 @@ static int service_deal_namespace_stat(struct fast_task_info *task)
     int result;
     int expect_blen;
     static int64_t mem_size = 0;
-    int64_t inode_used;
     int64_t inode_total;
+    FDIRNamespaceStat stat;
     string_t ns;
     FDIRProtoNamespaceStatReq *req;
     FDIRProtoNamespaceStatResp *resp;
@@ -292,12 +359,19 @@ static int service_deal_namespace_stat(struct fast_task_info *task)
             */
 
     inode_total = mem_size / 300;
-    inode_used = dentry_get_namespace_inode_count(&ns);
+    dentry_get_namespace_stat(&ns, &stat);
+    if (stat.quota.inodes > 0 && stat.quota.inodes < inode_total) {
+        inode_total = stat.quota.inodes;
+    }
 
     resp = (FDIRProtoNamespaceStatResp *)REQUEST.body;
     long2buff(inode_total, resp->inode_counters.total);
-    long2buff(inode_used, resp->inode_counters.used);
-    long2buff(inode_total - inode_used, resp->inode_counters.avail);
+    long2buff(stat.inode.used, resp->inode_counters.used);
+    long2buff(inode_total > stat.inode.used ? inode_total -
+            stat.inode.used : 0, resp->inode_counters.avail);
+    long2buff(stat.used_bytes, resp->used_bytes);
+    long2buff(stat.quota.inodes, resp->quota.inodes);
+    long2buff(stat.quota.bytes, resp->quota.bytes);
 
     RESPONSE.header.body_len = sizeof(FDIRProtoNamespaceStatResp);
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_NAMESPACE_STAT_RESP;
@@ -384,37 +458,51 @@ static int service_deal_get_slaves(struct fast_task_info *task)
     return 0;
 }
 
+/* weighted random by the replica lag and the load of the active servers,
+ * published by the ping of the master
+ */
 static FDIRClusterServerInfo *get_readable_server()
 {
-    int index;
-    int old_index;
-    int acc_index;
+    int64_t total;
+    int64_t target;
+    int64_t weight;
     FDIRClusterServerInfo *cs;
     FDIRClusterServerInfo *send;
+    FDIRClusterServerInfo *last;
 
-    index = rand() % CLUSTER_SERVER_ARRAY.count;
-    if (__sync_fetch_and_add(&CLUSTER_SERVER_ARRAY.servers[index].status, 0) ==
-            FDIR_SERVER_STATUS_ACTIVE)
-    {
-        return CLUSTER_SERVER_ARRAY.servers + index;
+    total = 0;
+    send = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
+    for (cs=CLUSTER_SERVER_ARRAY.servers; cs<send; cs++) {
+        if (__sync_fetch_and_add(&cs->status, 0) ==
+                FDIR_SERVER_STATUS_ACTIVE)
+        {
+            total += load_stat_get_weight(cs);
+        }
     }
 
-    acc_index = 0;
-    send = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
-    do {
-        old_index = acc_index;
-        for (cs=CLUSTER_SERVER_ARRAY.servers; cs<send; cs++) {
-            if (__sync_fetch_and_add(&cs->status, 0) ==
-                    FDIR_SERVER_STATUS_ACTIVE)
-            {
-                if (acc_index++ == index) {
-                    return cs;
-                }
-            }
+    if (total == 0) {
+        return NULL;
+    }
+
+    //the weight maybe changed since the first pass
+    last = NULL;
+    target = (((int64_t)rand() << 31) | rand()) % total;
+    for (cs=CLUSTER_SERVER_ARRAY.servers; cs<send; cs++) {
+        if (__sync_fetch_and_add(&cs->status, 0) !=
+                FDIR_SERVER_STATUS_ACTIVE)
+        {
+            continue;
+        }
+
+        weight = load_stat_get_weight(cs);
+        if (target < weight) {
+            return cs;
         }
-    } while (acc_index - old_index > 0);
+        target -= weight;
+        last = cs;
+    }
 
-    return NULL;
+    return last;
 }
 
 static int service_deal_get_readable_server(struct fast_task_info *task)
@@ -658,7 +746,14 @@ static int handle_replica_done(struct fast_task_info *task)
     service_idempotency_request_finish(task, 0);
 
     if (RBUFFER != NULL) {
-        result = push_to_binlog_write_queue(RBUFFER);
+        //the last task of the group writes the binlog
+        if (RBUFFER->group.count == 0 || __sync_sub_and_fetch(
+                    &RBUFFER->group.done_count, 1) == 0)
+        {
+            result = push_to_binlog_write_queue(RBUFFER);
+        } else {
+            result = 0;
+        }
         server_binlog_release_rbuffer(RBUFFER);
         RBUFFER = NULL;
     } else {
@@ -669,18 +764,32 @@ static int handle_replica_done(struct fast_task_info *task)
     return result;
 }
 
+static inline void push_to_producer_queue(ServerBinlogRecordBuffer *rbuffer)
+{
+    if (!rbuffer->wait_replica) {
+        //the task maybe done before the producer, released by the consumer
+        __sync_add_and_fetch(&rbuffer->reffer_count, 1);
+    }
+    binlog_push_to_producer_queue(rbuffer);
+}
+
 static inline int do_binlog_produce(struct fast_task_info *task,
         ServerBinlogRecordBuffer *rbuffer)
 {
     rbuffer->args = task;
+    rbuffer->wait_replica = REPLICA_WAIT_FOR_ACK;
     RBUFFER = rbuffer;
-    if (SLAVE_SERVER_COUNT > 0) {
+    READ_VERSION_CTX.data_version = rbuffer->data_version.last;
+    if (rbuffer->wait_replica) {
         task->continue_callback = handle_replica_done;
-        binlog_push_to_producer_queue(rbuffer);
+        push_to_producer_queue(rbuffer);
         return TASK_STATUS_CONTINUE;
-    } else {
-        return handle_replica_done(task);
     }
+
+    if (SLAVE_SERVER_COUNT > 0) {
+        push_to_producer_queue(rbuffer);
+    }
+    return handle_replica_done(task);
 }
 
 static int server_binlog_produce(struct fast_task_info *task)
@@ -709,6 +818,34 @@ static int server_binlog_produce(struct fast_task_info *task)
     }
 }
 
+//the rbuffer shared by the records of the group commit
+static int group_binlog_produce(struct fast_task_info *task)
+{
+    ServerBinlogRecordBuffer *rbuffer;
+
+    rbuffer = RECORD->notify.rbuffer;
+    rbuffer->group.tasks[RECORD->data_version -
+        rbuffer->data_version.first] = task;
+    READ_VERSION_CTX.data_version = RECORD->data_version;
+    free_record_object(task);
+
+    RBUFFER = rbuffer;
+    if (rbuffer->wait_replica) {
+        task->continue_callback = handle_replica_done;
+    }
+    if (SLAVE_SERVER_COUNT > 0 && __sync_sub_and_fetch(
+                &rbuffer->group.ready_count, 1) == 0)
+    {
+        push_to_producer_queue(rbuffer);
+    }
+
+    if (rbuffer->wait_replica) {
+        return TASK_STATUS_CONTINUE;
+    } else {
+        return handle_replica_done(task);
+    }
+}
+
 static inline void dstat_output(struct fast_task_info *task,
             const int64_t inode, const FDIRDEntryStatus *stat)
 {
@@ -725,7 +862,7 @@ static inline void dentry_stat_output(struct fast_task_info *task,
         FDIRServerDentry **dentry)
 {
     if (FDIR_IS_DENTRY_HARD_LINK((*dentry)->stat.mode)) {
-        *dentry = (*dentry)->src_dentry;
+        *dentry = (*dentry)->extra->src_dentry;
     }
     dstat_output(task, (*dentry)->inode, &(*dentry)->stat);
 }
@@ -753,7 +890,7 @@ static void record_deal_done_notify(FDIRBinlogRecord *record,
     if (result != 0) {
         int log_level;
 
-        if (is_error) {
+        if (is_error && result != EDQUOT) {
             log_level = LOG_ERR;
         } else {
             log_level = LOG_WARNING;
@@ -794,7 +931,11 @@ static int handle_record_deal_done(struct fast_task_info *task)
 
     task->continue_callback = NULL;
     if (RESPONSE_STATUS == 0) {
-        result = server_binlog_produce(task);
+        if (RECORD->notify.rbuffer != NULL) {
+            result = group_binlog_produce(task);
+        } else {
+            result = server_binlog_produce(task);
+        }
         need_release = false;
     } else {
         result = RESPONSE_STATUS;
@@ -815,6 +956,7 @@ static inline int push_record_to_data_thread_queue(struct fast_task_info *task)
 {
     RECORD->notify.func = record_deal_done_notify; //call by data thread
     RECORD->notify.args = task;
+    RECORD->notify.rbuffer = NULL;
 
     sf_hold_task(task);
     task->continue_callback = handle_record_deal_done;
@@ -864,30 +1006,36 @@ static int service_set_record_pname_info(struct fast_task_info *task,
 #define init_record_for_create(task, mode) \
     init_record_for_create_ex(task, mode, false)
 
-static void init_record_for_create_ex(struct fast_task_info *task,
+static void init_create_record(FDIRBinlogRecord *record,
+        const FDIRProtoCreateDEntryFront *front,
         const int mode, const bool is_hdlink)
 {
     int new_mode;
     if (is_hdlink) {
         new_mode = FDIR_SET_DENTRY_HARD_LINK((mode & (~S_IFMT)) |
-                (RECORD->hdlink.src_dentry->stat.mode & S_IFMT));
+                (record->hdlink.src_dentry->stat.mode & S_IFMT));
     } else {
         new_mode = FDIR_UNSET_DENTRY_HARD_LINK(mode);
     }
-    RECORD->stat.mode = new_mode;
-    RECORD->operation = BINLOG_OP_CREATE_DENTRY_INT;
-    RECORD->stat.uid = buff2int(((FDIRProtoCreateDEntryFront *)
-                REQUEST.body)->uid);
-    RECORD->stat.gid = buff2int(((FDIRProtoCreateDEntryFront *)
-                REQUEST.body)->gid);
-    RECORD->stat.size = 0;
-    RECORD->stat.atime = RECORD->stat.btime = RECORD->stat.ctime =
-        RECORD->stat.mtime = g_current_time;
-    RECORD->options.atime = RECORD->options.btime = RECORD->options.ctime =
-        RECORD->options.mtime = 1;
-    RECORD->options.mode = 1;
-    RECORD->options.uid = 1;
-    RECORD->options.gid = 1;
+    record->stat.mode = new_mode;
+    record->operation = BINLOG_OP_CREATE_DENTRY_INT;
+    record->stat.uid = buff2int(front->uid);
+    record->stat.gid = buff2int(front->gid);
+    record->stat.size = 0;
+    record->stat.atime = record->stat.btime = record->stat.ctime =
+        record->stat.mtime = g_current_time;
+    record->options.atime = record->options.btime = record->options.ctime =
+        record->options.mtime = 1;
+    record->options.mode = 1;
+    record->options.uid = 1;
+    record->options.gid = 1;
+}
+
+static inline void init_record_for_create_ex(struct fast_task_info *task,
+        const int mode, const bool is_hdlink)
+{
+    init_create_record(RECORD, (FDIRProtoCreateDEntryFront *)
+            REQUEST.body, mode, is_hdlink);
 }
 
 static int server_parse_dentry_for_update(struct fast_task_info *task,
@@ -1295,6 +1443,68 @@ static int service_deal_remove_by_pname(struct fast_task_info *task)
     return push_record_to_data_thread_queue(task);
 }
 
+static int service_deal_namespace_set_quota(struct fast_task_info *task)
+{
+    FDIRProtoNamespaceSetQuotaReq *req;
+    FDIRNamespaceQuota quota;
+    int result;
+
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_RESP;
+    if (!cluster_info_is_peer_ip(task->client_ip)) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "client %s is not a cluster peer, permission denied",
+                task->client_ip);
+        return EPERM;
+    }
+
+    if ((result=server_check_body_length(task,
+                    sizeof(FDIRProtoNamespaceSetQuotaReq) + 1,
+                    sizeof(FDIRProtoNamespaceSetQuotaReq) + NAME_MAX)) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoNamespaceSetQuotaReq *)REQUEST.body;
+    if (sizeof(FDIRProtoNamespaceSetQuotaReq) + req->ns_len !=
+            REQUEST.header.body_len)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d",
+                REQUEST.header.body_len, (int)sizeof(
+                    FDIRProtoNamespaceSetQuotaReq) + req->ns_len);
+        return EINVAL;
+    }
+
+    quota.inodes = buff2long(req->quota.inodes);
+    quota.bytes = buff2long(req->quota.bytes);
+    if (quota.inodes < 0 || quota.bytes < 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "invalid quota, inodes: %"PRId64", bytes: %"PRId64,
+                quota.inodes, quota.bytes);
+        return EINVAL;
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    RECORD->ns.str = req->ns_str;
+    RECORD->ns.len = req->ns_len;
+    RECORD->me.pname.name.str = "";
+    RECORD->me.pname.name.len = 0;
+    RECORD->me.parent = NULL;
+    RECORD->me.dentry = NULL;
+    if ((result=service_set_record_pname_info(task,
+                    sizeof(FDIRProtoStatDEntryResp))) != 0)
+    {
+        return result;
+    }
+
+    RECORD->quota = quota;
+    RECORD->operation = BINLOG_OP_SET_QUOTA_INT;
+    return push_record_to_data_thread_queue(task);
+}
+
 static int set_rename_src_by_dentry(struct fast_task_info *task,
         FDIRServerDentry *dentry)
 {
@@ -1475,6 +1685,33 @@ static int service_deal_stat_dentry_by_path(struct fast_task_info *task)
     return 0;
 }
 
+static int service_deal_dentry_usage_by_path(struct fast_task_info *task)
+{
+    int result;
+    FDIRDEntryFullName fullname;
+    FDIRServerDentry *dentry;
+    FDIRDEntryUsage usage;
+    FDIRProtoDEntryUsageResp *resp;
+
+    if ((result=server_check_and_parse_dentry(task, 0, &fullname)) != 0) {
+        return result;
+    }
+
+    if ((result=dentry_find(&fullname, &dentry)) != 0) {
+        return result;
+    }
+
+    dentry_get_usage(dentry, &usage);
+    resp = (FDIRProtoDEntryUsageResp *)REQUEST.body;
+    long2buff(usage.file_count, resp->file_count);
+    long2buff(usage.dir_count, resp->dir_count);
+    long2buff(usage.bytes, resp->bytes);
+    RESPONSE.header.body_len = sizeof(FDIRProtoDEntryUsageResp);
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_RESP;
+    TASK_ARG->context.response_done = true;
+    return 0;
+}
+
 static int readlink_output(struct fast_task_info *task,
         FDIRServerDentry *dentry, const int resp_cmd)
 {
@@ -1486,8 +1723,8 @@ static int readlink_output(struct fast_task_info *task,
     }
 
     RESPONSE.header.cmd = resp_cmd;
-    RESPONSE.header.body_len = dentry->link.len;
-    memcpy(REQUEST.body, dentry->link.str, dentry->link.len);
+    RESPONSE.header.body_len = dentry->extra->link.len;
+    memcpy(REQUEST.body, dentry->extra->link.str, dentry->extra->link.len);
     TASK_ARG->context.response_done = true;
     return 0;
 }
@@ -1702,9 +1939,8 @@ static FDIRServerDentry *do_set_dentry_size(FDIRBinlogRecord *record,
     FDIRServerDentry *dentry;
 
     if ((dentry=inode_index_check_set_dentry_size(dsize,
-                    need_lock, modified_flags)) == NULL)
+                    need_lock, modified_flags, result)) == NULL)
     {
-        *result = ENOENT;
         return NULL;
     }
 
@@ -1751,14 +1987,17 @@ static FDIRServerDentry *set_dentry_size(
         return NULL;
     }
 
+    data_checkpoint_update_begin();
     dentry = do_set_dentry_size(RECORD, ns_str, ns_len,
             dsize, need_lock, result, &modified_flags);
     if (dentry == NULL || modified_flags == 0) {
+        data_checkpoint_update_end();
         free_record_object(task);
         return dentry;
     }
 
     *result = binlog_produce_directly(task);
+    data_checkpoint_update_end();
     return dentry;
 }
 
@@ -1875,6 +2114,7 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
     rbody = (FDIRProtoBatchSetDentrySizeReqBody *)
         (rheader->ns_str + rheader->ns_len);
     rbend = rbody + count;
+    data_checkpoint_update_begin();
     for (; rbody < rbend; rbody++) {
         SERVICE_UNPACK_DENTRY_SIZE_INFO(dsize, rbody);
 
@@ -1883,6 +2123,7 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
                     &((FDIRServerContext *)task->thread_data->arg)->
                     service.record_allocator);
             if (*record == NULL) {
+                data_checkpoint_update_end();
                 RESPONSE.error.length = sprintf(
                         RESPONSE.error.message,
                         "system busy, please try later");
@@ -1901,6 +2142,7 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
     record_count = recend - records;
     rbuffer->data_version.last = __sync_add_and_fetch(
                 &DATA_CURRENT_VERSION, record_count);
+    data_checkpoint_update_end();
     rbuffer->data_version.first = rbuffer->
         data_version.last - record_count + 1;
     current_version = rbuffer->data_version.first;
@@ -1954,14 +2196,18 @@ static FDIRServerDentry *modify_dentry_stat(struct fast_task_info *task,
     RECORD->hash_code = simple_hash(ns_str, ns_len);
     RECORD->operation = BINLOG_OP_UPDATE_DENTRY_INT;
 
-    if ((dentry=inode_index_update_dentry(RECORD)) == NULL) {
+    data_checkpoint_update_begin();
+    if ((dentry=inode_index_update_dentry_ex(RECORD,
+                    true, result)) == NULL)
+    {
+        data_checkpoint_update_end();
         free_record_object(task);
-        *result = ENOENT;
         return NULL;
     }
 
     RECORD->me.dentry = dentry;
     *result = binlog_produce_directly(task);
+    data_checkpoint_update_end();
     return dentry;
 }
 
@@ -2029,113 +2275,813 @@ static int service_deal_modify_dentry_stat(struct fast_task_info *task)
     return result;
 }
 
-static inline int service_check_master(struct fast_task_info *task)
+static int compound_parse_dentry(struct fast_task_info *task,
+        ServerCompoundOp *op, char *body, const int body_len,
+        const int front_part_size)
 {
-    if (CLUSTER_MYSELF_PTR != CLUSTER_MASTER_ATOM_PTR) {
-        RESPONSE.error.length = sprintf(
-                RESPONSE.error.message,
-                "i am not master");
-        return SF_RETRIABLE_ERROR_NOT_MASTER;
-    }
+    FDIRDEntryFullName fullname;
+    int fixed_part_size;
+    int result;
 
-    return 0;
-}
+    fixed_part_size = front_part_size + sizeof(FDIRProtoDEntryInfo);
+    if (body_len < fixed_part_size + 2) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, body length: %d is too small",
+                op->cmd, body_len);
+        return EINVAL;
+    }
 
-static inline int service_check_readable(struct fast_task_info *task)
-{
-    if (__sync_fetch_and_add(&CLUSTER_MYSELF_PTR->status, 0) !=
-                FDIR_SERVER_STATUS_ACTIVE)
+    if ((result=server_parse_dentry_info(task, body +
+                    front_part_size, &fullname)) != 0)
     {
-        RESPONSE.error.length = sprintf(
-                RESPONSE.error.message,
-                "i am not active");
-        return SF_RETRIABLE_ERROR_NOT_ACTIVE;
+        return result;
+    }
+
+    if (fixed_part_size + fullname.ns.len + fullname.path.len != body_len) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, body length: %d != expected: %d", op->cmd,
+                body_len, fixed_part_size + fullname.ns.len +
+                fullname.path.len);
+        return EINVAL;
     }
 
+    op->record->ns = fullname.ns;
+    op->path = fullname.path;
     return 0;
 }
 
-static int service_process_update(struct fast_task_info *task,
-        deal_task_func real_update_func, const int resp_cmd)
+static int compound_parse_pname(struct fast_task_info *task,
+        ServerCompoundOp *op, char *body, const int body_len,
+        const int front_part_size)
 {
+    FDIRProtoDEntryByPName *req;
+    int fixed_part_size;
     int result;
-    bool deal_done;
 
-    if ((result=service_check_master(task)) != 0) {
-        return result;
+    fixed_part_size = front_part_size + sizeof(FDIRProtoDEntryByPName);
+    if (body_len < fixed_part_size + 2) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, body length: %d is too small",
+                op->cmd, body_len);
+        return EINVAL;
     }
 
-    result = service_update_prepare_and_check(task, resp_cmd, &deal_done);
-    if (result != 0 || deal_done) {
+    req = (FDIRProtoDEntryByPName *)(body + front_part_size);
+    if ((result=check_name_length(task, req->ns_len, "namespace")) != 0) {
+        return result;
+    }
+    if ((result=check_name_length(task, req->name_len, "path name")) != 0) {
         return result;
     }
 
-    if ((result=real_update_func(task)) != TASK_STATUS_CONTINUE) {
-        service_idempotency_request_finish(task, result);
+    if (fixed_part_size + req->ns_len + req->name_len != body_len) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, body length: %d != expected: %d", op->cmd,
+                body_len, fixed_part_size + req->ns_len + req->name_len);
+        return EINVAL;
     }
 
-    return result;
+    op->record->ns.len = req->ns_len;
+    op->record->ns.str = req->ns_str;
+    op->record->me.pname.parent_inode = buff2long(req->parent_inode);
+    op->record->me.pname.name.len = req->name_len;
+    op->record->me.pname.name.str = req->ns_str + req->ns_len;
+    return 0;
 }
 
-static int compare_flock_task(FLockTask *flck, const FlockOwner *owner,
-        const int64_t inode, const int64_t offset, const int64_t length)
+static int compound_parse_ns(struct fast_task_info *task,
+        ServerCompoundOp *op, const int body_len,
+        const int fixed_part_size, char *ns_str, const int ns_len)
 {
-    int sub;
-    if ((sub=fc_compare_int64(flck->owner.id, owner->id)) != 0) {
-        return sub;
-    }
-
-    if ((sub=fc_compare_int64(flck->dentry->inode, inode)) != 0) {
-        return sub;
-    }
-
-    if ((sub=fc_compare_int64(flck->region->offset, offset)) != 0) {
-        return sub;
+    if (ns_len <= 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, namespace length: %d is invalid which <= 0",
+                op->cmd, ns_len);
+        return EINVAL;
     }
-
-    if ((sub=fc_compare_int64(flck->region->length, length)) != 0) {
-        return sub;
+    if (fixed_part_size + ns_len != body_len) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cmd: %d, body length: %d != expected: %d",
+                op->cmd, body_len, fixed_part_size + ns_len);
+        return EINVAL;
     }
 
+    op->record->ns.len = ns_len;
+    op->record->ns.str = ns_str;
     return 0;
 }
 
-static int flock_unlock_dentry(struct fast_task_info *task,
-        const FlockOwner *owner, const int64_t inode, const int64_t offset,
-        const int64_t length)
+static int compound_parse_op(struct fast_task_info *task,
+        ServerCompoundOp *op, char *body, const int body_len)
 {
-    FLockTask *flck;
-    fc_list_for_each_entry(flck, FTASK_HEAD_PTR, clink) {
-
-        /*
-        logInfo("==type: %d, which_queue: %d, inode: %"PRId64", "
-                "offset: %"PRId64", length: %"PRId64", "
-                "owner.id: %"PRId64", owner.pid: %d",
-                flck->type, flck->which_queue, flck->dentry->inode,
-                flck->region->offset, flck->region->length,
-                flck->owner.id, flck->owner.pid);
-                */
-
-        if (flck->which_queue != FDIR_FLOCK_TASK_IN_LOCKED_QUEUE) {
-            continue;
-        }
+    FDIRBinlogRecord *record;
+    FDIRProtoStatDEntryByPNameReq *pname_req;
+    FDIRProtoSetDentrySizeReq *size_req;
+    FDIRProtoModifyDentryStatReq *stat_req;
+    int result;
 
-        if (compare_flock_task(flck, owner, inode, offset, length) == 0) {
-            release_flock_task(task, flck);
+    record = op->record;
+    record->inode = record->data_version = 0;
+    record->operation = BINLOG_OP_NONE_INT;
+    record->options.flags = 0;
+    record->me.pname.parent_inode = 0;
+    record->me.parent = record->me.dentry = NULL;
+    record->ns.len = 0;
+
+    switch (op->cmd) {
+        case FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ:
+        case FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ:
+            if (op->cmd == FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ) {
+                result = compound_parse_dentry(task, op, body, body_len,
+                        sizeof(FDIRProtoCreateDEntryFront));
+            } else {
+                result = compound_parse_pname(task, op, body, body_len,
+                        sizeof(FDIRProtoCreateDEntryFront));
+            }
+            if (result != 0) {
+                return result;
+            }
+            record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+            init_create_record(record, (FDIRProtoCreateDEntryFront *)body,
+                    buff2int(((FDIRProtoCreateDEntryFront *)body)->mode),
+                    false);
+            break;
+        case FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ:
+        case FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ:
+            if (op->cmd == FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ) {
+                result = compound_parse_dentry(task, op, body, body_len, 0);
+            } else {
+                result = compound_parse_pname(task, op, body, body_len, 0);
+            }
+            if (result != 0) {
+                return result;
+            }
+            record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+            record->operation = BINLOG_OP_REMOVE_DENTRY_INT;
+            break;
+        case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
+            return compound_parse_dentry(task, op, body, body_len, 0);
+        case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
+            if (body_len != 8) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "cmd: %d, body length: %d != expected: 8",
+                        op->cmd, body_len);
+                return EINVAL;
+            }
+            record->inode = buff2long(body);
             return 0;
-        }
+        case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
+            pname_req = (FDIRProtoStatDEntryByPNameReq *)body;
+            if (body_len <= sizeof(FDIRProtoStatDEntryByPNameReq) ||
+                    sizeof(FDIRProtoStatDEntryByPNameReq) +
+                    pname_req->name_len != body_len)
+            {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "cmd: %d, invalid body length: %d",
+                        op->cmd, body_len);
+                return EINVAL;
+            }
+            record->me.pname.parent_inode = buff2long(
+                    pname_req->parent_inode);
+            record->me.pname.name.len = pname_req->name_len;
+            record->me.pname.name.str = pname_req->name_str;
+            return 0;
+        case FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ:
+            size_req = (FDIRProtoSetDentrySizeReq *)body;
+            if (body_len <= sizeof(FDIRProtoSetDentrySizeReq)) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "cmd: %d, body length: %d is too small",
+                        op->cmd, body_len);
+                return EINVAL;
+            }
+            if ((result=compound_parse_ns(task, op, body_len,
+                            sizeof(FDIRProtoSetDentrySizeReq),
+                            size_req->ns_str, size_req->ns_len)) != 0)
+            {
+                return result;
+            }
+            SERVICE_UNPACK_DENTRY_SIZE_INFO(op->dsize, size_req);
+            break;
+        case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
+            stat_req = (FDIRProtoModifyDentryStatReq *)body;
+            if (body_len <= sizeof(FDIRProtoModifyDentryStatReq)) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "cmd: %d, body length: %d is too small",
+                        op->cmd, body_len);
+                return EINVAL;
+            }
+            if ((result=compound_parse_ns(task, op, body_len,
+                            sizeof(FDIRProtoModifyDentryStatReq),
+                            stat_req->ns_str, stat_req->ns_len)) != 0)
+            {
+                return result;
+            }
+            record->inode = buff2long(stat_req->inode);
+            record->options.flags = (buff2long(stat_req->mflags) &
+                    dstat_mflags_mask);
+            if (record->options.flags == 0) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "cmd: %d, invalid flags: %"PRId64, op->cmd,
+                        (int64_t)buff2long(stat_req->mflags));
+                return EINVAL;
+            }
+            fdir_proto_unpack_dentry_stat(&stat_req->stat, &record->stat);
+            record->operation = BINLOG_OP_UPDATE_DENTRY_INT;
+            break;
+        default:
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "unsupported cmd: %d (%s) in compound request",
+                    op->cmd, fdir_get_cmd_caption(op->cmd));
+            return EINVAL;
     }
 
-    return ENOENT;
+    record->hash_code = simple_hash(record->ns.str, record->ns.len);
+    return 0;
 }
 
-static int service_deal_flock_dentry(struct fast_task_info *task)
+static int compound_find_parent(FDIRBinlogRecord *record,
+        const string_t *path)
 {
-    FDIRProtoFlockDEntryReq *req;
-    FLockTask *ftask;
+    FDIRDEntryFullName fullname;
+    FDIRServerDentry *parent_dentry;
+    bool is_create;
     int result;
-    short type;
-    FlockOwner owner;
+
+    fullname.ns = record->ns;
+    fullname.path = *path;
+    is_create = (record->operation == BINLOG_OP_CREATE_DENTRY_INT);
+    parent_dentry = NULL;
+    if ((result=dentry_find_parent(&fullname, &parent_dentry,
+                    &record->me.pname.name)) != 0)
+    {
+        if (!(result == ENOENT && is_create)) {
+            return result;
+        }
+        if (!FDIR_IS_ROOT_PATH(fullname.path)) {
+            return result;
+        }
+    } else if (is_create && FDIR_IS_ROOT_PATH(fullname.path)) {
+        return EEXIST;
+    }
+
+    record->me.pname.parent_inode = (parent_dentry != NULL) ?
+        parent_dentry->inode : 0;
+    return 0;
+}
+
+//call by the data thread
+static FDIRServerDentry *compound_apply_op(FDIRDataThreadContext *thread_ctx,
+        ServerCompoundOp *op, int *result)
+{
+    FDIRDEntryFullName fullname;
+    FDIRServerDentry *dentry;
+    int modified_flags;
+
+    switch (op->cmd) {
+        case FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ:
+        case FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ:
+            //the parent maybe created by the former operation
+            if ((*result=compound_find_parent(op->record, &op->path)) != 0) {
+                return NULL;
+            }
+            //continue to apply the record
+        case FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ:
+        case FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ:
+            if ((*result=data_thread_apply_record(thread_ctx,
+                            op->record)) != 0)
+            {
+                return NULL;
+            }
+            op->changed = true;
+            return op->record->me.dentry;
+        case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
+            fullname.ns = op->record->ns;
+            fullname.path = op->path;
+            *result = dentry_find(&fullname, &dentry);
+            return (*result == 0) ? dentry : NULL;
+        case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
+            dentry = inode_index_get_dentry(op->record->inode);
+            break;
+        case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
+            dentry = inode_index_get_dentry_by_pname(op->record->
+                    me.pname.parent_inode, &op->record->me.pname.name);
+            break;
+        case FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ:
+            dentry = do_set_dentry_size(op->record, op->record->ns.str,
+                    op->record->ns.len, &op->dsize, true, result,
+                    &modified_flags);
+            op->changed = (dentry != NULL && modified_flags != 0);
+            return dentry;
+        case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
+            dentry = inode_index_update_dentry_ex(op->record,
+                    true, result);
+            op->record->me.dentry = dentry;
+            op->changed = (dentry != NULL);
+            return dentry;
+        default:
+            dentry = NULL;
+            break;
+    }
+
+    *result = (dentry != NULL) ? 0 : ENOENT;
+    return dentry;
+}
+
+static void compound_deal_notify(FDIRBinlogRecord *carrier,
+        const int result, const bool is_error)
+{
+    struct fast_task_info *task;
+    ServerCompoundContext *ctx;
+    ServerCompoundOp *op;
+    ServerCompoundOp *end;
+    FDIRDataThreadContext *thread_ctx;
+    FDIRProtoCompoundRespHeader *rheader;
+    FDIRProtoCompoundOpResult *op_result;
+    FDIRServerDentry *dentry;
+    int64_t data_version;
+    int op_errno;
+
+    task = (struct fast_task_info *)carrier->notify.args;
+    ctx = COMPOUND_CTX;
+    thread_ctx = data_thread_get_context(carrier);
+    if (ctx->exclusive) {
+        data_thread_exclusive_begin(thread_ctx);
+    }
+
+    rheader = (FDIRProtoCompoundRespHeader *)
+        (task->data + sizeof(FDIRProtoHeader));
+    int2buff(ctx->count, rheader->count);
+    memset(rheader->padding, 0, sizeof(rheader->padding));
+    op_result = (FDIRProtoCompoundOpResult *)(rheader + 1);
+    end = ctx->ops + ctx->count;
+    for (op=ctx->ops; op<end; op++, op_result++) {
+        memset(op_result, 0, sizeof(FDIRProtoCompoundOpResult));
+        if ((dentry=compound_apply_op(thread_ctx, op, &op_errno)) != NULL) {
+            if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+                dentry = dentry->extra->src_dentry;
+            }
+            long2buff(dentry->inode, op_result->dentry.inode);
+            fdir_proto_pack_dentry_stat_ex(&dentry->stat,
+                    &op_result->dentry.stat, true);
+        }
+        short2buff(op_errno, op_result->status);
+        if (op->changed) {
+            ctx->changed_count++;
+        }
+    }
+
+    //the versions of all the records are contiguous for one rbuffer
+    if (ctx->changed_count > 0) {
+        ctx->data_version.last = __sync_add_and_fetch(
+                &DATA_CURRENT_VERSION, ctx->changed_count);
+        ctx->data_version.first = ctx->data_version.last -
+            ctx->changed_count + 1;
+        data_version = ctx->data_version.first;
+        for (op=ctx->ops; op<end; op++) {
+            if (op->changed) {
+                op->record->data_version = data_version++;
+            }
+        }
+    }
+
+    if (ctx->exclusive) {
+        data_thread_exclusive_end(thread_ctx);
+    }
+
+    RESPONSE.header.body_len = sizeof(FDIRProtoCompoundRespHeader) +
+        sizeof(FDIRProtoCompoundOpResult) * ctx->count;
+    TASK_ARG->context.response_done = true;
+    RESPONSE_STATUS = 0;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+}
+
+static void compound_context_free(struct fast_task_info *task)
+{
+    ServerCompoundContext *ctx;
+    ServerCompoundOp *op;
+    ServerCompoundOp *end;
+
+    ctx = COMPOUND_CTX;
+    end = ctx->ops + ctx->count;
+    for (op=ctx->ops; op<end; op++) {
+        if (op->record != NULL) {
+            fast_mblock_free_object(&SERVER_CTX->service.
+                    record_allocator, op->record);
+        }
+    }
+    if (ctx->carrier != NULL) {
+        fast_mblock_free_object(&SERVER_CTX->service.
+                record_allocator, ctx->carrier);
+    }
+    if (ctx->rbuffer != NULL) {
+        server_binlog_free_rbuffer(ctx->rbuffer);
+    }
+
+    free(ctx);
+    COMPOUND_CTX = NULL;
+}
+
+static int handle_compound_done(struct fast_task_info *task)
+{
+    ServerCompoundContext *ctx;
+    ServerCompoundOp *op;
+    ServerCompoundOp *end;
+    ServerBinlogRecordBuffer *rbuffer;
+    int result;
+
+    task->continue_callback = NULL;
+    ctx = COMPOUND_CTX;
+    rbuffer = ctx->rbuffer;
+    result = 0;
+    end = ctx->ops + ctx->count;
+    for (op=ctx->ops; op<end; op++) {
+        if (op->changed) {
+            op->record->timestamp = g_current_time;
+            if ((result=binlog_pack_record(op->record,
+                            &rbuffer->buffer)) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    if (result == 0 && ctx->changed_count > 0) {
+        rbuffer->data_version = ctx->data_version;
+        ctx->rbuffer = NULL;
+        compound_context_free(task);
+        return do_binlog_produce(task, rbuffer);
+    }
+
+    compound_context_free(task);
+    service_idempotency_request_finish(task, result);
+    sf_release_task(task);
+    return result;
+}
+
+static int service_deal_compound(struct fast_task_info *task)
+{
+    FDIRProtoCompoundReqHeader *rheader;
+    FDIRProtoCompoundOpHeader *oheader;
+    ServerCompoundContext *ctx;
+    ServerCompoundOp *op;
+    ServerCompoundOp *end;
+    char *p;
+    char *body_end;
+    unsigned int hash_code;
+    bool has_update;
+    bool cross_ns;
+    int count;
+    int body_len;
+    int resp_len;
+    int bytes;
+    int result;
+
+    if ((result=server_check_min_body_length(task,
+                    sizeof(FDIRProtoCompoundReqHeader) +
+                    sizeof(FDIRProtoCompoundOpHeader))) != 0)
+    {
+        return result;
+    }
+
+    rheader = (FDIRProtoCompoundReqHeader *)REQUEST.body;
+    count = buff2int(rheader->count);
+    if (count <= 0 || count > FDIR_COMPOUND_MAX_OP_COUNT) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "count: %d is invalid which <= 0 or > %d",
+                count, FDIR_COMPOUND_MAX_OP_COUNT);
+        return EINVAL;
+    }
+
+    resp_len = sizeof(FDIRProtoHeader) + sizeof(FDIRProtoCompoundRespHeader)
+        + sizeof(FDIRProtoCompoundOpResult) * count;
+    if (READ_VERSION_CTX.resp_data_version) {
+        resp_len += sizeof(FDIRProtoUpdateRespTrailer);
+    }
+    if (resp_len > task->size) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "task pkg size: %d is too small", task->size);
+        return EOVERFLOW;
+    }
+
+    //the request body is overwritten by the response
+    bytes = sizeof(ServerCompoundContext) + sizeof(ServerCompoundOp) *
+        count + REQUEST.header.body_len;
+    if ((ctx=(ServerCompoundContext *)fc_malloc(bytes)) == NULL) {
+        return ENOMEM;
+    }
+    memset(ctx, 0, sizeof(ServerCompoundContext) +
+            sizeof(ServerCompoundOp) * count);
+    ctx->count = count;
+    ctx->ops = (ServerCompoundOp *)(ctx + 1);
+    ctx->body = (char *)(ctx->ops + count);
+    memcpy(ctx->body, REQUEST.body, REQUEST.header.body_len);
+    COMPOUND_CTX = ctx;
+
+    p = ctx->body + sizeof(FDIRProtoCompoundReqHeader);
+    body_end = ctx->body + REQUEST.header.body_len;
+    end = ctx->ops + count;
+    for (op=ctx->ops; op<end; op++) {
+        if (body_end - p < sizeof(FDIRProtoCompoundOpHeader)) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "body length: %d is too small for %d operations",
+                    REQUEST.header.body_len, count);
+            result = EINVAL;
+            break;
+        }
+
+        oheader = (FDIRProtoCompoundOpHeader *)p;
+        p += sizeof(FDIRProtoCompoundOpHeader);
+        op->cmd = oheader->cmd;
+        body_len = buff2int(oheader->body_len);
+        if (body_len < 0 || body_len > body_end - p) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "cmd: %d, invalid body length: %d",
+                    op->cmd, body_len);
+            result = EINVAL;
+            break;
+        }
+
+        op->record = (FDIRBinlogRecord *)fast_mblock_alloc_object(
+                &SERVER_CTX->service.record_allocator);
+        if (op->record == NULL) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "system busy, please try later");
+            result = EBUSY;
+            break;
+        }
+
+        if ((result=compound_parse_op(task, op, p, body_len)) != 0) {
+            break;
+        }
+        p += body_len;
+    }
+
+    if (result == 0 && p != body_end) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d", REQUEST.header.body_len,
+                (int)(p - ctx->body));
+        result = EINVAL;
+    }
+
+    if (result == 0) {
+        ctx->carrier = (FDIRBinlogRecord *)fast_mblock_alloc_object(
+                &SERVER_CTX->service.record_allocator);
+        if (ctx->carrier == NULL) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "system busy, please try later");
+            result = EBUSY;
+        } else if ((ctx->rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
+            result = ENOMEM;
+        }
+    }
+
+    if (result != 0) {
+        compound_context_free(task);
+        return result;
+    }
+
+    //the updates of the same namespace are dealt by the same data thread
+    has_update = cross_ns = false;
+    hash_code = 0;
+    for (op=ctx->ops; op<end; op++) {
+        if (op->record->ns.len == 0 || op->cmd ==
+                FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ)
+        {
+            continue;
+        }
+
+        if (!has_update) {
+            has_update = true;
+            hash_code = op->record->hash_code;
+        } else if (op->record->hash_code != hash_code) {
+            cross_ns = true;
+        }
+    }
+    ctx->exclusive = (has_update && g_data_thread_vars.thread_array.
+            count > 1 && (cross_ns || DATA_DISPATCH_MODE ==
+                FDIR_DATA_DISPATCH_MODE_PARENT));
+
+    ctx->carrier->operation = DATA_THREAD_OP_COMPOUND_INT;
+    ctx->carrier->hash_code = hash_code;
+    ctx->carrier->notify.func = compound_deal_notify; //call by data thread
+    ctx->carrier->notify.args = task;
+
+    sf_hold_task(task);
+    task->continue_callback = handle_compound_done;
+    push_to_data_thread_queue(ctx->carrier);
+    return TASK_STATUS_CONTINUE;
+}
+
+static inline int service_check_master(struct fast_task_info *task)
+{
+    if (CLUSTER_MYSELF_PTR != CLUSTER_MASTER_ATOM_PTR) {
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "i am not master");
+        return SF_RETRIABLE_ERROR_NOT_MASTER;
+    }
+
+    return 0;
+}
+
+static inline int service_check_readable(struct fast_task_info *task)
+{
+    if (__sync_fetch_and_add(&CLUSTER_MYSELF_PTR->status, 0) !=
+                FDIR_SERVER_STATUS_ACTIVE)
+    {
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "i am not active");
+        return SF_RETRIABLE_ERROR_NOT_ACTIVE;
+    }
+
+    return 0;
+}
+
+static int service_process_update(struct fast_task_info *task,
+        deal_task_func real_update_func, const int resp_cmd)
+{
+    int result;
+    bool deal_done;
+
+    if ((result=service_check_master(task)) != 0) {
+        return result;
+    }
+
+    READ_VERSION_CTX.is_update = true;
+    result = service_update_prepare_and_check(task, resp_cmd, &deal_done);
+    if (result != 0 || deal_done) {
+        return result;
+    }
+
+    if ((result=real_update_func(task)) != TASK_STATUS_CONTINUE) {
+        service_idempotency_request_finish(task, result);
+    }
+
+    return result;
+}
+
+static int handle_read_version_done(struct fast_task_info *task)
+{
+    task->continue_callback = NULL;
+    sf_release_task(task);
+    if (RESPONSE_STATUS != 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "wait data version timeout");
+        return RESPONSE_STATUS;
+    }
+
+    if ((RESPONSE_STATUS=service_check_readable(task)) != 0) {
+        return RESPONSE_STATUS;
+    }
+
+    return READ_VERSION_CTX.query_func(task);
+}
+
+/* the slave waits for the data version of the client's last update
+ * before the query, the data version set by the previous one-way request
+ */
+static int service_process_query(struct fast_task_info *task,
+        deal_task_func query_func)
+{
+    int64_t min_data_version;
+    int result;
+
+    if ((result=service_check_readable(task)) != 0) {
+        return result;
+    }
+
+    min_data_version = READ_VERSION_CTX.min_data_version;
+    if (min_data_version == 0) {
+        return query_func(task);
+    }
+
+    READ_VERSION_CTX.min_data_version = 0;
+    if (CLUSTER_MYSELF_PTR == CLUSTER_MASTER_ATOM_PTR ||
+            version_waiter_readable(min_data_version))
+    {
+        return query_func(task);
+    }
+
+    READ_VERSION_CTX.query_func = query_func;
+    service_leave_epoch(task);
+    sf_hold_task(task);
+    if ((result=version_waiter_add(task, min_data_version)) == 0) {
+        task->continue_callback = handle_read_version_done;
+        return TASK_STATUS_CONTINUE;
+    }
+
+    sf_release_task(task);
+    service_enter_epoch(task);
+    return (result == EEXIST ? query_func(task) : result);
+}
+
+static int service_deal_set_read_version(struct fast_task_info *task)
+{
+    FDIRProtoSetReadVersionReq *req;
+    int result;
+
+    TASK_ARG->context.need_response = false;
+    if ((result=server_expect_body_length(task,
+                    sizeof(FDIRProtoSetReadVersionReq))) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoSetReadVersionReq *)REQUEST.body;
+    READ_VERSION_CTX.min_data_version = buff2long(req->data_version);
+    return 0;
+}
+
+//the data version for the read-your-writes of the client
+static int update_resp_append_data_version(struct fast_task_info *task)
+{
+    FDIRProtoUpdateRespTrailer *trailer;
+    int64_t data_version;
+
+    if (!TASK_ARG->context.response_done) {
+        RESPONSE.header.body_len = 0;
+        TASK_ARG->context.response_done = true;
+    }
+    if (sizeof(FDIRProtoHeader) + RESPONSE.header.body_len +
+            sizeof(FDIRProtoUpdateRespTrailer) > task->size)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "task pkg size: %d is too small", task->size);
+        TASK_ARG->context.response_done = false;
+        return EOVERFLOW;
+    }
+
+    //the retried request, the version maybe larger than the real one
+    if ((data_version=READ_VERSION_CTX.data_version) == 0) {
+        data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
+    }
+    trailer = (FDIRProtoUpdateRespTrailer *)(task->data +
+            sizeof(FDIRProtoHeader) + RESPONSE.header.body_len);
+    long2buff(data_version, trailer->data_version);
+    RESPONSE.header.body_len += sizeof(FDIRProtoUpdateRespTrailer);
+    return 0;
+}
+
+static int compare_flock_task(FLockTask *flck, const FlockOwner *owner,
+        const int64_t inode, const int64_t offset, const int64_t length)
+{
+    int sub;
+    if ((sub=fc_compare_int64(flck->owner.id, owner->id)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->inode, inode)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->region->offset, offset)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->region->length, length)) != 0) {
+        return sub;
+    }
+
+    return 0;
+}
+
+static int flock_unlock_dentry(struct fast_task_info *task,
+        const FlockOwner *owner, const int64_t inode, const int64_t offset,
+        const int64_t length)
+{
+    FLockTask *flck;
+    fc_list_for_each_entry(flck, FTASK_HEAD_PTR, clink) {
+
+        /*
+        logInfo("==type: %d, which_queue: %d, inode: %"PRId64", "
+                "offset: %"PRId64", length: %"PRId64", "
+                "owner.id: %"PRId64", owner.pid: %d",
+                flck->type, flck->which_queue, flck->inode,
+                flck->region->offset, flck->region->length,
+                flck->owner.id, flck->owner.pid);
+                */
+
+        if (flck->which_queue != FDIR_FLOCK_TASK_IN_LOCKED_QUEUE) {
+            continue;
+        }
+
+        if (compare_flock_task(flck, owner, inode, offset, length) == 0) {
+            release_flock_task(task, flck);
+            return 0;
+        }
+    }
+
+    return ENOENT;
+}
+
+static int service_deal_flock_dentry(struct fast_task_info *task)
+{
+    FDIRProtoFlockDEntryReq *req;
+    FLockTask *ftask;
+    int result;
+    short type;
+    FlockOwner owner;
     int64_t inode;
     int64_t offset;
     int64_t length;
@@ -2202,7 +3148,13 @@ static int service_deal_flock_dentry(struct fast_task_info *task)
             */
 
     fc_list_add_tail(&ftask->clink, FTASK_HEAD_PTR);
-    return result == 0 ? 0 : TASK_STATUS_CONTINUE;
+    if (result == 0) {
+        return 0;
+    } else {
+        //don't block the reclaiming while waiting for the lock
+        service_leave_epoch(task);
+        return TASK_STATUS_CONTINUE;
+    }
 }
 
 static int service_deal_getlk_dentry(struct fast_task_info *task)
@@ -2280,16 +3232,25 @@ static int service_deal_getlk_dentry(struct fast_task_info *task)
     return result;
 }
 
-static void sys_lock_dentry_output(struct fast_task_info *task,
-        const FDIRServerDentry *dentry)
+static int sys_lock_dentry_output(struct fast_task_info *task,
+        const int64_t inode)
 {
+    FDIRServerDentry *dentry;
     FDIRProtoSysLockDEntryResp *resp;
-    resp = (FDIRProtoSysLockDEntryResp *)REQUEST.body;
 
+    //the lock holds the inode only, the dentry maybe removed
+    if ((dentry=inode_index_get_dentry(inode)) == NULL) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "inode %"PRId64" not exist", inode);
+        return ENOENT;
+    }
+
+    resp = (FDIRProtoSysLockDEntryResp *)REQUEST.body;
     long2buff(dentry->stat.size, resp->size);
     long2buff(dentry->stat.space_end, resp->space_end);
     RESPONSE.header.body_len = sizeof(FDIRProtoSysLockDEntryResp);
     TASK_ARG->context.response_done = true;
+    return 0;
 }
 
 static int handle_sys_lock_done(struct fast_task_info *task)
@@ -2312,14 +3273,11 @@ static int handle_sys_lock_done(struct fast_task_info *task)
     } else {
         /*
            logInfo("file: "__FILE__", line: %d, func: %s, "
-           "inode: %"PRId64", file size: %"PRId64,
-           __LINE__, __FUNCTION__,
-           sys_lock_task->dentry->inode,
-           sys_lock_task->dentry->stat.size);
+           "inode: %"PRId64, __LINE__, __FUNCTION__,
+           sys_lock_task->inode);
          */
 
-        sys_lock_dentry_output(task, sys_lock_task->dentry);
-        return 0;
+        return sys_lock_dentry_output(task, sys_lock_task->inode);
     }
 }
 
@@ -2340,7 +3298,7 @@ static int service_deal_sys_lock_dentry(struct fast_task_info *task)
     if (SYS_LOCK_TASK != NULL) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "sys lock already exist, locked inode: %"PRId64,
-                SYS_LOCK_TASK->dentry->inode);
+                SYS_LOCK_TASK->inode);
         return EEXIST;
     }
 
@@ -2362,26 +3320,27 @@ static int service_deal_sys_lock_dentry(struct fast_task_info *task)
         /*
         logInfo("file: "__FILE__", line: %d, func: %s, "
                 "locked for inode: %"PRId64", task: %p, sock: %d",
-                __LINE__, __FUNCTION__, SYS_LOCK_TASK->dentry->inode,
+                __LINE__, __FUNCTION__, SYS_LOCK_TASK->inode,
                 task, task->event.fd);
                 */
 
-        sys_lock_dentry_output(task, SYS_LOCK_TASK->dentry);
-        return 0;
+        return sys_lock_dentry_output(task, SYS_LOCK_TASK->inode);
     } else {
         /*
         logInfo("file: "__FILE__", line: %d, func: %s, "
                 "waiting lock for inode: %"PRId64", task: %p, "
                 "sock: %d", __LINE__, __FUNCTION__,
-                SYS_LOCK_TASK->dentry->inode, task, task->event.fd);
+                SYS_LOCK_TASK->inode, task, task->event.fd);
                 */
 
+        //don't block the reclaiming while waiting for the lock
+        service_leave_epoch(task);
         task->continue_callback = handle_sys_lock_done;
         return TASK_STATUS_CONTINUE;
     }
 }
 
-static void on_sys_lock_release(FDIRServerDentry *dentry, void *args)
+static void on_sys_lock_release(const int64_t inode, void *args)
 {
     struct fast_task_info *task;
     FDIRProtoSysUnlockDEntryReq *req;
@@ -2390,7 +3349,7 @@ static void on_sys_lock_release(FDIRServerDentry *dentry, void *args)
 
     task = (struct fast_task_info *)args;
     req = (FDIRProtoSysUnlockDEntryReq *)REQUEST.body;
-    dsize.inode = SYS_LOCK_TASK->dentry->inode;
+    dsize.inode = inode;
     dsize.file_size = buff2long(req->new_size);
     dsize.inc_alloc = buff2long(req->inc_alloc);
     dsize.flags = buff2int(req->flags);
@@ -2404,6 +3363,7 @@ static void on_sys_lock_release(FDIRServerDentry *dentry, void *args)
 static int service_deal_sys_unlock_dentry(struct fast_task_info *task)
 {
     FDIRProtoSysUnlockDEntryReq *req;
+    FDIRServerDentry *dentry;
     int result;
     int flags;
     int64_t inode;
@@ -2442,10 +3402,10 @@ static int service_deal_sys_unlock_dentry(struct fast_task_info *task)
     }
 
     inode = buff2long(req->inode);
-    if (inode != SYS_LOCK_TASK->dentry->inode) {
+    if (inode != SYS_LOCK_TASK->inode) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "sys lock check fail, req inode: %"PRId64", "
-                "expect: %"PRId64, inode, SYS_LOCK_TASK->dentry->inode);
+                "expect: %"PRId64, inode, SYS_LOCK_TASK->inode);
         return EINVAL;
     }
     flags = buff2int(req->flags);
@@ -2464,13 +3424,14 @@ static int service_deal_sys_unlock_dentry(struct fast_task_info *task)
         old_size = buff2long(req->old_size);
         new_size = buff2long(req->new_size);
         if ((flags & FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE) &&
-                old_size != SYS_LOCK_TASK->dentry->stat.size)
+                (dentry=inode_index_get_dentry(inode)) != NULL &&
+                old_size != dentry->stat.size)
         {
             logWarning("file: "__FILE__", line: %d, "
                     "client ip: %s, inode: %"PRId64", old size: %"PRId64
                     ", != current size: %"PRId64", maybe changed by others",
                     __LINE__, task->client_ip, inode, old_size,
-                    SYS_LOCK_TASK->dentry->stat.size);
+                    dentry->stat.size);
         }
         if (new_size < 0) {
             RESPONSE.error.length = sprintf(RESPONSE.error.message,
@@ -2504,82 +3465,145 @@ static int service_deal_sys_unlock_dentry(struct fast_task_info *task)
     }
 }
 
-static int server_list_dentry_output(struct fast_task_info *task)
+static inline bool server_list_dentry_pack(char **p, char *buf_end,
+        FDIRServerDentry *dentry)
 {
-    FDIRProtoListDEntryRespBodyHeader *body_header;
     FDIRServerDentry *src_dentry;
-    FDIRServerDentry **dentry;
-    FDIRServerDentry **start;
-    FDIRServerDentry **end;
     FDIRProtoListDEntryRespBodyPart *body_part;
+
+    if (buf_end - *p < sizeof(FDIRProtoListDEntryRespBodyPart) +
+            dentry->name.len)
+    {
+        return false;
+    }
+
+    src_dentry = FDIR_GET_REAL_DENTRY(dentry);
+    body_part = (FDIRProtoListDEntryRespBodyPart *)*p;
+    long2buff(src_dentry->inode, body_part->inode);
+    fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
+            &body_part->stat, true);
+    body_part->name_len = dentry->name.len;
+    memcpy(body_part->name_str, dentry->name.str, dentry->name.len);
+    *p += sizeof(FDIRProtoListDEntryRespBodyPart) + dentry->name.len;
+    return true;
+}
+
+/* list the children in the name order directly from the children index,
+ * the client lists the next page with the last name as the cursor,
+ * or pushes the stream credits to get the next pages by the saved cursor.
+ * the offset is for the old clients which list the next page by offset,
+ * the cursor is saved for the stream only when save_cursor is true
+ */
+static int server_list_dentry_output(struct fast_task_info *task,
+        FDIRServerDentry *dentry, const string_t *start_after,
+        const int offset, const bool save_cursor)
+{
+    FDIRProtoListDEntryRespBodyHeader *body_header;
+    FDIRServerDentry *child;
+    FDIRServerDentry *last;
+    FDIRChildrenIterator iterator;
     char *p;
     char *buf_end;
-    int remain_count;
     int count;
-
-    remain_count = DENTRY_LIST_CACHE.array.count -
-        DENTRY_LIST_CACHE.offset;
+    int i;
+    bool is_last;
 
     buf_end = task->data + task->size;
     p = REQUEST.body + sizeof(FDIRProtoListDEntryRespBodyHeader);
-    start = DENTRY_LIST_CACHE.array.entries +
-        DENTRY_LIST_CACHE.offset;
-    end = start + remain_count;
-    for (dentry=start; dentry<end; dentry++) {
-        src_dentry = FDIR_GET_REAL_DENTRY(*dentry);
-        if (buf_end - p < sizeof(FDIRProtoListDEntryRespBodyPart) +
-                (*dentry)->name.len)
-        {
-            break;
+    count = 0;
+    is_last = true;
+    last = NULL;
+    if (!S_ISDIR(dentry->stat.mode)) {
+        if (server_list_dentry_pack(&p, buf_end, dentry)) {
+            count++;
+        } else {
+            is_last = false;
+        }
+    } else if (dentry->children != NULL) {
+        if (start_after != NULL) {
+            dentry_children_iterator_ex(dentry->children,
+                    start_after, &iterator);
+        } else {
+            dentry_children_iterator(dentry->children, &iterator);
+        }
+
+        for (i=0; i<offset; i++) {
+            if (dentry_children_next(&iterator) == NULL) {
+                break;
+            }
+        }
+
+        while ((child=dentry_children_next(&iterator)) != NULL) {
+            if (!server_list_dentry_pack(&p, buf_end, child)) {
+                is_last = false;
+                break;
+            }
+            last = child;
+            count++;
         }
-        body_part = (FDIRProtoListDEntryRespBodyPart *)p;
-        long2buff(src_dentry->inode, body_part->inode);
+    }
+
+    if (!is_last) {
+        if (last == NULL) {  //the task buffer is too small for one entry
+            if (save_cursor) {
+                LIST_STREAM.inode = 0;
+            }
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "task buffer size: %d is too small for the list entry",
+                    task->size);
+            return EOVERFLOW;
+        }
+
 
-        fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
-                &body_part->stat, true);
-        body_part->name_len = (*dentry)->name.len;
-        memcpy(body_part->name_str, (*dentry)->name.str, (*dentry)->name.len);
-        p += sizeof(FDIRProtoListDEntryRespBodyPart) + (*dentry)->name.len;
+        if (save_cursor) {
+            LIST_STREAM.name_len = last->name.len;
+            memcpy(LIST_STREAM.name_buff, last->name.str, last->name.len);
+        }
+    }
+    if (save_cursor) {
+        LIST_STREAM.inode = is_last ? 0 : dentry->inode;
     }
-    count = dentry - start;
+
     RESPONSE.header.body_len = p - REQUEST.body;
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LIST_DENTRY_RESP;
 
     body_header = (FDIRProtoListDEntryRespBodyHeader *)REQUEST.body;
+    long2buff(dentry->inode, body_header->inode);
     int2buff(count, body_header->count);
-    if (count < remain_count) {
-        DENTRY_LIST_CACHE.offset += count;
-        DENTRY_LIST_CACHE.expires = g_current_time + 60;
-        DENTRY_LIST_CACHE.token = __sync_add_and_fetch(&next_token, 1);
-
-        body_header->is_last = 0;
-        long2buff(DENTRY_LIST_CACHE.token, body_header->token);
-    } else {
-        body_header->is_last = 1;
-        long2buff(0, body_header->token);
-    }
-
+    body_header->is_last = is_last;
+    body_header->padding = 0;
+    short2buff(save_cursor ? LIST_STREAM.token : 0,
+            body_header->stream_token);
     TASK_ARG->context.response_done = true;
     return 0;
 }
 
+/* a new list replaces the stream of the connection, the credits
+ * of the replaced stream are rejected by the token
+ */
+static inline int server_list_dentry_first(struct fast_task_info *task,
+        FDIRServerDentry *dentry)
+{
+    LIST_STREAM.token++;
+    return server_list_dentry_output(task, dentry, NULL, 0, true);
+}
+
 static int service_deal_list_dentry_by_path(struct fast_task_info *task)
 {
-    int result;
+    const bool hdlink_follow = false;
     FDIRDEntryFullName fullname;
+    FDIRServerDentry *dentry;
+    int result;
 
     if ((result=server_check_and_parse_dentry(task, 0, &fullname)) != 0) {
         return result;
     }
 
-    if ((result=dentry_list_by_path(&fullname,
-                    &DENTRY_LIST_CACHE.array)) != 0)
-    {
+    if ((result=dentry_find_ex(&fullname, &dentry, hdlink_follow)) != 0) {
         return result;
     }
 
-    DENTRY_LIST_CACHE.offset = 0;
-    return server_list_dentry_output(task);
+    return server_list_dentry_first(task, dentry);
 }
 
 static int service_deal_list_dentry_by_inode(struct fast_task_info *task)
@@ -2596,20 +3620,17 @@ static int service_deal_list_dentry_by_inode(struct fast_task_info *task)
         return ENOENT;
     }
 
-    if ((result=dentry_list(dentry, &DENTRY_LIST_CACHE.array)) != 0) {
-        return result;
-    }
-
-    DENTRY_LIST_CACHE.offset = 0;
-    return server_list_dentry_output(task);
+    return server_list_dentry_first(task, dentry);
 }
 
+//for the old clients, the token is the inode of the list response
 static int service_deal_list_dentry_next(struct fast_task_info *task)
 {
     FDIRProtoListDEntryNextBody *next_body;
-    int result;
+    FDIRServerDentry *dentry;
+    int64_t inode;
     int offset;
-    int64_t token;
+    int result;
 
     if ((result=server_expect_body_length(task,
                     sizeof(FDIRProtoListDEntryNextBody))) != 0)
@@ -2617,30 +3638,119 @@ static int service_deal_list_dentry_next(struct fast_task_info *task)
         return result;
     }
 
-    if (DENTRY_LIST_CACHE.expires < g_current_time) {
+    next_body = (FDIRProtoListDEntryNextBody *)REQUEST.body;
+    inode = buff2long(next_body->token);
+    offset = buff2int(next_body->offset);
+    if (offset <= 0) {
         RESPONSE.error.length = sprintf(
                 RESPONSE.error.message,
-                "dentry list cache expires, please try again");
-        return ETIMEDOUT;
+                "invalid next list offset: %d", offset);
+        return EINVAL;
     }
 
-    next_body = (FDIRProtoListDEntryNextBody *)REQUEST.body;
-    token = buff2long(next_body->token);
-    offset = buff2int(next_body->offset);
-    if (token != DENTRY_LIST_CACHE.token) {
+    if ((dentry=inode_index_get_dentry(inode)) == NULL) {
+        return ENOENT;
+    }
+    if (!S_ISDIR(dentry->stat.mode)) {
+        return ENOTDIR;
+    }
+
+    return server_list_dentry_output(task, dentry, NULL, offset, false);
+}
+
+static int service_deal_list_dentry_next_by_name(struct fast_task_info *task)
+{
+    FDIRProtoListDEntryNextByNameBody *next_body;
+    FDIRServerDentry *dentry;
+    char name_buff[NAME_MAX + 1];
+    string_t start_after;
+    int64_t inode;
+    int result;
+
+    if ((result=server_check_body_length(task,
+                    sizeof(FDIRProtoListDEntryNextByNameBody) + 1,
+                    sizeof(FDIRProtoListDEntryNextByNameBody) + NAME_MAX)) != 0)
+    {
+        return result;
+    }
+
+    next_body = (FDIRProtoListDEntryNextByNameBody *)REQUEST.body;
+    if (sizeof(FDIRProtoListDEntryNextByNameBody) + next_body->name_len !=
+            REQUEST.header.body_len)
+    {
         RESPONSE.error.length = sprintf(
                 RESPONSE.error.message,
-                "invalid token for next list");
+                "body length: %d != expect: %d",
+                REQUEST.header.body_len, (int)sizeof(
+                    FDIRProtoListDEntryNextByNameBody) + next_body->name_len);
         return EINVAL;
     }
-    if (offset != DENTRY_LIST_CACHE.offset) {
+
+    inode = buff2long(next_body->inode);
+    if ((dentry=inode_index_get_dentry(inode)) == NULL) {
+        return ENOENT;
+    }
+    if (!S_ISDIR(dentry->stat.mode)) {
+        return ENOTDIR;
+    }
+
+    //the request body is overwritten by the response
+    memcpy(name_buff, next_body->name_str, next_body->name_len);
+    FC_SET_STRING_EX(start_after, name_buff, next_body->name_len);
+    return server_list_dentry_output(task, dentry, &start_after, 0, false);
+}
+
+/* one credit for one response frame, the client keeps the credits of
+ * the flow control window in flight, so the pages are pushed continuously
+ * without waiting for the round trip, the credit after the last page
+ * gets an empty frame
+ */
+static int service_deal_list_dentry_stream(struct fast_task_info *task)
+{
+    FDIRProtoListDEntryStreamBody *stream_body;
+    FDIRProtoListDEntryRespBodyHeader *body_header;
+    FDIRServerDentry *dentry;
+    char name_buff[NAME_MAX + 1];
+    string_t start_after;
+    int token;
+    int result;
+
+    if ((result=server_expect_body_length(task,
+                    sizeof(FDIRProtoListDEntryStreamBody))) != 0)
+    {
+        return result;
+    }
+
+    stream_body = (FDIRProtoListDEntryStreamBody *)REQUEST.body;
+    token = (uint16_t)buff2short(stream_body->stream_token);
+    if (token != LIST_STREAM.token) {
         RESPONSE.error.length = sprintf(
                 RESPONSE.error.message,
-                "next list offset: %d != expected: %d",
-                offset, DENTRY_LIST_CACHE.offset);
-        return EINVAL;
+                "stream token: %d != current: %d, the stream "
+                "is replaced by a new list", token, LIST_STREAM.token);
+        return ESTALE;
+    }
+
+    if (LIST_STREAM.inode == 0) {
+        body_header = (FDIRProtoListDEntryRespBodyHeader *)REQUEST.body;
+        memset(body_header, 0, sizeof(*body_header));
+        body_header->is_last = 1;
+        short2buff(LIST_STREAM.token, body_header->stream_token);
+        RESPONSE.header.body_len = sizeof(*body_header);
+        RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LIST_DENTRY_RESP;
+        TASK_ARG->context.response_done = true;
+        return 0;
+    }
+
+    if ((dentry=inode_index_get_dentry(LIST_STREAM.inode)) == NULL) {
+        LIST_STREAM.inode = 0;
+        return ENOENT;
     }
-    return server_list_dentry_output(task);
+
+    //the saved cursor is overwritten by the output
+    memcpy(name_buff, LIST_STREAM.name_buff, LIST_STREAM.name_len);
+    FC_SET_STRING_EX(start_after, name_buff, LIST_STREAM.name_len);
+    return server_list_dentry_output(task, dentry, &start_after, 0, true);
 }
 
 int service_deal_task(struct fast_task_info *task, const int stage)
@@ -2658,6 +3768,8 @@ int service_deal_task(struct fast_task_info *task, const int stage)
 
     if (stage == SF_NIO_STAGE_CONTINUE) {
         if (task->continue_callback != NULL) {
+            //the lock waiters left the epoch before continue
+            service_enter_epoch(task);
             result = task->continue_callback(task);
         } else {
             result = RESPONSE_STATUS;
@@ -2669,6 +3781,15 @@ int service_deal_task(struct fast_task_info *task, const int stage)
         }
     } else {
         handler_init_task_context(task);
+        READ_VERSION_CTX.is_update = false;
+        READ_VERSION_CTX.data_version = 0;
+        if (!TASK_ARG->context.service.load_counted) {
+            TASK_ARG->context.service.load_counted = true;
+            load_stat_request_begin();
+        }
+
+        //the dentries accessed without lock until the response done
+        service_enter_epoch(task);
 
         switch (REQUEST.header.cmd) {
             case SF_PROTO_ACTIVE_TEST_REQ:
@@ -2743,60 +3864,73 @@ int service_deal_task(struct fast_task_info *task, const int stage)
                         service_deal_modify_dentry_stat,
                         FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP);
                 break;
+            case FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_REQ:
+                result = service_process_update(task,
+                        service_deal_namespace_set_quota,
+                        FDIR_SERVICE_PROTO_NAMESPACE_SET_QUOTA_RESP);
+                break;
+            case FDIR_SERVICE_PROTO_COMPOUND_REQ:
+                //the retried request responds without the op results
+                RESPONSE.header.cmd = FDIR_SERVICE_PROTO_COMPOUND_RESP;
+                result = service_process_update(task,
+                        service_deal_compound,
+                        FDIR_SERVICE_PROTO_COMPOUND_RESP);
+                break;
             case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_lookup_inode_by_path(task);
-                }
+                result = service_process_query(task,
+                        service_deal_lookup_inode_by_path);
                 break;
             case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_lookup_inode_by_pname(task);
-                }
+                result = service_process_query(task,
+                        service_deal_lookup_inode_by_pname);
                 break;
             case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_path(task);
-                }
+                result = service_process_query(task,
+                        service_deal_stat_dentry_by_path);
                 break;
             case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_inode(task);
-                }
+                result = service_process_query(task,
+                        service_deal_stat_dentry_by_inode);
                 break;
             case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_pname(task);
-                }
+                result = service_process_query(task,
+                        service_deal_stat_dentry_by_pname);
+                break;
+            case FDIR_SERVICE_PROTO_DENTRY_USAGE_BY_PATH_REQ:
+                result = service_process_query(task,
+                        service_deal_dentry_usage_by_path);
                 break;
             case FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_path(task);
-                }
+                result = service_process_query(task,
+                        service_deal_readlink_by_path);
                 break;
             case FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_pname(task);
-                }
+                result = service_process_query(task,
+                        service_deal_readlink_by_pname);
                 break;
             case FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_inode(task);
-                }
+                result = service_process_query(task,
+                        service_deal_readlink_by_inode);
                 break;
             case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_by_path(task);
-                }
+                result = service_process_query(task,
+                        service_deal_list_dentry_by_path);
                 break;
             case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_by_inode(task);
-                }
+                result = service_process_query(task,
+                        service_deal_list_dentry_by_inode);
                 break;
             case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_next(task);
-                }
+                result = service_process_query(task,
+                        service_deal_list_dentry_next);
+                break;
+            case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_BY_NAME_REQ:
+                result = service_process_query(task,
+                        service_deal_list_dentry_next_by_name);
+                break;
+            case FDIR_SERVICE_PROTO_LIST_DENTRY_STREAM_REQ:
+                result = service_process_query(task,
+                        service_deal_list_dentry_stream);
                 break;
             case FDIR_SERVICE_PROTO_FLOCK_DENTRY_REQ:
                 if ((result=service_check_master(task)) == 0) {
@@ -2836,6 +3970,9 @@ int service_deal_task(struct fast_task_info *task, const int stage)
             case FDIR_SERVICE_PROTO_GET_READABLE_SERVER_REQ:
                 result = service_deal_get_readable_server(task);
                 break;
+            case FDIR_SERVICE_PROTO_SET_READ_VERSION_REQ:
+                result = service_deal_set_read_version(task);
+                break;
             case SF_SERVICE_PROTO_SETUP_CHANNEL_REQ:
                 if ((result=sf_server_deal_setup_channel(task,
                                 &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL,
@@ -2868,6 +4005,18 @@ int service_deal_task(struct fast_task_info *task, const int stage)
     if (result == TASK_STATUS_CONTINUE) {
         return 0;
     } else {
+        service_leave_epoch(task);
+
+        if (result == 0 && READ_VERSION_CTX.is_update &&
+                READ_VERSION_CTX.resp_data_version)
+        {
+            result = update_resp_append_data_version(task);
+        }
+        if (TASK_ARG->context.service.load_counted) {
+            TASK_ARG->context.service.load_counted = false;
+            load_stat_request_end(get_current_time_us() -
+                    TASK_ARG->req_start_time);
+        }
         RESPONSE_STATUS = result;
         return handler_deal_task_done(task);
     }
@@ -2902,5 +4051,12 @@ void *service_alloc_thread_extra_data(const int thread_index)
         return NULL;
     }
 
+    if ((server_context->service.epoch_reader=
+                epoch_reclaim_alloc_reader()) == NULL)
+    {
+        free(server_context);
+        return NULL;
+    }
+
     return server_context;
 }
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/sched_thread.h"
+#include "sf/sf_nio.h"
+#include "sf/sf_global.h"
+#include "server_global.h"
+#include "version_waiter.h"
+
+typedef struct fdir_version_waiter_context {
+    FDIRVersionWaiter *head;
+    volatile int count;
+    pthread_mutex_t lock;
+    struct fast_mblock_man allocator;
+} FDIRVersionWaiterContext;
+
+static FDIRVersionWaiterContext waiter_ctx;
+
+//the caller MUST hold the lock
+static void notify_waiters(const int64_t data_version, const time_t now)
+{
+    FDIRVersionWaiter *previous;
+    FDIRVersionWaiter *waiter;
+    FDIRVersionWaiter *deleted;
+    struct fast_task_info *task;
+
+    previous = NULL;
+    waiter = waiter_ctx.head;
+    while (waiter != NULL) {
+        task = waiter->task;
+        if (waiter->data_version <= data_version) {
+            RESPONSE_STATUS = 0;
+        } else if (waiter->expires < now) {
+            RESPONSE_STATUS = ETIMEDOUT;
+        } else {
+            previous = waiter;
+            waiter = waiter->next;
+            continue;
+        }
+
+        deleted = waiter;
+        waiter = waiter->next;
+        if (previous == NULL) {
+            waiter_ctx.head = waiter;
+        } else {
+            previous->next = waiter;
+        }
+        fast_mblock_free_object(&waiter_ctx.allocator, deleted);
+        __sync_sub_and_fetch(&waiter_ctx.count, 1);
+
+        sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    }
+}
+
+static int clear_timeouts_func(void *args)
+{
+    if (__sync_add_and_fetch(&waiter_ctx.count, 0) == 0) {
+        return 0;
+    }
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    notify_waiters(__sync_add_and_fetch(&DATA_READABLE_VERSION, 0),
+            g_current_time);
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+    return 0;
+}
+
+static int setup_clear_timeouts_task()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, 1, clear_timeouts_func, NULL);
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
+
+int version_waiter_init()
+{
+    int result;
+
+    if ((result=init_pthread_lock(&waiter_ctx.lock)) != 0) {
+        return result;
+    }
+
+    if ((result=fast_mblock_init_ex1(&waiter_ctx.allocator,
+                    "version_waiter", sizeof(FDIRVersionWaiter),
+                    1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+
+    waiter_ctx.head = NULL;
+    waiter_ctx.count = 0;
+    return setup_clear_timeouts_task();
+}
+
+void version_waiter_destroy()
+{
+    fast_mblock_destroy(&waiter_ctx.allocator);
+    pthread_mutex_destroy(&waiter_ctx.lock);
+}
+
+int version_waiter_add(struct fast_task_info *task,
+        const int64_t data_version)
+{
+    FDIRVersionWaiter *waiter;
+    int result;
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    /* increase the count before checking the version, so the setter
+     * either sees the count or we see the new version
+     */
+    __sync_add_and_fetch(&waiter_ctx.count, 1);
+    if (version_waiter_readable(data_version)) {
+        result = EEXIST;  //reached after the caller checked
+    } else if ((waiter=fast_mblock_alloc_object(
+                    &waiter_ctx.allocator)) == NULL)
+    {
+        result = ENOMEM;
+    } else {
+        waiter->task = task;
+        waiter->data_version = data_version;
+        waiter->expires = g_current_time + READ_VERSION_WAIT_TIMEOUT;
+        waiter->next = waiter_ctx.head;
+        waiter_ctx.head = waiter;
+        result = 0;
+    }
+
+    if (result != 0) {
+        __sync_sub_and_fetch(&waiter_ctx.count, 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+
+    return result;
+}
+
+void version_waiter_set_readable(const int64_t data_version)
+{
+    int64_t old_version;
+
+    do {
+        old_version = __sync_add_and_fetch(&DATA_READABLE_VERSION, 0);
+        if (data_version <= old_version) {
+            break;
+        }
+    } while (!__sync_bool_compare_and_swap(&DATA_READABLE_VERSION,
+                old_version, data_version));
+
+    if (__sync_add_and_fetch(&waiter_ctx.count, 0) == 0) {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    notify_waiters(__sync_add_and_fetch(&DATA_READABLE_VERSION, 0),
+            g_current_time);
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+}
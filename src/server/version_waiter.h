@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//version_waiter.h
+
+#ifndef _VERSION_WAITER_H_
+#define _VERSION_WAITER_H_
+
+#include "fastcommon/fast_task_queue.h"
+#include "server_global.h"
+
+/* the read requests on the slave wait for the data version of
+ * the client's last update (read-your-writes)
+ */
+typedef struct fdir_version_waiter {
+    struct fast_task_info *task;
+    int64_t data_version;
+    time_t expires;
+    struct fdir_version_waiter *next;
+} FDIRVersionWaiter;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int version_waiter_init();
+void version_waiter_destroy();
+
+/* the task is notified with SF_NIO_STAGE_CONTINUE and RESPONSE_STATUS
+ * 0 when the readable version reached, or ETIMEDOUT
+ */
+int version_waiter_add(struct fast_task_info *task,
+        const int64_t data_version);
+
+//called after the records applied through data_version
+void version_waiter_set_readable(const int64_t data_version);
+
+static inline bool version_waiter_readable(const int64_t data_version)
+{
+    return data_version <= __sync_add_and_fetch(&DATA_READABLE_VERSION, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif